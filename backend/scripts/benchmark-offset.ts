@@ -0,0 +1,75 @@
+/**
+ * Compare calibration offset estimation on a 10 s, 48 kHz capture with a 1 s
+ * search window:
+ *
+ *   npm run bench:offset --workspace=backend
+ *
+ * Build the addon first (see docs/backend.md) to include the native row.
+ */
+import {
+  estimateAudioOffsetDirect,
+  estimateLatencyMsFromEnvelopes,
+} from '../src/utils/audioCorrelation';
+import { loadNativeAudio } from '../src/utils/nativeAudio';
+
+const SAMPLE_RATE = 48_000;
+const DELAY_SAMPLES = Math.round(SAMPLE_RATE * 0.0305);
+// Full-rate direct correlation takes minutes over the whole window, so only a
+// slice of lags around the answer is timed and its cost is reported per lag.
+const DIRECT_LAG_SLICE = 32;
+
+function time<T>(body: () => T): { result: T; ms: number } {
+  const start = process.hrtime.bigint();
+  const result = body();
+  return { result, ms: Number(process.hrtime.bigint() - start) / 1e6 };
+}
+
+function report(name: string, ms: number, offsetMs: number, lags: number): void {
+  console.log(
+    `${name.padEnd(34)}${ms.toFixed(1).padStart(10)} ms  ` +
+      `offset ${offsetMs.toFixed(3)} ms  ${(ms * 1_000 / lags).toFixed(2)} us/lag`
+  );
+}
+
+const reference = new Int16Array(SAMPLE_RATE * 10);
+const test = new Int16Array(reference.length + SAMPLE_RATE);
+let state = 0x12345678;
+for (let index = 0; index < reference.length; index++) {
+  state = (1664525 * state + 1013904223) >>> 0;
+  reference[index] = (state >>> 20) - 2_048;
+  test[index + DELAY_SAMPLES] = reference[index] >> 1;
+}
+
+const native = loadNativeAudio();
+console.log(
+  `Expected ${(DELAY_SAMPLES * 1_000 / SAMPLE_RATE).toFixed(3)} ms; ` +
+    `native addon ${native ? 'loaded' : 'not built'}`
+);
+
+const envelope = time(() =>
+  estimateLatencyMsFromEnvelopes(
+    { samples: reference, sampleRate: SAMPLE_RATE },
+    { samples: test, sampleRate: SAMPLE_RATE }
+  )
+);
+report('js onset envelope (2 kHz)', envelope.ms, envelope.result.offsetMs, 2 * 2_000 + 1);
+
+const direct = time(() =>
+  estimateAudioOffsetDirect(reference, test.subarray(DELAY_SAMPLES), DIRECT_LAG_SLICE)
+);
+report(
+  'js direct, full rate (lag slice)',
+  direct.ms,
+  (direct.result.offsetSamples + DELAY_SAMPLES) * 1_000 / SAMPLE_RATE,
+  2 * DIRECT_LAG_SLICE + 1
+);
+
+if (native) {
+  const fft = time(() => native.estimateAudioOffset(reference, test, SAMPLE_RATE));
+  report(
+    'native fft, full rate',
+    fft.ms,
+    fft.result.fractionalOffsetSamples * 1_000 / SAMPLE_RATE,
+    2 * SAMPLE_RATE + 1
+  );
+}
@@ -30,11 +30,17 @@ const mockDeleteMany = jest.fn().mockResolvedValue({ count: 0 });
 const mockTransaction = jest.fn();
 const mockMeasureLatencyMsForKeys = jest.fn().mockResolvedValue(42);
 const mockDeleteAudioFile = jest.fn().mockResolvedValue(undefined);
+const mockPrecomputePeaksForKey = jest.fn().mockResolvedValue('peaks/key.peaks');
 
 jest.mock('../../utils/latencyCalibration', () => ({
   measureLatencyMsForKeys: mockMeasureLatencyMsForKeys,
 }));
 
+jest.mock('../../utils/waveformPeaks', () => ({
+  ...jest.requireActual('../../utils/waveformPeaks'),
+  precomputePeaksForKey: mockPrecomputePeaksForKey,
+}));
+
 jest.mock('../../services/s3Service', () => {
   const actual = jest.requireActual('../../services/s3Service');
   return {
@@ -151,6 +157,7 @@ describe('Audio Routes', () => {
           parentId: null,
         },
       });
+      expect(mockPrecomputePeaksForKey).toHaveBeenCalledWith(mockAudioNode.audioUrl);
     });
 
     it('should return 400 if key is missing', async () => {
@@ -303,6 +310,23 @@ describe('Audio Routes', () => {
     });
   });
 
+  describe('GET /api/audio/peaks/:id', () => {
+    it('returns a presigned URL for the precomputed peaks', async () => {
+      const response = await request(app).get('/api/audio/peaks/audio-node-uuid');
+
+      expect(response.status).toBe(200);
+      expect(response.body.peaksUrl).toContain('peaks/test-uuid-1234-recording.webm.peaks');
+    });
+
+    it('returns 404 for an unknown node', async () => {
+      mockFindUnique.mockResolvedValueOnce(null);
+
+      const response = await request(app).get('/api/audio/peaks/missing');
+
+      expect(response.status).toBe(404);
+    });
+  });
+
   describe('POST /api/audio/calibrate', () => {
     it('converts local waveform delay into an absolute timeline offset', async () => {
       mockFindUnique
@@ -357,8 +381,9 @@ describe('Audio Routes', () => {
         isolationLevel: 'Serializable',
       });
       expect(mockDeleteMany).toHaveBeenCalledWith({ where: { id: { in: ['leaf-a'] } } });
-      expect(mockDeleteAudioFile).toHaveBeenCalledTimes(1);
+      expect(mockDeleteAudioFile).toHaveBeenCalledTimes(2);
       expect(mockDeleteAudioFile).toHaveBeenCalledWith('audio/leaf-a.wav');
+      expect(mockDeleteAudioFile).toHaveBeenCalledWith('peaks/leaf-a.wav.peaks');
     });
 
     it('rejects deleting a non-leaf as though it were one story', async () => {
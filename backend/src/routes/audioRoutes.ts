@@ -3,6 +3,7 @@ import { PrismaClient } from '@prisma/client';
 import type { Prisma } from '@prisma/client';
 import { generateUploadUrl, generateDownloadUrl, deleteAudioFile } from '../services/s3Service';
 import { measureLatencyMsForKeys } from '../utils/latencyCalibration';
+import { getPeaksKey, precomputePeaksForKey } from '../utils/waveformPeaks';
 import { getReplyStartTimeMs } from '../utils/audioTimeline';
 import {
   isValidUploadFilename,
@@ -192,6 +193,12 @@ router.post('/save', async (req: Request, res: Response) => {
       },
     });
 
+    // Peaks are derived once per upload in the background; a failure only
+    // costs the segment its waveform.
+    precomputePeaksForKey(audioNode.audioUrl).catch(error => {
+      console.error(`Failed to precompute peaks for ${audioNode.audioUrl}:`, error);
+    });
+
     // Return with presigned download URL
     const downloadUrl = await generateDownloadUrl(audioNode.audioUrl);
 
@@ -326,6 +333,25 @@ router.get('/tree/:id', async (req: Request, res: Response) => {
   }
 });
 
+// Presigned URL of a segment's precomputed waveform peaks
+router.get('/peaks/:id', async (req: Request, res: Response) => {
+  try {
+    const node = await prisma.audioNode.findUnique({
+      where: { id: req.params.id },
+      select: { id: true, audioUrl: true },
+    });
+    if (!node) {
+      return res.status(404).json({ error: 'Audio node not found' });
+    }
+
+    const peaksUrl = await generateDownloadUrl(getPeaksKey(node.audioUrl));
+    res.json({ id: node.id, peaksUrl });
+  } catch (error) {
+    console.error('Get peaks error:', error);
+    res.status(500).json({ error: 'Failed to get waveform peaks' });
+  }
+});
+
 // Calibrate latency between two audio nodes (reference and test)
 router.post('/calibrate', async (req: Request, res: Response) => {
   try {
@@ -388,11 +414,13 @@ router.delete('/chain/:id', async (req: Request, res: Response) => {
     // Database consistency is authoritative. Object cleanup follows, and an S3
     // failure leaves only an orphaned object rather than a broken story branch.
     for (const node of result.nodes) {
-      try {
-        await deleteAudioFile(node.audioUrl);
-      } catch (s3Error) {
-        console.error(`Failed to delete S3 file ${node.audioUrl}:`, s3Error);
-        // Continue even if S3 delete fails
+      for (const key of [node.audioUrl, getPeaksKey(node.audioUrl)]) {
+        try {
+          await deleteAudioFile(key);
+        } catch (s3Error) {
+          console.error(`Failed to delete S3 file ${key}:`, s3Error);
+          // Continue even if S3 delete fails
+        }
       }
     }
 
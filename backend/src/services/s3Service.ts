@@ -38,6 +38,24 @@ export async function generateDownloadUrl(key: string): Promise<string> {
   return await getSignedUrl(s3Client, command, { expiresIn: 3600 });
 }
 
+/**
+ * Store a file the backend derived itself, such as precomputed peaks
+ */
+export async function uploadObject(
+  key: string,
+  body: Buffer,
+  contentType: string
+): Promise<void> {
+  const command = new PutObjectCommand({
+    Bucket: BUCKET_NAME,
+    Key: key,
+    Body: body,
+    ContentType: contentType,
+  });
+
+  await s3Client.send(command);
+}
+
 /**
  * Delete an audio file from S3
  */
@@ -1,5 +1,6 @@
 import {
   estimateAudioOffset,
+  estimateAudioOffsetDirect,
   estimateLatencyMsFromPcm,
 } from '../audioCorrelation';
 
@@ -46,6 +47,31 @@ describe('estimateAudioOffset', () => {
 
     expect(result.confidence).toBe(0);
   });
+
+  it('interpolates a half-sample delay between neighbouring lags', () => {
+    // Averaging neighbours is a symmetric filter, so exactly half a sample late.
+    const reference = deterministicSignal(8_192);
+    const recorded = new Float64Array(reference.length + 400);
+    for (let index = 1; index < reference.length; index++) {
+      recorded[index + 300] = 0.5 * (reference[index] + reference[index - 1]);
+    }
+
+    const result = estimateAudioOffset(reference, recorded, 1_000);
+
+    expect(result.offsetSamples).toBe(300);
+    expect(result.fractionalOffsetSamples).toBeCloseTo(300.5, 2);
+  });
+
+  it('matches the direct per-lag sum, including the overlap cut-off', () => {
+    const reference = deterministicSignal(4_096);
+    const test = reference.slice(1_500, 2_800).map(sample => sample * 0.5);
+
+    const result = estimateAudioOffset(reference, test, 3_000);
+    const direct = estimateAudioOffsetDirect(reference, test, 3_000);
+
+    expect(result.offsetSamples).toBe(direct.offsetSamples);
+    expect(result.confidence).toBeCloseTo(direct.confidence, 9);
+  });
 });
 
 describe('estimateLatencyMsFromPcm', () => {
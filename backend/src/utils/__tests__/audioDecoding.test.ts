@@ -0,0 +1,46 @@
+process.env.TAPSTORY_NATIVE_ADDON = 'off';
+
+import { readPcm16MonoWav } from '../audioDecoding';
+
+function chunk(id: string, body: Buffer): Buffer {
+  const header = Buffer.alloc(8);
+  header.write(id, 0, 'ascii');
+  header.writeUInt32LE(body.length, 4);
+  return Buffer.concat([header, body, Buffer.alloc(body.length % 2)]);
+}
+
+function formatChunk(channels: number, bitsPerSample: number): Buffer {
+  const body = Buffer.alloc(16);
+  body.writeUInt16LE(1, 0);
+  body.writeUInt16LE(channels, 2);
+  body.writeUInt32LE(44_100, 4);
+  body.writeUInt32LE(44_100 * channels * bitsPerSample / 8, 8);
+  body.writeUInt16LE(channels * bitsPerSample / 8, 12);
+  body.writeUInt16LE(bitsPerSample, 14);
+  return chunk('fmt ', body);
+}
+
+function wav(...chunks: Buffer[]): Buffer {
+  return Buffer.concat([Buffer.from('RIFF\0\0\0\0WAVE', 'ascii'), ...chunks]);
+}
+
+describe('readPcm16MonoWav', () => {
+  const samples = Buffer.alloc(8);
+  [0, 1_000, -1_000, 32_767].forEach((value, index) => samples.writeInt16LE(value, index * 2));
+
+  it('walks past metadata chunks, including odd-sized ones that mention data', () => {
+    const pcm = readPcm16MonoWav(
+      wav(chunk('LIST', Buffer.from('INFOdata!', 'ascii')), formatChunk(1, 16), chunk('data', samples))
+    );
+
+    expect(pcm.sampleRate).toBe(44_100);
+    expect(Array.from(pcm.samples)).toEqual([0, 1_000, -1_000, 32_767]);
+  });
+
+  it('rejects formats the JavaScript reader cannot decode', () => {
+    expect(() => readPcm16MonoWav(wav(formatChunk(2, 16), chunk('data', samples)))).toThrow(
+      'Expected 16-bit PCM mono WAV'
+    );
+    expect(() => readPcm16MonoWav(wav(chunk('data', samples)))).toThrow('WAV fmt chunk not found');
+  });
+});
@@ -0,0 +1,37 @@
+process.env.TAPSTORY_NATIVE_ADDON = 'off';
+
+import { decodePeakFile, encodePeakFile, getPeaksKey, PEAK_LEVEL_FRAMES } from '../waveformPeaks';
+
+describe('waveformPeaks', () => {
+  it('stores the peaks of a segment beside its audio', () => {
+    expect(getPeaksKey('audio/abc-take.webm')).toBe('peaks/abc-take.webm.peaks');
+  });
+
+  it('round-trips min/max bins at every level', () => {
+    const samples = Int16Array.from({ length: 5_000 }, (_, index) =>
+      Math.round(Math.sin(index * 0.01) * 20_000)
+    );
+    samples[300] = -32_768;
+    samples[4_999] = 32_767;
+
+    const peaks = decodePeakFile(encodePeakFile(samples, 48_000));
+
+    expect(peaks.sampleRate).toBe(48_000);
+    expect(peaks.frameCount).toBe(5_000);
+    expect(peaks.levels.map(level => level.framesPerBin)).toEqual([...PEAK_LEVEL_FRAMES]);
+    for (const level of peaks.levels) {
+      const binCount = Math.ceil(samples.length / level.framesPerBin);
+      expect(level.minMax.length).toBe(binCount * 2);
+      for (let bin = 0; bin < binCount; bin++) {
+        const slice = samples.subarray(bin * level.framesPerBin, (bin + 1) * level.framesPerBin);
+        expect(level.minMax[bin * 2]).toBe(Math.min(...slice));
+        expect(level.minMax[bin * 2 + 1]).toBe(Math.max(...slice));
+      }
+    }
+    expect(peaks.levels[0].minMax[2]).toBe(-32_768);
+  });
+
+  it('rejects buffers that are not peak files', () => {
+    expect(() => decodePeakFile(Buffer.from('RIFF0000000000000000'))).toThrow('Not a peak file');
+  });
+});
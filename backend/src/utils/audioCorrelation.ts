@@ -1,6 +1,10 @@
+import { loadNativeAudio, type NativeSamples } from './nativeAudio';
+
 export interface AudioOffsetEstimate {
   /** Positive when the test signal occurs later than the reference. */
   offsetSamples: number;
+  /** offsetSamples refined by a parabola through the neighbouring lags. */
+  fractionalOffsetSamples: number;
   /** Absolute normalized correlation in the range 0...1. */
   confidence: number;
 }
@@ -20,10 +24,25 @@ function mean(samples: ArrayLike<number>): number {
   return sum / samples.length;
 }
 
+function toNativeSamples(samples: ArrayLike<number>): NativeSamples {
+  if (
+    samples instanceof Int16Array ||
+    samples instanceof Float32Array ||
+    samples instanceof Float64Array
+  ) {
+    return samples;
+  }
+  return Float64Array.from(samples);
+}
+
 /**
  * Estimate the sample offset between two related signals with normalized
  * cross-correlation. This is intentionally pure so synthetic and captured
  * calibration signals can use exactly the same implementation.
+ *
+ * Uses the native FFT correlation when the addon is built, which returns the
+ * same lags and confidences in O(N log N); otherwise every lag is summed
+ * directly.
  */
 export function estimateAudioOffset(
   reference: ArrayLike<number>,
@@ -31,7 +50,28 @@ export function estimateAudioOffset(
   maxOffsetSamples: number
 ): AudioOffsetEstimate {
   if (reference.length === 0 || test.length === 0) {
-    return { offsetSamples: 0, confidence: 0 };
+    return { offsetSamples: 0, fractionalOffsetSamples: 0, confidence: 0 };
+  }
+
+  const native = loadNativeAudio();
+  if (native) {
+    return native.estimateAudioOffset(
+      toNativeSamples(reference),
+      toNativeSamples(test),
+      Math.max(0, Math.floor(maxOffsetSamples))
+    );
+  }
+  return estimateAudioOffsetDirect(reference, test, maxOffsetSamples);
+}
+
+/** The O(lags x overlap) JavaScript implementation of estimateAudioOffset. */
+export function estimateAudioOffsetDirect(
+  reference: ArrayLike<number>,
+  test: ArrayLike<number>,
+  maxOffsetSamples: number
+): AudioOffsetEstimate {
+  if (reference.length === 0 || test.length === 0) {
+    return { offsetSamples: 0, fractionalOffsetSamples: 0, confidence: 0 };
   }
 
   const boundedMaxOffset = Math.max(0, Math.floor(maxOffsetSamples));
@@ -42,17 +82,16 @@ export function estimateAudioOffset(
     Math.floor(Math.min(reference.length, test.length) / 4)
   );
 
-  let bestOffset = 0;
-  let bestCorrelation = 0;
-
-  for (let offset = -boundedMaxOffset; offset <= boundedMaxOffset; offset++) {
+  // Negative for lags that are skipped.
+  const correlationAt = (offset: number): number => {
+    if (Math.abs(offset) > boundedMaxOffset) return -1;
     const referenceStart = Math.max(0, -offset);
     const testStart = Math.max(0, offset);
     const overlap = Math.min(
       reference.length - referenceStart,
       test.length - testStart
     );
-    if (overlap < minimumOverlap) continue;
+    if (overlap < minimumOverlap) return -1;
 
     let dotProduct = 0;
     let referenceEnergy = 0;
@@ -67,15 +106,32 @@ export function estimateAudioOffset(
     }
 
     const energy = Math.sqrt(referenceEnergy * testEnergy);
-    const correlation = energy > 0 ? Math.abs(dotProduct / energy) : 0;
+    return energy > 0 ? Math.abs(dotProduct / energy) : 0;
+  };
+
+  let bestOffset = 0;
+  let bestCorrelation = 0;
+
+  for (let offset = -boundedMaxOffset; offset <= boundedMaxOffset; offset++) {
+    const correlation = correlationAt(offset);
     if (correlation > bestCorrelation) {
       bestCorrelation = correlation;
       bestOffset = offset;
     }
   }
 
+  let fractionalOffset = bestOffset;
+  const before = correlationAt(bestOffset - 1);
+  const after = correlationAt(bestOffset + 1);
+  const curvature = before - 2 * bestCorrelation + after;
+  if (bestCorrelation > 0 && before >= 0 && after >= 0 && curvature < 0) {
+    const shift = (0.5 * (before - after)) / curvature;
+    fractionalOffset += Math.max(-0.5, Math.min(0.5, shift));
+  }
+
   return {
     offsetSamples: bestOffset,
+    fractionalOffsetSamples: fractionalOffset,
     confidence: Math.min(1, bestCorrelation),
   };
 }
@@ -99,7 +155,11 @@ function createOnsetEnvelope(
   return envelope;
 }
 
-/** Estimate route delay from related PCM using an onset envelope and NCC. */
+/**
+ * Estimate route delay from related PCM with NCC. The native addon correlates
+ * the full-rate samples with sub-sample interpolation; without it both signals
+ * are decimated to onset envelopes first to keep the JavaScript fast enough.
+ */
 export function estimateLatencyMsFromPcm(
   reference: PcmData,
   test: PcmData,
@@ -109,6 +169,31 @@ export function estimateLatencyMsFromPcm(
     throw new Error('Sample rates do not match in calibration files');
   }
 
+  const native = loadNativeAudio();
+  if (!native) {
+    return estimateLatencyMsFromEnvelopes(reference, test, maxLatencyMs);
+  }
+
+  const sampleRate = reference.sampleRate;
+  const maxSamples = Math.round(sampleRate * 10);
+  const maxLatencySamples = Math.round(sampleRate * maxLatencyMs / 1_000);
+  const estimate = native.estimateAudioOffset(
+    reference.samples.subarray(0, maxSamples),
+    test.samples.subarray(0, maxSamples + maxLatencySamples),
+    maxLatencySamples
+  );
+  return {
+    offsetMs: estimate.fractionalOffsetSamples * 1_000 / sampleRate,
+    confidence: estimate.confidence,
+  };
+}
+
+/** The JavaScript path of estimateLatencyMsFromPcm: 2 kHz onset envelopes. */
+export function estimateLatencyMsFromEnvelopes(
+  reference: PcmData,
+  test: PcmData,
+  maxLatencyMs = 1_000
+): { offsetMs: number; confidence: number } {
   const sampleRate = reference.sampleRate;
   const blockSize = Math.max(1, Math.round(sampleRate / 2_000));
   const maxSamples = Math.round(sampleRate * 10);
@@ -119,7 +204,7 @@ export function estimateLatencyMsFromPcm(
     maxSamples + Math.round(sampleRate * maxLatencyMs / 1_000)
   );
   const maxOffsetBlocks = Math.ceil(maxLatencyMs * sampleRate / 1_000 / blockSize);
-  const estimate = estimateAudioOffset(
+  const estimate = estimateAudioOffsetDirect(
     referenceEnvelope,
     testEnvelope,
     maxOffsetBlocks
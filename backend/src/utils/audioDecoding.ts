@@ -0,0 +1,105 @@
+import ffmpeg from 'fluent-ffmpeg';
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import { generateDownloadUrl } from '../services/s3Service';
+import type { PcmData } from './audioCorrelation';
+import { loadNativeAudio } from './nativeAudio';
+
+/**
+ * Decode an audio file from S3 (by key) to a local mono 16-bit PCM WAV file.
+ * Returns the path to the WAV file; the caller removes it.
+ */
+export async function decodeToWavTempFile(key: string, sampleRate = 44_100): Promise<string> {
+  const downloadUrl = await generateDownloadUrl(key);
+  const tmpDir = os.tmpdir();
+  const wavPath = path.join(tmpDir, `tapstory-decode-${Date.now()}-${Math.random().toString(36).slice(2)}.wav`);
+
+  await new Promise<void>((resolve, reject) => {
+    ffmpeg(downloadUrl)
+      .audioChannels(1)
+      .audioFrequency(sampleRate)
+      .format('wav')
+      .output(wavPath)
+      .on('end', () => resolve())
+      .on('error', (err) => reject(err))
+      .run();
+  });
+
+  return wavPath;
+}
+
+/**
+ * Read a WAV file as mono PCM16. The native addon maps the file and hands
+ * back a view of it (or a native decode for 24-bit, float or multichannel
+ * files); the JavaScript fallback reads 16-bit mono PCM only.
+ */
+export function readPcmFromWav(wavPath: string): PcmData {
+  const native = loadNativeAudio();
+  if (native) {
+    const { samples, sampleRate } = native.readWavPcm16(wavPath);
+    return { samples, sampleRate };
+  }
+  return readPcm16MonoWav(fs.readFileSync(wavPath));
+}
+
+export function readPcm16MonoWav(buffer: Buffer): PcmData {
+  if (
+    buffer.length < 12 ||
+    buffer.toString('ascii', 0, 4) !== 'RIFF' ||
+    buffer.toString('ascii', 8, 12) !== 'WAVE'
+  ) {
+    throw new Error('Unsupported WAV format');
+  }
+
+  let format: {
+    audioFormat: number;
+    numChannels: number;
+    sampleRate: number;
+    bitsPerSample: number;
+  } | null = null;
+  let data: Buffer | null = null;
+  // Walk the chunk list; sample data or metadata can contain chunk ids.
+  for (let offset = 12; offset + 8 <= buffer.length && !(format && data); ) {
+    const id = buffer.toString('ascii', offset, offset + 4);
+    const body = offset + 8;
+    const size = Math.min(buffer.readUInt32LE(offset + 4), buffer.length - body);
+    if (id === 'fmt ' && size >= 16) {
+      format = {
+        audioFormat: buffer.readUInt16LE(body),
+        numChannels: buffer.readUInt16LE(body + 2),
+        sampleRate: buffer.readUInt32LE(body + 4),
+        bitsPerSample: buffer.readUInt16LE(body + 14),
+      };
+    } else if (id === 'data' && !data) {
+      data = buffer.subarray(body, body + size);
+    }
+    // Odd-sized chunks are followed by a pad byte.
+    offset = body + size + (size % 2);
+  }
+
+  if (!format) {
+    throw new Error('WAV fmt chunk not found');
+  }
+  if (format.audioFormat !== 1 || format.numChannels !== 1 || format.bitsPerSample !== 16) {
+    throw new Error('Expected 16-bit PCM mono WAV');
+  }
+  if (!data) {
+    throw new Error('WAV data chunk not found');
+  }
+
+  // Int16Array views need an even byte offset.
+  const pcm = data.byteOffset % 2 === 0 ? data : Buffer.from(data);
+  const samples = new Int16Array(pcm.buffer, pcm.byteOffset, Math.floor(pcm.byteLength / 2));
+
+  return { samples, sampleRate: format.sampleRate };
+}
+
+/** Best-effort removal of a temporary decode. */
+export function removeTempFile(filePath: string): void {
+  try {
+    fs.unlinkSync(filePath);
+  } catch {
+    // ignore
+  }
+}
@@ -0,0 +1,56 @@
+import fs from 'fs';
+import path from 'path';
+
+export interface NativeOffsetEstimate {
+  offsetSamples: number;
+  fractionalOffsetSamples: number;
+  confidence: number;
+}
+
+export type NativeSamples = Int16Array | Float32Array | Float64Array;
+
+/** Functions exported by native/node/TapStoryNodeAddon.cpp. */
+export interface NativeAudioAddon {
+  estimateAudioOffset(
+    reference: NativeSamples,
+    test: NativeSamples,
+    maxOffsetSamples: number
+  ): NativeOffsetEstimate;
+  /** The peak pyramid file described in native/audio/PeakPyramid.h. */
+  computePeakFile(samples: NativeSamples, sampleRate: number): ArrayBuffer;
+  /** Mono PCM16 of a 16/24/32-bit or float WAV, channels averaged. */
+  readWavPcm16(path: string): {
+    sampleRate: number;
+    channelCount: number;
+    bitsPerSample: number;
+    frameCount: number;
+    samples: Int16Array;
+  };
+}
+
+// Where `cmake -S native -B native/build -DTAPSTORY_BUILD_NODE_ADDON=ON` puts it.
+const DEFAULT_ADDON_PATH = path.resolve(__dirname, '../../../native/build/tapstory_native.node');
+
+let cachedAddon: NativeAudioAddon | null | undefined;
+
+/**
+ * Load the native audio addon once. TAPSTORY_NATIVE_ADDON overrides the path,
+ * or disables the addon when set to "off". Returns null when unavailable so
+ * callers can fall back to the JavaScript implementations.
+ */
+export function loadNativeAudio(): NativeAudioAddon | null {
+  if (cachedAddon !== undefined) return cachedAddon;
+
+  const configuredPath = process.env.TAPSTORY_NATIVE_ADDON;
+  cachedAddon = null;
+  if (configuredPath === 'off') return cachedAddon;
+
+  const addonPath = configuredPath || DEFAULT_ADDON_PATH;
+  if (!fs.existsSync(addonPath)) return cachedAddon;
+  try {
+    cachedAddon = require(addonPath) as NativeAudioAddon;
+  } catch (error) {
+    console.warn(`Native audio addon at ${addonPath} failed to load:`, error);
+  }
+  return cachedAddon;
+}
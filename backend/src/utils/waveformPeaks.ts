@@ -0,0 +1,130 @@
+import { uploadObject } from '../services/s3Service';
+import { decodeToWavTempFile, readPcmFromWav, removeTempFile } from './audioDecoding';
+import { loadNativeAudio } from './nativeAudio';
+
+/** Frames per bin of each level, finest first; matches native/audio/PeakPyramid.h. */
+export const PEAK_LEVEL_FRAMES = [256, 1_024, 4_096] as const;
+
+// Segments are decoded at the rate the mobile engines usually run at.
+const PEAK_SAMPLE_RATE = 48_000;
+const PEAK_FILE_VERSION = 1;
+const HEADER_BYTES = 20;
+
+export interface PeakLevel {
+  framesPerBin: number;
+  /** Interleaved [min, max] PCM16 pairs, one per bin. */
+  minMax: Int16Array;
+}
+
+export interface PeakFile {
+  sampleRate: number;
+  frameCount: number;
+  levels: PeakLevel[];
+}
+
+/** Where the peaks of an uploaded segment are stored. */
+export function getPeaksKey(audioKey: string): string {
+  return `${audioKey.replace(/^audio\//, 'peaks/')}.peaks`;
+}
+
+function computeLevels(samples: Int16Array): PeakLevel[] {
+  return PEAK_LEVEL_FRAMES.map(framesPerBin => {
+    const binCount = Math.ceil(samples.length / framesPerBin);
+    const minMax = new Int16Array(binCount * 2);
+    for (let bin = 0; bin < binCount; bin++) {
+      const end = Math.min(samples.length, (bin + 1) * framesPerBin);
+      let minimum = samples[bin * framesPerBin];
+      let maximum = minimum;
+      for (let index = bin * framesPerBin + 1; index < end; index++) {
+        const sample = samples[index];
+        if (sample < minimum) minimum = sample;
+        if (sample > maximum) maximum = sample;
+      }
+      minMax[bin * 2] = minimum;
+      minMax[bin * 2 + 1] = maximum;
+    }
+    return { framesPerBin, minMax };
+  });
+}
+
+/**
+ * Build the peak file of mono PCM16. The native addon's buffer is wrapped
+ * without copying; the JavaScript path writes the identical format.
+ */
+export function encodePeakFile(samples: Int16Array, sampleRate: number): Buffer {
+  const native = loadNativeAudio();
+  if (native) {
+    return Buffer.from(native.computePeakFile(samples, sampleRate));
+  }
+
+  const levels = computeLevels(samples);
+  const pairCount = levels.reduce((sum, level) => sum + level.minMax.length / 2, 0);
+  const buffer = Buffer.alloc(HEADER_BYTES + levels.length * 8 + pairCount * 4);
+  buffer.write('TSPK', 0, 'ascii');
+  buffer.writeUInt16LE(PEAK_FILE_VERSION, 4);
+  buffer.writeUInt16LE(levels.length, 6);
+  buffer.writeUInt32LE(sampleRate, 8);
+  buffer.writeBigUInt64LE(BigInt(samples.length), 12);
+  let offset = HEADER_BYTES;
+  for (const level of levels) {
+    buffer.writeUInt32LE(level.framesPerBin, offset);
+    buffer.writeUInt32LE(level.minMax.length / 2, offset + 4);
+    offset += 8;
+  }
+  for (const level of levels) {
+    for (const value of level.minMax) {
+      buffer.writeInt16LE(value, offset);
+      offset += 2;
+    }
+  }
+  return buffer;
+}
+
+export function decodePeakFile(buffer: Buffer): PeakFile {
+  if (buffer.length < HEADER_BYTES || buffer.toString('ascii', 0, 4) !== 'TSPK') {
+    throw new Error('Not a peak file');
+  }
+  if (buffer.readUInt16LE(4) !== PEAK_FILE_VERSION) {
+    throw new Error('Unsupported peak file version');
+  }
+
+  const levelCount = buffer.readUInt16LE(6);
+  const levels: PeakLevel[] = [];
+  let dataOffset = HEADER_BYTES + levelCount * 8;
+  for (let index = 0; index < levelCount; index++) {
+    const framesPerBin = buffer.readUInt32LE(HEADER_BYTES + index * 8);
+    const binCount = buffer.readUInt32LE(HEADER_BYTES + index * 8 + 4);
+    const minMax = new Int16Array(binCount * 2);
+    for (let value = 0; value < minMax.length; value++) {
+      minMax[value] = buffer.readInt16LE(dataOffset + value * 2);
+    }
+    dataOffset += binCount * 4;
+    levels.push({ framesPerBin, minMax });
+  }
+
+  return {
+    sampleRate: buffer.readUInt32LE(8),
+    frameCount: Number(buffer.readBigUInt64LE(12)),
+    levels,
+  };
+}
+
+/**
+ * Decode an uploaded segment once and store its peak pyramid next to it, so
+ * timelines never need the audio itself to draw it.
+ */
+export async function precomputePeaksForKey(audioKey: string): Promise<string> {
+  const wavPath = await decodeToWavTempFile(audioKey, PEAK_SAMPLE_RATE);
+  try {
+    const pcm = readPcmFromWav(wavPath);
+    const peaksKey = getPeaksKey(audioKey);
+    await uploadObject(
+      peaksKey,
+      encodePeakFile(pcm.samples, pcm.sampleRate),
+      'application/octet-stream'
+    );
+    return peaksKey;
+  } finally {
+    removeTempFile(wavPath);
+  }
+}
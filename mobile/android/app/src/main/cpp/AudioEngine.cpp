@@ -2,12 +2,17 @@
 
 #include <android/log.h>
 
+#include <time.h>
+
 #include <algorithm>
-#include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <thread>
 
+#include "audio/LinearResampler.h"
+#include "audio/LosslessDecoder.h"
+
 #define TAG "TapStoryAudio"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
 #define LOGW(...) __android_log_print(ANDROID_LOG_WARN, TAG, __VA_ARGS__)
@@ -21,6 +26,26 @@ int32_t xRunCount(const std::shared_ptr<oboe::AudioStream> &stream) {
     return result ? result.value() : -1;
 }
 
+tapstory::StreamReadiness::Timestamp presentationTimestamp(
+        const std::shared_ptr<oboe::AudioStream> &stream) {
+    tapstory::StreamReadiness::Timestamp timestamp;
+    if (!stream) return timestamp;
+    const auto result = stream->getTimestamp(CLOCK_MONOTONIC);
+    if (result) {
+        timestamp.frame = result.value().position;
+        timestamp.nanos = result.value().timestamp;
+    } else {
+        // OpenSL ES streams never have one; readiness then stops waiting for it.
+        timestamp.unimplemented = result.error() == oboe::Result::ErrorUnimplemented;
+    }
+    return timestamp;
+}
+
+int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 double latencyMillis(const std::shared_ptr<oboe::AudioStream> &stream) {
     if (!stream || stream->getState() != oboe::StreamState::Started) return -1.0;
     const auto result = stream->calculateLatencyMillis();
@@ -29,7 +54,7 @@ double latencyMillis(const std::shared_ptr<oboe::AudioStream> &stream) {
 
 }  // namespace
 
-AudioEngine::AudioEngine() {
+AudioEngine::AudioEngine() : mCreatedNanos(steadyNanos()) {
     LOGI("AudioEngine created");
 }
 
@@ -43,11 +68,11 @@ AudioEngine::~AudioEngine() {
 
 bool AudioEngine::prepare() {
     std::lock_guard<std::mutex> lock(mControlMutex);
-    if (mCaptureArmed.load(std::memory_order_acquire) || mWriterThread.joinable()) {
+    if (mCore.isCaptureArmed() || mCore.isWriterActive()) {
         LOGE("Refusing to recreate streams while a capture is active");
         return false;
     }
-    if (mLastStreamError.load(std::memory_order_acquire) != 0) {
+    if (getLastStreamError() != 0) {
         LOGE("Failed engine must be deleted before streams are prepared again");
         return false;
     }
@@ -98,7 +123,7 @@ bool AudioEngine::openStreams() {
             ->setSharingMode(oboe::SharingMode::Exclusive)
             ->setFormat(oboe::AudioFormat::Float)
             ->setFormatConversionAllowed(true)
-            ->setChannelCount(kInputChannelCount)
+            ->setChannelCount(mInputChannelCount)
             ->setSampleRate(mSampleRate)
             ->setBufferCapacityInFrames(mPlayStream->getBufferCapacityInFrames() * 2)
             ->setInputPreset(oboe::InputPreset::VoiceRecognition);
@@ -128,10 +153,26 @@ bool AudioEngine::openStreams() {
     setNumInputBurstsCushion(1);
     setMinimumFramesBeforeRead(0);
 
-    mRecordingRing = std::make_unique<tapstory::SpscPcmRing>(
-            static_cast<size_t>(mSampleRate) * kRecordingRingSeconds);
+    // Only sizes the capture buffers; they are allocated on first arm or by
+    // prepareCaptureBuffers, so playback-only sessions never pay for them.
+    // The input may be delivered with other channels than requested; the
+    // core follows the stream.
+    mCore.prepareCapture(
+            static_cast<size_t>(mSampleRate) * kRecordingRingSeconds,
+            mSampleRate,
+            mRecordStream->getChannelCount());
+    // The timeline runs at the stream rate. Tracks keep their PCM at its own
+    // rate and the mixer converts it, so a reopen at another rate only
+    // rescales placements.
+    mCore.trackStore().setTimelineRate(mSampleRate);
+    mCore.refreshStems();
     mLastStreamError.store(0, std::memory_order_release);
 
+    int64_t notOpened = -1;
+    mStreamsOpenedNanos.compare_exchange_strong(
+            notOpened,
+            steadyNanos() - mCreatedNanos,
+            std::memory_order_acq_rel);
     LOGI("Duplex streams prepared: rate=%d, outputBurst=%d, inputBurst=%d, "
          "outputMode=%d, inputMode=%d",
          mSampleRate,
@@ -157,6 +198,7 @@ void AudioEngine::closeStreams() {
         mRecordStream.reset();
     }
     setInputStream(nullptr);
+    mStreamsStarted.store(false, std::memory_order_release);
     mSampleRate = 0;
     mLastInputLatencyMillis = -1.0;
     mLastOutputLatencyMillis = -1.0;
@@ -165,10 +207,29 @@ void AudioEngine::closeStreams() {
 bool AudioEngine::startSession() {
     std::lock_guard<std::mutex> lock(mControlMutex);
     if (mIsRunning.load(std::memory_order_acquire)) return true;
-    if (mLastStreamError.load(std::memory_order_acquire) != 0) {
+    if (getLastStreamError() != 0) {
         LOGE("Audio engine has failed; reinitialize it before restart");
         return false;
     }
+    if (mStreamsStarted.load(std::memory_order_acquire)) {
+        // Hot idle: the streams never stopped, so the next burst plays.
+        mLastStartWasHot.store(true, std::memory_order_release);
+        mIsRunning.store(true, std::memory_order_release);
+        mCore.resumeTransport();
+        LOGI("AudioEngine resumed from hot idle at timeline frame %lld",
+             static_cast<long long>(mCore.currentFrame()));
+        return true;
+    }
+
+    mLastStartWasHot.store(false, std::memory_order_release);
+    mCore.resumeTransport();
+    if (!startStreamsLocked(true)) return false;
+    LOGI("AudioEngine started at timeline frame %lld",
+         static_cast<long long>(mCore.currentFrame()));
+    return true;
+}
+
+bool AudioEngine::startStreamsLocked(bool transportRunning) {
     const bool streamsUsable = mPlayStream && mRecordStream
             && mPlayStream->getState() != oboe::StreamState::Closed
             && mPlayStream->getState() != oboe::StreamState::Disconnected
@@ -181,29 +242,53 @@ bool AudioEngine::startSession() {
 
     // Publish running before requesting the asynchronous starts so an immediate
     // error callback cannot be overwritten with a stale true value afterward.
-    mIsRunning.store(true, std::memory_order_release);
+    if (transportRunning) mIsRunning.store(true, std::memory_order_release);
+    mStreamsStarted.store(true, std::memory_order_release);
+    mReadiness.arm(mPlayStream->getFramesPerBurst(), mSampleRate, steadyNanos());
     const oboe::Result result = oboe::FullDuplexStream::start();
     if (result != oboe::Result::OK) {
         LOGE("Failed to start duplex streams: %s", oboe::convertToText(result));
         mLastStreamError.store(static_cast<int32_t>(result), std::memory_order_release);
-        oboe::FullDuplexStream::stop();
-        if (mPlayStream) mPlayStream->stop();
-        if (mRecordStream) mRecordStream->stop();
-        mIsRunning.store(false, std::memory_order_release);
-        waitForRealtimeProducer();
+        stopStreamsLocked();
         return false;
     }
     if (mLastStreamError.load(std::memory_order_acquire) != 0
-        || !mIsRunning.load(std::memory_order_acquire)) {
-        oboe::FullDuplexStream::stop();
-        if (mPlayStream) mPlayStream->stop();
-        if (mRecordStream) mRecordStream->stop();
-        mIsRunning.store(false, std::memory_order_release);
-        waitForRealtimeProducer();
+        || !mStreamsStarted.load(std::memory_order_acquire)
+        || (transportRunning && !mIsRunning.load(std::memory_order_acquire))) {
+        stopStreamsLocked();
         return false;
     }
-    LOGI("AudioEngine started at timeline frame %lld",
-         static_cast<long long>(mCurrentFrame.load(std::memory_order_acquire)));
+    return true;
+}
+
+void AudioEngine::stopStreamsLocked() {
+    oboe::FullDuplexStream::stop();
+    // FullDuplexStream requests an asynchronous stop. Blocking here ensures
+    // control-thread track mutation cannot race the realtime callback.
+    if (mPlayStream) mPlayStream->stop();
+    if (mRecordStream) mRecordStream->stop();
+    mStreamsStarted.store(false, std::memory_order_release);
+    mIsRunning.store(false, std::memory_order_release);
+    mCore.waitForCallbacks();
+}
+
+bool AudioEngine::setHotIdle(bool enabled) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    mHotIdle.store(enabled, std::memory_order_release);
+    if (mIsRunning.load(std::memory_order_acquire)) return true;
+    if (!enabled) {
+        if (mStreamsStarted.load(std::memory_order_acquire)) stopStreamsLocked();
+        return true;
+    }
+    if (mStreamsStarted.load(std::memory_order_acquire)) return true;
+    if (mSampleRate <= 0 || getLastStreamError() != 0) {
+        LOGE("Hot idle needs prepared, healthy duplex streams");
+        return false;
+    }
+    // Start parked so the first play skips stream start and warmup too.
+    mCore.parkTransport();
+    if (!startStreamsLocked(false)) return false;
+    LOGI("Duplex streams running in hot idle");
     return true;
 }
 
@@ -216,66 +301,47 @@ void AudioEngine::refreshLatencyDiagnosticsLocked() {
 
 void AudioEngine::stopPlayback() {
     std::unique_lock<std::mutex> lock(mControlMutex);
-    const bool captureArmedAtStop = mCaptureArmed.load(std::memory_order_acquire);
-    const int64_t captureStartAtStop = mActualRecordingStartFrame.load(
-            std::memory_order_acquire);
-    const bool cancelPendingCapture = captureArmedAtStop && captureStartAtStop < 0;
-    const bool shouldDrainTail = mIsRunning.load(std::memory_order_acquire)
-            && tapstory::shouldDrainCaptureTail(
-                    captureArmedAtStop,
-                    captureStartAtStop,
-                    mCaptureStopRequested.load(std::memory_order_acquire),
-                    mLatencyCompensationFrames.load(std::memory_order_acquire));
-    if (shouldDrainTail) {
-        const int64_t tailFrames = mLatencyCompensationFrames.load(std::memory_order_acquire);
-        mTailDrainFramesRemaining.store(tailFrames, std::memory_order_release);
+    const bool wasRunning = mIsRunning.load(std::memory_order_acquire);
+    if (wasRunning && mCore.beginTransportStop()) {
+        const int64_t tailFrames = mCore.captureCompensationFrames();
         const int64_t tailMillis = mSampleRate > 0
                 ? (tailFrames * 1'000 + mSampleRate - 1) / mSampleRate
                 : 0;
         const auto timeoutMillis = std::max<int64_t>(500, tailMillis * 2 + 250);
         const auto deadline = std::chrono::steady_clock::now()
                 + std::chrono::milliseconds(timeoutMillis);
-        while (mCaptureArmed.load(std::memory_order_acquire)
-               && mTailDrainFramesRemaining.load(std::memory_order_acquire) > 0
+        while (mCore.isDrainingTail()
                && mLastStreamError.load(std::memory_order_acquire) == 0
                && std::chrono::steady_clock::now() < deadline) {
             lock.unlock();
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
             lock.lock();
         }
-        if (mCaptureArmed.load(std::memory_order_acquire)
-            && mTailDrainFramesRemaining.load(std::memory_order_acquire) > 0
-            && mLastStreamError.load(std::memory_order_acquire) == 0) {
+        if (mCore.isDrainingTail() && mLastStreamError.load(std::memory_order_acquire) == 0) {
             LOGE("Timed out while draining %lld compensated tail frames",
-                 static_cast<long long>(
-                         mTailDrainFramesRemaining.load(std::memory_order_acquire)));
+                 static_cast<long long>(tailFrames));
             mLastStreamError.store(-1004, std::memory_order_release);
-            mCaptureStopRequested.store(true, std::memory_order_release);
+            mCore.requestCaptureStop();
         }
     }
-    if (captureArmedAtStop && !shouldDrainTail) {
-        mCaptureStopRequested.store(true, std::memory_order_release);
-    }
 
-    if (mIsRunning.load(std::memory_order_acquire)) refreshLatencyDiagnosticsLocked();
-    oboe::FullDuplexStream::stop();
-    // FullDuplexStream requests an asynchronous stop. Blocking here ensures
-    // control-thread track mutation cannot race the realtime callback.
-    if (mPlayStream) mPlayStream->stop();
-    if (mRecordStream) mRecordStream->stop();
-    mIsRunning.store(false, std::memory_order_release);
-    waitForRealtimeProducer();
-    if (mCaptureArmed.load(std::memory_order_acquire)) {
-        finishCaptureAtCurrentFrame();
-    }
-    if (cancelPendingCapture) {
-        // Stop won the control-thread race with the first accepted input frame.
-        // Even if an in-flight callback copied PCM, preserve pre-punch cancel
-        // semantics by making finalization return NO_RECORDING.
-        mActualRecordingStartFrame.store(-1, std::memory_order_release);
+    if (wasRunning) refreshLatencyDiagnosticsLocked();
+    if (mHotIdle.load(std::memory_order_acquire)
+        && mStreamsStarted.load(std::memory_order_acquire)
+        && mLastStreamError.load(std::memory_order_acquire) == 0) {
+        // Streams keep running silent; once the last unparked callback has
+        // returned, the transport is as still as a stopped stream.
+        mCore.parkTransport();
+        mIsRunning.store(false, std::memory_order_release);
+        mCore.waitForCallbacks();
+    } else {
+        stopStreamsLocked();
     }
+    // Ends a started take at the current frame and cancels one still waiting
+    // for its punch, so finalization returns NO_RECORDING.
+    mCore.onTransportStopped();
     LOGI("AudioEngine playback stopped at timeline frame %lld",
-         static_cast<long long>(mCurrentFrame.load(std::memory_order_acquire)));
+         static_cast<long long>(mCore.currentFrame()));
 }
 
 void AudioEngine::reset() {
@@ -283,14 +349,16 @@ void AudioEngine::reset() {
     stopRecording();
     std::lock_guard<std::mutex> lock(mControlMutex);
     closeStreams();
-    mCurrentFrame.store(0, std::memory_order_release);
+    mCore.seek(0);
 }
 
 bool AudioEngine::loadTrack(
         const std::string &trackId,
         const int16_t *data,
         int32_t numFrames,
-        int64_t startFrame) {
+        int64_t startFrame,
+        int32_t channelCount,
+        int32_t sampleRate) {
     if (data == nullptr || numFrames <= 0) return false;
     std::lock_guard<std::mutex> lock(mControlMutex);
     if (mIsRunning.load(std::memory_order_acquire)) {
@@ -298,177 +366,382 @@ bool AudioEngine::loadTrack(
         return false;
     }
 
-    Track track;
-    track.startFrame = startFrame;
-    track.lengthFrames = numFrames;
-    track.data.resize(static_cast<size_t>(numFrames));
-    constexpr float scalar = 1.0f / 32768.0f;
-    for (int32_t frame = 0; frame < numFrames; ++frame) {
-        track.data[static_cast<size_t>(frame)] = static_cast<float>(data[frame]) * scalar;
+    tapstory::TrackStore &store = mCore.trackStore();
+    if (!store.load(trackId, data, numFrames, startFrame, channelCount, sampleRate)) {
+        return false;
     }
-    mTracks.push_back(std::move(track));
-    LOGI("Loaded mono track '%s': %d frames, startFrame=%lld",
+    mCore.refreshStems();
+    const tapstory::Track *track = store.find(trackId);
+    LOGI("Loaded track '%s': %d frames of %d channels at %d Hz, startFrame=%lld, "
+         "loudness=%.1f LUFS, truePeak=%.1f dBTP, gain=%.2f",
          trackId.c_str(),
          numFrames,
-         static_cast<long long>(startFrame));
+         channelCount,
+         track->sampleRate,
+         static_cast<long long>(startFrame),
+         track->loudness.integratedLufs,
+         track->loudness.truePeakDbtp,
+         track->gain);
     return true;
 }
 
-bool AudioEngine::clearTracks() {
+bool AudioEngine::loadTrackFile(
+        const std::string &trackId,
+        const std::string &path,
+        int64_t startFrame) {
+    // Decoding takes the bulk of the time, so it runs outside the control lock.
+    // The PCM keeps the file's rate, so a route change never redoes this.
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<int16_t> pcm;
+    int32_t channelCount = 1;
+    int32_t sampleRate = 0;
+    if (!tapstory::decodeLosslessFileAtFileRate(path, pcm, channelCount, sampleRate)
+            || pcm.size() / channelCount > static_cast<size_t>(INT32_MAX)) {
+        return false;
+    }
+    LOGI("Decoded '%s' natively in %.1f ms",
+         trackId.c_str(),
+         std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start).count());
+    return loadTrack(
+            trackId,
+            pcm.data(),
+            static_cast<int32_t>(pcm.size() / channelCount),
+            startFrame,
+            channelCount,
+            sampleRate);
+}
+
+bool AudioEngine::loadChainSegment(
+        const std::string &path,
+        const std::string &trackId,
+        int64_t startFrame) {
     std::lock_guard<std::mutex> lock(mControlMutex);
     if (mIsRunning.load(std::memory_order_acquire)) {
-        LOGE("Refusing to clear tracks while audio is running");
+        LOGE("Refusing to mutate tracks while audio is running");
         return false;
     }
-    mTracks.clear();
+    if (!mChain || mChain->path() != path) {
+        auto chain = std::make_shared<tapstory::ChainContainer>();
+        if (!chain->open(path)) {
+            mChain.reset();
+            return false;
+        }
+        mChain = std::move(chain);
+    }
+
+    // Segments keep their own rate, so their placement may round a frame
+    // differently once rescaled to the stream's.
+    const tapstory::ChainSegment *segment = mChain->find(trackId);
+    if (segment == nullptr) return false;
+    const int64_t placedFrame = tapstory::rescaleFrame(
+            segment->startFrame, segment->sampleRate, mCore.trackStore().sampleRate());
+    if (std::llabs(placedFrame - startFrame) > 1) return false;
+    const auto index = static_cast<size_t>(segment - mChain->segments().data());
+    if (!mCore.trackStore().loadMapped(mChain, index)) return false;
+    mCore.refreshStems();
+    LOGI("Mapped track '%s' from chain: %lld frames, startFrame=%lld, gain=%.2f",
+         trackId.c_str(),
+         static_cast<long long>(segment->lengthFrames),
+         static_cast<long long>(startFrame),
+         segment->gain);
     return true;
 }
 
-bool AudioEngine::startRecording(const std::string &filePath, int64_t punchFrame) {
-    stopRecording();
+bool AudioEngine::appendChainSegment(const std::string &path, const std::string &trackId) {
     std::lock_guard<std::mutex> lock(mControlMutex);
-    if (!mRecordingRing || mSampleRate <= 0) {
-        LOGE("Cannot record before duplex streams are prepared");
+    const tapstory::Track *track = mCore.trackStore().find(trackId);
+    if (track == nullptr) return false;
+    if (!tapstory::ChainContainer::append(path, *track, mCore.trackStore().sampleRate())) {
+        LOGW("Could not append track '%s' to chain container", trackId.c_str());
         return false;
     }
-    if (mLastStreamError.load(std::memory_order_acquire) != 0) {
-        LOGE("Cannot record after an audio stream or writer failure; reinitialize first");
+    // The next load pass maps the file again to see the new segment.
+    mChain.reset();
+    return true;
+}
+
+bool AudioEngine::clearTracks() {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mIsRunning.load(std::memory_order_acquire)) {
+        LOGE("Refusing to clear tracks while audio is running");
+        return false;
+    }
+    mCore.trackStore().clear();
+    mCore.refreshStems();
+    return true;
+}
+
+bool AudioEngine::setStemMixing(bool enabled) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mIsRunning.load(std::memory_order_acquire)) {
+        LOGE("Refusing to switch stem mixing while audio is running");
         return false;
     }
+    const auto start = std::chrono::steady_clock::now();
+    mCore.setStemMixing(enabled);
+    LOGI("Stem mixing %s for %zu tracks in %.1f ms",
+         enabled ? "enabled" : "disabled",
+         mCore.trackStore().size(),
+         std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start).count());
+    return true;
+}
 
-    mRecordingRing->reset();
-    mRecordingFile.clear();
-    mRecordingFile.open(filePath, std::ios::binary | std::ios::trunc);
-    if (!mRecordingFile.is_open()) {
-        LOGE("Failed to open recording file: %s", filePath.c_str());
+bool AudioEngine::setInputChannelCount(int32_t channelCount) {
+    if (channelCount < 1 || channelCount > 2) return false;
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mIsRunning.load(std::memory_order_acquire)
+        || mCore.isCaptureArmed()
+        || mCore.isWriterActive()) {
+        LOGE("Refusing to change input channels while audio is running");
         return false;
     }
+    mInputChannelCount = channelCount;
+    if (mSampleRate <= 0 || channelCount == mCore.inputChannelCount()) return true;
 
-    const int64_t requestedPunchFrame = std::max<int64_t>(0, punchFrame);
-    const int64_t compensatedPunchFrame = tapstory::compensatedPunchFrame(
-            requestedPunchFrame,
-            mLatencyCompensationFrames.load(std::memory_order_acquire));
-    mRequestedPunchFrame.store(requestedPunchFrame, std::memory_order_release);
-    mPunchFrame.store(compensatedPunchFrame, std::memory_order_release);
-    mActualRecordingStartFrame.store(-1, std::memory_order_release);
-    mRecordingEndFrame.store(-1, std::memory_order_release);
-    mRecordedSampleCount.store(0, std::memory_order_release);
-    mDroppedCaptureFrames.store(0, std::memory_order_release);
-    mShortInputFrames.store(0, std::memory_order_release);
-    mTailDrainFramesRemaining.store(0, std::memory_order_release);
-    mInputXRunBaseline = getInputXRunCount();
-    mOutputXRunBaseline = getOutputXRunCount();
-    mWriterShouldStop.store(false, std::memory_order_release);
-    mCaptureStopRequested.store(false, std::memory_order_release);
-    mWriterThread = std::thread(&AudioEngine::writerLoop, this);
-    mCaptureArmed.store(true, std::memory_order_release);
-    LOGI("Recording armed: requestedPunch=%lld, compensatedGate=%lld, compensationFrames=%lld",
-         static_cast<long long>(requestedPunchFrame),
-         static_cast<long long>(compensatedPunchFrame),
-         static_cast<long long>(mLatencyCompensationFrames.load(std::memory_order_acquire)));
+    // Same route, so the rate, tracks and compensation carry over.
+    const bool wasStarted = mStreamsStarted.load(std::memory_order_acquire);
+    if (!openStreams()) return false;
+    if (wasStarted) {
+        mCore.parkTransport();
+        if (!startStreamsLocked(false)) return false;
+    }
+    LOGI("Input reopened with %d channels", mCore.inputChannelCount());
     return true;
 }
 
-void AudioEngine::finishCaptureAtFrame(int64_t endFrame) {
-    mRecordingEndFrame.store(endFrame, std::memory_order_release);
-    mCaptureArmed.store(false, std::memory_order_release);
-    mCaptureStopRequested.store(false, std::memory_order_release);
-    mTailDrainFramesRemaining.store(0, std::memory_order_release);
+tapstory::MixdownResult AudioEngine::renderMixdown(
+        const std::string &filePath,
+        int64_t startFrame,
+        int64_t endFrame,
+        tapstory::MixdownFormat format) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mSampleRate <= 0) return {};
+
+    tapstory::MixdownOptions options;
+    options.format = format;
+    options.sampleRate = mSampleRate;
+    const tapstory::MixdownResult result = tapstory::renderMixdown(
+            mCore.trackStore(),
+            startFrame,
+            endFrame,
+            filePath,
+            options);
+    if (!result.ok) {
+        LOGE("Mixdown of frames [%lld, %lld) to %s failed",
+             static_cast<long long>(startFrame),
+             static_cast<long long>(endFrame),
+             filePath.c_str());
+        return result;
+    }
+    LOGI("Mixdown rendered %lld frames in %.3fs (%.1fx realtime, %d workers)",
+         static_cast<long long>(result.frameCount),
+         result.renderSeconds,
+         result.realtimeFactor,
+         result.workerCount);
+    return result;
 }
 
-void AudioEngine::finishCaptureAtCurrentFrame() {
-    finishCaptureAtFrame(mCurrentFrame.load(std::memory_order_acquire));
+tapstory::MixdownCache::UpdateResult AudioEngine::updateChainMix(
+        const std::string &filePath) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mSampleRate <= 0) return {};
+    if (!mChainMixCache
+        || mChainMixCache->path() != filePath
+        || mChainMixCache->sampleRate() != mSampleRate) {
+        mChainMixCache = std::make_unique<tapstory::MixdownCache>(filePath, mSampleRate);
+    }
+
+    const tapstory::MixdownCache::UpdateResult result =
+            mChainMixCache->update(mCore.trackStore());
+    if (!result.ok) {
+        LOGE("Chain mix update of %s failed", filePath.c_str());
+        return result;
+    }
+    LOGI("Chain mix updated: %lld frames, re-rendered %lld of %lld blocks in %.3fs",
+         static_cast<long long>(result.frameCount),
+         static_cast<long long>(result.renderedBlocks),
+         static_cast<long long>(result.blockCount),
+         result.renderSeconds);
+    return result;
 }
 
-void AudioEngine::waitForRealtimeProducer() {
-    while (mRealtimeProducerActive.load(std::memory_order_acquire)) {
-        std::this_thread::yield();
+tapstory::DuplexCore::TakeOnsetEnvelopes AudioEngine::getTakeOnsetEnvelopes() {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    return mCore.takeOnsetEnvelopes();
+}
+
+std::vector<tapstory::DuplexCore::LoopTakeLane> AudioEngine::getLoopTakeLanes() {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    return mCore.loopTakeLanes();
+}
+
+namespace {
+
+int32_t copyPeakBins(
+        const tapstory::PeakPyramid::Level &level,
+        int64_t fromBin,
+        std::vector<int16_t> &minMax) {
+    const auto first = static_cast<size_t>(std::max<int64_t>(0, fromBin));
+    minMax.clear();
+    if (level.minMax == nullptr) return 0;
+    if (first < level.binCount) {
+        minMax.assign(level.minMax + first * 2, level.minMax + level.binCount * 2);
     }
+    return level.framesPerBin;
 }
 
-void AudioEngine::stopRecording() {
-    std::unique_lock<std::mutex> lock(mControlMutex);
-    const bool hasWriter = mWriterThread.joinable();
-    if (!hasWriter && !mCaptureArmed.load(std::memory_order_acquire)) return;
+}  // namespace
+
+int32_t AudioEngine::getTrackPeaks(
+        const std::string &trackId,
+        int32_t framesPerBin,
+        int64_t fromBin,
+        std::vector<int16_t> &minMax) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    const std::shared_ptr<const tapstory::PeakPyramid> peaks = mCore.trackStore().peaks(trackId);
+    if (!peaks) {
+        minMax.clear();
+        return 0;
+    }
+    return copyPeakBins(
+            peaks->level(tapstory::PeakPyramid::levelIndexFor(framesPerBin)),
+            fromBin,
+            minMax);
+}
 
-    mCaptureStopRequested.store(true, std::memory_order_release);
-    if (!mIsRunning.load(std::memory_order_acquire)) {
-        if (mCaptureArmed.load(std::memory_order_acquire)) {
-            finishCaptureAtCurrentFrame();
+int32_t AudioEngine::getCapturePeaks(
+        int32_t framesPerBin,
+        int64_t fromBin,
+        std::vector<int16_t> &minMax) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    return copyPeakBins(
+            mCore.capturePeaks(tapstory::PeakPyramid::levelIndexFor(framesPerBin)),
+            fromBin,
+            minMax);
+}
+
+tapstory::LoopbackCalibration::Result AudioEngine::calibrateLatency() {
+    int32_t sampleRate = 0;
+    {
+        std::lock_guard<std::mutex> lock(mControlMutex);
+        if (mIsRunning.load(std::memory_order_acquire) || mSampleRate <= 0) {
+            LOGE("Calibration needs prepared, stopped duplex streams");
+            return {};
         }
-    } else {
-        // Stop on the next output callback boundary. If the stream has failed
-        // and no callback arrives, fall back to the last completed frame.
-        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
-        while (mCaptureArmed.load(std::memory_order_acquire)
-               && std::chrono::steady_clock::now() < deadline) {
-            lock.unlock();
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            lock.lock();
+        if (!mCore.beginCalibration(mSampleRate)) {
+            LOGE("Cannot calibrate while a capture is active");
+            return {};
         }
-        if (mCaptureArmed.load(std::memory_order_acquire)) {
-            finishCaptureAtCurrentFrame();
+        sampleRate = mSampleRate;
+    }
+
+    if (startSession()) {
+        // Twice the session length covers slow stream starts.
+        const auto deadline = std::chrono::steady_clock::now()
+                + std::chrono::milliseconds(static_cast<int64_t>(
+                        tapstory::LoopbackCalibration::kSessionSeconds * 2'000));
+        while (!mCore.isCalibrationComplete()
+               && mLastStreamError.load(std::memory_order_acquire) == 0
+               && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
         }
+        stopPlayback();
     }
 
-    waitForRealtimeProducer();
-    mWriterShouldStop.store(true, std::memory_order_release);
-    lock.unlock();
-    if (mWriterThread.joinable()) mWriterThread.join();
-    lock.lock();
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    const tapstory::LoopbackCalibration::Result result = mCore.finishCalibration();
+    if (!result.ok) {
+        LOGE("Loopback calibration failed (shortInput=%lld)",
+             static_cast<long long>(result.shortInputFrames));
+        return result;
+    }
+    LOGI("Loopback calibration: %lld frames (%.2fms), confidence=%.3f, shortInput=%lld",
+         static_cast<long long>(result.compensationFrames),
+         result.fractionalFrames * 1'000.0 / sampleRate,
+         result.confidence,
+         static_cast<long long>(result.shortInputFrames));
+    return result;
+}
 
-    if (mRecordingFile.is_open()) {
-        mRecordingFile.flush();
-        if (!mRecordingFile.good()) {
-            mLastStreamError.store(-1001, std::memory_order_release);
-        }
-        mRecordingFile.close();
-        if (mRecordingFile.fail()) {
-            mLastStreamError.store(-1001, std::memory_order_release);
-        }
+bool AudioEngine::startRecording(
+        const std::string &filePath,
+        int64_t punchFrame,
+        int64_t punchOutFrame,
+        const std::string &lanePathPrefix) {
+    stopRecording();
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mSampleRate <= 0) {
+        LOGE("Cannot record before duplex streams are prepared");
+        return false;
     }
-    LOGI("Recording finalized: requestedPunch=%lld, actualFirstFrame=%lld, endFrame=%lld, "
-         "rawFrames=%lld, dropped=%lld, shortInput=%lld, driftLimit=%lld, "
-         "inputXRuns=%d, outputXRuns=%d",
-         static_cast<long long>(mRequestedPunchFrame.load(std::memory_order_acquire)),
-         static_cast<long long>(mActualRecordingStartFrame.load(std::memory_order_acquire)),
-         static_cast<long long>(mRecordingEndFrame.load(std::memory_order_acquire)),
-         static_cast<long long>(mRecordedSampleCount.load(std::memory_order_acquire)),
-         static_cast<long long>(mDroppedCaptureFrames.load(std::memory_order_acquire)),
-         static_cast<long long>(mShortInputFrames.load(std::memory_order_acquire)),
-         static_cast<long long>(getCaptureClockDriftFrameLimit()),
-         getInputXRunDelta(),
-         getOutputXRunDelta());
+    if (getLastStreamError() != 0) {
+        LOGE("Cannot record after an audio stream or writer failure; reinitialize first");
+        return false;
+    }
+
+    const int64_t compensationFrames = mLatencyCompensationFrames.load(std::memory_order_acquire);
+    mInputXRunBaseline = getInputXRunCount();
+    mOutputXRunBaseline = getOutputXRunCount();
+    if (!mCore.armCapture(
+            filePath,
+            punchFrame,
+            compensationFrames,
+            punchOutFrame,
+            lanePathPrefix)) {
+        LOGE("Failed to arm recording file: %s", filePath.c_str());
+        return false;
+    }
+    LOGI("Recording armed: requestedPunch=%lld, compensatedGate=%lld, compensationFrames=%lld, "
+         "punchOut=%lld, lanes=%d",
+         static_cast<long long>(mCore.requestedPunchFrame()),
+         static_cast<long long>(mCore.captureGateFrame()),
+         static_cast<long long>(compensationFrames),
+         static_cast<long long>(punchOutFrame),
+         lanePathPrefix.empty() ? 0 : 1);
+    return true;
 }
 
-void AudioEngine::writerLoop() {
-    std::array<int16_t, kWriterChunkFrames> buffer{};
-    for (;;) {
-        const size_t framesRead = mRecordingRing
-                ? mRecordingRing->read(buffer.data(), buffer.size())
-                : 0;
-        if (framesRead > 0) {
-            mRecordingFile.write(
-                    reinterpret_cast<const char *>(buffer.data()),
-                    static_cast<std::streamsize>(framesRead * sizeof(int16_t)));
-            if (!mRecordingFile.good()) {
-                mLastStreamError.store(-1001, std::memory_order_release);
-                mWriterShouldStop.store(true, std::memory_order_release);
-                mCaptureStopRequested.store(true, std::memory_order_release);
-            } else {
-                mRecordedSampleCount.fetch_add(
-                        static_cast<int64_t>(framesRead),
-                        std::memory_order_release);
-            }
-            continue;
-        }
+bool AudioEngine::prepareCaptureBuffers() {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mSampleRate <= 0) return false;
+    if (mCore.hasCaptureBuffers()) return true;
+    const int64_t startNanos = steadyNanos();
+    mCore.allocateCaptureBuffers();
+    LOGI("Capture buffers allocated in %.2fms: ring=%zu frames",
+         static_cast<double>(steadyNanos() - startNanos) / 1e6,
+         mCore.captureRingCapacity());
+    return mCore.hasCaptureBuffers();
+}
 
-        if (mWriterShouldStop.load(std::memory_order_acquire)
-            && (!mRecordingRing || mRecordingRing->availableToRead() == 0)) {
-            break;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+bool AudioEngine::stopRecordingAtFrame(int64_t frame) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (!mCore.scheduleCaptureStop(frame)) {
+        LOGE("Refusing to schedule a recording stop at frame %lld",
+             static_cast<long long>(frame));
+        return false;
     }
+    LOGI("Recording stop scheduled at frame %lld", static_cast<long long>(frame));
+    return true;
+}
+
+void AudioEngine::stopRecording() {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (!mCore.finishCapture(mIsRunning.load(std::memory_order_acquire))) return;
+    LOGI("Recording finalized: requestedPunch=%lld, actualFirstFrame=%lld, endFrame=%lld, "
+         "rawFrames=%lld, dropped=%lld, shortInput=%lld, driftLimit=%lld, "
+         "inputXRuns=%d, outputXRuns=%d, writerFailed=%d",
+         static_cast<long long>(mCore.requestedPunchFrame()),
+         static_cast<long long>(mCore.actualCaptureStartFrame()),
+         static_cast<long long>(mCore.captureEndFrame()),
+         static_cast<long long>(mCore.recordedFrameCount()),
+         static_cast<long long>(mCore.droppedCaptureFrameCount()),
+         static_cast<long long>(mCore.shortInputFrameCount()),
+         static_cast<long long>(getCaptureClockDriftFrameLimit()),
+         getInputXRunDelta(),
+         getOutputXRunDelta(),
+         mCore.writerFailed() ? 1 : 0);
 }
 
 oboe::DataCallbackResult AudioEngine::onAudioReady(
@@ -486,20 +759,79 @@ oboe::DataCallbackResult AudioEngine::onAudioReady(
                 -1002,
                 std::memory_order_release,
                 std::memory_order_relaxed);
-        mCaptureStopRequested.store(true, std::memory_order_release);
+        mCore.requestCaptureStop();
+        mStreamsStarted.store(false, std::memory_order_release);
         mIsRunning.store(false, std::memory_order_release);
     }
     return result;
 }
 
-void AudioEngine::seekToFrame(int64_t frame) {
-    mCurrentFrame.store(std::max<int64_t>(0, frame), std::memory_order_release);
+bool AudioEngine::seekToFrame(int64_t frame) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mIsRunning.load(std::memory_order_acquire)) return mCore.requestSeek(frame);
+    mCore.seek(frame);
+    return true;
+}
+
+bool AudioEngine::setLoopRegion(int64_t startFrame, int64_t endFrame, int32_t crossfadeFrames) {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    return mCore.setLoopRegion(startFrame, endFrame, crossfadeFrames);
+}
+
+void AudioEngine::clearLoopRegion() {
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    mCore.clearLoopRegion();
+}
+
+bool AudioEngine::setPlaybackSpeed(double speed) {
+    if (!std::isfinite(speed) || speed <= 0.0 || speed > 1.0) return false;
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    constexpr int32_t kScale = tapstory::DuplexCore::kPlaybackSpeedScale;
+    const auto scaled = static_cast<int32_t>(std::lround(speed * kScale));
+    if (!mCore.setPlaybackSpeed(scaled)) return false;
+    LOGI("Playback speed %.3fx", static_cast<double>(scaled) / kScale);
+    return true;
 }
 
 void AudioEngine::invalidateAudioRoute() {
     mLastStreamError.store(-1003, std::memory_order_release);
-    mCaptureStopRequested.store(true, std::memory_order_release);
+    mCore.requestCaptureStop();
+    stopPlayback();
+}
+
+int32_t AudioEngine::recoverAudioRoute() {
     stopPlayback();
+    std::lock_guard<std::mutex> lock(mControlMutex);
+    if (mCore.isCaptureArmed() || mCore.isWriterActive()) {
+        LOGE("Refusing to reopen streams while a capture is active");
+        return 0;
+    }
+    const int32_t previousRate = mCore.trackStore().sampleRate();
+    const int64_t playhead = mCore.currentFrame();
+    const tapstory::DuplexCore::LoopRegion loop = mCore.loopRegion();
+    if (!openStreams()) return 0;
+
+    if (previousRate > 0 && previousRate != mSampleRate) {
+        mCore.seek(tapstory::rescaleFrame(playhead, previousRate, mSampleRate));
+        if (loop.active()) {
+            mCore.setLoopRegion(
+                    tapstory::rescaleFrame(loop.startFrame, previousRate, mSampleRate),
+                    tapstory::rescaleFrame(loop.endFrame, previousRate, mSampleRate),
+                    static_cast<int32_t>(tapstory::rescaleFrame(
+                            loop.crossfadeFrames, previousRate, mSampleRate)));
+        }
+    }
+    mLatencyCompensationFrames.store(0, std::memory_order_release);
+
+    // Timestamps are unavailable until both streams have moved audio, so the
+    // streams start parked and the caller reads latency once they have.
+    mCore.parkTransport();
+    if (!startStreamsLocked(false)) return 0;
+    LOGI("Duplex streams reopened after route change: rate %d -> %d, %zu tracks kept",
+         previousRate,
+         mSampleRate,
+         mCore.trackStore().size());
+    return mSampleRate;
 }
 
 oboe::DataCallbackResult AudioEngine::onBothStreamsReady(
@@ -507,117 +839,43 @@ oboe::DataCallbackResult AudioEngine::onBothStreamsReady(
         int numInputFrames,
         void *outputData,
         int numOutputFrames) {
-    mRealtimeProducerActive.store(true, std::memory_order_release);
-
-    auto *output = static_cast<float *>(outputData);
-    const int64_t callbackFrame = mCurrentFrame.load(std::memory_order_relaxed);
-    const int32_t outputFrames = std::max(0, numOutputFrames);
-    const int64_t remainingTailFrames = mTailDrainFramesRemaining.load(
-            std::memory_order_acquire);
-    const bool isTailDrain = remainingTailFrames > 0;
-    const bool captureStopRequested = mCaptureStopRequested.load(
-            std::memory_order_acquire);
-    const int32_t availableInputFrames = inputData == nullptr
-            ? 0
-            : std::max(0, numInputFrames);
-    const tapstory::TailDrainSlice tailSlice = isTailDrain
-            ? tapstory::computeTailDrainSlice(remainingTailFrames, availableInputFrames)
-            : tapstory::TailDrainSlice{outputFrames, 0, false};
-    const int32_t timelineFrames = tailSlice.timelineFrames;
-
-    std::fill_n(
-            output,
-            static_cast<size_t>(outputFrames) * kOutputChannelCount,
-            0.0f);
-
-    if (!isTailDrain) {
-        for (const Track &track : mTracks) {
-            const int64_t trackOffset = callbackFrame - track.startFrame;
-            if (trackOffset >= track.lengthFrames || trackOffset + outputFrames <= 0) continue;
-
-            for (int32_t frame = 0; frame < outputFrames; ++frame) {
-                const int64_t sampleIndex = trackOffset + frame;
-                if (sampleIndex < 0 || sampleIndex >= track.lengthFrames) continue;
-                const float sample = track.data[static_cast<size_t>(sampleIndex)];
-                output[frame * 2] += sample;
-                output[frame * 2 + 1] += sample;
-            }
-        }
-    }
-
-    for (int32_t sample = 0; sample < outputFrames * kOutputChannelCount; ++sample) {
-        output[sample] = std::max(-1.0f, std::min(1.0f, output[sample]));
-    }
-
-    bool captureStopped = false;
-    if (captureStopRequested) {
-        finishCaptureAtCurrentFrame();
-        captureStopped = true;
-    } else if (mCaptureArmed.load(std::memory_order_acquire) && mRecordingRing) {
-        const int32_t alignedInputFrames = inputData == nullptr
-                ? 0
-                : std::min(availableInputFrames, timelineFrames);
-        const bool started = mActualRecordingStartFrame.load(std::memory_order_acquire) >= 0;
-        const int64_t punchFrame = mPunchFrame.load(std::memory_order_acquire);
-        const tapstory::CaptureSlice expectedSlice = tapstory::computeCaptureSlice(
-                callbackFrame,
-                timelineFrames,
-                punchFrame,
-                started);
-        const tapstory::CaptureSlice slice = tapstory::computeCaptureSlice(
-                callbackFrame,
-                alignedInputFrames,
-                punchFrame,
-                started);
-        if (slice.frameCount < expectedSlice.frameCount) {
-            mShortInputFrames.fetch_add(
-                    expectedSlice.frameCount - slice.frameCount,
-                    std::memory_order_release);
-        }
-
-        if (slice.frameCount > 0 && inputData != nullptr) {
-            const auto *input = static_cast<const float *>(inputData) + slice.offsetFrames;
-            const size_t written = mRecordingRing->writeGenerated(
-                    static_cast<size_t>(slice.frameCount),
-                    [input](size_t index) noexcept {
-                        const float value = std::max(-1.0f, std::min(1.0f, input[index]));
-                        return static_cast<int16_t>(value * 32767.0f);
-                    });
-
-            if (written > 0 && !started) {
-                mActualRecordingStartFrame.store(
-                        slice.firstTimelineFrame,
-                        std::memory_order_release);
-            }
-            if (written < static_cast<size_t>(slice.frameCount)) {
-                mDroppedCaptureFrames.fetch_add(
-                        static_cast<int64_t>(slice.frameCount - written),
-                        std::memory_order_release);
-            }
-        }
-    }
-
-    const int64_t nextFrame = callbackFrame + timelineFrames;
-    mCurrentFrame.store(nextFrame, std::memory_order_release);
-    if (isTailDrain && !captureStopped) {
-        mTailDrainFramesRemaining.store(tailSlice.remainingFrames, std::memory_order_release);
-        if (tailSlice.complete) {
-            finishCaptureAtFrame(nextFrame);
-        }
-    }
-    mRealtimeProducerActive.store(false, std::memory_order_release);
+    if (mFirstCallbackNanos.load(std::memory_order_relaxed) < 0) {
+        mFirstCallbackNanos.store(steadyNanos() - mCreatedNanos, std::memory_order_release);
+    }
+    if (!mReadiness.isReady()) observeReadiness(numOutputFrames);
+    mCore.process(
+            static_cast<const float *>(inputData),
+            numInputFrames,
+            static_cast<float *>(outputData),
+            numOutputFrames);
     return oboe::DataCallbackResult::Continue;
 }
 
+void AudioEngine::observeReadiness(int32_t numFrames) noexcept {
+    // Only queried until the streams settle, so steady-state callbacks never
+    // pay for the timestamp and xrun reads.
+    tapstory::StreamReadiness::Observation observation;
+    observation.frames = numFrames;
+    observation.output = presentationTimestamp(mPlayStream);
+    observation.input = presentationTimestamp(mRecordStream);
+    const int32_t inputXRuns = xRunCount(mRecordStream);
+    const int32_t outputXRuns = xRunCount(mPlayStream);
+    observation.xrunCount = inputXRuns >= 0 && outputXRuns >= 0 ? inputXRuns + outputXRuns : -1;
+    observation.nowNanos = steadyNanos();
+    mReadiness.observe(observation);
+}
+
 void AudioEngine::onErrorBeforeClose(oboe::AudioStream *, oboe::Result error) {
     mLastStreamError.store(static_cast<int32_t>(error), std::memory_order_release);
-    mCaptureStopRequested.store(true, std::memory_order_release);
+    mCore.requestCaptureStop();
+    mStreamsStarted.store(false, std::memory_order_release);
     mIsRunning.store(false, std::memory_order_release);
 }
 
 void AudioEngine::onErrorAfterClose(oboe::AudioStream *, oboe::Result error) {
     mLastStreamError.store(static_cast<int32_t>(error), std::memory_order_release);
-    mCaptureStopRequested.store(true, std::memory_order_release);
+    mCore.requestCaptureStop();
+    mStreamsStarted.store(false, std::memory_order_release);
     mIsRunning.store(false, std::memory_order_release);
     if (getInputStream()) getInputStream()->requestStop();
 }
@@ -647,8 +905,7 @@ int32_t AudioEngine::getOutputXRunDelta() const {
 }
 
 int64_t AudioEngine::getCaptureClockDriftFrameLimit() const {
-    const int64_t timelineFrames = mRecordingEndFrame.load(std::memory_order_acquire)
-            - mActualRecordingStartFrame.load(std::memory_order_acquire);
+    const int64_t timelineFrames = mCore.captureTimelineFrameCount();
     const int32_t framesPerBurst = std::max(
             getInputFramesPerBurst(),
             getOutputFramesPerBurst());
@@ -656,17 +913,22 @@ int64_t AudioEngine::getCaptureClockDriftFrameLimit() const {
 }
 
 bool AudioEngine::isCaptureClockDriftWithinBounds() const {
-    const int64_t timelineFrames = mRecordingEndFrame.load(std::memory_order_acquire)
-            - mActualRecordingStartFrame.load(std::memory_order_acquire);
+    const int64_t timelineFrames = mCore.captureTimelineFrameCount();
     const int32_t framesPerBurst = std::max(
             getInputFramesPerBurst(),
             getOutputFramesPerBurst());
     return tapstory::isClockDriftWithinLimit(
-            mRecordedSampleCount.load(std::memory_order_acquire),
+            mCore.recordedFrameCount(),
             timelineFrames,
             framesPerBurst);
 }
 
+int32_t AudioEngine::getLastStreamError() const {
+    const int32_t error = mLastStreamError.load(std::memory_order_acquire);
+    if (error == 0 && mCore.writerFailed()) return -1001;
+    return error;
+}
+
 int32_t AudioEngine::getInputPerformanceMode() const {
     return mRecordStream ? static_cast<int32_t>(mRecordStream->getPerformanceMode()) : -1;
 }
@@ -6,28 +6,25 @@
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
-#include <fstream>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
 #include <vector>
 
+#include "audio/ChainContainer.h"
+#include "audio/DuplexCore.h"
+#include "audio/MixdownCache.h"
+#include "audio/OfflineMixdown.h"
 #include "audio/PunchCapture.h"
-#include "audio/SpscPcmRing.h"
-
-struct Track {
-    std::vector<float> data;
-    int64_t startFrame = 0;
-    int64_t lengthFrames = 0;
-};
+#include "audio/StreamReadiness.h"
 
 /**
  * Low-latency duplex engine.
  *
  * Oboe FullDuplexStream owns the input/output warmup and buffering policy. The
- * realtime callback only mixes already-decoded tracks and copies captured PCM
- * into a lock-free SPSC ring. File I/O is isolated on mWriterThread.
+ * realtime callback forwards both buffers to the shared tapstory::DuplexCore,
+ * which mixes already-decoded tracks and copies captured PCM into a lock-free
+ * ring drained by its writer thread.
  */
 class AudioEngine final : public oboe::FullDuplexStream,
                           public oboe::AudioStreamErrorCallback {
@@ -37,58 +34,166 @@ public:
 
     bool prepare();
     bool startSession();
+    /**
+     * Keep the duplex streams running with silent output while transport is
+     * stopped, so the next play or take begins at the next burst instead of
+     * paying stream start and warmup. Enabling starts prepared streams parked.
+     */
+    bool setHotIdle(bool enabled);
+    bool isHotIdle() const { return mHotIdle.load(std::memory_order_acquire); }
+    /** Request-to-first-rendered-callback time of the last start, or -1. */
+    int64_t getTransportStartDelayNanos() const { return mCore.transportStartDelayNanos(); }
+    bool wasLastStartHot() const { return mLastStartWasHot.load(std::memory_order_acquire); }
+    /**
+     * From the last stream start to the callback that found both streams
+     * stable (see tapstory::StreamReadiness), or -1 until then.
+     */
+    int64_t getStreamReadyNanos() const { return mReadiness.readyAfterNanos(); }
+    /** From engine creation until streams first opened, or -1 until then. */
+    int64_t getStreamsOpenedNanos() const {
+        return mStreamsOpenedNanos.load(std::memory_order_acquire);
+    }
+    /** From engine creation to the start of the first duplex callback, or -1 until then. */
+    int64_t getFirstCallbackNanos() const {
+        return mFirstCallbackNanos.load(std::memory_order_acquire);
+    }
     void stopPlayback();
     void reset();
 
+    /**
+     * `data` holds `numFrames` interleaved frames of `channelCount` samples at
+     * `sampleRate`, or at the stream rate when zero; other rates are converted
+     * as they play. `startFrame` is at the stream rate.
+     */
     bool loadTrack(
             const std::string &trackId,
             const int16_t *data,
             int32_t numFrames,
-            int64_t startFrame);
+            int64_t startFrame,
+            int32_t channelCount = 1,
+            int32_t sampleRate = 0);
+    /**
+     * Decode a WAV or FLAC file natively at its own rate and load it like
+     * `loadTrack`. False for other formats, which the caller decodes with
+     * MediaCodec instead.
+     */
+    bool loadTrackFile(const std::string &trackId, const std::string &path, int64_t startFrame);
+    /**
+     * Load `trackId` as a view into the chain container at `path` when the
+     * container holds it at `startFrame`, whatever rate the segment is at.
+     * False when it does not, so the caller decodes the source file instead.
+     */
+    bool loadChainSegment(const std::string &path, const std::string &trackId, int64_t startFrame);
+    /** Append the decoded track `trackId` to the chain container at `path`. */
+    bool appendChainSegment(const std::string &path, const std::string &trackId);
     bool clearTracks();
+    /**
+     * Play from two pre-mixed turn lanes instead of mixing every track per
+     * callback (see `tapstory::ChainStems`). Loads and clears keep the lanes
+     * current; refused while audio is running.
+     */
+    bool setStemMixing(bool enabled);
+    /**
+     * Capture `channelCount` interleaved channels (1 or 2) from the next
+     * stream open on; open streams are reopened on the same route, parked if
+     * they were running. Refused while audio runs or a take is active.
+     */
+    bool setInputChannelCount(int32_t channelCount);
+    /** Channels of the open input stream, which takes are written with. */
+    int32_t getInputChannelCount() const { return mCore.inputChannelCount(); }
+    /**
+     * Offline render of the loaded tracks over [startFrame, endFrame) at the
+     * stream rate. Holds the control lock so tracks cannot change underneath
+     * the render; playback may keep running.
+     */
+    tapstory::MixdownResult renderMixdown(
+            const std::string &filePath,
+            int64_t startFrame,
+            int64_t endFrame,
+            tapstory::MixdownFormat format);
+    /**
+     * Bring the whole-chain WAV at `filePath` up to date, re-rendering only
+     * the blocks whose contributing tracks changed since the last call.
+     */
+    tapstory::MixdownCache::UpdateResult updateChainMix(const std::string &filePath);
 
-    bool startRecording(const std::string &filePath, int64_t punchFrame);
+    /**
+     * Measure the round trip of the current route by playing a sweep and
+     * recording it in one duplex session. Transport must be stopped; the
+     * compensation is returned, not applied.
+     */
+    tapstory::LoopbackCalibration::Result calibrateLatency();
+    /** Onset envelopes of the last finished take and of the mix it was played over. */
+    tapstory::DuplexCore::TakeOnsetEnvelopes getTakeOnsetEnvelopes();
+    /** Per-pass lanes of the last take armed with a lane prefix. */
+    std::vector<tapstory::DuplexCore::LoopTakeLane> getLoopTakeLanes();
+    /**
+     * Min/max pairs from bin `fromBin` on of the peak level nearest
+     * `framesPerBin`, for a loaded track or for the take being captured.
+     * Return that level's frames per bin, or zero when there is nothing to draw.
+     */
+    int32_t getTrackPeaks(
+            const std::string &trackId,
+            int32_t framesPerBin,
+            int64_t fromBin,
+            std::vector<int16_t> &minMax);
+    int32_t getCapturePeaks(int32_t framesPerBin, int64_t fromBin, std::vector<int16_t> &minMax);
+
+    /**
+     * Arm a take; with `punchOutFrame` >= 0 it ends there while playback runs
+     * on. A `lanePathPrefix` records a looped take across passes as lanes.
+     */
+    bool startRecording(
+            const std::string &filePath,
+            int64_t punchFrame,
+            int64_t punchOutFrame = tapstory::DuplexCore::kUnsetFrame,
+            const std::string &lanePathPrefix = {});
+    /**
+     * End the armed take at `frame` from inside the callback; a later
+     * `stopRecording` then finalizes without waiting on callbacks.
+     */
+    bool stopRecordingAtFrame(int64_t frame);
     void stopRecording();
+    /**
+     * Allocate the capture ring and live peaks ahead of the first take so
+     * arming does not; streams only size them. Call off the UI thread.
+     */
+    bool prepareCaptureBuffers();
     void setLatencyCompensationFrames(int64_t frames) {
         mLatencyCompensationFrames.store(
                 std::max<int64_t>(0, frames),
                 std::memory_order_release);
     }
     void invalidateAudioRoute();
+    /**
+     * Reopen the streams on the current route after `invalidateAudioRoute`,
+     * keeping loaded tracks: they, the playhead and any loop region move to
+     * the new rate. Streams restart parked so latency timestamps warm up;
+     * compensation measured on the old route is dropped. Returns the new
+     * rate, or zero while a take is still armed or being written.
+     */
+    int32_t recoverAudioRoute();
 
-    int64_t getRecordingStartFrame() const {
-        return mActualRecordingStartFrame.load(std::memory_order_acquire);
-    }
-    int64_t getRecordingEndFrame() const {
-        return mRecordingEndFrame.load(std::memory_order_acquire);
-    }
-    int64_t getRequestedPunchFrame() const {
-        return mRequestedPunchFrame.load(std::memory_order_acquire);
-    }
+    int64_t getRecordingStartFrame() const { return mCore.actualCaptureStartFrame(); }
+    int64_t getRecordingEndFrame() const { return mCore.captureEndFrame(); }
+    int64_t getRequestedPunchFrame() const { return mCore.requestedPunchFrame(); }
     int64_t getLatencyCompensationFrames() const {
         return mLatencyCompensationFrames.load(std::memory_order_acquire);
     }
-    int64_t getRecordedSampleCount() const {
-        return mRecordedSampleCount.load(std::memory_order_acquire);
-    }
-    int64_t getDroppedCaptureFrameCount() const {
-        return mDroppedCaptureFrames.load(std::memory_order_acquire);
-    }
-    int64_t getShortInputFrameCount() const {
-        return mShortInputFrames.load(std::memory_order_acquire);
-    }
+    int64_t getRecordedSampleCount() const { return mCore.recordedFrameCount(); }
+    int64_t getDroppedCaptureFrameCount() const { return mCore.droppedCaptureFrameCount(); }
+    int64_t getShortInputFrameCount() const { return mCore.shortInputFrameCount(); }
     bool isCaptureOnsetExact() const {
         return tapstory::isExactCaptureOnset(
-                mActualRecordingStartFrame.load(std::memory_order_acquire),
-                mPunchFrame.load(std::memory_order_acquire));
+                mCore.actualCaptureStartFrame(),
+                mCore.captureGateFrame());
     }
+    int64_t getCaptureTimelineFrameCount() const { return mCore.captureTimelineFrameCount(); }
     bool isCaptureClockDriftWithinBounds() const;
     int64_t getCaptureClockDriftFrameLimit() const;
     int32_t getInputXRunDelta() const;
     int32_t getOutputXRunDelta() const;
-    int64_t getCurrentFrame() const {
-        return mCurrentFrame.load(std::memory_order_acquire);
-    }
+    int64_t getCurrentFrame() const { return mCore.playheadFrame(); }
     int32_t getSampleRate() const { return mSampleRate; }
     int32_t getInputFramesPerBurst() const;
     int32_t getOutputFramesPerBurst() const;
@@ -96,13 +201,23 @@ public:
     int32_t getOutputXRunCount() const;
     int32_t getInputPerformanceMode() const;
     int32_t getOutputPerformanceMode() const;
-    int32_t getLastStreamError() const {
-        return mLastStreamError.load(std::memory_order_acquire);
-    }
+    int32_t getLastStreamError() const;
     double getInputLatencyMillis();
     double getOutputLatencyMillis();
 
-    void seekToFrame(int64_t frame);
+    /**
+     * Move the playhead. While streams run the core applies it at the next
+     * callback with a short crossfade; refused while a take is armed.
+     */
+    bool seekToFrame(int64_t frame);
+    /** Loop playback over [startFrame, endFrame) inside the callback. */
+    bool setLoopRegion(int64_t startFrame, int64_t endFrame, int32_t crossfadeFrames);
+    void clearLoopRegion();
+    /**
+     * Practice playback at `speed` times the nominal rate, 0.5 to 1.0, from
+     * the next callback. Refused while a take is armed.
+     */
+    bool setPlaybackSpeed(double speed);
 
     oboe::DataCallbackResult onBothStreamsReady(
             const void *inputData,
@@ -118,49 +233,45 @@ public:
     void onErrorAfterClose(oboe::AudioStream *stream, oboe::Result error) override;
 
 private:
-    static constexpr int32_t kOutputChannelCount = 2;
-    static constexpr int32_t kInputChannelCount = 1;
+    static constexpr int32_t kOutputChannelCount = tapstory::DuplexCore::kOutputChannelCount;
     static constexpr int32_t kRecordingRingSeconds = 10;
-    static constexpr size_t kWriterChunkFrames = 4096;
 
     bool openStreams();
     void closeStreams();
-    void writerLoop();
-    void finishCaptureAtFrame(int64_t endFrame);
-    void finishCaptureAtCurrentFrame();
-    void waitForRealtimeProducer();
+    bool startStreamsLocked(bool transportRunning);
+    void stopStreamsLocked();
     void refreshLatencyDiagnosticsLocked();
+    void observeReadiness(int32_t numFrames) noexcept;
 
     std::shared_ptr<oboe::AudioStream> mPlayStream;
     std::shared_ptr<oboe::AudioStream> mRecordStream;
 
-    // Mutated only while playback is fully stopped; callback reads without a lock.
-    std::vector<Track> mTracks;
+    // Tracks are mutated only while playback is fully stopped; the callback
+    // reads the core's track store without a lock.
+    tapstory::DuplexCore mCore;
+    tapstory::StreamReadiness mReadiness;
     std::mutex mControlMutex;
+    std::unique_ptr<tapstory::MixdownCache> mChainMixCache;
+    // Mapped once per load pass; loaded tracks keep their own reference.
+    std::shared_ptr<const tapstory::ChainContainer> mChain;
 
-    std::unique_ptr<tapstory::SpscPcmRing> mRecordingRing;
-    std::thread mWriterThread;
-    std::ofstream mRecordingFile;
-    std::atomic<bool> mWriterShouldStop{false};
-    std::atomic<bool> mCaptureArmed{false};
-    std::atomic<bool> mCaptureStopRequested{false};
-    std::atomic<bool> mRealtimeProducerActive{false};
-    std::atomic<int64_t> mPunchFrame{0};
-    std::atomic<int64_t> mRequestedPunchFrame{0};
     std::atomic<int64_t> mLatencyCompensationFrames{0};
-    std::atomic<int64_t> mActualRecordingStartFrame{-1};
-    std::atomic<int64_t> mRecordingEndFrame{-1};
-    std::atomic<int64_t> mRecordedSampleCount{0};
-    std::atomic<int64_t> mDroppedCaptureFrames{0};
-    std::atomic<int64_t> mShortInputFrames{0};
-    std::atomic<int64_t> mTailDrainFramesRemaining{0};
     int32_t mInputXRunBaseline = -1;
     int32_t mOutputXRunBaseline = -1;
 
-    std::atomic<int64_t> mCurrentFrame{0};
+    // Running means transport; in hot idle the streams are started while the
+    // core holds the transport parked.
     std::atomic<bool> mIsRunning{false};
+    std::atomic<bool> mStreamsStarted{false};
+    std::atomic<bool> mHotIdle{false};
+    std::atomic<bool> mLastStartWasHot{false};
     std::atomic<int32_t> mLastStreamError{0};
+    // Startup instrumentation, relative to construction.
+    const int64_t mCreatedNanos;
+    std::atomic<int64_t> mStreamsOpenedNanos{-1};
+    std::atomic<int64_t> mFirstCallbackNanos{-1};
     int32_t mSampleRate = 0;
+    int32_t mInputChannelCount = 1;
     double mLastInputLatencyMillis = -1.0;
     double mLastOutputLatencyMillis = -1.0;
 };
@@ -1,10 +1,13 @@
 #include <jni.h>
 
+#include <algorithm>
 #include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <vector>
 
 #include "AudioEngine.h"
+#include "audio/PunchTakes.h"
 
 namespace {
 AudioEngine *engine = nullptr;
@@ -12,6 +15,25 @@ AudioEngine *engine = nullptr;
 // different threads. Hold this for every engine access so deletion cannot race
 // a route callback, notifier poll, diagnostic read, or recording finalization.
 std::shared_mutex engineMutex;
+
+// [framesPerBin, fromBin, min, max, ...], or null when there is nothing to draw.
+jintArray makePeakArray(
+        JNIEnv *env,
+        int32_t framesPerBin,
+        jlong fromBin,
+        const std::vector<int16_t> &minMax) {
+    if (framesPerBin <= 0) return nullptr;
+    std::vector<jint> values;
+    values.reserve(2 + minMax.size());
+    values.push_back(framesPerBin);
+    values.push_back(static_cast<jint>(std::max<jlong>(0, fromBin)));
+    values.insert(values.end(), minMax.begin(), minMax.end());
+    const jsize count = static_cast<jsize>(values.size());
+    jintArray array = env->NewIntArray(count);
+    if (array) env->SetIntArrayRegion(array, 0, count, values.data());
+    return array;
+}
+
 }
 
 extern "C" {
@@ -42,6 +64,49 @@ Java_com_tapstory_audio_TapStoryAudioEngine_nativeStart(JNIEnv *, jobject) {
     return engine && engine->startSession() ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeSetHotIdle(
+        JNIEnv *, jobject, jboolean enabled) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine && engine->setHotIdle(enabled == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetTransportStartDelayNanos(JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine ? static_cast<jlong>(engine->getTransportStartDelayNanos()) : -1;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeWasLastStartHot(JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine && engine->wasLastStartHot() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetStreamReadyNanos(JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine ? static_cast<jlong>(engine->getStreamReadyNanos()) : -1;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetStreamsOpenedNanos(JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine ? static_cast<jlong>(engine->getStreamsOpenedNanos()) : -1;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetFirstCallbackNanos(JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine ? static_cast<jlong>(engine->getFirstCallbackNanos()) : -1;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativePrepareCaptureBuffers(JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine && engine->prepareCaptureBuffers() ? JNI_TRUE : JNI_FALSE;
+}
+
 JNIEXPORT void JNICALL
 Java_com_tapstory_audio_TapStoryAudioEngine_nativeStop(JNIEnv *, jobject) {
     std::shared_lock<std::shared_mutex> lock(engineMutex);
@@ -54,42 +119,346 @@ Java_com_tapstory_audio_TapStoryAudioEngine_nativeLoadTrack(
         jobject,
         jstring trackId,
         jshortArray audioData,
+        jint channelCount,
+        jint sampleRate,
         jlong startFrame) {
     std::shared_lock<std::shared_mutex> lock(engineMutex);
-    if (!engine || !trackId || !audioData) return JNI_FALSE;
+    if (!engine || !trackId || !audioData || channelCount <= 0) return JNI_FALSE;
 
     const char *idChars = env->GetStringUTFChars(trackId, nullptr);
     if (!idChars) return JNI_FALSE;
     const std::string id(idChars);
     env->ReleaseStringUTFChars(trackId, idChars);
 
-    const jsize frameCount = env->GetArrayLength(audioData);
+    const jsize frameCount = env->GetArrayLength(audioData) / channelCount;
     jshort *samples = env->GetShortArrayElements(audioData, nullptr);
     if (!samples) return JNI_FALSE;
-    const bool loaded = engine->loadTrack(id, samples, frameCount, startFrame);
+    const bool loaded =
+            engine->loadTrack(id, samples, frameCount, startFrame, channelCount, sampleRate);
     env->ReleaseShortArrayElements(audioData, samples, JNI_ABORT);
     return loaded ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeLoadTrackFile(
+        JNIEnv *env,
+        jobject,
+        jstring trackId,
+        jstring filePath,
+        jlong startFrame) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine || !trackId || !filePath) return JNI_FALSE;
+    const char *idChars = env->GetStringUTFChars(trackId, nullptr);
+    if (!idChars) return JNI_FALSE;
+    const std::string id(idChars);
+    env->ReleaseStringUTFChars(trackId, idChars);
+    const char *pathChars = env->GetStringUTFChars(filePath, nullptr);
+    if (!pathChars) return JNI_FALSE;
+    const std::string path(pathChars);
+    env->ReleaseStringUTFChars(filePath, pathChars);
+    return engine->loadTrackFile(id, path, startFrame) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeLoadChainSegment(
+        JNIEnv *env,
+        jobject,
+        jstring chainPath,
+        jstring trackId,
+        jlong startFrame) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine || !chainPath || !trackId) return JNI_FALSE;
+    const char *pathChars = env->GetStringUTFChars(chainPath, nullptr);
+    if (!pathChars) return JNI_FALSE;
+    const std::string path(pathChars);
+    env->ReleaseStringUTFChars(chainPath, pathChars);
+    const char *idChars = env->GetStringUTFChars(trackId, nullptr);
+    if (!idChars) return JNI_FALSE;
+    const std::string id(idChars);
+    env->ReleaseStringUTFChars(trackId, idChars);
+    return engine->loadChainSegment(path, id, startFrame) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeAppendChainSegment(
+        JNIEnv *env,
+        jobject,
+        jstring chainPath,
+        jstring trackId) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine || !chainPath || !trackId) return JNI_FALSE;
+    const char *pathChars = env->GetStringUTFChars(chainPath, nullptr);
+    if (!pathChars) return JNI_FALSE;
+    const std::string path(pathChars);
+    env->ReleaseStringUTFChars(chainPath, pathChars);
+    const char *idChars = env->GetStringUTFChars(trackId, nullptr);
+    if (!idChars) return JNI_FALSE;
+    const std::string id(idChars);
+    env->ReleaseStringUTFChars(trackId, idChars);
+    return engine->appendChainSegment(path, id) ? JNI_TRUE : JNI_FALSE;
+}
+
 JNIEXPORT jboolean JNICALL
 Java_com_tapstory_audio_TapStoryAudioEngine_nativeClearTracks(JNIEnv *, jobject) {
     std::shared_lock<std::shared_mutex> lock(engineMutex);
     return engine && engine->clearTracks() ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeSetStemMixing(
+        JNIEnv *, jobject, jboolean enabled) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine && engine->setStemMixing(enabled == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeSetInputChannelCount(
+        JNIEnv *, jobject, jint channelCount) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine && engine->setInputChannelCount(channelCount) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetInputChannelCount(JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine ? engine->getInputChannelCount() : 0;
+}
+
+JNIEXPORT jdoubleArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeRenderMixdown(
+        JNIEnv *env,
+        jobject,
+        jstring filePath,
+        jlong startFrame,
+        jlong endFrame,
+        jboolean flac) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine || !filePath) return nullptr;
+    const char *pathChars = env->GetStringUTFChars(filePath, nullptr);
+    if (!pathChars) return nullptr;
+    const std::string path(pathChars);
+    env->ReleaseStringUTFChars(filePath, pathChars);
+
+    const tapstory::MixdownResult result = engine->renderMixdown(
+            path,
+            static_cast<int64_t>(startFrame),
+            static_cast<int64_t>(endFrame),
+            flac ? tapstory::MixdownFormat::Flac : tapstory::MixdownFormat::Wav);
+    if (!result.ok) return nullptr;
+    // [frameCount, renderSeconds, realtimeFactor, workerCount]
+    const jdouble values[] = {
+        static_cast<jdouble>(result.frameCount),
+        result.renderSeconds,
+        result.realtimeFactor,
+        static_cast<jdouble>(result.workerCount),
+    };
+    jdoubleArray array = env->NewDoubleArray(4);
+    if (array) env->SetDoubleArrayRegion(array, 0, 4, values);
+    return array;
+}
+
+JNIEXPORT jdoubleArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeUpdateChainMix(
+        JNIEnv *env,
+        jobject,
+        jstring filePath) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine || !filePath) return nullptr;
+    const char *pathChars = env->GetStringUTFChars(filePath, nullptr);
+    if (!pathChars) return nullptr;
+    const std::string path(pathChars);
+    env->ReleaseStringUTFChars(filePath, pathChars);
+
+    const tapstory::MixdownCache::UpdateResult result = engine->updateChainMix(path);
+    if (!result.ok) return nullptr;
+    // [frameCount, blockCount, renderedBlocks, renderSeconds]
+    const jdouble values[] = {
+        static_cast<jdouble>(result.frameCount),
+        static_cast<jdouble>(result.blockCount),
+        static_cast<jdouble>(result.renderedBlocks),
+        result.renderSeconds,
+    };
+    jdoubleArray array = env->NewDoubleArray(4);
+    if (array) env->SetDoubleArrayRegion(array, 0, 4, values);
+    return array;
+}
+
+JNIEXPORT jdoubleArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeCalibrateLatency(
+        JNIEnv *env,
+        jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine) return nullptr;
+
+    const tapstory::LoopbackCalibration::Result result = engine->calibrateLatency();
+    if (!result.ok) return nullptr;
+    // [compensationFrames, fractionalFrames, confidence, shortInputFrames]
+    const jdouble values[] = {
+        static_cast<jdouble>(result.compensationFrames),
+        result.fractionalFrames,
+        result.confidence,
+        static_cast<jdouble>(result.shortInputFrames),
+    };
+    jdoubleArray array = env->NewDoubleArray(4);
+    if (array) env->SetDoubleArrayRegion(array, 0, 4, values);
+    return array;
+}
+
+JNIEXPORT jdoubleArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetTakeOnsetEnvelopes(
+        JNIEnv *env,
+        jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine) return nullptr;
+
+    const tapstory::DuplexCore::TakeOnsetEnvelopes envelopes = engine->getTakeOnsetEnvelopes();
+    if (envelopes.blockFrames <= 0) return nullptr;
+    // [blockFrames, startFrame, takeBlockCount, take..., mix...]
+    std::vector<jdouble> values;
+    values.reserve(3 + envelopes.take.size() + envelopes.mix.size());
+    values.push_back(static_cast<jdouble>(envelopes.blockFrames));
+    values.push_back(static_cast<jdouble>(envelopes.startFrame));
+    values.push_back(static_cast<jdouble>(envelopes.take.size()));
+    values.insert(values.end(), envelopes.take.begin(), envelopes.take.end());
+    values.insert(values.end(), envelopes.mix.begin(), envelopes.mix.end());
+    const jsize count = static_cast<jsize>(values.size());
+    jdoubleArray array = env->NewDoubleArray(count);
+    if (array) env->SetDoubleArrayRegion(array, 0, count, values.data());
+    return array;
+}
+
+JNIEXPORT jintArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetTrackPeaks(
+        JNIEnv *env,
+        jobject,
+        jstring trackId,
+        jint framesPerBin,
+        jlong fromBin) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine || !trackId) return nullptr;
+    const char *idChars = env->GetStringUTFChars(trackId, nullptr);
+    if (!idChars) return nullptr;
+    const std::string id(idChars);
+    env->ReleaseStringUTFChars(trackId, idChars);
+
+    std::vector<int16_t> minMax;
+    const int32_t levelFrames = engine->getTrackPeaks(id, framesPerBin, fromBin, minMax);
+    return makePeakArray(env, levelFrames, fromBin, minMax);
+}
+
+JNIEXPORT jintArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetCapturePeaks(
+        JNIEnv *env,
+        jobject,
+        jint framesPerBin,
+        jlong fromBin) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine) return nullptr;
+
+    std::vector<int16_t> minMax;
+    const int32_t levelFrames = engine->getCapturePeaks(framesPerBin, fromBin, minMax);
+    return makePeakArray(env, levelFrames, fromBin, minMax);
+}
+
 JNIEXPORT jboolean JNICALL
 Java_com_tapstory_audio_TapStoryAudioEngine_nativeStartRecording(
         JNIEnv *env,
         jobject,
         jstring filePath,
-        jlong punchFrame) {
+        jlong punchFrame,
+        jlong punchOutFrame,
+        jstring lanePathPrefix) {
     std::shared_lock<std::shared_mutex> lock(engineMutex);
     if (!engine || !filePath) return JNI_FALSE;
     const char *pathChars = env->GetStringUTFChars(filePath, nullptr);
     if (!pathChars) return JNI_FALSE;
     const std::string path(pathChars);
     env->ReleaseStringUTFChars(filePath, pathChars);
-    return engine->startRecording(path, punchFrame) ? JNI_TRUE : JNI_FALSE;
+    std::string prefix;
+    if (lanePathPrefix) {
+        const char *prefixChars = env->GetStringUTFChars(lanePathPrefix, nullptr);
+        if (!prefixChars) return JNI_FALSE;
+        prefix = prefixChars;
+        env->ReleaseStringUTFChars(lanePathPrefix, prefixChars);
+    }
+    return engine->startRecording(path, punchFrame, punchOutFrame, prefix) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetLoopTakeLanes(
+        JNIEnv *env,
+        jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine) return nullptr;
+
+    const std::vector<tapstory::DuplexCore::LoopTakeLane> lanes = engine->getLoopTakeLanes();
+    if (lanes.empty()) return nullptr;
+    // [passIndex, startFrame, endFrame, rawFrameCount, driftFrames] per lane
+    std::vector<jlong> values;
+    values.reserve(lanes.size() * 5);
+    for (const tapstory::DuplexCore::LoopTakeLane &lane : lanes) {
+        values.push_back(lane.passIndex);
+        values.push_back(lane.startFrame);
+        values.push_back(lane.endFrame);
+        values.push_back(lane.rawFrameCount);
+        values.push_back(lane.driftFrames);
+    }
+    const auto count = static_cast<jsize>(values.size());
+    jlongArray array = env->NewLongArray(count);
+    if (array) env->SetLongArrayRegion(array, 0, count, values.data());
+    return array;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetCaptureTimelineFrameCount(
+        JNIEnv *,
+        jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine ? engine->getCaptureTimelineFrameCount() : 0;
+}
+
+// Pure file work on a finalized take, so it needs no engine.
+JNIEXPORT jlongArray JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeWritePunchTakes(
+        JNIEnv *env,
+        jobject,
+        jstring takePath,
+        jlong takeStartFrame,
+        jlongArray rangeFrames,
+        jstring pathPrefix) {
+    if (!takePath || !rangeFrames || !pathPrefix) return nullptr;
+    const char *takeChars = env->GetStringUTFChars(takePath, nullptr);
+    if (!takeChars) return nullptr;
+    const std::string take(takeChars);
+    env->ReleaseStringUTFChars(takePath, takeChars);
+    const char *prefixChars = env->GetStringUTFChars(pathPrefix, nullptr);
+    if (!prefixChars) return nullptr;
+    const std::string prefix(prefixChars);
+    env->ReleaseStringUTFChars(pathPrefix, prefixChars);
+
+    // [start0, end0, start1, end1, ...]
+    const jsize valueCount = env->GetArrayLength(rangeFrames);
+    std::vector<jlong> values(static_cast<size_t>(valueCount));
+    env->GetLongArrayRegion(rangeFrames, 0, valueCount, values.data());
+    std::vector<tapstory::PunchRange> ranges;
+    for (size_t index = 0; index + 1 < values.size(); index += 2) {
+        ranges.push_back({values[index], values[index + 1]});
+    }
+
+    std::vector<tapstory::PunchTake> takes;
+    if (!tapstory::writePunchTakes(take, takeStartFrame, ranges, prefix, takes)) return nullptr;
+    // [rangeIndex, startFrame, frameCount] per take; unreached ranges are absent.
+    std::vector<jlong> result;
+    result.reserve(takes.size() * 3);
+    for (const tapstory::PunchTake &punchTake : takes) {
+        result.push_back(static_cast<jlong>(punchTake.rangeIndex));
+        result.push_back(punchTake.startFrame);
+        result.push_back(punchTake.frameCount);
+    }
+    const auto count = static_cast<jsize>(result.size());
+    jlongArray array = env->NewLongArray(count);
+    if (array) env->SetLongArrayRegion(array, 0, count, result.data());
+    return array;
 }
 
 JNIEXPORT void JNICALL
@@ -106,6 +475,22 @@ Java_com_tapstory_audio_TapStoryAudioEngine_nativeInvalidateAudioRoute(
     if (engine) engine->invalidateAudioRoute();
 }
 
+JNIEXPORT jint JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeRecoverAudioRoute(
+        JNIEnv *, jobject) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine ? engine->recoverAudioRoute() : 0;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeStopRecordingAtFrame(
+        JNIEnv *, jobject, jlong frame) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return engine && engine->stopRecordingAtFrame(static_cast<int64_t>(frame))
+            ? JNI_TRUE
+            : JNI_FALSE;
+}
+
 JNIEXPORT void JNICALL
 Java_com_tapstory_audio_TapStoryAudioEngine_nativeStopRecording(JNIEnv *, jobject) {
     std::shared_lock<std::shared_mutex> lock(engineMutex);
@@ -118,11 +503,34 @@ Java_com_tapstory_audio_TapStoryAudioEngine_nativeGetCurrentFrame(JNIEnv *, jobj
     return engine ? static_cast<jlong>(engine->getCurrentFrame()) : 0;
 }
 
-JNIEXPORT void JNICALL
+JNIEXPORT jboolean JNICALL
 Java_com_tapstory_audio_TapStoryAudioEngine_nativeSeekToFrame(
         JNIEnv *, jobject, jlong frame) {
     std::shared_lock<std::shared_mutex> lock(engineMutex);
-    if (engine) engine->seekToFrame(static_cast<int64_t>(frame));
+    return engine && engine->seekToFrame(static_cast<int64_t>(frame)) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeSetLoopRegion(
+        JNIEnv *, jobject, jlong startFrame, jlong endFrame, jint crossfadeFrames) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine) return JNI_FALSE;
+    if (endFrame <= startFrame) {
+        engine->clearLoopRegion();
+        return JNI_TRUE;
+    }
+    return engine->setLoopRegion(
+            static_cast<int64_t>(startFrame),
+            static_cast<int64_t>(endFrame),
+            static_cast<int32_t>(crossfadeFrames)) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_tapstory_audio_TapStoryAudioEngine_nativeSetPlaybackSpeed(
+        JNIEnv *, jobject, jdouble speed) {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    if (!engine) return JNI_FALSE;
+    return engine->setPlaybackSpeed(static_cast<double>(speed)) ? JNI_TRUE : JNI_FALSE;
 }
 
 JNIEXPORT jlong JNICALL
@@ -27,9 +27,120 @@ data class RecordingResult(
     val clockDriftFrameLimit: Long,
     val inputXRunCount: Int,
     val outputXRunCount: Int,
+    val sampleRate: Int,
+    /** One WAV per requested range of a multi-range pass; empty otherwise. */
+    val punchTakes: List<PunchTakeResult> = emptyList(),
+    /** One WAV per loop pass of a take recorded as lanes; empty otherwise. */
+    val loopTakes: List<LoopTakeResult> = emptyList()
+)
+
+/**
+ * One loop pass of a take recorded as lanes. Pass 0 starts at the punch,
+ * later passes at the loop start. driftFrames is raw input frames minus
+ * timeline frames; the lane holds the raw frames uncorrected.
+ */
+data class LoopTakeResult(
+    val uri: String,
+    val passIndex: Int,
+    val startTimeMs: Long,
+    val durationMs: Long,
+    val startFrame: Long,
+    val frameCount: Long,
+    val driftFrames: Long
+)
+
+/**
+ * One range of a multi-range pass, cut from the pass's aligned take.
+ * rangeIndex is the range's position in the request; ranges the pass never
+ * reached have no take.
+ */
+data class PunchTakeResult(
+    val uri: String,
+    val rangeIndex: Int,
+    val startTimeMs: Long,
+    val durationMs: Long,
+    val startFrame: Long,
+    val frameCount: Long
+)
+
+/**
+ * An offline render of the loaded tracks. realtimeFactor is seconds of audio
+ * rendered per second of wall-clock time.
+ */
+data class MixdownResult(
+    val uri: String,
+    val format: String,
+    val startFrame: Long,
+    val frameCount: Long,
+    val durationMs: Long,
+    val renderMs: Double,
+    val realtimeFactor: Double,
+    val workerCount: Int,
     val sampleRate: Int
 )
 
+/**
+ * The incrementally maintained whole-chain WAV. renderedBlocks of blockCount
+ * were re-rendered by this update; the rest were reused from the last one.
+ */
+data class ChainMixResult(
+    val uri: String,
+    val frameCount: Long,
+    val durationMs: Long,
+    val blockCount: Long,
+    val renderedBlocks: Long,
+    val renderMs: Double,
+    val sampleRate: Int
+)
+
+/**
+ * A loopback round-trip measurement of the current route. It is not applied;
+ * pass compensationMs to setLatencyCompensationMs when confidence is high.
+ */
+data class LatencyCalibrationResult(
+    val compensationFrames: Long,
+    val compensationMs: Double,
+    val confidence: Double,
+    val shortInputFrames: Long,
+    val sampleRate: Int
+)
+
+/**
+ * Onset envelopes (summed absolute sample differences per block) of the last
+ * take and of the mix it was recorded over, both starting at startFrame.
+ */
+data class TakeOnsetEnvelopes(
+    val sampleRate: Int,
+    val blockFrames: Int,
+    val startFrame: Long,
+    val take: DoubleArray,
+    val mix: DoubleArray
+)
+
+/**
+ * Interleaved [min, max] PCM16 peaks of one pyramid level, starting at bin
+ * firstBin; bin b covers frames [b * framesPerBin, (b + 1) * framesPerBin).
+ */
+data class WaveformPeaks(
+    val sampleRate: Int,
+    val framesPerBin: Int,
+    val firstBin: Long,
+    val minMax: IntArray
+)
+
+/**
+ * Streams reopened on a new route with the loaded tracks kept. Latencies are
+ * read once the reopened streams have moved audio; -1 when still unavailable.
+ * `streamReadyMs` is the warmup time as initialize reports it, -1 on timeout.
+ */
+data class RouteRecoveryResult(
+    val sampleRate: Int,
+    val recoveryMs: Double,
+    val streamReadyMs: Double,
+    val inputLatencyMs: Double,
+    val outputLatencyMs: Double
+)
+
 data class AudioDiagnostics(
     val sampleRate: Int,
     val inputLatencyMs: Double,
@@ -51,5 +162,23 @@ data class AudioDiagnostics(
     val clockDriftFrameLimit: Long,
     val captureOnsetExact: Boolean,
     val inputXRunDelta: Int,
-    val outputXRunDelta: Int
-)
+    val outputXRunDelta: Int,
+    /** Whether the last play resumed parked streams instead of starting them. */
+    val transportStartedHot: Boolean,
+    /** From the last play request to its first rendered callback; -1 until then. */
+    val transportStartDelayMs: Double,
+    /** From the last stream start until its callbacks were stable; -1 until then. */
+    val streamReadyMs: Double,
+    /** From engine creation until the streams first opened; -1 until then. */
+    val streamsOpenedMs: Double,
+    /** From engine creation to the first duplex callback; -1 until then. */
+    val firstCallbackMs: Double
+) {
+    /** Start delay plus output latency: when the first played frame is heard. */
+    val firstAudibleFrameMs: Double
+        get() = if (transportStartDelayMs >= 0.0 && outputLatencyMs >= 0.0) {
+            transportStartDelayMs + outputLatencyMs
+        } else {
+            -1.0
+        }
+}
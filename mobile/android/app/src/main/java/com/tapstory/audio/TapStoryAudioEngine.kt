@@ -20,18 +20,25 @@ import kotlin.math.roundToLong
 
 /**
  * Android synchronized audio engine backed by Oboe FullDuplexStream.
- * Compressed files are decoded, mixed to mono, and resampled to the actual
- * negotiated duplex rate before crossing JNI.
+ * Compressed files are decoded at their own rate before crossing JNI, keeping
+ * their channels interleaved; the native mixer converts them to the
+ * negotiated duplex rate as they play.
  */
 class TapStoryAudioEngine(private val context: Context) {
 
     companion object {
         private const val TAG = "TapStoryAudioEngine"
-        private const val CHANNELS_IN = 1
         private const val BYTES_PER_SAMPLE = 2
+        // Matches kMaxTrackChannelCount; wider sources are folded to mono.
+        private const val MAX_TRACK_CHANNELS = 8
         private const val CODEC_TIMEOUT_US = 10_000L
-        private const val LATENCY_WARMUP_MS = 250L
+        // Upper bound on waiting for freshly started streams to settle.
+        private const val STREAM_READY_TIMEOUT_MS = 1_000L
         private const val MAX_LATENCY_COMPENSATION_MS = 1_000.0
+        // Matches DuplexCore::kMinPlaybackSpeed.
+        private const val MIN_PLAYBACK_SPEED = 0.5
+        private const val CHAIN_MIX_FILE_NAME = "chain_mix.wav"
+        private const val CHAIN_CONTAINER_EXTENSION = "tschain"
 
         init {
             System.loadLibrary("tapstory-audio")
@@ -43,18 +50,77 @@ class TapStoryAudioEngine(private val context: Context) {
     private external fun nativePrepare(): Int
     private external fun nativeStart(): Boolean
     private external fun nativeStop()
+    private external fun nativeSetHotIdle(enabled: Boolean): Boolean
+    private external fun nativeGetTransportStartDelayNanos(): Long
+    private external fun nativeWasLastStartHot(): Boolean
+    private external fun nativeGetStreamReadyNanos(): Long
+    private external fun nativeGetStreamsOpenedNanos(): Long
+    private external fun nativeGetFirstCallbackNanos(): Long
+    private external fun nativePrepareCaptureBuffers(): Boolean
     private external fun nativeLoadTrack(
         id: String,
         data: ShortArray,
+        channelCount: Int,
+        sampleRate: Int,
+        startFrame: Long
+    ): Boolean
+    private external fun nativeLoadTrackFile(
+        id: String,
+        filePath: String,
+        startFrame: Long
+    ): Boolean
+    private external fun nativeLoadChainSegment(
+        chainPath: String,
+        id: String,
         startFrame: Long
     ): Boolean
+    private external fun nativeAppendChainSegment(chainPath: String, id: String): Boolean
     private external fun nativeClearTracks(): Boolean
-    private external fun nativeStartRecording(filePath: String, startFrame: Long): Boolean
+    private external fun nativeSetStemMixing(enabled: Boolean): Boolean
+    private external fun nativeSetInputChannelCount(channelCount: Int): Boolean
+    private external fun nativeGetInputChannelCount(): Int
+    private external fun nativeRenderMixdown(
+        filePath: String,
+        startFrame: Long,
+        endFrame: Long,
+        flac: Boolean
+    ): DoubleArray?
+    private external fun nativeUpdateChainMix(filePath: String): DoubleArray?
+    private external fun nativeCalibrateLatency(): DoubleArray?
+    private external fun nativeGetTakeOnsetEnvelopes(): DoubleArray?
+    private external fun nativeGetTrackPeaks(
+        trackId: String,
+        framesPerBin: Int,
+        fromBin: Long
+    ): IntArray?
+    private external fun nativeGetCapturePeaks(framesPerBin: Int, fromBin: Long): IntArray?
+    private external fun nativeStartRecording(
+        filePath: String,
+        startFrame: Long,
+        punchOutFrame: Long,
+        lanePathPrefix: String?
+    ): Boolean
+    private external fun nativeGetLoopTakeLanes(): LongArray?
+    private external fun nativeGetCaptureTimelineFrameCount(): Long
+    private external fun nativeWritePunchTakes(
+        takePath: String,
+        takeStartFrame: Long,
+        rangeFrames: LongArray,
+        pathPrefix: String
+    ): LongArray?
     private external fun nativeSetLatencyCompensationFrames(frames: Long)
     private external fun nativeInvalidateAudioRoute()
+    private external fun nativeRecoverAudioRoute(): Int
+    private external fun nativeStopRecordingAtFrame(frame: Long): Boolean
     private external fun nativeStopRecording()
     private external fun nativeGetCurrentFrame(): Long
-    private external fun nativeSeekToFrame(frame: Long)
+    private external fun nativeSeekToFrame(frame: Long): Boolean
+    private external fun nativeSetLoopRegion(
+        startFrame: Long,
+        endFrame: Long,
+        crossfadeFrames: Int
+    ): Boolean
+    private external fun nativeSetPlaybackSpeed(speed: Double): Boolean
     private external fun nativeGetRecordingStartFrame(): Long
     private external fun nativeGetRecordingEndFrame(): Long
     private external fun nativeGetRequestedPunchFrame(): Long
@@ -82,11 +148,20 @@ class TapStoryAudioEngine(private val context: Context) {
     private val isRecording = AtomicBoolean(false)
     private var loadedTracks: List<TrackInfo> = emptyList()
     private var rawRecordingFile: File? = null
-    private var sampleRate: Int = 0
+    @Volatile private var sampleRate: Int = 0
+    private var hotIdleEnabled = false
     private var requestedRecordingStartMs: Long = 0
+    // [start0, end0, start1, end1, ...] of a multi-range pass, else null.
+    private var punchRangeFrames: LongArray? = null
+    // Lane files of a take recorded across loop passes, else null.
+    private var loopLanePrefix: String? = null
     @Volatile private var recordingNotifierThread: Thread? = null
 
-    fun initialize() {
+    /**
+     * Open and warm up the duplex streams. Returns how long the streams took
+     * to settle after starting, or -1 when they had not within the timeout.
+     */
+    fun initialize(): Double {
         nativeCreateEngine()
         sampleRate = nativePrepare()
         if (sampleRate <= 0) {
@@ -97,11 +172,12 @@ class TapStoryAudioEngine(private val context: Context) {
             )
         }
         // Timestamps are unavailable until both streams have moved audio. Run a
-        // short silent duplex warmup once so the first overdub can use measured
-        // route latency instead of silently falling back to zero.
-        try {
+        // silent duplex warmup once, only until the callbacks are stable, so
+        // the first overdub can use measured route latency instead of silently
+        // falling back to zero.
+        val readyMs = try {
             check(nativeStart()) { "Unable to start duplex latency warmup" }
-            Thread.sleep(LATENCY_WARMUP_MS)
+            awaitStreamsReady()
         } finally {
             nativeStop()
             nativeSeekToFrame(0)
@@ -109,7 +185,45 @@ class TapStoryAudioEngine(private val context: Context) {
         check(nativeGetLastStreamError() == 0) {
             "Duplex latency warmup failed with native error ${nativeGetLastStreamError()}"
         }
-        Log.i(TAG, "Native duplex engine prepared at ${sampleRate}Hz")
+        Log.i(
+            TAG,
+            "Native duplex engine prepared at ${sampleRate}Hz: streams opened after " +
+                "${nanosToMillis(nativeGetStreamsOpenedNanos())}ms, first callback after " +
+                "${nanosToMillis(nativeGetFirstCallbackNanos())}ms, ready in ${readyMs}ms"
+        )
+        return readyMs
+    }
+
+    /**
+     * Allocate the capture buffers before the first take. Opening the streams
+     * only sizes them, so playback-only sessions never allocate them; without
+     * this call the first take allocates them when it is armed.
+     */
+    fun prepareRecording() {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        check(nativePrepareCaptureBuffers()) { "Unable to allocate capture buffers" }
+    }
+
+    /**
+     * Wait until the native callbacks report stable streams: a run of
+     * callbacks with no xruns and, where the route has them, advancing
+     * timestamps. Returns the time from stream start to that point, or -1
+     * after the timeout.
+     */
+    private fun awaitStreamsReady(): Double {
+        val deadline = System.nanoTime() + STREAM_READY_TIMEOUT_MS * 1_000_000L
+        while (nativeGetStreamReadyNanos() < 0 &&
+            nativeGetLastStreamError() == 0 &&
+            System.nanoTime() < deadline
+        ) {
+            Thread.sleep(1)
+        }
+        val readyNanos = nativeGetStreamReadyNanos()
+        if (readyNanos < 0) {
+            Log.w(TAG, "Duplex streams not stable after ${STREAM_READY_TIMEOUT_MS}ms")
+            return -1.0
+        }
+        return readyNanos / 1_000_000.0
     }
 
     fun loadTracks(tracks: List<TrackInfo>) {
@@ -118,22 +232,181 @@ class TapStoryAudioEngine(private val context: Context) {
         check(sampleRate > 0) { "Audio engine is not initialized" }
         check(nativeClearTracks()) { "Native engine refused to clear tracks" }
 
+        val chainFile = chainContainerFile(tracks)
+        evictChainContainers(keep = chainFile)
+        val chainPath = chainFile?.absolutePath
         for (track in tracks) {
-            val pcmData = decodeAudioFile(track.uri, sampleRate)
-                ?: throw IllegalArgumentException("Failed to decode track ${track.id}")
             val startFrame = millisecondsToFrames(track.startTimeMs)
-            check(nativeLoadTrack(track.id, pcmData, startFrame)) {
-                "Native engine refused track ${track.id}"
+            if (chainPath != null && nativeLoadChainSegment(chainPath, track.id, startFrame)) {
+                continue
+            }
+            // Our own WAV and FLAC segments decode natively; MediaCodec is kept
+            // for compressed formats and content URIs. Either way the PCM keeps
+            // the source rate and the mixer converts it as it plays.
+            val localPath = track.uri.removePrefix("file://").takeIf { File(it).isFile }
+            if (localPath == null || !nativeLoadTrackFile(track.id, localPath, startFrame)) {
+                val decoded = decodeAudioFile(track.uri)
+                    ?: throw IllegalArgumentException("Failed to decode track ${track.id}")
+                check(
+                    nativeLoadTrack(
+                        track.id,
+                        decoded.pcm,
+                        decoded.channelCount,
+                        decoded.sampleRate,
+                        startFrame
+                    )
+                ) { "Native engine refused track ${track.id}" }
+                Log.i(
+                    TAG,
+                    "Loaded ${track.id}: ${decoded.pcm.size / decoded.channelCount} frames of " +
+                        "${decoded.channelCount} channels at ${decoded.sampleRate}Hz, " +
+                        "startFrame=$startFrame"
+                )
+            }
+            // The next load of this chain maps the segment instead of decoding it.
+            if (chainPath != null && !nativeAppendChainSegment(chainPath, track.id)) {
+                Log.w(TAG, "Could not add ${track.id} to the chain container")
             }
-            Log.i(
-                TAG,
-                "Loaded ${track.id}: ${pcmData.size} mono frames at ${sampleRate}Hz, " +
-                    "startFrame=$startFrame"
-            )
         }
         loadedTracks = tracks
     }
 
+    /**
+     * Chain container for the chain that starts with the first of `tracks`.
+     * A chain keeps its first segment as turns are added, so every load of it
+     * maps the same file and new turns extend it.
+     */
+    private fun chainContainerFile(tracks: List<TrackInfo>): File? {
+        val root = tracks.minByOrNull { it.startTimeMs } ?: return null
+        val name = root.id.replace(Regex("[^A-Za-z0-9_-]"), "_")
+        return File(context.cacheDir, "chain_$name.$CHAIN_CONTAINER_EXTENSION")
+    }
+
+    /**
+     * Delete the containers of every chain but the one being loaded. Blocks
+     * are float PCM, twice the size of their sources, so keeping each chain
+     * ever opened would grow the cache without bound. Leftovers of an
+     * interrupted rewrite go too.
+     */
+    private fun evictChainContainers(keep: File?) {
+        context.cacheDir.listFiles { file ->
+            file.name.startsWith("chain_") &&
+                file.name.contains(".$CHAIN_CONTAINER_EXTENSION") &&
+                file != keep
+        }?.forEach { file ->
+            if (!file.delete()) Log.w(TAG, "Could not evict chain container ${file.name}")
+        }
+    }
+
+    /**
+     * Render the loaded tracks between two timeline positions into a WAV or
+     * FLAC file in the cache directory, using the realtime mixer offline.
+     */
+    fun renderMixdown(startMs: Long, endMs: Long, format: String): MixdownResult {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        require(format == "wav" || format == "flac") { "Unsupported mixdown format $format" }
+        val startFrame = millisecondsToFrames(startMs)
+        val endFrame = millisecondsToFrames(endMs)
+        require(startMs >= 0 && endFrame > startFrame) { "Mixdown range is empty" }
+
+        val file = File(context.cacheDir, "mixdown_${System.currentTimeMillis()}.$format")
+        val stats = nativeRenderMixdown(file.absolutePath, startFrame, endFrame, format == "flac")
+        if (stats == null) {
+            file.delete()
+            throw IllegalStateException("Native mixdown failed to render $format")
+        }
+        val frameCount = stats[0].toLong()
+        val result = MixdownResult(
+            uri = Uri.fromFile(file).toString(),
+            format = format,
+            startFrame = startFrame,
+            frameCount = frameCount,
+            durationMs = frameCount * 1000L / sampleRate,
+            renderMs = stats[1] * 1000.0,
+            realtimeFactor = stats[2],
+            workerCount = stats[3].toInt(),
+            sampleRate = sampleRate
+        )
+        Log.i(
+            TAG,
+            "Mixdown ${result.durationMs}ms rendered in ${"%.1f".format(result.renderMs)}ms " +
+                "(${"%.1f".format(result.realtimeFactor)}x realtime)"
+        )
+        return result
+    }
+
+    /**
+     * Bring the whole-chain WAV in the cache directory up to date with the
+     * loaded tracks. Only blocks touched by tracks added or removed since the
+     * previous call are re-rendered, so appending a segment stays cheap as the
+     * chain grows. The file is rewritten in place by the next call.
+     */
+    fun exportChainMix(): ChainMixResult {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        val file = File(context.cacheDir, CHAIN_MIX_FILE_NAME)
+        val stats = nativeUpdateChainMix(file.absolutePath)
+            ?: throw IllegalStateException("Native chain mix update failed")
+        val frameCount = stats[0].toLong()
+        val result = ChainMixResult(
+            uri = Uri.fromFile(file).toString(),
+            frameCount = frameCount,
+            durationMs = frameCount * 1000L / sampleRate,
+            blockCount = stats[1].toLong(),
+            renderedBlocks = stats[2].toLong(),
+            renderMs = stats[3] * 1000.0,
+            sampleRate = sampleRate
+        )
+        Log.i(
+            TAG,
+            "Chain mix ${result.durationMs}ms updated in ${"%.1f".format(result.renderMs)}ms " +
+                "(${result.renderedBlocks}/${result.blockCount} blocks)"
+        )
+        return result
+    }
+
+    /**
+     * Keep the duplex streams running silent while transport is stopped, so
+     * play and record begin at the next burst instead of restarting streams.
+     */
+    fun setHotIdle(enabled: Boolean) {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        check(nativeSetHotIdle(enabled)) {
+            "Failed to start hot idle streams (error ${nativeGetLastStreamError()})"
+        }
+        hotIdleEnabled = enabled
+        Log.i(TAG, "Hot idle ${if (enabled) "enabled" else "disabled"}")
+    }
+
+    /**
+     * Play loaded chains from two pre-mixed lanes, even and odd turns, so the
+     * audio callback's cost no longer grows with the number of segments. Each
+     * lane spans the whole chain and is silent through the other lane's
+     * turns, so the lanes cost chain length x channels x 2 floats: about
+     * 460MB for a 10-minute stereo chain at 48kHz.
+     */
+    fun setStemMixing(enabled: Boolean) {
+        check(!isRecording.get()) { "Cannot switch stem mixing while recording" }
+        if (isPlaying.get()) stop()
+        check(nativeSetStemMixing(enabled)) { "Native engine refused to switch stem mixing" }
+        Log.i(TAG, "Stem mixing ${if (enabled) "enabled" else "disabled"}")
+    }
+
+    /**
+     * Record takes with one or two interleaved channels, reopening the input
+     * on the current route. Returns the channels the input actually delivers.
+     */
+    fun setInputChannelCount(channelCount: Int): Int {
+        require(channelCount in 1..2) { "Input channel count must be 1 or 2" }
+        check(!isRecording.get()) { "Cannot change input channels while recording" }
+        if (isPlaying.get()) stop()
+        check(nativeSetInputChannelCount(channelCount)) {
+            "Native engine refused to change input channels"
+        }
+        val opened = nativeGetInputChannelCount()
+        Log.i(TAG, "Input channels set to $channelCount, stream delivers $opened")
+        return opened
+    }
+
     fun play(playFromMs: Long) {
         if (isPlaying.get()) stop()
         check(sampleRate > 0) { "Audio engine is not initialized" }
@@ -146,19 +419,86 @@ class TapStoryAudioEngine(private val context: Context) {
         playFromMs: Long,
         recordStartMs: Long,
         onRecordingStarted: (Long) -> Unit
+    ) {
+        startTake(playFromMs, recordStartMs, -1L, null, false, onRecordingStarted)
+    }
+
+    /**
+     * Record a looped take across passes instead of ending it at the loop end.
+     * The take runs until stopRecording, which returns every pass as its own
+     * lane in loopTakes so the best one can be picked without recording again.
+     */
+    fun playAndRecordLoopTakes(
+        playFromMs: Long,
+        recordStartMs: Long,
+        onRecordingStarted: (Long) -> Unit
+    ) {
+        startTake(playFromMs, recordStartMs, -1L, null, true, onRecordingStarted)
+    }
+
+    /**
+     * Record several [startMs, endMs) ranges in one pass. Capture runs
+     * continuously from the first range start and ends by itself at the last
+     * range end while playback continues; stopRecording cuts each range into
+     * its own WAV from the aligned take.
+     */
+    fun playAndRecordRanges(
+        playFromMs: Long,
+        rangesMs: List<Pair<Long, Long>>,
+        onRecordingStarted: (Long) -> Unit
+    ) {
+        check(rangesMs.isNotEmpty()) { "At least one punch range is required" }
+        val rangeFrames = LongArray(rangesMs.size * 2)
+        var previousEnd = 0L
+        rangesMs.forEachIndexed { index, (startMs, endMs) ->
+            check(startMs >= previousEnd && endMs > startMs) {
+                "Punch ranges must be non-empty, ascending and non-overlapping"
+            }
+            previousEnd = endMs
+            rangeFrames[index * 2] = millisecondsToFrames(startMs)
+            rangeFrames[index * 2 + 1] = millisecondsToFrames(endMs)
+        }
+        startTake(
+            playFromMs,
+            rangesMs.first().first,
+            rangeFrames.last(),
+            rangeFrames,
+            false,
+            onRecordingStarted
+        )
+    }
+
+    private fun startTake(
+        playFromMs: Long,
+        recordStartMs: Long,
+        punchOutFrame: Long,
+        rangeFrames: LongArray?,
+        recordLoopLanes: Boolean,
+        onRecordingStarted: (Long) -> Unit
     ) {
         if (isPlaying.get()) stop()
         check(!isRecording.get()) { "A recording is already active" }
         check(sampleRate > 0) { "Audio engine is not initialized" }
 
-        rawRecordingFile = File(
-            context.cacheDir,
-            "recording_raw_${System.currentTimeMillis()}.pcm"
-        )
+        val takeTime = System.currentTimeMillis()
+        rawRecordingFile = File(context.cacheDir, "recording_raw_$takeTime.pcm")
         nativeSeekToFrame(millisecondsToFrames(playFromMs))
         val punchFrame = millisecondsToFrames(recordStartMs)
         requestedRecordingStartMs = recordStartMs
-        check(nativeStartRecording(rawRecordingFile!!.absolutePath, punchFrame)) {
+        punchRangeFrames = rangeFrames
+        loopLanePrefix = if (recordLoopLanes) {
+            File(context.cacheDir, "recording_${takeTime}_pass_").absolutePath
+        } else {
+            null
+        }
+        check(
+            nativeStartRecording(
+                rawRecordingFile!!.absolutePath,
+                punchFrame,
+                punchOutFrame,
+                loopLanePrefix
+            )
+        ) {
             "Failed to arm native recording"
         }
 
@@ -177,6 +517,73 @@ class TapStoryAudioEngine(private val context: Context) {
         startRecordingStartNotifier(onRecordingStarted)
     }
 
+    /**
+     * Play a sweep through the current route and record it in the same duplex
+     * session to measure the round trip. Blocks for under a second; playback
+     * is stopped first.
+     */
+    fun calibrateLatency(): LatencyCalibrationResult {
+        check(!isRecording.get()) { "Cannot calibrate during a take" }
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        if (isPlaying.get()) stop()
+
+        val stats = nativeCalibrateLatency()
+            ?: throw IllegalStateException(
+                "Loopback calibration failed (error ${nativeGetLastStreamError()})"
+            )
+        val result = LatencyCalibrationResult(
+            compensationFrames = stats[0].toLong(),
+            compensationMs = stats[1] * 1000.0 / sampleRate,
+            confidence = stats[2],
+            shortInputFrames = stats[3].toLong(),
+            sampleRate = sampleRate
+        )
+        Log.i(
+            TAG,
+            "Loopback round trip ${"%.2f".format(result.compensationMs)}ms " +
+                "(confidence ${"%.3f".format(result.confidence)})"
+        )
+        return result
+    }
+
+    /**
+     * Envelopes streamed while the last take was written, so alignment tools
+     * can compare it with the mix without re-reading either as PCM.
+     */
+    fun getTakeOnsetEnvelopes(): TakeOnsetEnvelopes? {
+        if (isRecording.get()) return null
+        val values = nativeGetTakeOnsetEnvelopes() ?: return null
+        val takeBlocks = values[2].toInt()
+        return TakeOnsetEnvelopes(
+            sampleRate = sampleRate,
+            blockFrames = values[0].toInt(),
+            startFrame = values[1].toLong(),
+            take = values.copyOfRange(3, 3 + takeBlocks),
+            mix = values.copyOfRange(3 + takeBlocks, values.size)
+        )
+    }
+
+    /** Peaks of a loaded track, from the level nearest framesPerBin. */
+    fun getTrackPeaks(trackId: String, framesPerBin: Int): WaveformPeaks? =
+        toWaveformPeaks(nativeGetTrackPeaks(trackId, framesPerBin, 0))
+
+    /**
+     * Peaks of the take being recorded, from bin fromBin on, so a live
+     * waveform only fetches the bins completed since its last poll.
+     */
+    fun getCapturePeaks(framesPerBin: Int, fromBin: Long): WaveformPeaks? =
+        toWaveformPeaks(nativeGetCapturePeaks(framesPerBin, fromBin))
+
+    private fun toWaveformPeaks(values: IntArray?): WaveformPeaks? {
+        if (values == null) return null
+        return WaveformPeaks(
+            sampleRate = sampleRate,
+            framesPerBin = values[0],
+            firstBin = values[1].toLong(),
+            minMax = values.copyOfRange(2, values.size)
+        )
+    }
+
     fun setLatencyCompensationMs(compensationMs: Double) {
         require(
             compensationMs.isFinite() &&
@@ -198,6 +605,51 @@ class TapStoryAudioEngine(private val context: Context) {
         isPlaying.set(false)
     }
 
+    /** True from playAndRecord until stopRecording has finalized the take. */
+    val hasActiveRecording: Boolean
+        get() = isRecording.get()
+
+    /**
+     * Reopen the duplex streams on the route that replaced an invalidated one.
+     * Loaded tracks are kept, not decoded again: their PCM stays at its own
+     * rate and the mixer converts it to the new one. The route latency is
+     * re-read after the same warmup as initialize. Latency compensation
+     * starts at zero and must be configured for the new route.
+     */
+    fun recoverAudioRoute(): RouteRecoveryResult {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        check(!isRecording.get()) { "Finish the take before recovering the audio route" }
+        val startNanos = System.nanoTime()
+        val recoveredRate = nativeRecoverAudioRoute()
+        check(recoveredRate > 0) {
+            "Unable to reopen duplex streams on the new route " +
+                "(error ${nativeGetLastStreamError()})"
+        }
+        sampleRate = recoveredRate
+        val readyMs = try {
+            awaitStreamsReady()
+        } finally {
+            // The streams restart parked; without hot idle they stop again.
+            if (!hotIdleEnabled) nativeSetHotIdle(false)
+        }
+        check(nativeGetLastStreamError() == 0) {
+            "Route recovery warmup failed with native error ${nativeGetLastStreamError()}"
+        }
+        val result = RouteRecoveryResult(
+            sampleRate = sampleRate,
+            recoveryMs = (System.nanoTime() - startNanos) / 1_000_000.0,
+            streamReadyMs = readyMs,
+            inputLatencyMs = nativeGetInputLatencyMillis(),
+            outputLatencyMs = nativeGetOutputLatencyMillis()
+        )
+        Log.i(
+            TAG,
+            "Audio route recovered at ${sampleRate}Hz in ${result.recoveryMs}ms, " +
+                "streams ready in ${readyMs}ms"
+        )
+        return result
+    }
+
     private fun startRecordingStartNotifier(onRecordingStarted: (Long) -> Unit) {
         recordingNotifierThread?.interrupt()
         recordingNotifierThread = Thread({
@@ -216,6 +668,52 @@ class TapStoryAudioEngine(private val context: Context) {
         }, "TapStoryRecordingStart").also { it.start() }
     }
 
+    /**
+     * Move the playhead. While playing, the jump lands on the next callback
+     * with a short crossfade instead of restarting the streams.
+     */
+    fun seekTo(positionMs: Long) {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        check(!isRecording.get()) { "Cannot seek while recording" }
+        check(nativeSeekToFrame(millisecondsToFrames(positionMs))) {
+            "Native engine refused to seek"
+        }
+    }
+
+    /**
+     * Loop playback over [startMs, endMs) without restarting the streams;
+     * an empty range clears the loop. Takes recorded inside it end with the pass.
+     */
+    fun setLoopRegion(startMs: Long, endMs: Long, crossfadeMs: Long) {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        val crossfadeFrames = millisecondsToFrames(crossfadeMs).coerceIn(0L, Int.MAX_VALUE.toLong())
+        check(nativeSetLoopRegion(
+            millisecondsToFrames(startMs),
+            millisecondsToFrames(endMs),
+            crossfadeFrames.toInt()
+        )) {
+            "Loop region must be longer than its crossfade and the armed take's latency"
+        }
+    }
+
+    fun clearLoopRegion() {
+        if (sampleRate <= 0) return
+        nativeSetLoopRegion(0, 0, 0)
+    }
+
+    /**
+     * Practice playback at `speed` times the nominal rate, resampled in the
+     * mixer from the next callback; tracks are not decoded again. Takes only
+     * record at 1.0.
+     */
+    fun setPlaybackSpeed(speed: Double) {
+        check(sampleRate > 0) { "Audio engine is not initialized" }
+        check(speed in MIN_PLAYBACK_SPEED..1.0) {
+            "Playback speed must be between $MIN_PLAYBACK_SPEED and 1.0"
+        }
+        check(nativeSetPlaybackSpeed(speed)) { "Playback speed cannot change while recording" }
+    }
+
     fun getCurrentPositionMs(): Long {
         if (sampleRate <= 0) return 0
         return nativeGetCurrentFrame() * 1000L / sampleRate
@@ -227,8 +725,33 @@ class TapStoryAudioEngine(private val context: Context) {
         isPlaying.set(false)
     }
 
+    /**
+     * End the take at timeline frame [frame] from inside the audio callback,
+     * so its last sample does not depend on thread scheduling. Playback runs
+     * on; call stopRecording once the frame has passed to collect the take.
+     */
+    fun stopRecordingAtFrame(frame: Long) {
+        check(isRecording.get()) { "No recording is active" }
+        check(nativeStopRecordingAtFrame(frame)) {
+            "Recording stop frame must lie after the punch-in"
+        }
+    }
+
     fun stopRecording(): RecordingResult? {
         if (!isRecording.get()) return null
+        val lanePrefix = loopLanePrefix
+        loopLanePrefix = null
+        val result = try {
+            finishRecording(lanePrefix)
+        } catch (error: Exception) {
+            deleteLoopLanes(lanePrefix)
+            throw error
+        }
+        if (result == null) deleteLoopLanes(lanePrefix)
+        return result
+    }
+
+    private fun finishRecording(lanePrefix: String?): RecordingResult? {
 
         nativeStopRecording()
         isRecording.set(false)
@@ -247,7 +770,7 @@ class TapStoryAudioEngine(private val context: Context) {
         val inputXRuns = nativeGetInputXRunDelta()
         val outputXRuns = nativeGetOutputXRunDelta()
         val streamError = nativeGetLastStreamError()
-        val timelineFrames = endFrame - actualStartFrame
+        val timelineFrames = nativeGetCaptureTimelineFrameCount()
         val rawFile = rawRecordingFile ?: return null
 
         if (streamError != 0) {
@@ -260,7 +783,7 @@ class TapStoryAudioEngine(private val context: Context) {
         }
 
         if (requestedPunchFrame < 0 || actualStartFrame < 0 ||
-            endFrame <= actualStartFrame || rawInputFrames <= 0
+            timelineFrames <= 0 || rawInputFrames <= 0
         ) {
             rawFile.delete()
             rawRecordingFile = null
@@ -309,6 +832,30 @@ class TapStoryAudioEngine(private val context: Context) {
             )
         }
 
+        if (lanePrefix != null) {
+            rawFile.delete()
+            rawRecordingFile = null
+            return loopLaneRecording(
+                lanePrefix,
+                RecordingResult(
+                    uri = "",
+                    startTimeMs = requestedRecordingStartMs,
+                    durationMs = 0,
+                    startFrame = requestedPunchFrame,
+                    actualStartFrame = actualStartFrame,
+                    endFrame = endFrame,
+                    frameCount = 0,
+                    rawInputFrameCount = rawInputFrames,
+                    droppedFrameCount = droppedFrames,
+                    shortInputFrameCount = shortInputFrames,
+                    clockDriftFrameLimit = clockDriftFrameLimit,
+                    inputXRunCount = inputXRuns,
+                    outputXRunCount = outputXRuns,
+                    sampleRate = sampleRate
+                )
+            )
+        }
+
         val wavFile = File(context.cacheDir, "recording_${System.currentTimeMillis()}.wav")
         try {
             convertRawToWav(
@@ -316,7 +863,8 @@ class TapStoryAudioEngine(private val context: Context) {
                 wavFile = wavFile,
                 rawSampleCount = rawInputFrames,
                 targetSampleCount = timelineFrames,
-                outputSampleRate = sampleRate
+                outputSampleRate = sampleRate,
+                channelCount = nativeGetInputChannelCount()
             )
         } catch (error: Exception) {
             wavFile.delete()
@@ -326,6 +874,7 @@ class TapStoryAudioEngine(private val context: Context) {
         }
         rawFile.delete()
         rawRecordingFile = null
+        val punchTakes = writePunchTakes(wavFile, requestedPunchFrame)
 
         if (rawInputFrames != timelineFrames) {
             Log.i(
@@ -349,10 +898,72 @@ class TapStoryAudioEngine(private val context: Context) {
             clockDriftFrameLimit = clockDriftFrameLimit,
             inputXRunCount = inputXRuns,
             outputXRunCount = outputXRuns,
-            sampleRate = sampleRate
+            sampleRate = sampleRate,
+            punchTakes = punchTakes
+        )
+    }
+
+    // The writer already split the take into one WAV per pass; the first
+    // lane stands in for the take, so a caller that ignores loopTakes gets
+    // the same single pass a plain looped take records.
+    private fun loopLaneRecording(lanePrefix: String, take: RecordingResult): RecordingResult? {
+        val lanes = nativeGetLoopTakeLanes() ?: return null
+        val loopTakes = (lanes.indices step 5).map { offset ->
+            val passIndex = lanes[offset].toInt()
+            val startFrame = lanes[offset + 1]
+            val frameCount = lanes[offset + 2] - startFrame
+            LoopTakeResult(
+                uri = "file://$lanePrefix$passIndex.wav",
+                passIndex = passIndex,
+                startTimeMs = (startFrame * 1000.0 / sampleRate).roundToLong(),
+                durationMs = (frameCount * 1000.0 / sampleRate).roundToLong(),
+                startFrame = startFrame,
+                frameCount = frameCount,
+                driftFrames = lanes[offset + 4]
+            )
+        }
+        val first = loopTakes.firstOrNull() ?: return null
+        return take.copy(
+            uri = first.uri,
+            durationMs = first.durationMs,
+            frameCount = first.frameCount,
+            loopTakes = loopTakes
         )
     }
 
+    private fun deleteLoopLanes(lanePrefix: String?) {
+        val prefix = File(lanePrefix ?: return)
+        prefix.parentFile
+            ?.listFiles { file -> file.name.startsWith(prefix.name) }
+            ?.forEach { it.delete() }
+    }
+
+    // Cut each requested range from the aligned take, whose first frame is
+    // the requested punch frame.
+    private fun writePunchTakes(wavFile: File, takeStartFrame: Long): List<PunchTakeResult> {
+        val rangeFrames = punchRangeFrames ?: return emptyList()
+        punchRangeFrames = null
+        val prefix = wavFile.absolutePath.removeSuffix(".wav") + "_range_"
+        val takes = nativeWritePunchTakes(wavFile.absolutePath, takeStartFrame, rangeFrames, prefix)
+            ?: run {
+                wavFile.delete()
+                throw IllegalStateException("Failed to write the punch range takes")
+            }
+        return (takes.indices step 3).map { offset ->
+            val rangeIndex = takes[offset].toInt()
+            val startFrame = takes[offset + 1]
+            val frameCount = takes[offset + 2]
+            PunchTakeResult(
+                uri = "file://$prefix$rangeIndex.wav",
+                rangeIndex = rangeIndex,
+                startTimeMs = (startFrame * 1000.0 / sampleRate).roundToLong(),
+                durationMs = (frameCount * 1000.0 / sampleRate).roundToLong(),
+                startFrame = startFrame,
+                frameCount = frameCount
+            )
+        }
+    }
+
     fun getDiagnostics(): AudioDiagnostics = AudioDiagnostics(
         sampleRate = nativeGetSampleRate(),
         inputLatencyMs = nativeGetInputLatencyMillis(),
@@ -374,9 +985,16 @@ class TapStoryAudioEngine(private val context: Context) {
         clockDriftFrameLimit = nativeGetCaptureClockDriftFrameLimit(),
         captureOnsetExact = nativeIsCaptureOnsetExact(),
         inputXRunDelta = nativeGetInputXRunDelta(),
-        outputXRunDelta = nativeGetOutputXRunDelta()
+        outputXRunDelta = nativeGetOutputXRunDelta(),
+        transportStartedHot = nativeWasLastStartHot(),
+        transportStartDelayMs = nanosToMillis(nativeGetTransportStartDelayNanos()),
+        streamReadyMs = nanosToMillis(nativeGetStreamReadyNanos()),
+        streamsOpenedMs = nanosToMillis(nativeGetStreamsOpenedNanos()),
+        firstCallbackMs = nanosToMillis(nativeGetFirstCallbackNanos())
     )
 
+    private fun nanosToMillis(nanos: Long): Double = if (nanos >= 0) nanos / 1_000_000.0 else -1.0
+
     fun cleanup() {
         if (isPlaying.get()) stop()
         if (isRecording.get()) {
@@ -387,6 +1005,7 @@ class TapStoryAudioEngine(private val context: Context) {
         recordingNotifierThread = null
         nativeDeleteEngine()
         sampleRate = 0
+        hotIdleEnabled = false
         loadedTracks = emptyList()
         rawRecordingFile?.delete()
         rawRecordingFile = null
@@ -409,7 +1028,10 @@ class TapStoryAudioEngine(private val context: Context) {
         fun toArray(): FloatArray = values.copyOf(size)
     }
 
-    private fun decodeAudioFile(uriString: String, targetSampleRate: Int): ShortArray? {
+    /** Interleaved PCM16 frames of `channelCount` samples each, at `sampleRate`. */
+    private class DecodedAudio(val pcm: ShortArray, val channelCount: Int, val sampleRate: Int)
+
+    private fun decodeAudioFile(uriString: String): DecodedAudio? {
         val extractor = MediaExtractor()
         var decoder: MediaCodec? = null
         var descriptor: android.os.ParcelFileDescriptor? = null
@@ -451,7 +1073,8 @@ class TapStoryAudioEngine(private val context: Context) {
             var outputChannels = format.getInteger(MediaFormat.KEY_CHANNEL_COUNT)
             var outputSampleRate = format.getInteger(MediaFormat.KEY_SAMPLE_RATE)
             var pcmEncoding = AudioFormat.ENCODING_PCM_16BIT
-            val monoSamples = FloatAccumulator()
+            val samples = FloatAccumulator()
+            var keptChannels = 0
             val info = MediaCodec.BufferInfo()
             var inputDone = false
             var outputDone = false
@@ -503,12 +1126,22 @@ class TapStoryAudioEngine(private val context: Context) {
                         if (outputBuffer != null && info.size > 0 &&
                             info.flags and MediaCodec.BUFFER_FLAG_CODEC_CONFIG == 0
                         ) {
-                            appendDecodedMono(
+                            val channels = if (outputChannels <= MAX_TRACK_CHANNELS) {
+                                outputChannels
+                            } else {
+                                1
+                            }
+                            check(keptChannels == 0 || keptChannels == channels) {
+                                "Decoder changed channel count mid-stream"
+                            }
+                            keptChannels = channels
+                            appendDecodedFrames(
                                 outputBuffer,
                                 info,
                                 outputChannels,
+                                keptChannels,
                                 pcmEncoding,
-                                monoSamples
+                                samples
                             )
                         }
                         outputDone = info.flags and MediaCodec.BUFFER_FLAG_END_OF_STREAM != 0
@@ -517,9 +1150,9 @@ class TapStoryAudioEngine(private val context: Context) {
                 }
             }
 
-            val mono = monoSamples.toArray()
-            if (mono.isEmpty()) return null
-            return resampleAndConvertToPcm16(mono, outputSampleRate, targetSampleRate)
+            val interleaved = samples.toArray()
+            if (interleaved.isEmpty() || outputSampleRate <= 0) return null
+            return DecodedAudio(convertToPcm16(interleaved), keptChannels, outputSampleRate)
         } catch (error: Exception) {
             Log.e(TAG, "Failed to decode $uriString", error)
             return null
@@ -534,14 +1167,20 @@ class TapStoryAudioEngine(private val context: Context) {
         }
     }
 
-    private fun appendDecodedMono(
+    /**
+     * Appends the buffer's frames interleaved, or averaged to mono when
+     * `keptChannels` is 1 and the decoder delivers more.
+     */
+    private fun appendDecodedFrames(
         source: ByteBuffer,
         info: MediaCodec.BufferInfo,
         channelCount: Int,
+        keptChannels: Int,
         pcmEncoding: Int,
         destination: FloatAccumulator
     ) {
         require(channelCount > 0) { "Decoder returned invalid channel count" }
+        require(keptChannels == channelCount || keptChannels == 1)
         val start = info.offset.coerceAtLeast(0)
         val end = (start + info.size).coerceAtMost(source.capacity())
         require(end >= start) { "Decoder returned invalid BufferInfo range" }
@@ -555,70 +1194,58 @@ class TapStoryAudioEngine(private val context: Context) {
             else -> throw IllegalArgumentException("Unsupported decoder PCM encoding: $pcmEncoding")
         }
         val frameCount = pcm.remaining() / (bytesPerSample * channelCount)
+        fun readSample(): Float = when (pcmEncoding) {
+            AudioFormat.ENCODING_PCM_16BIT -> pcm.short / 32768.0f
+            else -> pcm.float
+        }
         repeat(frameCount) {
-            var mixed = 0f
-            repeat(channelCount) {
-                mixed += when (pcmEncoding) {
-                    AudioFormat.ENCODING_PCM_16BIT -> pcm.short / 32768.0f
-                    else -> pcm.float
-                }
+            if (keptChannels == channelCount) {
+                repeat(channelCount) { destination.append(readSample()) }
+            } else {
+                var mixed = 0f
+                repeat(channelCount) { mixed += readSample() }
+                destination.append(mixed / channelCount)
             }
-            destination.append(mixed / channelCount)
         }
     }
 
-    private fun resampleAndConvertToPcm16(
-        input: FloatArray,
-        inputSampleRate: Int,
-        outputSampleRate: Int
-    ): ShortArray {
-        require(inputSampleRate > 0 && outputSampleRate > 0)
-        val outputFrameCount = if (inputSampleRate == outputSampleRate) {
-            input.size
-        } else {
-            ((input.size.toLong() * outputSampleRate + inputSampleRate / 2) /
-                inputSampleRate).toInt()
-        }
-        val output = ShortArray(outputFrameCount)
-        for (outputFrame in 0 until outputFrameCount) {
-            val sourcePosition = outputFrame.toDouble() * inputSampleRate / outputSampleRate
-            val lower = floor(sourcePosition).toInt().coerceIn(0, input.lastIndex)
-            val upper = min(lower + 1, input.lastIndex)
-            val fraction = (sourcePosition - lower).toFloat()
-            val sample = input[lower] + (input[upper] - input[lower]) * fraction
-            output[outputFrame] = (sample.coerceIn(-1f, 1f) * 32767f).roundToInt().toShort()
+    private fun convertToPcm16(input: FloatArray): ShortArray =
+        ShortArray(input.size) { index ->
+            (input[index].coerceIn(-1f, 1f) * 32767f).roundToInt().toShort()
         }
-        return output
-    }
 
     /**
      * Writes an exact-timeline-length WAV. A small raw/timeline discrepancy is
      * expected when independent hardware clocks differ; linear offline
      * resampling removes that accumulated drift. Ring overflow is rejected by
-     * the caller and never hidden by this method.
+     * the caller and never hidden by this method. Counts are in frames of
+     * `channelCount` interleaved samples.
      */
     private fun convertRawToWav(
         rawFile: File,
         wavFile: File,
         rawSampleCount: Long,
         targetSampleCount: Long,
-        outputSampleRate: Int
+        outputSampleRate: Int,
+        channelCount: Int
     ) {
         require(rawSampleCount in 1..Int.MAX_VALUE)
         require(targetSampleCount in 1..Int.MAX_VALUE)
-        require(rawFile.length() >= rawSampleCount * BYTES_PER_SAMPLE)
+        require(channelCount > 0)
+        val bytesPerFrame = BYTES_PER_SAMPLE * channelCount
+        require(rawFile.length() >= rawSampleCount * bytesPerFrame)
 
-        val targetDataSize = targetSampleCount * BYTES_PER_SAMPLE
+        val targetDataSize = targetSampleCount * bytesPerFrame
         require(targetDataSize <= UInt.MAX_VALUE.toLong()) { "Recording exceeds WAV size limit" }
 
         RandomAccessFile(wavFile, "rw").use { output ->
             output.setLength(0)
-            writeWavHeader(output, targetDataSize.toInt(), outputSampleRate)
+            writeWavHeader(output, targetDataSize.toInt(), outputSampleRate, channelCount)
 
             if (rawSampleCount == targetSampleCount) {
                 rawFile.inputStream().use { input ->
                     val buffer = ByteArray(8192)
-                    var remaining = rawSampleCount * BYTES_PER_SAMPLE
+                    var remaining = rawSampleCount * bytesPerFrame
                     while (remaining > 0) {
                         val read = input.read(buffer, 0, min(buffer.size.toLong(), remaining).toInt())
                         if (read < 0) break
@@ -631,39 +1258,53 @@ class TapStoryAudioEngine(private val context: Context) {
 
             val rawFrames = rawSampleCount.toInt()
             val targetFrames = targetSampleCount.toInt()
-            val outputChunk = ByteArray(8192)
+            val outputChunk = ByteArray(8192 - 8192 % bytesPerFrame)
             var chunkOffset = 0
 
             rawFile.inputStream().buffered().use { input ->
-                fun readSample(): Int {
-                    val low = input.read()
-                    val high = input.read()
-                    check(low >= 0 && high >= 0) { "Raw recording ended before its frame count" }
-                    return ((high shl 8) or low).toShort().toInt()
+                fun readFrame(frame: IntArray) {
+                    for (channel in 0 until channelCount) {
+                        val low = input.read()
+                        val high = input.read()
+                        check(low >= 0 && high >= 0) {
+                            "Raw recording ended before its frame count"
+                        }
+                        frame[channel] = ((high shl 8) or low).toShort().toInt()
+                    }
                 }
 
                 var lowerFrame = 0
-                var lowerSample = readSample()
-                var upperSample = if (rawFrames > 1) readSample() else lowerSample
+                var lowerSamples = IntArray(channelCount).also(::readFrame)
+                var upperSamples = if (rawFrames > 1) {
+                    IntArray(channelCount).also(::readFrame)
+                } else {
+                    lowerSamples.copyOf()
+                }
 
                 for (targetFrame in 0 until targetFrames) {
                     val sourcePosition = targetFrame.toDouble() * rawFrames / targetFrames
                     val wantedLower = floor(sourcePosition).toInt().coerceIn(0, rawFrames - 1)
                     while (lowerFrame < wantedLower) {
-                        lowerSample = upperSample
+                        // Swap so the old lower frame's array is refilled as the new upper.
+                        val recycled = lowerSamples
+                        lowerSamples = upperSamples
+                        upperSamples = recycled
                         lowerFrame++
-                        upperSample = if (lowerFrame + 1 < rawFrames) {
-                            readSample()
+                        if (lowerFrame + 1 < rawFrames) {
+                            readFrame(upperSamples)
                         } else {
-                            lowerSample
+                            lowerSamples.copyInto(upperSamples)
                         }
                     }
                     val fraction = sourcePosition - wantedLower
-                    val interpolated = (
-                        lowerSample + (upperSample - lowerSample) * fraction
-                    ).roundToInt().coerceIn(Short.MIN_VALUE.toInt(), Short.MAX_VALUE.toInt())
-                    outputChunk[chunkOffset++] = (interpolated and 0xff).toByte()
-                    outputChunk[chunkOffset++] = ((interpolated shr 8) and 0xff).toByte()
+                    for (channel in 0 until channelCount) {
+                        val lower = lowerSamples[channel]
+                        val interpolated = (
+                            lower + (upperSamples[channel] - lower) * fraction
+                        ).roundToInt().coerceIn(Short.MIN_VALUE.toInt(), Short.MAX_VALUE.toInt())
+                        outputChunk[chunkOffset++] = (interpolated and 0xff).toByte()
+                        outputChunk[chunkOffset++] = ((interpolated shr 8) and 0xff).toByte()
+                    }
                     if (chunkOffset == outputChunk.size) {
                         output.write(outputChunk)
                         chunkOffset = 0
@@ -674,17 +1315,22 @@ class TapStoryAudioEngine(private val context: Context) {
         }
     }
 
-    private fun writeWavHeader(output: RandomAccessFile, dataSize: Int, outputSampleRate: Int) {
+    private fun writeWavHeader(
+        output: RandomAccessFile,
+        dataSize: Int,
+        outputSampleRate: Int,
+        channelCount: Int
+    ) {
         output.writeBytes("RIFF")
         output.write(intToByteArrayLE(36 + dataSize))
         output.writeBytes("WAVE")
         output.writeBytes("fmt ")
         output.write(intToByteArrayLE(16))
         output.write(shortToByteArrayLE(1))
-        output.write(shortToByteArrayLE(CHANNELS_IN.toShort()))
+        output.write(shortToByteArrayLE(channelCount.toShort()))
         output.write(intToByteArrayLE(outputSampleRate))
-        output.write(intToByteArrayLE(outputSampleRate * CHANNELS_IN * BYTES_PER_SAMPLE))
-        output.write(shortToByteArrayLE((CHANNELS_IN * BYTES_PER_SAMPLE).toShort()))
+        output.write(intToByteArrayLE(outputSampleRate * channelCount * BYTES_PER_SAMPLE))
+        output.write(shortToByteArrayLE((channelCount * BYTES_PER_SAMPLE).toShort()))
         output.write(shortToByteArrayLE((BYTES_PER_SAMPLE * 8).toShort()))
         output.writeBytes("data")
         output.write(intToByteArrayLE(dataSize))
@@ -8,6 +8,7 @@ import android.os.Build
 import android.util.Log
 import com.facebook.react.bridge.*
 import com.facebook.react.modules.core.DeviceEventManagerModule
+import java.util.concurrent.atomic.AtomicBoolean
 import kotlin.math.roundToLong
 
 /**
@@ -30,6 +31,7 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
     private val routeLock = Any()
     private val moduleLifecycleLock = Any()
     private var knownAudioDeviceIds: Set<Int> = emptySet()
+    private val routeRecoveryPending = AtomicBoolean(false)
     private val audioManager: AudioManager
         get() = reactContext.getSystemService(Context.AUDIO_SERVICE) as AudioManager
     private val audioDeviceCallback = object : AudioDeviceCallback() {
@@ -66,11 +68,11 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
                     audioEngine = TapStoryAudioEngine(reactContext)
                 }
 
-                audioEngine?.initialize()
+                val readyMs = audioEngine?.initialize()
                 isInitialized = true
                 registerRouteCallback()
 
-                Log.d(TAG, "TapStoryAudioEngine initialized successfully")
+                Log.d(TAG, "TapStoryAudioEngine initialized successfully, streams ready in ${readyMs}ms")
                 promise.resolve(null)
             } catch (e: Exception) {
                 Log.e(TAG, "Failed to initialize audio engine", e)
@@ -121,6 +123,69 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
         }
     }
 
+    /**
+     * Render the loaded tracks between two positions to a WAV or FLAC file
+     * faster than realtime.
+     */
+    @ReactMethod
+    fun renderMixdown(startMs: Double, endMs: Double, format: String, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+
+            val result = engine.renderMixdown(startMs.roundToLong(), endMs.roundToLong(), format)
+            promise.resolve(
+                Arguments.createMap().apply {
+                    putString("uri", result.uri)
+                    putString("format", result.format)
+                    putDouble("startFrame", result.startFrame.toDouble())
+                    putDouble("frameCount", result.frameCount.toDouble())
+                    putDouble("durationMs", result.durationMs.toDouble())
+                    putDouble("renderMs", result.renderMs)
+                    putDouble("realtimeFactor", result.realtimeFactor)
+                    putInt("workerCount", result.workerCount)
+                    putInt("sampleRate", result.sampleRate)
+                }
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to render mixdown", e)
+            promise.reject("MIXDOWN_ERROR", "Failed to render mixdown: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Update the cached whole-chain WAV, re-rendering only changed blocks.
+     */
+    @ReactMethod
+    fun exportChainMix(promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+
+            val result = engine.exportChainMix()
+            promise.resolve(
+                Arguments.createMap().apply {
+                    putString("uri", result.uri)
+                    putDouble("frameCount", result.frameCount.toDouble())
+                    putDouble("durationMs", result.durationMs.toDouble())
+                    putDouble("blockCount", result.blockCount.toDouble())
+                    putDouble("renderedBlocks", result.renderedBlocks.toDouble())
+                    putDouble("renderMs", result.renderMs)
+                    putInt("sampleRate", result.sampleRate)
+                }
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to export chain mix", e)
+            promise.reject("MIXDOWN_ERROR", "Failed to export chain mix: ${e.message}", e)
+        }
+    }
+
     /**
      * Start playback only (no recording)
      * 
@@ -176,9 +241,189 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
         }
     }
 
+    /**
+     * Start playback and a take that keeps recording across loop passes.
+     * stopRecording returns each pass in loopTakes.
+     */
+    @ReactMethod
+    fun playAndRecordLoopTakes(playFromMs: Double, recordStartMs: Double, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+
+            Log.d(TAG, "Starting playback from ${playFromMs}ms, loop takes at ${recordStartMs}ms")
+            engine.playAndRecordLoopTakes(
+                playFromMs.roundToLong(),
+                recordStartMs.roundToLong()
+            ) { actualStartMs ->
+                sendEvent("onRecordingStarted", Arguments.createMap().apply {
+                    putDouble("actualStartMs", actualStartMs.toDouble())
+                })
+            }
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to start playback and loop recording", e)
+            promise.reject(
+                "PLAY_RECORD_ERROR",
+                "Failed to start playback and loop recording: ${e.message}",
+                e
+            )
+        }
+    }
+
+    /**
+     * Record several punch ranges in one pass of playback. Each entry of
+     * ranges is { startMs, endMs }; stopRecording returns one take per range
+     * in punchTakes next to the pass's whole aligned take.
+     */
+    @ReactMethod
+    fun playAndRecordRanges(playFromMs: Double, ranges: ReadableArray, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+
+            val rangesMs = (0 until ranges.size()).mapNotNull { index ->
+                ranges.getMap(index)?.let { range ->
+                    range.getDouble("startMs").roundToLong() to
+                        range.getDouble("endMs").roundToLong()
+                }
+            }
+            Log.d(TAG, "Starting playback from ${playFromMs}ms, recording ${rangesMs.size} ranges")
+            engine.playAndRecordRanges(playFromMs.roundToLong(), rangesMs) { actualStartMs ->
+                sendEvent("onRecordingStarted", Arguments.createMap().apply {
+                    putDouble("actualStartMs", actualStartMs.toDouble())
+                })
+            }
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to start playback and range recording", e)
+            promise.reject(
+                "PLAY_RECORD_ERROR",
+                "Failed to start playback and range recording: ${e.message}",
+                e
+            )
+        }
+    }
+
+    @ReactMethod
+    fun setHotIdle(enabled: Boolean, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            engine.setHotIdle(enabled)
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to set hot idle", e)
+            promise.reject("HOT_IDLE_ERROR", "Failed to set hot idle: ${e.message}", e)
+        }
+    }
+
+    @ReactMethod
+    fun setStemMixing(enabled: Boolean, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            engine.setStemMixing(enabled)
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to set stem mixing", e)
+            promise.reject("STEM_MIXING_ERROR", "Failed to set stem mixing: ${e.message}", e)
+        }
+    }
+
+    @ReactMethod
+    fun setInputChannelCount(channelCount: Int, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            promise.resolve(engine.setInputChannelCount(channelCount))
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to set input channels", e)
+            promise.reject(
+                "INPUT_CHANNELS_ERROR",
+                "Failed to set input channels: ${e.message}",
+                e
+            )
+        }
+    }
+
+    @ReactMethod
+    fun seekTo(positionMs: Double, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            engine.seekTo(positionMs.roundToLong())
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to seek", e)
+            promise.reject("SEEK_ERROR", "Failed to seek: ${e.message}", e)
+        }
+    }
+
+    @ReactMethod
+    fun setLoopRegion(startMs: Double, endMs: Double, crossfadeMs: Double, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            engine.setLoopRegion(
+                startMs.roundToLong(),
+                endMs.roundToLong(),
+                crossfadeMs.roundToLong()
+            )
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to set loop region", e)
+            promise.reject("LOOP_ERROR", "Failed to set loop region: ${e.message}", e)
+        }
+    }
+
+    @ReactMethod
+    fun clearLoopRegion(promise: Promise) {
+        audioEngine?.clearLoopRegion()
+        promise.resolve(null)
+    }
+
+    @ReactMethod
+    fun setPlaybackSpeed(speed: Double, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            engine.setPlaybackSpeed(speed)
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to set playback speed", e)
+            promise.reject("PLAYBACK_SPEED_ERROR", "Failed to set playback speed: ${e.message}", e)
+        }
+    }
+
     /**
      * Get current playback position with hardware-accurate timing
      */
+
     @ReactMethod
     fun getCurrentPositionMs(promise: Promise) {
         try {
@@ -214,6 +459,97 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
         }
     }
 
+    /**
+     * Measure the route's round-trip latency on device with a loopback sweep.
+     */
+    @ReactMethod
+    fun calibrateLatency(promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+
+            val result = engine.calibrateLatency()
+            promise.resolve(
+                Arguments.createMap().apply {
+                    putDouble("compensationFrames", result.compensationFrames.toDouble())
+                    putDouble("compensationMs", result.compensationMs)
+                    putDouble("confidence", result.confidence)
+                    putDouble("shortInputFrames", result.shortInputFrames.toDouble())
+                    putInt("sampleRate", result.sampleRate)
+                }
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to calibrate latency", e)
+            promise.reject("CALIBRATION_ERROR", "Failed to calibrate latency: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Onset envelopes of the last take and of the mix under it, or null when
+     * no take has finished since the engine started.
+     */
+    @ReactMethod
+    fun getTakeOnsetEnvelopes(promise: Promise) {
+        try {
+            val envelopes = audioEngine?.getTakeOnsetEnvelopes()
+            if (envelopes == null) {
+                promise.resolve(null)
+                return
+            }
+            promise.resolve(
+                Arguments.createMap().apply {
+                    putInt("sampleRate", envelopes.sampleRate)
+                    putInt("blockFrames", envelopes.blockFrames)
+                    putDouble("startFrame", envelopes.startFrame.toDouble())
+                    putArray("take", Arguments.fromArray(envelopes.take))
+                    putArray("mix", Arguments.fromArray(envelopes.mix))
+                }
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to read onset envelopes", e)
+            promise.reject("ENVELOPE_ERROR", "Failed to read onset envelopes: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Waveform peaks of a loaded track at roughly framesPerBin frames per
+     * bin. Resolves null for unknown tracks.
+     */
+    @ReactMethod
+    fun getTrackPeaks(trackId: String, framesPerBin: Int, promise: Promise) {
+        try {
+            promise.resolve(audioEngine?.getTrackPeaks(trackId, framesPerBin)?.let(::peaksToMap))
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to read track peaks", e)
+            promise.reject("PEAKS_ERROR", "Failed to read track peaks: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Waveform peaks of the take being recorded, from bin fromBin on.
+     */
+    @ReactMethod
+    fun getCapturePeaks(framesPerBin: Int, fromBin: Double, promise: Promise) {
+        try {
+            promise.resolve(
+                audioEngine?.getCapturePeaks(framesPerBin, fromBin.toLong())?.let(::peaksToMap)
+            )
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to read capture peaks", e)
+            promise.reject("PEAKS_ERROR", "Failed to read capture peaks: ${e.message}", e)
+        }
+    }
+
+    private fun peaksToMap(peaks: WaveformPeaks) = Arguments.createMap().apply {
+        putInt("sampleRate", peaks.sampleRate)
+        putInt("framesPerBin", peaks.framesPerBin)
+        putDouble("firstBin", peaks.firstBin.toDouble())
+        putArray("minMax", Arguments.fromArray(peaks.minMax))
+    }
+
     /**
      * Stop playback
      */
@@ -229,6 +565,50 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
         }
     }
 
+    /**
+     * Allocate the capture buffers ahead of the first take. Runs on the
+     * module's background thread, so arming the take does not pay for it.
+     */
+    @ReactMethod
+    fun prepareRecording(promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            engine.prepareRecording()
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to prepare recording", e)
+            promise.reject("PREPARE_RECORD_ERROR", "Failed to prepare recording: ${e.message}", e)
+        }
+    }
+
+    /**
+     * Schedule the end of the take at a timeline frame; resolves once the
+     * audio callback will apply it, not when the take has ended.
+     */
+    @ReactMethod
+    fun stopRecordingAtFrame(frame: Double, promise: Promise) {
+        try {
+            val engine = audioEngine
+            if (!isInitialized || engine == null) {
+                promise.reject("NOT_INITIALIZED", "Audio engine not initialized")
+                return
+            }
+            engine.stopRecordingAtFrame(frame.roundToLong())
+            promise.resolve(null)
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to schedule recording stop", e)
+            promise.reject(
+                "STOP_RECORD_ERROR",
+                "Failed to schedule recording stop: ${e.message}",
+                e
+            )
+        }
+    }
+
     /**
      * Stop recording and get the recording result
      */
@@ -241,7 +621,12 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
             }
 
             Log.d(TAG, "Stopping recording")
-            val result = audioEngine?.stopRecording()
+            val result = try {
+                audioEngine?.stopRecording()
+            } finally {
+                // A route change during the take waits for it to finalize.
+                recoverRouteIfPending()
+            }
             
             if (result != null) {
                 val response = Arguments.createMap().apply {
@@ -265,6 +650,31 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
                     putInt("inputXRunCount", result.inputXRunCount)
                     putInt("outputXRunCount", result.outputXRunCount)
                     putInt("sampleRate", result.sampleRate)
+                    putArray("punchTakes", Arguments.createArray().apply {
+                        result.punchTakes.forEach { take ->
+                            pushMap(Arguments.createMap().apply {
+                                putString("uri", take.uri)
+                                putInt("rangeIndex", take.rangeIndex)
+                                putDouble("startTimeMs", take.startTimeMs.toDouble())
+                                putDouble("durationMs", take.durationMs.toDouble())
+                                putDouble("startFrame", take.startFrame.toDouble())
+                                putDouble("frameCount", take.frameCount.toDouble())
+                            })
+                        }
+                    })
+                    putArray("loopTakes", Arguments.createArray().apply {
+                        result.loopTakes.forEach { take ->
+                            pushMap(Arguments.createMap().apply {
+                                putString("uri", take.uri)
+                                putInt("passIndex", take.passIndex)
+                                putDouble("startTimeMs", take.startTimeMs.toDouble())
+                                putDouble("durationMs", take.durationMs.toDouble())
+                                putDouble("startFrame", take.startFrame.toDouble())
+                                putDouble("frameCount", take.frameCount.toDouble())
+                                putDouble("driftFrames", take.driftFrames.toDouble())
+                            })
+                        }
+                    })
                 }
                 promise.resolve(response)
             } else {
@@ -319,9 +729,42 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
     }
 
     private fun invalidateAudioRoute() {
-        if (!isInitialized) return
-        Log.w(TAG, "Audio device topology changed; synchronized engine must be rebuilt")
-        audioEngine?.invalidateAudioRoute()
+        val engine = audioEngine
+        if (!isInitialized || engine == null) return
+        Log.w(TAG, "Audio device topology changed; reopening streams on the new route")
+        engine.invalidateAudioRoute()
+        // Set before checking the take, so a concurrent stopRecording either
+        // sees the request or has already cleared the recording flag.
+        routeRecoveryPending.set(true)
+        if (!engine.hasActiveRecording) recoverRouteIfPending()
+    }
+
+    private fun recoverRouteIfPending() {
+        if (!routeRecoveryPending.compareAndSet(true, false)) return
+        val engine = audioEngine ?: return
+        Thread({
+            synchronized(moduleLifecycleLock) {
+                // Cleanup or a rebuild since the route change owns the engine now.
+                if (!isInitialized || audioEngine !== engine) return@Thread
+                try {
+                    val result = engine.recoverAudioRoute()
+                    sendEvent("onAudioRouteRecovered", Arguments.createMap().apply {
+                        putBoolean("recovered", true)
+                        putInt("sampleRate", result.sampleRate)
+                        putDouble("recoveryMs", result.recoveryMs)
+                        putDouble("streamReadyMs", result.streamReadyMs)
+                        putDouble("inputLatencyMs", result.inputLatencyMs)
+                        putDouble("outputLatencyMs", result.outputLatencyMs)
+                    })
+                } catch (e: Exception) {
+                    Log.e(TAG, "Failed to reopen streams after route change", e)
+                    sendEvent("onAudioRouteRecovered", Arguments.createMap().apply {
+                        putBoolean("recovered", false)
+                        putString("error", e.message ?: "Route recovery failed")
+                    })
+                }
+            }
+        }, "TapStoryRouteRecovery").start()
     }
 
     private fun invalidateIfDeviceSetChanged() {
@@ -411,6 +854,12 @@ class TapStoryAudioModule(private val reactContext: ReactApplicationContext) :
                 putBoolean("captureOnsetExact", diagnostics.captureOnsetExact)
                 putInt("inputXRunDelta", diagnostics.inputXRunDelta)
                 putInt("outputXRunDelta", diagnostics.outputXRunDelta)
+                putBoolean("transportStartedHot", diagnostics.transportStartedHot)
+                putDouble("transportStartDelayMs", diagnostics.transportStartDelayMs)
+                putDouble("firstAudibleFrameMs", diagnostics.firstAudibleFrameMs)
+                putDouble("streamReadyMs", diagnostics.streamReadyMs)
+                putDouble("streamsOpenedMs", diagnostics.streamsOpenedMs)
+                putDouble("firstCallbackMs", diagnostics.firstCallbackMs)
             })
         } catch (e: Exception) {
             promise.reject("DIAGNOSTICS_ERROR", "Failed to read audio diagnostics: ${e.message}", e)
@@ -3,6 +3,7 @@ import { View, Text, StyleSheet, TouchableOpacity, LayoutChangeEvent, ScrollView
 import { GestureDetector, Gesture } from 'react-native-gesture-handler';
 import Animated, { useSharedValue, useAnimatedStyle, withTiming, runOnJS, interpolateColor } from 'react-native-reanimated';
 import { colors } from '../utils/theme';
+import { getWaveformBarHeights, type WaveformPeaks } from '../services/audio/TapStoryNativeAudio';
 
 interface AudioSegment {
   id: string;
@@ -26,9 +27,37 @@ interface AudioTimelineProps {
   previewTimelinePosition?: number | null; // Visual preview position during dragging
   processingSegmentIds?: Set<string>; // IDs of segments currently being uploaded/processed
   downloadingSegmentIds?: Set<string>; // IDs of segments currently being downloaded
+  waveforms?: Map<string, WaveformPeaks>; // Native peaks by segment ID
+  recordingWaveform?: WaveformPeaks | null; // Peaks of the take being recorded
 }
 
 const MIN_WIDTH_PX = 30; // Minimum segment width in pixels
+const WAVEFORM_BAR_PITCH_PX = 3; // 2px bar + 1px gap
+
+// Drawn behind the segment label from precomputed peaks; never touches PCM.
+const SegmentWaveform = React.memo(function SegmentWaveform({
+  peaks,
+  width,
+}: {
+  peaks?: WaveformPeaks | null;
+  width: number;
+}) {
+  const heights = React.useMemo(
+    () => (peaks ? getWaveformBarHeights(peaks.minMax, Math.floor(width / WAVEFORM_BAR_PITCH_PX)) : []),
+    [peaks, width]
+  );
+  if (heights.length === 0) return null;
+  return (
+    <View style={styles.waveform} pointerEvents="none">
+      {heights.map((height, index) => (
+        <View
+          key={index}
+          style={[styles.waveformBar, { height: `${Math.max(4, height * 100)}%` }]}
+        />
+      ))}
+    </View>
+  );
+});
 
 interface AnimatedSegmentProps {
   segment: AudioSegment;
@@ -40,6 +69,7 @@ interface AnimatedSegmentProps {
   recordingDuration: number;
   isProcessing: boolean;
   isDownloading: boolean;
+  waveform?: WaveformPeaks;
 }
 
 // Module-scoped so its component identity is stable. Declaring it inside
@@ -55,6 +85,7 @@ const AnimatedSegment = React.memo(function AnimatedSegment({
   recordingDuration,
   isProcessing,
   isDownloading,
+  waveform,
 }: AnimatedSegmentProps) {
   const glowOpacity = useSharedValue(isPlaying ? 1 : 0);
   const brightness = useSharedValue(isPlaying ? 1 : 0);
@@ -118,6 +149,7 @@ const AnimatedSegment = React.memo(function AnimatedSegment({
         },
       ]}
     >
+      <SegmentWaveform peaks={waveform} width={width} />
       <SegmentComponent {...segmentProps} style={styles.segmentInner}>
         <Text style={styles.segmentText} numberOfLines={1}>
           {isRecordingSegment
@@ -142,6 +174,8 @@ export function AudioTimeline({
   previewTimelinePosition = null,
   processingSegmentIds = new Set(),
   downloadingSegmentIds = new Set(),
+  waveforms,
+  recordingWaveform = null,
 }: AudioTimelineProps) {
   const [containerWidth, setContainerWidth] = useState(300);
   const [zoomScale, setZoomScale] = useState(1); // 1 = auto-fit, >1 = zoomed in
@@ -370,6 +404,7 @@ export function AudioTimeline({
         recordingDuration={recordingDuration}
         isProcessing={isProcessing}
         isDownloading={isDownloading}
+        waveform={waveforms?.get(segment.id)}
       />
     );
   };
@@ -404,6 +439,7 @@ export function AudioTimeline({
               },
             ]}
           >
+            <SegmentWaveform peaks={recordingWaveform} width={timeToWidth(recordingDuration)} />
             <Text style={styles.segmentText} numberOfLines={1}>
               {recordingDuration.toFixed(1)}s
             </Text>
@@ -429,6 +465,7 @@ export function AudioTimeline({
               },
             ]}
           >
+            <SegmentWaveform peaks={recordingWaveform} width={timeToWidth(recordingDuration)} />
             <Text style={styles.segmentText} numberOfLines={1}>
               {recordingDuration.toFixed(1)}s
             </Text>
@@ -513,6 +550,18 @@ const styles = StyleSheet.create({
     justifyContent: 'center',
     alignItems: 'center',
   },
+  waveform: {
+    ...StyleSheet.absoluteFillObject,
+    flexDirection: 'row',
+    alignItems: 'center',
+    paddingHorizontal: 1,
+  },
+  waveformBar: {
+    width: 2,
+    marginRight: 1,
+    borderRadius: 1,
+    backgroundColor: 'rgba(255, 255, 255, 0.35)',
+  },
   segmentText: {
     color: 'white',
     fontSize: 12,
@@ -30,6 +30,7 @@ import type {
 } from '@shared/types/audio';
 import { getNextTimelineStartTimeMs } from '@shared/utils/audioTimeline';
 import { createPendingAudioSegment } from '../services/audio/pendingAudioSegment';
+import { appendWaveformPeaks, type WaveformPeaks } from '../services/audio/TapStoryNativeAudio';
 import {
   savePendingUpload,
   removePendingUpload,
@@ -79,6 +80,11 @@ export function DuetRecorderWithTrackPlayer() {
   const [processingSegmentIds, setProcessingSegmentIds] = useState<Set<string>>(new Set());  // Segments being uploaded/processed
   const [failedSegmentIds, setFailedSegmentIds] = useState<Set<string>>(new Set());  // Takes whose upload failed (kept for retry)
   const [latencyOffsetMs, setLatencyOffsetMs] = useState(0);
+  // Fine-tune change measured from the last take's onset envelopes
+  const [suggestedNudgeMs, setSuggestedNudgeMs] = useState<number | null>(null);
+  // Native waveform peaks: per loaded segment, and of the take in progress
+  const [waveforms, setWaveforms] = useState<Map<string, WaveformPeaks>>(new Map());
+  const [recordingWaveform, setRecordingWaveform] = useState<WaveformPeaks | null>(null);
 
   // Download state
   const [downloadingSegmentIds, setDownloadingSegmentIds] = useState<Set<string>>(new Set());
@@ -136,6 +142,8 @@ export function DuetRecorderWithTrackPlayer() {
   const recordingStartTimestamp = useRef(0);
   const positionInterval = useRef<NodeJS.Timeout | null>(null);
   const recordingDurationInterval = useRef<NodeJS.Timeout | null>(null);
+  const recordingWaveformRef = useRef<WaveformPeaks | null>(null);
+  const capturePeaksPending = useRef(false);
 
   useEffect(() => {
     initAudio();
@@ -169,6 +177,61 @@ export function DuetRecorderWithTrackPlayer() {
     return () => sub.remove();
   }, [viewMode, isRecording, isWaitingToRecord]);
 
+  // Native tracks carry segment ids and get their peaks when loaded, which
+  // happens on play; retry missing segments whenever either changes.
+  useEffect(() => {
+    if (!usingNativeAudio) return;
+    const missing = audioChain.filter(node => !waveforms.has(node.id));
+    if (missing.length === 0) return;
+    let cancelled = false;
+    Promise.all(
+      missing.map(node =>
+        getTapStoryAudio()
+          .getTrackPeaks(node.id)
+          .then(peaks => [node.id, peaks] as const)
+          .catch(() => [node.id, null] as const)
+      )
+    ).then(results => {
+      if (cancelled) return;
+      const found = results.filter(
+        (result): result is readonly [string, WaveformPeaks] => result[1] !== null
+      );
+      if (found.length === 0) return;
+      setWaveforms(prev => {
+        const next = new Map(prev);
+        for (const [id, peaks] of found) next.set(id, peaks);
+        return next;
+      });
+    });
+    return () => {
+      cancelled = true;
+    };
+  }, [audioChain, isPlaying, usingNativeAudio]);
+
+  /** Fetch only the capture peak bins completed since the last poll. */
+  function pollCapturePeaks() {
+    if (capturePeaksPending.current) return;
+    const previous = recordingWaveformRef.current;
+    const fromBin = previous ? previous.firstBin + previous.minMax.length / 2 : 0;
+    capturePeaksPending.current = true;
+    getTapStoryAudio()
+      .getCapturePeaks(fromBin)
+      .then(update => {
+        if (!update || recordingWaveformRef.current !== previous) return;
+        recordingWaveformRef.current = appendWaveformPeaks(previous, update);
+        setRecordingWaveform(recordingWaveformRef.current);
+      })
+      .catch(() => {})
+      .finally(() => {
+        capturePeaksPending.current = false;
+      });
+  }
+
+  function resetRecordingWaveform() {
+    recordingWaveformRef.current = null;
+    setRecordingWaveform(null);
+  }
+
   async function initAudio() {
     try {
       // AudioRecorder owns the runtime microphone permission request. Native
@@ -201,6 +264,7 @@ export function DuetRecorderWithTrackPlayer() {
   async function handleLatencyChange(newOffset: number) {
     const clampedOffset = Math.max(-250, Math.min(250, newOffset));
     setLatencyOffsetMs(clampedOffset);
+    setSuggestedNudgeMs(null);
     await saveLatencyOffset(clampedOffset);
   }
 
@@ -568,10 +632,12 @@ export function DuetRecorderWithTrackPlayer() {
         
         setIsRecording(true);
         setRecordingDuration(0);
+        resetRecordingWaveform();
 
         recordingDurationInterval.current = setInterval(() => {
           const elapsed = (Date.now() - recordingStartTimestamp.current) / 1000;
           setRecordingDuration(elapsed);
+          pollCapturePeaks();
         }, 100);
       } else {
         // Non-native: use AudioRecorder
@@ -612,6 +678,7 @@ export function DuetRecorderWithTrackPlayer() {
 
       setIsRecording(false);
       setRecordingDuration(0);
+      resetRecordingWaveform();
       setIsPlaying(false);
       stopPositionTracking();
 
@@ -668,6 +735,7 @@ export function DuetRecorderWithTrackPlayer() {
       setIsWaitingToRecord(false);
       setIsPlaying(false);
       setRecordingDuration(0);
+      resetRecordingWaveform();
       stopPositionTracking();
 
       if (tempSegmentId) {
@@ -693,6 +761,10 @@ export function DuetRecorderWithTrackPlayer() {
       if (!result) {
         throw new Error('No recording result from native player');
       }
+      getTapStoryAudio()
+        .suggestLatencyNudgeMs()
+        .then(nudgeMs => setSuggestedNudgeMs(nudgeMs || null))
+        .catch(() => setSuggestedNudgeMs(null));
       return {
         uri: result.uri,
         durationMs: Math.max(1, Math.round(result.durationMs)),
@@ -786,6 +858,7 @@ export function DuetRecorderWithTrackPlayer() {
       setIsWaitingToRecord(false);
       setIsPlaying(false);
       setRecordingDuration(0);
+      resetRecordingWaveform();
       stopPositionTracking();
       setAudioError(null);
     }
@@ -991,6 +1064,8 @@ export function DuetRecorderWithTrackPlayer() {
           onSeekPreview={handleSeekPreview}
           processingSegmentIds={processingSegmentIds}
           downloadingSegmentIds={downloadingSegmentIds}
+          waveforms={waveforms}
+          recordingWaveform={recordingWaveform}
         />
       </View>
 
@@ -1058,6 +1133,7 @@ export function DuetRecorderWithTrackPlayer() {
       {usingNativeAudio && !isRecording && !isWaitingToRecord && audioChain.length > 0 && (
         <LatencyNudge
           offsetMs={latencyOffsetMs}
+          suggestedNudgeMs={suggestedNudgeMs}
           onOffsetChange={handleLatencyChange}
           disabled={isPlaying}
         />
@@ -4,11 +4,18 @@ import { colors } from '../utils/theme';
 
 interface LatencyNudgeProps {
   offsetMs: number;
+  /** Change measured from the last take; offered as a one-tap adjustment. */
+  suggestedNudgeMs?: number | null;
   onOffsetChange: (newOffset: number) => void;
   disabled?: boolean;
 }
 
-export function LatencyNudge({ offsetMs, onOffsetChange, disabled = false }: LatencyNudgeProps) {
+export function LatencyNudge({
+  offsetMs,
+  suggestedNudgeMs = null,
+  onOffsetChange,
+  disabled = false,
+}: LatencyNudgeProps) {
   const adjust = (delta: number) => {
     onOffsetChange(offsetMs + delta);
   };
@@ -57,6 +64,18 @@ export function LatencyNudge({ offsetMs, onOffsetChange, disabled = false }: Lat
           <Text style={styles.buttonText}>{'>>'}</Text>
         </TouchableOpacity>
       </View>
+      {suggestedNudgeMs !== null && (
+        <TouchableOpacity
+          style={styles.suggestion}
+          onPress={() => adjust(suggestedNudgeMs)}
+          disabled={disabled}
+          accessibilityHint="Apply the timing offset measured from your last take"
+        >
+          <Text style={styles.suggestionText}>
+            {`Last take was ${Math.abs(suggestedNudgeMs)} ms ${suggestedNudgeMs > 0 ? 'late' : 'early'} - tap to match`}
+          </Text>
+        </TouchableOpacity>
+      )}
     </View>
   );
 }
@@ -103,6 +122,16 @@ const styles = StyleSheet.create({
     alignItems: 'center',
     paddingHorizontal: 8,
   },
+  suggestion: {
+    marginTop: 8,
+    paddingVertical: 4,
+    paddingHorizontal: 8,
+  },
+  suggestionText: {
+    color: colors.textSecondary,
+    fontSize: 12,
+    textDecorationLine: 'underline',
+  },
   valueText: {
     color: colors.textPrimary,
     fontSize: 16,
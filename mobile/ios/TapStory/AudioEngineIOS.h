@@ -42,20 +42,78 @@ NS_ASSUME_NONNULL_BEGIN
  * Load a track into the mixer.
  *
  * @param trackId Unique identifier for the track
- * @param data Pointer to Int16 PCM samples (mono)
- * @param numSamples Number of samples in the data
- * @param startFrame Frame number where this track starts playing
+ * @param data Pointer to interleaved Int16 PCM frames
+ * @param numFrames Number of frames in the data
+ * @param channelCount Samples per frame, up to tapstory::kMaxTrackChannelCount
+ * @param sampleRate Rate of the PCM, converted as it plays; 0 for the session rate
+ * @param startFrame Frame number where this track starts playing, at the session rate
  */
 - (void)loadTrackWithId:(NSString *)trackId
                    data:(const int16_t *)data
-             numSamples:(int32_t)numSamples
+              numFrames:(int32_t)numFrames
+           channelCount:(int32_t)channelCount
+             sampleRate:(int32_t)sampleRate
              startFrame:(int32_t)startFrame;
 
+/**
+ * Load a track as a view into the chain container at `chainPath`, when the
+ * container holds it at `startFrame`, whatever rate the segment is at. Returns
+ * NO when it does not, so the caller decodes the source file instead.
+ */
+- (BOOL)loadChainSegmentAtPath:(NSString *)chainPath
+                        trackId:(NSString *)trackId
+                     startFrame:(int32_t)startFrame;
+
+/**
+ * Append a decoded, loaded track to the chain container at `chainPath`.
+ */
+- (BOOL)appendChainSegmentAtPath:(NSString *)chainPath trackId:(NSString *)trackId;
+
 /**
  * Clear all loaded tracks.
  */
 - (void)clearTracks;
 
+/**
+ * Play from two pre-mixed turn lanes instead of mixing every track per
+ * render cycle (see `tapstory::ChainStems`). Loads and clears keep the lanes
+ * current; refused while transport is running.
+ */
+- (BOOL)setStemMixing:(BOOL)enabled error:(NSError **)outError;
+
+/**
+ * Capture one or two interleaved channels. An initialized unit is rebuilt on
+ * the same route, resuming hot idle parked; refused while transport runs or
+ * a take is active.
+ */
+- (BOOL)setInputChannelCount:(int32_t)channelCount error:(NSError **)outError;
+
+/** Channels takes are captured and written with. */
+- (int32_t)inputChannelCount;
+
+/**
+ * Render the loaded tracks over [startFrame, endFrame) to a 16-bit stereo WAV
+ * or FLAC file. Uses the realtime mixer offline on a worker pool; call it from
+ * the same serial queue that loads tracks.
+ *
+ * @return Dictionary with frameCount, renderMs, realtimeFactor and workerCount
+ */
+- (nullable NSDictionary *)renderMixdownToPath:(NSString *)filePath
+                                    startFrame:(int64_t)startFrame
+                                      endFrame:(int64_t)endFrame
+                                          flac:(BOOL)flac
+                                         error:(NSError **)outError;
+
+/**
+ * Bring the whole-chain WAV at filePath up to date with the loaded tracks,
+ * re-rendering only blocks whose tracks changed since the previous call.
+ * Call it from the same serial queue that loads tracks.
+ *
+ * @return Dictionary with frameCount, blockCount, renderedBlocks and renderMs
+ */
+- (nullable NSDictionary *)updateChainMixAtPath:(NSString *)filePath
+                                          error:(NSError **)outError;
+
 /**
  * Start audio playback.
  * If tracks are loaded, they will be mixed according to their startFrame positions.
@@ -68,11 +126,25 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)stop;
 
+/**
+ * Keep RemoteIO rendering silence while transport is stopped, so the next
+ * start begins at the next render cycle instead of restarting the unit.
+ * Enabling starts an initialized, stopped unit parked.
+ */
+- (BOOL)setHotIdle:(BOOL)enabled error:(NSError **)outError;
+
+/**
+ * Allocate the capture ring and live peaks before the first take. Preparing
+ * the route only sizes them; without this call the first take allocates them
+ * when it is armed.
+ */
+- (void)prepareCaptureBuffers;
+
 /**
  * Start recording to a file.
  * Recording will begin when the current frame reaches startFrame.
  *
- * @param filePath Path to write raw PCM data (Int16 mono at the active route rate)
+ * @param filePath Path to write raw PCM data (interleaved Int16 at the active route rate)
  * @param startFrame Logical timeline frame at which the new recording is aligned
  * @param outError Error returned when the writer cannot be armed
  */
@@ -80,17 +152,82 @@ NS_ASSUME_NONNULL_BEGIN
                   startFrame:(int64_t)startFrame
                        error:(NSError **)outError;
 
+/**
+ * Start recording that ends by itself once the input heard at punchOutFrame
+ * has arrived, while playback runs on. A negative punchOutFrame records until
+ * stopped.
+ */
+- (BOOL)startRecordingToPath:(NSString *)filePath
+                  startFrame:(int64_t)startFrame
+               punchOutFrame:(int64_t)punchOutFrame
+                       error:(NSError **)outError;
+
+/**
+ * Start a looped take that records across passes instead of ending at the
+ * loop end. The writer splits it into one WAV per pass, named
+ * lanePathPrefix + pass index + ".wav"; see loopTakeLanes.
+ */
+- (BOOL)startRecordingToPath:(NSString *)filePath
+                  startFrame:(int64_t)startFrame
+               punchOutFrame:(int64_t)punchOutFrame
+              lanePathPrefix:(nullable NSString *)lanePathPrefix
+                       error:(NSError **)outError;
+
+/**
+ * Cut [start, end) frame ranges out of a finalized aligned WAV whose first
+ * frame is takeStartFrame. rangeFrames holds start0, end0, start1, end1, ...
+ * Range i is written to pathPrefix + i + ".wav". Each entry has path,
+ * rangeIndex, startFrame and frameCount; unreached ranges are absent.
+ */
+- (nullable NSArray<NSDictionary *> *)writePunchTakesFromPath:(NSString *)takePath
+                                               takeStartFrame:(int64_t)takeStartFrame
+                                                  rangeFrames:(NSArray<NSNumber *> *)rangeFrames
+                                                   pathPrefix:(NSString *)pathPrefix
+                                                        error:(NSError **)outError;
+
+/**
+ * End the armed take at `frame` from inside the render callback, exactly
+ * where the input heard at that frame arrives. Playback runs on; a later
+ * `stopRecording` finalizes without waiting on callbacks.
+ *
+ * @return NO when no take is armed or the frame is not after the punch
+ */
+- (BOOL)stopRecordingAtFrame:(int64_t)frame;
+
 /**
  * Stop recording.
  */
 - (void)stopRecording;
 
 /**
- * Seek to a specific frame position.
+ * Seek to a specific frame position. While the transport runs, the jump is
+ * applied at the next render callback with a short crossfade.
  *
  * @param frame The frame number to seek to
+ * @return NO while a take is armed
+ */
+- (BOOL)seekToFrame:(int64_t)frame;
+
+/**
+ * Loop playback over [startFrame, endFrame) inside the render callback.
+ *
+ * @param crossfadeFrames Length of the fade across the wrap, 0 for a hard cut
+ * @return NO when the loop is no longer than its crossfade or the armed take's latency
+ */
+- (BOOL)setLoopRegionFromFrame:(int64_t)startFrame
+                       toFrame:(int64_t)endFrame
+               crossfadeFrames:(int32_t)crossfadeFrames;
+
+/** Stop looping; playback continues past the old loop end. */
+- (void)clearLoopRegion;
+
+/**
+ * Practice playback at `speed` times the nominal rate, resampled in the render
+ * callback from the next one on; tracks are not decoded again.
+ *
+ * @return NO outside 0.5-1.0, or for a speed other than 1.0 while a take is armed
  */
-- (void)seekToFrame:(int64_t)frame;
+- (BOOL)setPlaybackSpeed:(double)speed;
 
 /**
  * Get the current playback position in frames.
@@ -112,6 +249,15 @@ NS_ASSUME_NONNULL_BEGIN
 /** The exclusive render timeline end frame of the captured PCM span. */
 - (int64_t)recordingTimelineEndFrame;
 
+/** Timeline frames the take covered; the sum of its passes when recorded as lanes. */
+- (int64_t)recordingTimelineFrameCount;
+
+/**
+ * Passes of the last take recorded as lanes, with path, passIndex,
+ * startFrame, endFrame, rawFrameCount and driftFrames. Empty otherwise.
+ */
+- (NSArray<NSDictionary *> *)loopTakeLanes;
+
 /**
  * Get the number of samples recorded so far.
  *
@@ -140,6 +286,40 @@ NS_ASSUME_NONNULL_BEGIN
 /** Whether the transport callback is active. */
 - (BOOL)isRunning;
 
+/**
+ * Measure the route's round trip by playing a sweep through RemoteIO and
+ * recording it in the same session. Transport must be stopped; blocks for
+ * under a second. The result is returned, not applied.
+ *
+ * @return Dictionary with compensationFrames, compensationMs, confidence and
+ *         shortInputFrames
+ */
+- (nullable NSDictionary *)calibrateLatency:(NSError **)outError;
+
+/**
+ * Onset envelopes of the last finished take and of the mix it was recorded
+ * over, streamed while the take was written.
+ *
+ * @return Dictionary with blockFrames, startFrame, take and mix, or nil when
+ *         no take has finished or one is still being written
+ */
+- (nullable NSDictionary *)takeOnsetEnvelopes;
+
+/**
+ * Waveform peaks of a loaded track, from the pyramid level nearest
+ * framesPerBin.
+ *
+ * @return Dictionary with framesPerBin, firstBin and interleaved minMax PCM16
+ *         pairs, or nil for an unknown track
+ */
+- (nullable NSDictionary *)trackPeaksForId:(NSString *)trackId framesPerBin:(int32_t)framesPerBin;
+
+/**
+ * Waveform peaks of the take being recorded, from bin fromBin on, so a live
+ * waveform only fetches the bins completed since its last poll.
+ */
+- (nullable NSDictionary *)capturePeaksWithFramesPerBin:(int32_t)framesPerBin fromBin:(int64_t)fromBin;
+
 /**
  * Configure capture latency compensation.
  * Zero restores automatic input + output route latency; a positive value
@@ -150,6 +330,18 @@ NS_ASSUME_NONNULL_BEGIN
 /** Fail closed after an audio-session route/interruption notification. */
 - (void)invalidateAudioRoute;
 
+/**
+ * Rebuild the session and RemoteIO unit on the route that replaced an
+ * invalidated one, keeping loaded tracks: their PCM stays at its own rate and
+ * the mixer converts it, while their placements, the playhead and any loop
+ * region are rescaled to the new rate. A latency override is cleared, and
+ * hot idle resumes parked. Fails while a take is armed or being written; a
+ * route that cannot be set up leaves the engine invalidated.
+ *
+ * @return Dictionary with sampleRate, recoveryMs, inputLatencyMs and outputLatencyMs
+ */
+- (nullable NSDictionary *)recoverAudioRoute:(NSError **)outError;
+
 /**
  * Get latency information from the audio session.
  *
@@ -2,9 +2,10 @@
 //  AudioEngineIOS.mm
 //  TapStory
 //
-//  RemoteIO full-duplex engine. The render callback only pulls input, copies
-//  capture PCM into a lock-free SPSC ring, and mixes immutable tracks. File I/O
-//  and React Native notification happen on a background writer queue.
+//  RemoteIO full-duplex engine. The render callback only pulls input and
+//  forwards both buffers to the shared tapstory::DuplexCore, which mixes the
+//  immutable tracks and copies capture PCM into its lock-free ring. File I/O
+//  and React Native notification happen on the core's background writer.
 //
 
 #import "AudioEngineIOS.h"
@@ -12,135 +13,26 @@
 #import <AudioToolbox/AudioToolbox.h>
 
 #include <algorithm>
-#include <array>
 #include <atomic>
 #include <chrono>
 #include <cmath>
-#include <cstring>
-#include <fstream>
+#include <cstdlib>
 #include <limits>
+#include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
-namespace {
-
-constexpr int32_t kOutputChannelCount = 2;
-constexpr int32_t kInputChannelCount = 1;
-constexpr size_t kWriterChunkFrames = 8192;
-constexpr int64_t kUnsetFrame = -1;
-constexpr int64_t kPublishingFrame = -2;
-
-enum class CaptureStartState : uint8_t {
-    Pending,
-    Started,
-    Cancelled,
-};
-
-static_assert(std::atomic<CaptureStartState>::is_always_lock_free);
-
-size_t nextPowerOfTwo(size_t value) {
-    if (value <= 1) return 1;
-    --value;
-    for (size_t shift = 1; shift < sizeof(size_t) * 8; shift <<= 1) {
-        value |= value >> shift;
-    }
-    return value + 1;
-}
-
-struct Track {
-    std::vector<float> samples;
-    int64_t startFrame = 0;
-    int64_t lengthFrames = 0;
-};
-
-/** Single-producer/single-consumer PCM ring with monotonic cursors. */
-class PcmRing {
-public:
-    void configure(size_t minimumCapacity) {
-        const size_t capacity = nextPowerOfTwo(minimumCapacity);
-        samples_.assign(capacity, 0);
-        mask_ = capacity - 1;
-        reset();
-    }
-
-    void reset() {
-        readCursor_.store(0, std::memory_order_relaxed);
-        writeCursor_.store(0, std::memory_order_relaxed);
-    }
-
-    size_t write(const int16_t *source, size_t count) noexcept {
-        if (samples_.empty() || count == 0) return 0;
-
-        const uint64_t writeCursor = writeCursor_.load(std::memory_order_relaxed);
-        const uint64_t readCursor = readCursor_.load(std::memory_order_acquire);
-        const size_t used = static_cast<size_t>(writeCursor - readCursor);
-        const size_t writable = std::min(count, samples_.size() - used);
-        const size_t index = static_cast<size_t>(writeCursor) & mask_;
-        const size_t firstCopy = std::min(writable, samples_.size() - index);
-
-        if (firstCopy > 0) {
-            std::memcpy(samples_.data() + index, source, firstCopy * sizeof(int16_t));
-        }
-        const size_t secondCopy = writable - firstCopy;
-        if (secondCopy > 0) {
-            std::memcpy(samples_.data(), source + firstCopy, secondCopy * sizeof(int16_t));
-        }
-
-        writeCursor_.store(writeCursor + writable, std::memory_order_release);
-        return writable;
-    }
-
-    size_t read(int16_t *destination, size_t count) noexcept {
-        if (samples_.empty() || count == 0) return 0;
-
-        const uint64_t readCursor = readCursor_.load(std::memory_order_relaxed);
-        const uint64_t writeCursor = writeCursor_.load(std::memory_order_acquire);
-        const size_t readable = std::min(count, static_cast<size_t>(writeCursor - readCursor));
-        const size_t index = static_cast<size_t>(readCursor) & mask_;
-        const size_t firstCopy = std::min(readable, samples_.size() - index);
-
-        if (firstCopy > 0) {
-            std::memcpy(destination, samples_.data() + index, firstCopy * sizeof(int16_t));
-        }
-        const size_t secondCopy = readable - firstCopy;
-        if (secondCopy > 0) {
-            std::memcpy(destination + firstCopy, samples_.data(), secondCopy * sizeof(int16_t));
-        }
-
-        readCursor_.store(readCursor + readable, std::memory_order_release);
-        return readable;
-    }
-
-    size_t size() const noexcept {
-        const uint64_t writeCursor = writeCursor_.load(std::memory_order_acquire);
-        const uint64_t readCursor = readCursor_.load(std::memory_order_acquire);
-        return static_cast<size_t>(writeCursor - readCursor);
-    }
-
-    size_t capacity() const noexcept {
-        return samples_.size();
-    }
-
-private:
-    std::vector<int16_t> samples_;
-    size_t mask_ = 0;
-    alignas(64) std::atomic<uint64_t> readCursor_ { 0 };
-    alignas(64) std::atomic<uint64_t> writeCursor_ { 0 };
-};
-
-class CallbackActivityGuard {
-public:
-    explicit CallbackActivityGuard(std::atomic<uint32_t> &counter) : counter_(counter) {
-        counter_.fetch_add(1, std::memory_order_acq_rel);
-    }
+#include "audio/ChainContainer.h"
+#include "audio/DuplexCore.h"
+#include "audio/LinearResampler.h"
+#include "audio/MixdownCache.h"
+#include "audio/OfflineMixdown.h"
+#include "audio/PunchTakes.h"
 
-    ~CallbackActivityGuard() {
-        counter_.fetch_sub(1, std::memory_order_acq_rel);
-    }
+namespace {
 
-private:
-    std::atomic<uint32_t> &counter_;
-};
+constexpr int32_t kOutputChannelCount = tapstory::DuplexCore::kOutputChannelCount;
 
 NSError *makeEngineError(NSInteger code, NSString *message) {
     return [NSError errorWithDomain:@"AudioEngineIOS"
@@ -148,6 +40,26 @@ NSError *makeEngineError(NSInteger code, NSString *message) {
                            userInfo:@{NSLocalizedDescriptionKey: message}];
 }
 
+NSArray<NSNumber *> *makeNumberArray(const std::vector<float> &values) {
+    NSMutableArray<NSNumber *> *array = [NSMutableArray arrayWithCapacity:values.size()];
+    for (const float value : values) [array addObject:@(value)];
+    return array;
+}
+
+NSDictionary *makePeakDictionary(const tapstory::PeakPyramid::Level &level, int64_t fromBin) {
+    if (level.minMax == nullptr) return nil;
+    const size_t first = static_cast<size_t>(std::max<int64_t>(0, fromBin));
+    NSMutableArray<NSNumber *> *minMax = [NSMutableArray array];
+    for (size_t value = first * 2; value < level.binCount * 2; ++value) {
+        [minMax addObject:@(level.minMax[value])];
+    }
+    return @{
+        @"framesPerBin": @(level.framesPerBin),
+        @"firstBin": @(static_cast<int64_t>(first)),
+        @"minMax": minMax
+    };
+}
+
 } // namespace
 
 @interface AudioEngineIOS () {
@@ -156,48 +68,35 @@ NSError *makeEngineError(NSInteger code, NSString *message) {
     AudioStreamBasicDescription _inputFormat;
     double _sampleRate;
     UInt32 _maximumFramesPerSlice;
+    // Requested capture channels, applied when the unit is set up.
+    int32_t _inputChannelCount;
 
-    // Track storage is mutated only while transport is stopped. It is immutable
-    // for the entire lifetime of an active render callback.
-    std::vector<Track> _tracks;
+    // Tracks, timeline, capture gating and the PCM writer. Track storage is
+    // mutated only while transport is stopped.
+    tapstory::DuplexCore _core;
+    std::unique_ptr<tapstory::MixdownCache> _chainMixCache;
+    // Mapped once per load pass; loaded tracks keep their own reference.
+    std::shared_ptr<const tapstory::ChainContainer> _chain;
 
     std::atomic<bool> _initialized;
+    // Running means transport. In hot idle RemoteIO keeps rendering while the
+    // core holds the transport parked.
     std::atomic<bool> _isRunning;
-    std::atomic<bool> _outputMuted;
-    std::atomic<int64_t> _firstMutedOutputFrame;
-    std::atomic<int64_t> _currentFrame;
-    std::atomic<uint32_t> _callbackActivityCount;
+    std::atomic<bool> _unitRunning;
+    std::atomic<bool> _hotIdle;
+    std::atomic<bool> _lastStartWasHot;
     std::atomic<double> _lastRenderSampleTime;
     std::atomic<uint32_t> _lastRenderFrameCount;
     std::atomic<bool> _routeInvalidated;
 
-    // Capture state shared with the real-time producer. The start state makes
-    // the first punch and a concurrent cancellation one atomic decision.
-    std::atomic<bool> _captureArmed;
-    std::atomic<CaptureStartState> _captureStartState;
-    std::atomic<int64_t> _requestedRecordStartFrame;
-    std::atomic<int64_t> _captureGateFrame;
-    std::atomic<int64_t> _actualRecordStartFrame;
-    std::atomic<int64_t> _captureTimelineEndFrame;
-    std::atomic<int64_t> _captureStopFrame;
+    // RemoteIO-specific take diagnostics.
     std::atomic<int64_t> _latencyCompensationFrames;
-    std::atomic<int64_t> _overflowFrameCount;
     std::atomic<int64_t> _inputRenderErrorCount;
     std::atomic<int64_t> _timelineDiscontinuityCount;
     std::atomic<bool> _captureRouteInvalidated;
 
     // The input buffer and ring storage are allocated before transport starts.
-    std::vector<int16_t> _inputBuffer;
-    PcmRing _captureRing;
-
-    // Only the background writer touches the stream after it is opened.
-    std::ofstream _recordingFile;
-    dispatch_queue_t _writerQueue;
-    dispatch_group_t _writerGroup;
-    std::atomic<bool> _writerActive;
-    std::atomic<bool> _writerStopRequested;
-    std::atomic<bool> _writerFailed;
-    std::atomic<int64_t> _writtenSampleCount;
+    std::vector<float> _inputBuffer;
 
     // Snapshot of the route values used to align this capture.
     std::atomic<double> _configuredLatencyCompensationMs;
@@ -210,7 +109,8 @@ NSError *makeEngineError(NSInteger code, NSString *message) {
 
 - (BOOL)setupAudioSession:(NSError **)outError;
 - (BOOL)setupAudioUnit:(NSError **)outError;
-- (void)drainRecordingRing;
+- (void)prepareCoreForRoute;
+- (void)disposeAudioUnit;
 - (OSStatus)performRenderWithActionFlags:(AudioUnitRenderActionFlags *)ioActionFlags
                                timeStamp:(const AudioTimeStamp *)inTimeStamp
                                busNumber:(UInt32)inBusNumber
@@ -243,39 +143,31 @@ static OSStatus RenderCallback(
         _remoteIOUnit = NULL;
         _sampleRate = 0;
         _maximumFramesPerSlice = 0;
+        _inputChannelCount = 1;
         _initialized.store(false);
         _isRunning.store(false);
-        _outputMuted.store(false);
-        _firstMutedOutputFrame.store(-1);
-        _currentFrame.store(0);
-        _callbackActivityCount.store(0);
+        _unitRunning.store(false);
+        _hotIdle.store(false);
+        _lastStartWasHot.store(false);
         _lastRenderSampleTime.store(std::numeric_limits<double>::quiet_NaN());
         _lastRenderFrameCount.store(0);
         _routeInvalidated.store(false);
-        _captureArmed.store(false);
-        _captureStartState.store(CaptureStartState::Cancelled);
-        _requestedRecordStartFrame.store(0);
-        _captureGateFrame.store(0);
-        _actualRecordStartFrame.store(-1);
-        _captureTimelineEndFrame.store(-1);
-        _captureStopFrame.store(-1);
         _latencyCompensationFrames.store(0);
-        _overflowFrameCount.store(0);
         _inputRenderErrorCount.store(0);
         _timelineDiscontinuityCount.store(0);
         _captureRouteInvalidated.store(false);
-        _writerActive.store(false);
-        _writerStopRequested.store(false);
-        _writerFailed.store(false);
-        _writtenSampleCount.store(0);
         _configuredLatencyCompensationMs.store(0);
         _appliedInputLatencySeconds.store(0);
         _appliedOutputLatencySeconds.store(0);
         _automaticLatencyCompensationMs.store(0);
         _effectiveLatencyCompensationMs.store(0);
         _latencyCompensationWasOverridden.store(false);
-        _writerQueue = dispatch_queue_create("com.tapstory.audio.capture-writer", DISPATCH_QUEUE_SERIAL);
-        _writerGroup = dispatch_group_create();
+
+        __weak AudioEngineIOS *weakSelf = self;
+        _core.setCaptureStartedHandler([weakSelf](int64_t timelineFrame) {
+            void (^handler)(int64_t) = weakSelf.recordingStartedHandler;
+            if (handler) handler(timelineFrame);
+        });
         NSLog(@"[AudioEngineIOS] Created");
     }
     return self;
@@ -398,15 +290,16 @@ static OSStatus RenderCallback(
         return NO;
     }
 
+    // Capture as float so the core applies the same PCM16 conversion as Android.
     _inputFormat = {
         .mSampleRate = _sampleRate,
         .mFormatID = kAudioFormatLinearPCM,
-        .mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked,
-        .mBytesPerPacket = sizeof(SInt16) * kInputChannelCount,
+        .mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked,
+        .mBytesPerPacket = sizeof(Float32) * _inputChannelCount,
         .mFramesPerPacket = 1,
-        .mBytesPerFrame = sizeof(SInt16) * kInputChannelCount,
-        .mChannelsPerFrame = kInputChannelCount,
-        .mBitsPerChannel = sizeof(SInt16) * 8,
+        .mBytesPerFrame = sizeof(Float32) * _inputChannelCount,
+        .mChannelsPerFrame = static_cast<UInt32>(_inputChannelCount),
+        .mBitsPerChannel = sizeof(Float32) * 8,
         .mReserved = 0
     };
     status = AudioUnitSetProperty(_remoteIOUnit,
@@ -467,40 +360,177 @@ static OSStatus RenderCallback(
         return NO;
     }
 
-    _inputBuffer.assign(_maximumFramesPerSlice, 0);
-    const size_t routeFrames = static_cast<size_t>(std::ceil(_sampleRate * 4.0));
-    const size_t burstFrames = static_cast<size_t>(_maximumFramesPerSlice) * 8;
-    _captureRing.configure(std::max(routeFrames, burstFrames));
+    [self prepareCoreForRoute];
     _initialized.store(true, std::memory_order_release);
     _routeInvalidated.store(false, std::memory_order_release);
 
     NSLog(@"[AudioEngineIOS] Initialized at %.0fHz, maxSlice=%u, captureRing=%zu frames",
           _sampleRate,
           (unsigned)_maximumFramesPerSlice,
-          _captureRing.capacity());
+          _core.captureRingCapacity());
     return YES;
 }
 
+- (void)prepareCoreForRoute {
+    const int32_t channels = static_cast<int32_t>(_inputFormat.mChannelsPerFrame);
+    _inputBuffer.assign(static_cast<size_t>(_maximumFramesPerSlice) * channels, 0.0f);
+    const int32_t sampleRate = static_cast<int32_t>(std::lround(_sampleRate));
+    const size_t routeFrames = static_cast<size_t>(std::ceil(_sampleRate * 4.0));
+    const size_t burstFrames = static_cast<size_t>(_maximumFramesPerSlice) * 8;
+    _core.prepareCapture(std::max(routeFrames, burstFrames), sampleRate, channels);
+    // The timeline runs at the session rate. Tracks keep their PCM at its own
+    // rate and the mixer converts it, so a route change only rescales
+    // placements.
+    _core.trackStore().setTimelineRate(sampleRate);
+    _core.refreshStems();
+}
+
+- (void)disposeAudioUnit {
+    if (_remoteIOUnit) {
+        AudioUnitUninitialize(_remoteIOUnit);
+        AudioComponentInstanceDispose(_remoteIOUnit);
+        _remoteIOUnit = NULL;
+    }
+}
+
+- (nullable NSDictionary *)recoverAudioRoute:(NSError **)outError {
+    if (!_initialized.load(std::memory_order_acquire)) {
+        if (outError) *outError = makeEngineError(8, @"Audio engine is not initialized");
+        return nil;
+    }
+    if (_core.isCaptureArmed() || _core.isWriterActive()) {
+        if (outError) {
+            *outError = makeEngineError(16, @"Finish the take before recovering the audio route");
+        }
+        return nil;
+    }
+    const auto started = std::chrono::steady_clock::now();
+    [self stop];
+    if (_unitRunning.exchange(false, std::memory_order_acq_rel)) {
+        AudioOutputUnitStop(_remoteIOUnit);
+        _core.waitForCallbacks();
+    }
+    [self disposeAudioUnit];
+
+    const int32_t previousRate = _core.trackStore().sampleRate();
+    const int64_t playhead = _core.currentFrame();
+    const tapstory::DuplexCore::LoopRegion loop = _core.loopRegion();
+    if (![self setupAudioSession:outError] || ![self setupAudioUnit:outError]) {
+        // Stay invalidated with the tracks kept; the next start fails and the
+        // caller rebuilds the engine as before.
+        [self disposeAudioUnit];
+        return nil;
+    }
+    [self prepareCoreForRoute];
+    const int32_t sampleRate = _core.trackStore().sampleRate();
+    if (previousRate > 0 && previousRate != sampleRate) {
+        _core.seek(tapstory::rescaleFrame(playhead, previousRate, sampleRate));
+        if (loop.active()) {
+            _core.setLoopRegion(
+                tapstory::rescaleFrame(loop.startFrame, previousRate, sampleRate),
+                tapstory::rescaleFrame(loop.endFrame, previousRate, sampleRate),
+                static_cast<int32_t>(
+                    tapstory::rescaleFrame(loop.crossfadeFrames, previousRate, sampleRate)));
+        }
+    }
+    // An override was measured on the old route; fall back to its automatic value.
+    [self setLatencyCompensationMs:0];
+    _routeInvalidated.store(false, std::memory_order_release);
+    if (_hotIdle.load(std::memory_order_acquire) && ![self setHotIdle:YES error:outError]) {
+        return nil;
+    }
+
+    AVAudioSession *session = [AVAudioSession sharedInstance];
+    const double recoveryMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+    NSLog(@"[AudioEngineIOS] Route recovered: %dHz -> %dHz, %zu tracks kept, %.1fms",
+          previousRate,
+          sampleRate,
+          _core.trackStore().size(),
+          recoveryMs);
+    return @{
+        @"sampleRate": @(_sampleRate),
+        @"recoveryMs": @(recoveryMs),
+        @"inputLatencyMs": @(session.inputLatency * 1000),
+        @"outputLatencyMs": @(session.outputLatency * 1000)
+    };
+}
+
 - (void)loadTrackWithId:(NSString *)trackId
                    data:(const int16_t *)data
-             numSamples:(int32_t)numSamples
+              numFrames:(int32_t)numFrames
+           channelCount:(int32_t)channelCount
+             sampleRate:(int32_t)sampleRate
              startFrame:(int32_t)startFrame {
     if (_isRunning.load(std::memory_order_acquire)) {
         NSLog(@"[AudioEngineIOS] Refusing to mutate track '%@' while transport is running", trackId);
         return;
     }
-    if (!data || numSamples <= 0) return;
+    if (!data || numFrames <= 0) return;
+
+    const std::string identifier(trackId.UTF8String);
+    tapstory::TrackStore &store = _core.trackStore();
+    if (!store.load(identifier, data, numFrames, startFrame, channelCount, sampleRate)) return;
+    _core.refreshStems();
+    const tapstory::Track *track = store.find(identifier);
+    NSLog(@"[AudioEngineIOS] Loaded '%@': %d frames x %d (%d Hz) at %d, %.1f LUFS, %.1f dBTP, "
+          @"gain %.2f",
+          trackId,
+          numFrames,
+          channelCount,
+          track->sampleRate,
+          startFrame,
+          track->loudness.integratedLufs,
+          track->loudness.truePeakDbtp,
+          track->gain);
+}
+
+- (BOOL)loadChainSegmentAtPath:(NSString *)chainPath
+                        trackId:(NSString *)trackId
+                     startFrame:(int32_t)startFrame {
+    if (_isRunning.load(std::memory_order_acquire)) {
+        NSLog(@"[AudioEngineIOS] Refusing to mutate track '%@' while transport is running", trackId);
+        return NO;
+    }
+    const std::string path(chainPath.UTF8String);
+    if (!_chain || _chain->path() != path) {
+        auto chain = std::make_shared<tapstory::ChainContainer>();
+        if (!chain->open(path)) {
+            _chain.reset();
+            return NO;
+        }
+        _chain = std::move(chain);
+    }
 
-    Track track;
-    track.startFrame = startFrame;
-    track.lengthFrames = numSamples;
-    track.samples.resize(static_cast<size_t>(numSamples));
-    constexpr float scalar = 1.0f / 32768.0f;
-    for (int32_t index = 0; index < numSamples; ++index) {
-        track.samples[static_cast<size_t>(index)] = static_cast<float>(data[index]) * scalar;
+    // Segments keep their own rate, so their placement may round a frame
+    // differently once rescaled to the session's.
+    const tapstory::ChainSegment *segment = _chain->find(std::string(trackId.UTF8String));
+    if (segment == nullptr) return NO;
+    const int64_t placedFrame = tapstory::rescaleFrame(
+            segment->startFrame, segment->sampleRate, _core.trackStore().sampleRate());
+    if (std::llabs(placedFrame - startFrame) > 1) return NO;
+    const auto index = static_cast<size_t>(segment - _chain->segments().data());
+    if (!_core.trackStore().loadMapped(_chain, index)) return NO;
+    _core.refreshStems();
+    NSLog(@"[AudioEngineIOS] Mapped '%@' from chain: %lld frames at %d, gain %.2f",
+          trackId,
+          static_cast<long long>(segment->lengthFrames),
+          startFrame,
+          segment->gain);
+    return YES;
+}
+
+- (BOOL)appendChainSegmentAtPath:(NSString *)chainPath trackId:(NSString *)trackId {
+    const tapstory::Track *track = _core.trackStore().find(std::string(trackId.UTF8String));
+    if (track == nullptr) return NO;
+    if (!tapstory::ChainContainer::append(
+                std::string(chainPath.UTF8String), *track, _core.trackStore().sampleRate())) {
+        NSLog(@"[AudioEngineIOS] Could not append '%@' to chain container", trackId);
+        return NO;
     }
-    _tracks.push_back(std::move(track));
-    NSLog(@"[AudioEngineIOS] Loaded '%@': %d frames at %d", trackId, numSamples, startFrame);
+    // The next load pass maps the file again to see the new segment.
+    _chain.reset();
+    return YES;
 }
 
 - (void)clearTracks {
@@ -508,7 +538,138 @@ static OSStatus RenderCallback(
         NSLog(@"[AudioEngineIOS] Refusing to clear tracks while transport is running");
         return;
     }
-    _tracks.clear();
+    _core.trackStore().clear();
+    _core.refreshStems();
+}
+
+- (BOOL)setStemMixing:(BOOL)enabled error:(NSError **)outError {
+    if (_isRunning.load(std::memory_order_acquire)) {
+        if (outError) {
+            *outError = makeEngineError(
+                    18, @"Cannot switch stem mixing while transport is running");
+        }
+        return NO;
+    }
+    _core.setStemMixing(enabled);
+    NSLog(@"[AudioEngineIOS] Stem mixing %@ for %zu tracks",
+          enabled ? @"enabled" : @"disabled",
+          _core.trackStore().size());
+    return YES;
+}
+
+- (BOOL)setInputChannelCount:(int32_t)channelCount error:(NSError **)outError {
+    if (channelCount < 1 || channelCount > 2) {
+        if (outError) *outError = makeEngineError(19, @"Input channel count must be 1 or 2");
+        return NO;
+    }
+    if (_isRunning.load(std::memory_order_acquire)
+        || _core.isCaptureArmed()
+        || _core.isWriterActive()) {
+        if (outError) {
+            *outError = makeEngineError(
+                    19, @"Cannot change input channels while transport is running");
+        }
+        return NO;
+    }
+    _inputChannelCount = channelCount;
+    if (!_initialized.load(std::memory_order_acquire)
+        || _routeInvalidated.load(std::memory_order_acquire)
+        || channelCount == _core.inputChannelCount()) {
+        return YES;
+    }
+
+    // The stream format is fixed once the unit is initialized, so rebuild the
+    // unit on the same route; tracks, rate and compensation carry over.
+    if (_unitRunning.exchange(false, std::memory_order_acq_rel)) {
+        AudioOutputUnitStop(_remoteIOUnit);
+        _core.waitForCallbacks();
+    }
+    [self disposeAudioUnit];
+    if (![self setupAudioUnit:outError]) {
+        [self disposeAudioUnit];
+        _routeInvalidated.store(true, std::memory_order_release);
+        return NO;
+    }
+    [self prepareCoreForRoute];
+    if (_hotIdle.load(std::memory_order_acquire) && ![self setHotIdle:YES error:outError]) {
+        return NO;
+    }
+    NSLog(@"[AudioEngineIOS] Input rebuilt with %d channels", _core.inputChannelCount());
+    return YES;
+}
+
+- (int32_t)inputChannelCount {
+    return _core.inputChannelCount();
+}
+
+- (nullable NSDictionary *)renderMixdownToPath:(NSString *)filePath
+                                    startFrame:(int64_t)startFrame
+                                      endFrame:(int64_t)endFrame
+                                          flac:(BOOL)flac
+                                         error:(NSError **)outError {
+    if (!_initialized.load(std::memory_order_acquire) || _sampleRate <= 0) {
+        if (outError) *outError = makeEngineError(8, @"Audio engine is not initialized");
+        return nil;
+    }
+
+    tapstory::MixdownOptions options;
+    options.format = flac ? tapstory::MixdownFormat::Flac : tapstory::MixdownFormat::Wav;
+    options.sampleRate = static_cast<int32_t>(std::lround(_sampleRate));
+    const tapstory::MixdownResult result = tapstory::renderMixdown(
+        _core.trackStore(),
+        startFrame,
+        endFrame,
+        std::string(filePath.UTF8String),
+        options
+    );
+    if (!result.ok) {
+        if (outError) *outError = makeEngineError(12, @"Offline mixdown could not be rendered");
+        return nil;
+    }
+    NSLog(@"[AudioEngineIOS] Mixdown rendered %lld frames in %.3fs (%.1fx realtime, %d workers)",
+          (long long)result.frameCount,
+          result.renderSeconds,
+          result.realtimeFactor,
+          result.workerCount);
+    return @{
+        @"frameCount": @(result.frameCount),
+        @"renderMs": @(result.renderSeconds * 1000),
+        @"realtimeFactor": @(result.realtimeFactor),
+        @"workerCount": @(result.workerCount)
+    };
+}
+
+- (nullable NSDictionary *)updateChainMixAtPath:(NSString *)filePath
+                                          error:(NSError **)outError {
+    if (!_initialized.load(std::memory_order_acquire) || _sampleRate <= 0) {
+        if (outError) *outError = makeEngineError(8, @"Audio engine is not initialized");
+        return nil;
+    }
+
+    const std::string path(filePath.UTF8String);
+    const int32_t sampleRate = static_cast<int32_t>(std::lround(_sampleRate));
+    if (!_chainMixCache
+        || _chainMixCache->path() != path
+        || _chainMixCache->sampleRate() != sampleRate) {
+        _chainMixCache = std::make_unique<tapstory::MixdownCache>(path, sampleRate);
+    }
+    const tapstory::MixdownCache::UpdateResult result =
+        _chainMixCache->update(_core.trackStore());
+    if (!result.ok) {
+        if (outError) *outError = makeEngineError(13, @"Chain mix could not be updated");
+        return nil;
+    }
+    NSLog(@"[AudioEngineIOS] Chain mix updated: %lld frames, re-rendered %lld of %lld blocks in %.3fs",
+          (long long)result.frameCount,
+          (long long)result.renderedBlocks,
+          (long long)result.blockCount,
+          result.renderSeconds);
+    return @{
+        @"frameCount": @(result.frameCount),
+        @"blockCount": @(result.blockCount),
+        @"renderedBlocks": @(result.renderedBlocks),
+        @"renderMs": @(result.renderSeconds * 1000)
+    };
 }
 
 - (BOOL)start:(NSError **)outError {
@@ -537,13 +698,19 @@ static OSStatus RenderCallback(
     }
     bool expected = false;
     if (!_isRunning.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) return YES;
+    if (_unitRunning.load(std::memory_order_acquire)) {
+        // Hot idle: RemoteIO never stopped, so the next render cycle plays.
+        _lastStartWasHot.store(true, std::memory_order_release);
+        _core.resumeTransport();
+        return YES;
+    }
+    _lastStartWasHot.store(false, std::memory_order_release);
+    _core.resumeTransport();
     _lastRenderSampleTime.store(
         std::numeric_limits<double>::quiet_NaN(),
         std::memory_order_release
     );
     _lastRenderFrameCount.store(0, std::memory_order_release);
-    _firstMutedOutputFrame.store(kUnsetFrame, std::memory_order_release);
-    _outputMuted.store(false, std::memory_order_release);
 
     const OSStatus status = AudioOutputUnitStart(_remoteIOUnit);
     if (status != noErr) {
@@ -554,75 +721,171 @@ static OSStatus RenderCallback(
         }
         return NO;
     }
+    _unitRunning.store(true, std::memory_order_release);
     return YES;
 }
 
 - (void)stop {
     if (!_isRunning.load(std::memory_order_acquire)) return;
 
-    // Stop and the callback share this transition as the punch boundary. If
-    // Stop changes Pending to Cancelled, an in-flight pre-punch callback must
-    // discard its input. If the callback already changed it to Started, retain
-    // the normal compensated capture tail even if actualStart is not published yet.
-    CaptureStartState captureStartState = CaptureStartState::Pending;
-    const bool cancelledPendingStart = _captureStartState.compare_exchange_strong(
-        captureStartState,
-        CaptureStartState::Cancelled,
-        std::memory_order_acq_rel,
-        std::memory_order_acquire
-    );
-    if (cancelledPendingStart) captureStartState = CaptureStartState::Cancelled;
-
-    const int64_t compensationFrames =
-        _latencyCompensationFrames.load(std::memory_order_acquire);
-    const bool shouldDrainCaptureTail =
-        _captureArmed.load(std::memory_order_acquire) &&
-        captureStartState == CaptureStartState::Started &&
-        compensationFrames > 0;
-    if (shouldDrainCaptureTail) {
-        // Input heard at logical frame E arrives C frames later. Keep the
-        // duplex callback alive with silent output until that final input tail
-        // is captured, then clip the last callback exactly at E + C.
-        _firstMutedOutputFrame.store(kUnsetFrame, std::memory_order_release);
-        _outputMuted.store(true, std::memory_order_release);
-        const auto muteDeadline = std::chrono::steady_clock::now()
-            + std::chrono::milliseconds(500);
-        while (_firstMutedOutputFrame.load(std::memory_order_acquire) < 0 &&
-               std::chrono::steady_clock::now() < muteDeadline) {
+    // Input heard at logical frame E arrives C frames later. For a started take
+    // the core keeps the duplex callback alive with silent output until that
+    // final input tail is captured, then clips the take exactly at E + C. A
+    // punch that has not been reached is cancelled instead.
+    if (_core.beginTransportStop()) {
+        const double tailSeconds =
+            static_cast<double>(_core.captureCompensationFrames()) / _sampleRate;
+        const auto deadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(tailSeconds + 0.5)
+            );
+        while (_core.isDrainingTail() && std::chrono::steady_clock::now() < deadline) {
             std::this_thread::sleep_for(std::chrono::microseconds(250));
         }
-        const int64_t transportStopFrame =
-            _firstMutedOutputFrame.load(std::memory_order_acquire);
-        const int64_t tailStopFrame = _captureStopFrame.load(std::memory_order_acquire);
-        if (transportStopFrame >= 0 && tailStopFrame >= transportStopFrame) {
-            const double tailSeconds = static_cast<double>(compensationFrames) / _sampleRate;
-            const auto deadline = std::chrono::steady_clock::now()
-                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
-                    std::chrono::duration<double>(tailSeconds + 0.5)
-                );
-            while (_currentFrame.load(std::memory_order_acquire) < tailStopFrame &&
-                   std::chrono::steady_clock::now() < deadline) {
-                std::this_thread::sleep_for(std::chrono::microseconds(250));
-            }
-            if (_currentFrame.load(std::memory_order_acquire) < tailStopFrame) {
-                _timelineDiscontinuityCount.fetch_add(1, std::memory_order_relaxed);
-            }
-        } else {
+        if (_core.isDrainingTail()) {
             _timelineDiscontinuityCount.fetch_add(1, std::memory_order_relaxed);
         }
     }
 
-    AudioOutputUnitStop(_remoteIOUnit);
+    if (_hotIdle.load(std::memory_order_acquire)
+        && !_routeInvalidated.load(std::memory_order_acquire)) {
+        // RemoteIO keeps rendering silence; once the last unparked callback
+        // has returned, the transport is as still as a stopped unit.
+        _core.parkTransport();
+    } else {
+        AudioOutputUnitStop(_remoteIOUnit);
+        _unitRunning.store(false, std::memory_order_release);
+    }
     _isRunning.store(false, std::memory_order_release);
-    while (_callbackActivityCount.load(std::memory_order_acquire) != 0) {
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    _core.waitForCallbacks();
+    _core.onTransportStopped();
+}
+
+- (BOOL)setHotIdle:(BOOL)enabled error:(NSError **)outError {
+    _hotIdle.store(enabled, std::memory_order_release);
+    if (_isRunning.load(std::memory_order_acquire)) return YES;
+    if (!enabled) {
+        if (_unitRunning.exchange(false, std::memory_order_acq_rel)) {
+            AudioOutputUnitStop(_remoteIOUnit);
+            _core.waitForCallbacks();
+        }
+        return YES;
+    }
+    if (_unitRunning.load(std::memory_order_acquire)) return YES;
+    if (!_initialized.load(std::memory_order_acquire)
+        || _routeInvalidated.load(std::memory_order_acquire)) {
+        if (outError) *outError = makeEngineError(8, @"Audio engine is not initialized");
+        return NO;
+    }
+    // Start parked so the first play skips the unit start too.
+    _core.parkTransport();
+    const OSStatus status = AudioOutputUnitStart(_remoteIOUnit);
+    if (status != noErr) {
+        if (outError) {
+            *outError = [NSError errorWithDomain:NSOSStatusErrorDomain code:status userInfo:nil];
+        }
+        return NO;
     }
-    _outputMuted.store(false, std::memory_order_release);
+    _unitRunning.store(true, std::memory_order_release);
+    return YES;
+}
+
+- (nullable NSDictionary *)calibrateLatency:(NSError **)outError {
+    if (!_initialized.load(std::memory_order_acquire) || _sampleRate <= 0) {
+        if (outError) *outError = makeEngineError(8, @"Audio engine is not initialized");
+        return nil;
+    }
+    if (_isRunning.load(std::memory_order_acquire)
+        || !_core.beginCalibration(static_cast<int32_t>(std::lround(_sampleRate)))) {
+        if (outError) *outError = makeEngineError(14, @"Stop transport before calibrating latency");
+        return nil;
+    }
+
+    NSError *startError = nil;
+    if ([self start:&startError]) {
+        // Twice the session length covers a slow RemoteIO start.
+        const auto deadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(tapstory::LoopbackCalibration::kSessionSeconds * 2)
+            );
+        while (!_core.isCalibrationComplete()
+               && !_routeInvalidated.load(std::memory_order_acquire)
+               && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        [self stop];
+    }
+
+    const tapstory::LoopbackCalibration::Result result = _core.finishCalibration();
+    if (!result.ok) {
+        if (outError) {
+            *outError = startError ?: makeEngineError(15, @"Calibration sweep was not heard at the input");
+        }
+        return nil;
+    }
+    NSLog(@"[AudioEngineIOS] Loopback calibration: %lld frames, confidence %.3f, %lld short input frames",
+          (long long)result.compensationFrames,
+          result.confidence,
+          (long long)result.shortInputFrames);
+    return @{
+        @"compensationFrames": @(result.compensationFrames),
+        @"compensationMs": @(result.fractionalFrames * 1000 / _sampleRate),
+        @"confidence": @(result.confidence),
+        @"shortInputFrames": @(result.shortInputFrames)
+    };
+}
+
+- (nullable NSDictionary *)takeOnsetEnvelopes {
+    const tapstory::DuplexCore::TakeOnsetEnvelopes envelopes = _core.takeOnsetEnvelopes();
+    if (envelopes.blockFrames <= 0) return nil;
+    return @{
+        @"blockFrames": @(envelopes.blockFrames),
+        @"startFrame": @(envelopes.startFrame),
+        @"take": makeNumberArray(envelopes.take),
+        @"mix": makeNumberArray(envelopes.mix)
+    };
+}
+
+- (nullable NSDictionary *)trackPeaksForId:(NSString *)trackId framesPerBin:(int32_t)framesPerBin {
+    const std::shared_ptr<const tapstory::PeakPyramid> peaks =
+            _core.trackStore().peaks(std::string(trackId.UTF8String));
+    if (!peaks) return nil;
+    return makePeakDictionary(
+            peaks->level(tapstory::PeakPyramid::levelIndexFor(framesPerBin)),
+            0);
+}
+
+- (nullable NSDictionary *)capturePeaksWithFramesPerBin:(int32_t)framesPerBin fromBin:(int64_t)fromBin {
+    return makePeakDictionary(
+            _core.capturePeaks(tapstory::PeakPyramid::levelIndexFor(framesPerBin)),
+            fromBin);
 }
 
 - (BOOL)startRecordingToPath:(NSString *)filePath
                   startFrame:(int64_t)startFrame
                        error:(NSError **)outError {
+    return [self startRecordingToPath:filePath
+                           startFrame:startFrame
+                        punchOutFrame:tapstory::DuplexCore::kUnsetFrame
+                                error:outError];
+}
+
+- (BOOL)startRecordingToPath:(NSString *)filePath
+                  startFrame:(int64_t)startFrame
+               punchOutFrame:(int64_t)punchOutFrame
+                       error:(NSError **)outError {
+    return [self startRecordingToPath:filePath
+                           startFrame:startFrame
+                        punchOutFrame:punchOutFrame
+                       lanePathPrefix:nil
+                                error:outError];
+}
+
+- (BOOL)startRecordingToPath:(NSString *)filePath
+                  startFrame:(int64_t)startFrame
+               punchOutFrame:(int64_t)punchOutFrame
+              lanePathPrefix:(nullable NSString *)lanePathPrefix
+                       error:(NSError **)outError {
     if (!_initialized.load(std::memory_order_acquire)) {
         if (outError) *outError = makeEngineError(4, @"Audio engine is not initialized");
         return NO;
@@ -632,8 +895,7 @@ static OSStatus RenderCallback(
         return NO;
     }
 
-    if (_captureArmed.load(std::memory_order_acquire) ||
-        _writerActive.load(std::memory_order_acquire)) {
+    if (_core.isCaptureArmed() || _core.isWriterActive()) {
         [self stopRecording];
     }
 
@@ -652,7 +914,7 @@ static OSStatus RenderCallback(
     const bool usesOverride = overrideMs > 0;
     const double effectiveCompensationMs = usesOverride
         ? overrideMs
-        : (_tracks.empty() ? inputLatencySeconds * 1000 : automaticCompensationMs);
+        : (_core.trackStore().empty() ? inputLatencySeconds * 1000 : automaticCompensationMs);
     const double compensationFrameValue = effectiveCompensationMs * _sampleRate / 1000;
     if (!std::isfinite(compensationFrameValue) ||
         compensationFrameValue > static_cast<double>(std::numeric_limits<int64_t>::max())) {
@@ -660,162 +922,158 @@ static OSStatus RenderCallback(
         return NO;
     }
 
-    if (_recordingFile.is_open()) _recordingFile.close();
-    _recordingFile.clear();
-    _recordingFile.open(filePath.fileSystemRepresentation,
-                        std::ios::binary | std::ios::out | std::ios::trunc);
-    if (!_recordingFile.is_open()) {
-        if (outError) *outError = makeEngineError(6, @"Unable to open raw PCM capture file");
+    const int64_t compensationFrames = static_cast<int64_t>(std::llround(compensationFrameValue));
+    if (startFrame < 0 || compensationFrames > std::numeric_limits<int64_t>::max() - startFrame) {
+        if (outError) *outError = makeEngineError(11, @"Capture punch frame is out of range");
         return NO;
     }
 
-    _captureRing.reset();
-    _requestedRecordStartFrame.store(startFrame, std::memory_order_relaxed);
-    _actualRecordStartFrame.store(kUnsetFrame, std::memory_order_relaxed);
-    _captureTimelineEndFrame.store(kUnsetFrame, std::memory_order_relaxed);
-    _captureStopFrame.store(kUnsetFrame, std::memory_order_relaxed);
-    _overflowFrameCount.store(0, std::memory_order_relaxed);
     _inputRenderErrorCount.store(0, std::memory_order_relaxed);
     _timelineDiscontinuityCount.store(0, std::memory_order_relaxed);
     _captureRouteInvalidated.store(false, std::memory_order_relaxed);
-    _writtenSampleCount.store(0, std::memory_order_relaxed);
-    _writerFailed.store(false, std::memory_order_relaxed);
-    _writerStopRequested.store(false, std::memory_order_relaxed);
-
     _appliedInputLatencySeconds.store(inputLatencySeconds, std::memory_order_relaxed);
     _appliedOutputLatencySeconds.store(outputLatencySeconds, std::memory_order_relaxed);
     _automaticLatencyCompensationMs.store(automaticCompensationMs, std::memory_order_relaxed);
     _effectiveLatencyCompensationMs.store(effectiveCompensationMs, std::memory_order_relaxed);
     _latencyCompensationWasOverridden.store(usesOverride, std::memory_order_relaxed);
-    const int64_t compensationFrames = static_cast<int64_t>(std::llround(compensationFrameValue));
-    if (startFrame < 0 || compensationFrames > std::numeric_limits<int64_t>::max() - startFrame) {
-        _recordingFile.close();
-        if (outError) *outError = makeEngineError(11, @"Capture punch frame is out of range");
-        return NO;
-    }
     _latencyCompensationFrames.store(compensationFrames, std::memory_order_relaxed);
-    _captureGateFrame.store(startFrame + compensationFrames, std::memory_order_relaxed);
 
-    _writerActive.store(true, std::memory_order_release);
-    dispatch_group_async(_writerGroup, _writerQueue, ^{
-        [self drainRecordingRing];
-    });
-    _captureStartState.store(CaptureStartState::Pending, std::memory_order_release);
-    _captureArmed.store(true, std::memory_order_release);
+    const int64_t corePunchOutFrame = punchOutFrame < 0 ? tapstory::DuplexCore::kUnsetFrame : punchOutFrame;
+    const std::string lanePrefix = lanePathPrefix ? lanePathPrefix.fileSystemRepresentation : "";
+    if (!_core.armCapture(filePath.fileSystemRepresentation,
+                          startFrame,
+                          compensationFrames,
+                          corePunchOutFrame,
+                          lanePrefix)) {
+        if (outError) *outError = makeEngineError(6, @"Unable to arm raw PCM capture file");
+        return NO;
+    }
 
-    NSLog(@"[AudioEngineIOS] Capture armed requested=%lld gate=%lld compensation=%lld frames",
+    NSLog(@"[AudioEngineIOS] Capture armed requested=%lld gate=%lld compensation=%lld punchOut=%lld frames",
           startFrame,
           startFrame + compensationFrames,
-          compensationFrames);
+          compensationFrames,
+          corePunchOutFrame);
     return YES;
 }
 
-- (void)drainRecordingRing {
-    std::array<int16_t, kWriterChunkFrames> chunk {};
-    bool didNotifyStart = false;
-
-    while (true) {
-        const size_t count = _captureRing.read(chunk.data(), chunk.size());
-        if (count > 0) {
-            _recordingFile.write(reinterpret_cast<const char *>(chunk.data()),
-                                 static_cast<std::streamsize>(count * sizeof(int16_t)));
-            if (_recordingFile.good()) {
-                _writtenSampleCount.fetch_add(static_cast<int64_t>(count), std::memory_order_relaxed);
-            } else {
-                _writerFailed.store(true, std::memory_order_release);
-                _captureArmed.store(false, std::memory_order_release);
-                _writerStopRequested.store(true, std::memory_order_release);
-            }
-        }
-
-        if (!didNotifyStart) {
-            const int64_t actualStart = _actualRecordStartFrame.load(std::memory_order_acquire);
-            if (actualStart >= 0) {
-                didNotifyStart = true;
-                void (^handler)(int64_t) = self.recordingStartedHandler;
-                if (handler) handler(actualStart);
-            }
-        }
+- (nullable NSArray<NSDictionary *> *)writePunchTakesFromPath:(NSString *)takePath
+                                               takeStartFrame:(int64_t)takeStartFrame
+                                                  rangeFrames:(NSArray<NSNumber *> *)rangeFrames
+                                                   pathPrefix:(NSString *)pathPrefix
+                                                        error:(NSError **)outError {
+    std::vector<tapstory::PunchRange> ranges;
+    for (NSUInteger index = 0; index + 1 < rangeFrames.count; index += 2) {
+        ranges.push_back({rangeFrames[index].longLongValue, rangeFrames[index + 1].longLongValue});
+    }
+    std::vector<tapstory::PunchTake> takes;
+    if (!tapstory::writePunchTakes(
+            takePath.fileSystemRepresentation,
+            takeStartFrame,
+            ranges,
+            pathPrefix.fileSystemRepresentation,
+            takes)) {
+        if (outError) *outError = makeEngineError(17, @"Unable to write punch range takes");
+        return nil;
+    }
 
-        if (_writerStopRequested.load(std::memory_order_acquire) && _captureRing.size() == 0) {
-            break;
-        }
-        if (count == 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
+    NSMutableArray<NSDictionary *> *result = [NSMutableArray arrayWithCapacity:takes.size()];
+    for (const tapstory::PunchTake &take : takes) {
+        [result addObject:@{
+            @"path": [NSString stringWithUTF8String:take.path.c_str()],
+            @"rangeIndex": @(take.rangeIndex),
+            @"startFrame": @(take.startFrame),
+            @"frameCount": @(take.frameCount),
+        }];
     }
+    return result;
+}
 
-    _recordingFile.flush();
-    if (!_recordingFile.good()) _writerFailed.store(true, std::memory_order_release);
-    _recordingFile.close();
-    if (_recordingFile.fail()) _writerFailed.store(true, std::memory_order_release);
+- (void)prepareCaptureBuffers {
+    if (!_initialized.load(std::memory_order_acquire)) return;
+    _core.allocateCaptureBuffers();
+}
+
+- (BOOL)stopRecordingAtFrame:(int64_t)frame {
+    return _core.scheduleCaptureStop(frame) ? YES : NO;
 }
 
 - (void)stopRecording {
-    // Linearize cancellation against the callback's first capture slice. If
-    // this wins while the punch is pending, no raced callback can publish a
-    // valid start after Stop was requested.
-    CaptureStartState pending = CaptureStartState::Pending;
-    _captureStartState.compare_exchange_strong(
-        pending,
-        CaptureStartState::Cancelled,
-        std::memory_order_acq_rel,
-        std::memory_order_acquire
-    );
-    const bool hadCapture = _captureArmed.exchange(false, std::memory_order_acq_rel);
-    const bool hadWriter = _writerActive.load(std::memory_order_acquire);
-    if (!hadCapture && !hadWriter) return;
+    // The core linearizes cancellation against the callback's first capture
+    // slice, so no raced callback can publish a start after this call.
+    _core.finishCapture(_isRunning.load(std::memory_order_acquire));
+}
 
-    // A callback that observed the old armed state must finish publishing before
-    // the consumer is asked to drain and stop. New callbacks observe false.
-    while (_callbackActivityCount.load(std::memory_order_acquire) != 0) {
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
+- (BOOL)seekToFrame:(int64_t)frame {
+    if (_isRunning.load(std::memory_order_acquire)) {
+        return _core.requestSeek(frame) ? YES : NO;
     }
+    _core.seek(frame);
+    return YES;
+}
 
-    _writerStopRequested.store(true, std::memory_order_release);
-    if (hadWriter) {
-        dispatch_group_wait(_writerGroup, DISPATCH_TIME_FOREVER);
-        _writerActive.store(false, std::memory_order_release);
-    }
-    if (_recordingFile.is_open()) {
-        _recordingFile.close();
-        if (_recordingFile.fail()) _writerFailed.store(true, std::memory_order_release);
-    }
+- (BOOL)setLoopRegionFromFrame:(int64_t)startFrame
+                       toFrame:(int64_t)endFrame
+               crossfadeFrames:(int32_t)crossfadeFrames {
+    return _core.setLoopRegion(startFrame, endFrame, crossfadeFrames) ? YES : NO;
 }
 
-- (void)seekToFrame:(int64_t)frame {
-    if (_isRunning.load(std::memory_order_acquire)) {
-        NSLog(@"[AudioEngineIOS] Refusing to seek while transport is running");
-        return;
-    }
-    _currentFrame.store(frame, std::memory_order_release);
+- (void)clearLoopRegion {
+    _core.clearLoopRegion();
+}
+
+- (BOOL)setPlaybackSpeed:(double)speed {
+    if (!std::isfinite(speed) || speed <= 0.0 || speed > 1.0) return NO;
+    const auto scaled = static_cast<int32_t>(
+            std::lround(speed * tapstory::DuplexCore::kPlaybackSpeedScale));
+    return _core.setPlaybackSpeed(scaled) ? YES : NO;
 }
 
 - (int64_t)currentFrame {
-    return _currentFrame.load(std::memory_order_acquire);
+    return _core.playheadFrame();
 }
 
 - (int64_t)recordingStartFrame {
-    const int64_t actualStart = _actualRecordStartFrame.load(std::memory_order_acquire);
-    if (actualStart < 0) return _requestedRecordStartFrame.load(std::memory_order_acquire);
-    const int64_t aligned = actualStart - _latencyCompensationFrames.load(std::memory_order_acquire);
+    const int64_t actualStart = _core.actualCaptureStartFrame();
+    if (actualStart < 0) return _core.requestedPunchFrame();
+    const int64_t aligned = actualStart - _core.captureCompensationFrames();
     return std::max<int64_t>(0, aligned);
 }
 
 - (int64_t)actualRecordingStartFrame {
-    return _actualRecordStartFrame.load(std::memory_order_acquire);
+    return _core.actualCaptureStartFrame();
 }
 
 - (int64_t)recordingTimelineEndFrame {
-    return _captureTimelineEndFrame.load(std::memory_order_acquire);
+    return _core.captureEndFrame();
+}
+
+- (int64_t)recordingTimelineFrameCount {
+    return _core.captureTimelineFrameCount();
+}
+
+- (NSArray<NSDictionary *> *)loopTakeLanes {
+    const std::vector<tapstory::DuplexCore::LoopTakeLane> lanes = _core.loopTakeLanes();
+    NSMutableArray<NSDictionary *> *result = [NSMutableArray arrayWithCapacity:lanes.size()];
+    for (const tapstory::DuplexCore::LoopTakeLane &lane : lanes) {
+        [result addObject:@{
+            @"path": [NSString stringWithUTF8String:lane.path.c_str()],
+            @"passIndex": @(lane.passIndex),
+            @"startFrame": @(lane.startFrame),
+            @"endFrame": @(lane.endFrame),
+            @"rawFrameCount": @(lane.rawFrameCount),
+            @"driftFrames": @(lane.driftFrames),
+        }];
+    }
+    return result;
 }
 
 - (int64_t)recordedSampleCount {
-    return _writtenSampleCount.load(std::memory_order_acquire);
+    return _core.recordedFrameCount();
 }
 
 - (int64_t)recordingOverflowFrameCount {
-    return _overflowFrameCount.load(std::memory_order_acquire);
+    return _core.droppedCaptureFrameCount();
 }
 
 - (int64_t)recordingInputErrorCount {
@@ -831,7 +1089,7 @@ static OSStatus RenderCallback(
 }
 
 - (BOOL)recordingWriteFailed {
-    return _writerFailed.load(std::memory_order_acquire);
+    return _core.writerFailed();
 }
 
 - (double)sampleRate {
@@ -850,13 +1108,12 @@ static OSStatus RenderCallback(
 
     // Preserve the snapshot of an in-flight capture. Otherwise make diagnostics
     // reflect the setting immediately, before the next recording is armed.
-    if (!_captureArmed.load(std::memory_order_acquire) &&
-        !_writerActive.load(std::memory_order_acquire)) {
+    if (!_core.isCaptureArmed() && !_core.isWriterActive()) {
         AVAudioSession *session = [AVAudioSession sharedInstance];
         const double automaticMs = (session.inputLatency + session.outputLatency) * 1000;
         const double effectiveMs = value > 0
             ? value
-            : (_tracks.empty() ? session.inputLatency * 1000 : automaticMs);
+            : (_core.trackStore().empty() ? session.inputLatency * 1000 : automaticMs);
         const double compensationFrameValue = effectiveMs * _sampleRate / 1000;
         _automaticLatencyCompensationMs.store(automaticMs, std::memory_order_relaxed);
         _effectiveLatencyCompensationMs.store(effectiveMs, std::memory_order_relaxed);
@@ -872,15 +1129,7 @@ static OSStatus RenderCallback(
 
 - (void)invalidateAudioRoute {
     _routeInvalidated.store(true, std::memory_order_release);
-    CaptureStartState pending = CaptureStartState::Pending;
-    _captureStartState.compare_exchange_strong(
-        pending,
-        CaptureStartState::Cancelled,
-        std::memory_order_acq_rel,
-        std::memory_order_acquire
-    );
-    if (_captureArmed.exchange(false, std::memory_order_acq_rel) ||
-        _writerActive.load(std::memory_order_acquire)) {
+    if (_core.abortCapture()) {
         _captureRouteInvalidated.store(true, std::memory_order_release);
     }
 }
@@ -889,15 +1138,15 @@ static OSStatus RenderCallback(
     AVAudioSession *session = [AVAudioSession sharedInstance];
     const int64_t actualStart = [self actualRecordingStartFrame];
     const int64_t timelineEnd = [self recordingTimelineEndFrame];
-    const int64_t expectedFrames = actualStart >= 0 && timelineEnd >= actualStart
-        ? timelineEnd - actualStart
-        : 0;
+    const int64_t expectedFrames = [self recordingTimelineFrameCount];
     const double appliedInputLatencySeconds =
         _appliedInputLatencySeconds.load(std::memory_order_acquire);
     const double appliedOutputLatencySeconds =
         _appliedOutputLatencySeconds.load(std::memory_order_acquire);
     const bool wasOverridden =
         _latencyCompensationWasOverridden.load(std::memory_order_acquire);
+    const int64_t startDelayNanos = _core.transportStartDelayNanos();
+    const double startDelayMs = startDelayNanos >= 0 ? startDelayNanos / 1e6 : -1;
     return @{
         @"inputLatencyMs": @(session.inputLatency * 1000),
         @"outputLatencyMs": @(session.outputLatency * 1000),
@@ -912,8 +1161,8 @@ static OSStatus RenderCallback(
         @"effectiveLatencyCompensationMs": @(_effectiveLatencyCompensationMs.load(std::memory_order_acquire)),
         @"latencyCompensationSource": wasOverridden ? @"manualOverride" : @"automaticRoute",
         @"latencyCompensationFrames": @(_latencyCompensationFrames.load(std::memory_order_acquire)),
-        @"requestedStartFrame": @(_requestedRecordStartFrame.load(std::memory_order_acquire)),
-        @"captureGateFrame": @(_captureGateFrame.load(std::memory_order_acquire)),
+        @"requestedStartFrame": @(_core.requestedPunchFrame()),
+        @"captureGateFrame": @(_core.captureGateFrame()),
         @"actualCaptureStartFrame": @(actualStart),
         @"alignedStartFrame": @([self recordingStartFrame]),
         @"captureTimelineEndFrame": @(timelineEnd),
@@ -924,27 +1173,26 @@ static OSStatus RenderCallback(
         @"timelineDiscontinuities": @([self recordingTimelineDiscontinuityCount]),
         @"routeInvalidated": @([self recordingRouteInvalidated]),
         @"writerFailed": @([self recordingWriteFailed]),
-        @"ringCapacityFrames": @(_captureRing.capacity()),
-        @"ringBufferedFrames": @(_captureRing.size()),
-        @"maximumFramesPerSlice": @(_maximumFramesPerSlice)
+        @"ringCapacityFrames": @(_core.captureRingCapacity()),
+        @"ringBufferedFrames": @(_core.captureBufferedFrames()),
+        @"maximumFramesPerSlice": @(_maximumFramesPerSlice),
+        @"transportStartedHot": @(_lastStartWasHot.load(std::memory_order_acquire)),
+        @"transportStartDelayMs": @(startDelayMs),
+        @"firstAudibleFrameMs": @(startDelayMs >= 0 ? startDelayMs + session.outputLatency * 1000 : -1)
     };
 }
 
 - (void)cleanup {
     [self stop];
+    [self setHotIdle:NO error:nil];
     [self stopRecording];
     [self clearTracks];
     self.recordingStartedHandler = nil;
 
-    if (_remoteIOUnit) {
-        AudioUnitUninitialize(_remoteIOUnit);
-        AudioComponentInstanceDispose(_remoteIOUnit);
-        _remoteIOUnit = NULL;
-    }
+    [self disposeAudioUnit];
     _initialized.store(false, std::memory_order_release);
     _routeInvalidated.store(false, std::memory_order_release);
     _inputBuffer.clear();
-    _captureRing.reset();
 }
 
 - (OSStatus)performRenderWithActionFlags:(AudioUnitRenderActionFlags *)ioActionFlags
@@ -952,33 +1200,7 @@ static OSStatus RenderCallback(
                                busNumber:(UInt32)inBusNumber
                              numberFrames:(UInt32)inNumberFrames
                               bufferList:(AudioBufferList *)ioData {
-    CallbackActivityGuard activity(_callbackActivityCount);
-    const int64_t currentFrame = _currentFrame.load(std::memory_order_relaxed);
-    const bool outputMuted = _outputMuted.load(std::memory_order_acquire);
-    if (outputMuted) {
-        int64_t unset = kUnsetFrame;
-        if (_firstMutedOutputFrame.compare_exchange_strong(
-                unset,
-                kPublishingFrame,
-                std::memory_order_acq_rel,
-                std::memory_order_relaxed)) {
-            const int64_t compensationFrames =
-                _latencyCompensationFrames.load(std::memory_order_acquire);
-            if (compensationFrames <=
-                std::numeric_limits<int64_t>::max() - currentFrame) {
-                _captureStopFrame.store(
-                    currentFrame + compensationFrames,
-                    std::memory_order_relaxed
-                );
-            } else {
-                _captureStopFrame.store(kUnsetFrame, std::memory_order_relaxed);
-                _timelineDiscontinuityCount.fetch_add(1, std::memory_order_relaxed);
-            }
-            // This release publishes the stop frame before the control thread
-            // can observe a non-negative mute boundary.
-            _firstMutedOutputFrame.store(currentFrame, std::memory_order_release);
-        }
-    }
+    const bool captureArmed = _core.isCaptureArmed();
 
     if (inTimeStamp && (inTimeStamp->mFlags & kAudioTimeStampSampleTimeValid) != 0) {
         const double sampleTime = inTimeStamp->mSampleTime;
@@ -992,33 +1214,23 @@ static OSStatus RenderCallback(
         );
         if (std::isfinite(previousSampleTime)) {
             const double expectedSampleTime = previousSampleTime + previousFrameCount;
-            if (std::fabs(sampleTime - expectedSampleTime) > 0.5 &&
-                _captureArmed.load(std::memory_order_acquire)) {
+            if (std::fabs(sampleTime - expectedSampleTime) > 0.5 && captureArmed) {
                 _timelineDiscontinuityCount.fetch_add(1, std::memory_order_relaxed);
             }
         }
     }
 
-    if (_captureArmed.load(std::memory_order_acquire)) {
-        const int64_t frameCount = static_cast<int64_t>(inNumberFrames);
-        const bool frameRangeValid =
-            currentFrame <= std::numeric_limits<int64_t>::max() - frameCount;
-        const int64_t bufferEndFrame = frameRangeValid
-            ? currentFrame + frameCount
-            : std::numeric_limits<int64_t>::max();
-        const int64_t stopFrame = _captureStopFrame.load(std::memory_order_acquire);
-        const bool captureAlreadyStopped = stopFrame >= 0 && currentFrame >= stopFrame;
-
-        if (!frameRangeValid) {
-            _timelineDiscontinuityCount.fetch_add(1, std::memory_order_relaxed);
-            _captureArmed.store(false, std::memory_order_release);
-        } else if (captureAlreadyStopped) {
-            _captureArmed.store(false, std::memory_order_release);
-        } else if (inNumberFrames <= _inputBuffer.size()) {
+    // Input is only pulled while a take is armed or the route is being
+    // calibrated. A failed pull is passed to the core as missing input so it
+    // is accounted as a short capture.
+    const float *input = nullptr;
+    if (captureArmed || _core.isCalibrating()) {
+        if (inNumberFrames * _inputFormat.mChannelsPerFrame <= _inputBuffer.size()) {
             AudioBufferList inputBuffers;
             inputBuffers.mNumberBuffers = 1;
-            inputBuffers.mBuffers[0].mNumberChannels = kInputChannelCount;
-            inputBuffers.mBuffers[0].mDataByteSize = inNumberFrames * sizeof(SInt16);
+            inputBuffers.mBuffers[0].mNumberChannels = _inputFormat.mChannelsPerFrame;
+            inputBuffers.mBuffers[0].mDataByteSize =
+                inNumberFrames * _inputFormat.mBytesPerFrame;
             inputBuffers.mBuffers[0].mData = _inputBuffer.data();
 
             const OSStatus inputStatus = AudioUnitRender(_remoteIOUnit,
@@ -1028,97 +1240,20 @@ static OSStatus RenderCallback(
                                                          inNumberFrames,
                                                          &inputBuffers);
             if (inputStatus == noErr) {
-                const int64_t gateFrame = _captureGateFrame.load(std::memory_order_relaxed);
-                const int64_t captureEndFrame = stopFrame >= 0
-                    ? std::min(bufferEndFrame, stopFrame)
-                    : bufferEndFrame;
-                const int64_t firstFrame = std::max(currentFrame, gateFrame);
-                if (firstFrame < captureEndFrame) {
-                    const size_t offset = static_cast<size_t>(firstFrame - currentFrame);
-                    const size_t requestedCount = static_cast<size_t>(captureEndFrame - firstFrame);
-                    CaptureStartState startState =
-                        _captureStartState.load(std::memory_order_acquire);
-                    if (startState == CaptureStartState::Pending) {
-                        // This claim is the punch boundary. A concurrent
-                        // pre-punch stop changes Pending to Cancelled instead.
-                        const bool claimedStart = _captureStartState.compare_exchange_strong(
-                            startState,
-                            CaptureStartState::Started,
-                            std::memory_order_acq_rel,
-                            std::memory_order_acquire
-                        );
-                        if (claimedStart) startState = CaptureStartState::Started;
-                    }
-                    if (startState == CaptureStartState::Started) {
-                        const size_t acceptedCount = _captureRing.write(
-                            _inputBuffer.data() + offset,
-                            requestedCount
-                        );
-                        if (acceptedCount > 0) {
-                            int64_t unsetStart = kUnsetFrame;
-                            _actualRecordStartFrame.compare_exchange_strong(
-                                unsetStart,
-                                firstFrame,
-                                std::memory_order_release,
-                                std::memory_order_relaxed
-                            );
-                        }
-                        if (acceptedCount < requestedCount) {
-                            _overflowFrameCount.fetch_add(
-                                static_cast<int64_t>(requestedCount - acceptedCount),
-                                std::memory_order_relaxed
-                            );
-                        }
-                        _captureTimelineEndFrame.store(
-                            captureEndFrame,
-                            std::memory_order_release
-                        );
-                    }
-                }
+                input = _inputBuffer.data();
             } else {
                 _inputRenderErrorCount.fetch_add(1, std::memory_order_relaxed);
             }
         } else {
             _inputRenderErrorCount.fetch_add(1, std::memory_order_relaxed);
         }
-        // A failed input pull at the exclusive stop boundary invalidates the
-        // take through diagnostics, but must never carry capture into a later
-        // callback whose currentFrame is already beyond stopFrame.
-        if (stopFrame >= 0 && bufferEndFrame >= stopFrame) {
-            _captureArmed.store(false, std::memory_order_release);
-        }
-    }
-
-    if (ioData && ioData->mNumberBuffers > 0 && ioData->mBuffers[0].mData) {
-        auto *output = static_cast<Float32 *>(ioData->mBuffers[0].mData);
-        const size_t outputSampleCount = static_cast<size_t>(inNumberFrames) * kOutputChannelCount;
-        std::fill(output, output + outputSampleCount, 0.0f);
-
-        if (!outputMuted) {
-            for (const Track &track : _tracks) {
-                const int64_t trackOffset = currentFrame - track.startFrame;
-                if (trackOffset >= track.lengthFrames ||
-                    trackOffset + static_cast<int64_t>(inNumberFrames) <= 0) {
-                    continue;
-                }
-                for (UInt32 frame = 0; frame < inNumberFrames; ++frame) {
-                    const int64_t sampleIndex = trackOffset + frame;
-                    if (sampleIndex < 0 || sampleIndex >= track.lengthFrames) continue;
-                    const float sample = track.samples[static_cast<size_t>(sampleIndex)];
-                    output[frame * 2] += sample;
-                    output[frame * 2 + 1] += sample;
-                }
-            }
-
-            for (size_t index = 0; index < outputSampleCount; ++index) {
-                if (output[index] > 1.0f || output[index] < -1.0f) {
-                    output[index] = std::tanh(output[index]);
-                }
-            }
-        }
     }
 
-    _currentFrame.fetch_add(inNumberFrames, std::memory_order_release);
+    Float32 *output = ioData && ioData->mNumberBuffers > 0
+        ? static_cast<Float32 *>(ioData->mBuffers[0].mData)
+        : nullptr;
+    const int32_t frameCount = static_cast<int32_t>(inNumberFrames);
+    _core.process(input, input ? frameCount : 0, output, frameCount);
     return noErr;
 }
 
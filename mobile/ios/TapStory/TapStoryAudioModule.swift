@@ -7,6 +7,10 @@ class TapStoryAudioModule: RCTEventEmitter {
     private var audioEngine: AudioEngineIOS?
     private var hasListeners = false
     private var rawRecordingFile: URL?
+    // Start and end frames of each range of a multi-range pass, else nil.
+    private var punchRangeFrames: [Int64]?
+    // Lane files of a take recorded across loop passes, else nil.
+    private var loopLanePrefix: String?
     private var audioSessionObservers: [NSObjectProtocol] = []
     private let audioControlQueue = DispatchQueue(label: "com.tapstory.audio.module-control")
     private let invalidationScheduleLock = NSLock()
@@ -29,7 +33,7 @@ class TapStoryAudioModule: RCTEventEmitter {
     }
 
     override func supportedEvents() -> [String]! {
-        ["onRecordingStarted", "onPositionUpdate", "onPlaybackComplete"]
+        ["onRecordingStarted", "onPositionUpdate", "onPlaybackComplete", "onAudioRouteRecovered"]
     }
 
     override func startObserving() {
@@ -94,6 +98,9 @@ class TapStoryAudioModule: RCTEventEmitter {
         engine.stop()
         engine.clearTracks()
 
+        let chainURL = chainContainerURL(for: tracks)
+        evictChainContainers(keeping: chainURL)
+        let chainPath = chainURL?.path
         do {
             for track in tracks {
                 guard let id = track["id"] as? String,
@@ -102,17 +109,28 @@ class TapStoryAudioModule: RCTEventEmitter {
                     throw ModuleError.invalidTrack
                 }
 
-                let pcm = try decodeAudioFile(uri: uri, targetSampleRate: targetSampleRate)
                 let startFrame = Int32((startTimeMs * targetSampleRate / 1000).rounded())
+                if let chainPath = chainPath,
+                   engine.loadChainSegment(atPath: chainPath, trackId: id, startFrame: startFrame) {
+                    continue
+                }
+                // The PCM keeps the file's rate; the mixer converts it as it plays.
+                let (pcm, channelCount, fileSampleRate) = try decodeAudioFile(uri: uri)
                 pcm.withUnsafeBufferPointer { buffer in
                     guard let baseAddress = buffer.baseAddress else { return }
                     engine.loadTrack(
                         withId: id,
                         data: baseAddress,
-                        numSamples: Int32(pcm.count),
+                        numFrames: Int32(pcm.count / channelCount),
+                        channelCount: Int32(channelCount),
+                        sampleRate: Int32(fileSampleRate),
                         startFrame: startFrame
                     )
                 }
+                // The next load of this chain maps the segment instead of decoding it.
+                if let chainPath = chainPath {
+                    _ = engine.appendChainSegment(atPath: chainPath, trackId: id)
+                }
             }
             resolve(nil)
         } catch {
@@ -121,6 +139,126 @@ class TapStoryAudioModule: RCTEventEmitter {
         }
     }
 
+    /// Chain container for the chain that starts with the earliest of `tracks`.
+    /// A chain keeps its first segment as turns are added, so every load of it
+    /// maps the same file and new turns extend it.
+    private func chainContainerURL(for tracks: [[String: Any]]) -> URL? {
+        let root = tracks.min {
+            ($0["startTimeMs"] as? Double ?? 0) < ($1["startTimeMs"] as? Double ?? 0)
+        }
+        guard let id = root?["id"] as? String,
+              let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first
+        else { return nil }
+        let name = String(id.unicodeScalars.map {
+            CharacterSet.alphanumerics.contains($0) || $0 == "-" || $0 == "_" ? Character($0) : "_"
+        })
+        return caches.appendingPathComponent("chain_\(name).tschain")
+    }
+
+    /// Delete the containers of every chain but the one being loaded. Blocks
+    /// are float PCM, twice the size of their sources, so keeping each chain
+    /// ever opened would grow the cache without bound. Leftovers of an
+    /// interrupted rewrite go too.
+    private func evictChainContainers(keeping kept: URL?) {
+        guard let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first,
+              let files = try? FileManager.default.contentsOfDirectory(
+                  at: caches, includingPropertiesForKeys: nil)
+        else { return }
+        for file in files where file.lastPathComponent.hasPrefix("chain_")
+            && file.lastPathComponent.contains(".tschain")
+            && file.standardizedFileURL != kept?.standardizedFileURL {
+            do {
+                try FileManager.default.removeItem(at: file)
+            } catch {
+                NSLog("[TapStoryAudio] Could not evict chain container %@", file.lastPathComponent)
+            }
+        }
+    }
+
+    @objc
+    func renderMixdown(
+        _ startMs: Double,
+        endMs: Double,
+        format: String,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        guard format == "wav" || format == "flac" else {
+            reject("MIXDOWN_ERROR", "Unsupported mixdown format \(format)", nil)
+            return
+        }
+
+        let sampleRate = engine.sampleRate()
+        let startFrame = Int64((startMs * sampleRate / 1000).rounded())
+        let endFrame = Int64((endMs * sampleRate / 1000).rounded())
+        guard startFrame >= 0, endFrame > startFrame else {
+            reject("MIXDOWN_ERROR", "Mixdown range is empty", nil)
+            return
+        }
+
+        let mixdownFile = FileManager.default.temporaryDirectory
+            .appendingPathComponent("tapstory-mixdown-\(UUID().uuidString).\(format)")
+        do {
+            let stats = try engine.renderMixdown(
+                toPath: mixdownFile.path,
+                startFrame: startFrame,
+                endFrame: endFrame,
+                flac: format == "flac"
+            )
+            let frameCount = (stats["frameCount"] as? NSNumber)?.int64Value ?? 0
+            let response: [String: Any] = [
+                "uri": mixdownFile.absoluteString,
+                "format": format,
+                "startFrame": startFrame,
+                "frameCount": frameCount,
+                "durationMs": Double(frameCount) * 1000 / sampleRate,
+                "renderMs": stats["renderMs"] ?? 0,
+                "realtimeFactor": stats["realtimeFactor"] ?? 0,
+                "workerCount": stats["workerCount"] ?? 0,
+                "sampleRate": sampleRate,
+            ]
+            resolve(response)
+        } catch {
+            try? FileManager.default.removeItem(at: mixdownFile)
+            reject("MIXDOWN_ERROR", "Failed to render mixdown: \(error.localizedDescription)", error)
+        }
+    }
+
+    @objc
+    func exportChainMix(
+        _ resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+
+        let sampleRate = engine.sampleRate()
+        let chainMixFile = FileManager.default.temporaryDirectory
+            .appendingPathComponent("tapstory-chain-mix.wav")
+        do {
+            let stats = try engine.updateChainMix(atPath: chainMixFile.path)
+            let frameCount = (stats["frameCount"] as? NSNumber)?.int64Value ?? 0
+            let response: [String: Any] = [
+                "uri": chainMixFile.absoluteString,
+                "frameCount": frameCount,
+                "durationMs": Double(frameCount) * 1000 / sampleRate,
+                "blockCount": stats["blockCount"] ?? 0,
+                "renderedBlocks": stats["renderedBlocks"] ?? 0,
+                "renderMs": stats["renderMs"] ?? 0,
+                "sampleRate": sampleRate,
+            ]
+            resolve(response)
+        } catch {
+            reject("MIXDOWN_ERROR", "Failed to export chain mix: \(error.localizedDescription)", error)
+        }
+    }
+
     @objc
     func play(
         _ playFromMs: Double,
@@ -153,6 +291,80 @@ class TapStoryAudioModule: RCTEventEmitter {
         recordStartMs: Double,
         resolver resolve: @escaping RCTPromiseResolveBlock,
         rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        startTake(
+            playFromMs: playFromMs,
+            recordStartMs: recordStartMs,
+            rangesMs: nil,
+            recordLoopLanes: false,
+            resolve: resolve,
+            reject: reject
+        )
+    }
+
+    /// Start a looped take that records across passes instead of ending at
+    /// the loop end. stopRecording returns each pass in `loopTakes`.
+    @objc
+    func playAndRecordLoopTakes(
+        _ playFromMs: Double,
+        recordStartMs: Double,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        startTake(
+            playFromMs: playFromMs,
+            recordStartMs: recordStartMs,
+            rangesMs: nil,
+            recordLoopLanes: true,
+            resolve: resolve,
+            reject: reject
+        )
+    }
+
+    /// Record several { startMs, endMs } ranges in one pass. Capture ends by
+    /// itself at the last range end; stopRecording returns one take per range
+    /// in `punchTakes` next to the pass's whole aligned take.
+    @objc
+    func playAndRecordRanges(
+        _ playFromMs: Double,
+        ranges: [[String: Double]],
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        var rangesMs: [(Double, Double)] = []
+        for range in ranges {
+            guard let startMs = range["startMs"], let endMs = range["endMs"],
+                  startMs >= (rangesMs.last?.1 ?? 0), endMs > startMs else {
+                reject(
+                    "INVALID_PUNCH_RANGES",
+                    "Punch ranges must be non-empty, ascending and non-overlapping",
+                    nil
+                )
+                return
+            }
+            rangesMs.append((startMs, endMs))
+        }
+        guard let first = rangesMs.first else {
+            reject("INVALID_PUNCH_RANGES", "At least one punch range is required", nil)
+            return
+        }
+        startTake(
+            playFromMs: playFromMs,
+            recordStartMs: first.0,
+            rangesMs: rangesMs,
+            recordLoopLanes: false,
+            resolve: resolve,
+            reject: reject
+        )
+    }
+
+    private func startTake(
+        playFromMs: Double,
+        recordStartMs: Double,
+        rangesMs: [(Double, Double)]?,
+        recordLoopLanes: Bool,
+        resolve: @escaping RCTPromiseResolveBlock,
+        reject: @escaping RCTPromiseRejectBlock
     ) {
         guard let engine = audioEngine else {
             reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
@@ -177,9 +389,17 @@ class TapStoryAudioModule: RCTEventEmitter {
         let sampleRate = engine.sampleRate()
         let playFrame = Int64((playFromMs * sampleRate / 1000).rounded())
         let requestedRecordFrame = Int64((recordStartMs * sampleRate / 1000).rounded())
-        let captureFile = FileManager.default.temporaryDirectory
-            .appendingPathComponent("tapstory-recording-\(UUID().uuidString).pcm")
+        let rangeFrames = rangesMs?.flatMap { range in
+            [range.0, range.1].map { Int64(($0 * sampleRate / 1000).rounded()) }
+        }
+        punchRangeFrames = rangeFrames
+        let takeName = "tapstory-recording-\(UUID().uuidString)"
+        let directory = FileManager.default.temporaryDirectory
+        let captureFile = directory.appendingPathComponent("\(takeName).pcm")
         rawRecordingFile = captureFile
+        loopLanePrefix = recordLoopLanes
+            ? directory.appendingPathComponent("\(takeName)-pass-").path
+            : nil
 
         engine.recordingStartedHandler = { [weak self, weak engine] actualFrame in
             guard let self, let engine else { return }
@@ -205,7 +425,9 @@ class TapStoryAudioModule: RCTEventEmitter {
         do {
             try engine.startRecording(
                 toPath: captureFile.path,
-                startFrame: requestedRecordFrame
+                startFrame: requestedRecordFrame,
+                punchOutFrame: rangeFrames?.last ?? -1,
+                lanePathPrefix: loopLanePrefix
             )
         } catch {
             engine.recordingStartedHandler = nil
@@ -233,6 +455,167 @@ class TapStoryAudioModule: RCTEventEmitter {
         }
     }
 
+    @objc
+    func setHotIdle(
+        _ enabled: Bool,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        do {
+            try engine.setHotIdle(enabled)
+            resolve(nil)
+        } catch {
+            reject("HOT_IDLE_ERROR", "Failed to set hot idle: \(error.localizedDescription)", error)
+        }
+    }
+
+    @objc
+    func setStemMixing(
+        _ enabled: Bool,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        do {
+            try engine.setStemMixing(enabled)
+            resolve(nil)
+        } catch {
+            reject(
+                "STEM_MIXING_ERROR",
+                "Failed to set stem mixing: \(error.localizedDescription)",
+                error
+            )
+        }
+    }
+
+    /// Captures takes with one or two channels; resolves with the channel
+    /// count the input now delivers.
+    @objc
+    func setInputChannelCount(
+        _ channelCount: Int,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        do {
+            try engine.setInputChannelCount(Int32(channelCount))
+            resolve(Int(engine.inputChannelCount()))
+        } catch {
+            reject(
+                "INPUT_CHANNELS_ERROR",
+                "Failed to set input channels: \(error.localizedDescription)",
+                error
+            )
+        }
+    }
+
+    /// Allocates the capture buffers ahead of the first take, off the
+    /// thread that later arms it.
+    @objc
+    func prepareRecording(
+        _ resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        engine.prepareCaptureBuffers()
+        resolve(nil)
+    }
+
+    @objc
+    func seekTo(
+        _ positionMs: Double,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine, engine.sampleRate() > 0 else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        let frame = Int64((positionMs * engine.sampleRate() / 1000).rounded())
+        guard engine.seek(toFrame: frame) else {
+            reject("SEEK_ERROR", "Cannot seek while a take is armed", nil)
+            return
+        }
+        resolve(nil)
+    }
+
+    @objc
+    func setLoopRegion(
+        _ startMs: Double,
+        endMs: Double,
+        crossfadeMs: Double,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine, engine.sampleRate() > 0 else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        let toFrame = { (ms: Double) in Int64((ms * engine.sampleRate() / 1000).rounded()) }
+        if endMs <= startMs {
+            engine.clearLoopRegion()
+            resolve(nil)
+            return
+        }
+        let crossfadeFrames = Int32(clamping: toFrame(max(0, crossfadeMs)))
+        guard engine.setLoopRegion(
+            fromFrame: toFrame(startMs),
+            toFrame: toFrame(endMs),
+            crossfadeFrames: crossfadeFrames
+        ) else {
+            reject(
+                "LOOP_ERROR",
+                "Loop region must be longer than its crossfade and the armed take's latency",
+                nil
+            )
+            return
+        }
+        resolve(nil)
+    }
+
+    @objc
+    func clearLoopRegion(
+        _ resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        audioEngine?.clearLoopRegion()
+        resolve(nil)
+    }
+
+    @objc
+    func setPlaybackSpeed(
+        _ speed: Double,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine, engine.sampleRate() > 0 else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        guard engine.setPlaybackSpeed(speed) else {
+            reject(
+                "PLAYBACK_SPEED_ERROR",
+                "Playback speed must be between 0.5 and 1.0, and 1.0 while recording",
+                nil
+            )
+            return
+        }
+        resolve(nil)
+    }
+
     @objc
     func getCurrentPositionMs(
         _ resolve: @escaping RCTPromiseResolveBlock,
@@ -256,6 +639,25 @@ class TapStoryAudioModule: RCTEventEmitter {
         resolve(nil)
     }
 
+    /// Schedules the end of the take at a timeline frame; resolves once the
+    /// render callback will apply it, not when the take has ended.
+    @objc
+    func stopRecordingAtFrame(
+        _ frame: Double,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+        guard engine.stopRecording(atFrame: Int64(frame.rounded())) else {
+            reject("STOP_RECORD_ERROR", "No take is armed, or the stop frame is not after its punch", nil)
+            return
+        }
+        resolve(nil)
+    }
+
     @objc
     func stopRecording(
         _ resolve: @escaping RCTPromiseResolveBlock,
@@ -281,9 +683,7 @@ class TapStoryAudioModule: RCTEventEmitter {
         let inputErrors = engine.recordingInputErrorCount()
         let timelineDiscontinuities = engine.recordingTimelineDiscontinuityCount()
         let routeInvalidated = engine.recordingRouteInvalidated()
-        let expectedFrames = actualStartFrame >= 0 && captureEndFrame >= actualStartFrame
-            ? captureEndFrame - actualStartFrame
-            : 0
+        let expectedFrames = engine.recordingTimelineFrameCount()
 
         guard !routeInvalidated else {
             discardRawRecording()
@@ -343,12 +743,33 @@ class TapStoryAudioModule: RCTEventEmitter {
 
         var partialWavFile: URL?
         do {
-            let expectedBytes = sampleCount * Int64(MemoryLayout<Int16>.size)
+            let channelCount = Int64(engine.inputChannelCount())
+            let expectedBytes = sampleCount * channelCount * Int64(MemoryLayout<Int16>.size)
             let attributes = try FileManager.default.attributesOfItem(atPath: rawFile.path)
             let rawBytes = (attributes[.size] as? NSNumber)?.int64Value ?? -1
             guard rawBytes == expectedBytes else {
                 throw ModuleError.rawFileSize(expected: expectedBytes, actual: rawBytes)
             }
+            if loopLanePrefix != nil {
+                let loopTakes = loopLaneTakes(engine: engine)
+                guard let first = loopTakes.first else { throw ModuleError.noLoopTakes }
+                loopLanePrefix = nil
+                discardRawRecording()
+                // The first lane stands in for the take, so a caller that
+                // ignores loopTakes gets the single pass a looped take records.
+                resolve([
+                    "uri": first["uri"] ?? "",
+                    "startTimeMs": first["startTimeMs"] ?? 0,
+                    "durationMs": first["durationMs"] ?? 0,
+                    "actualCaptureStartMs": Double(actualStartFrame) * 1000 / engine.sampleRate(),
+                    "captureTimelineEndMs": Double(captureEndFrame) * 1000 / engine.sampleRate(),
+                    "sampleRate": engine.sampleRate(),
+                    "overflowFrames": overflowFrames,
+                    "loopTakes": loopTakes,
+                    "diagnostics": engine.getLatencyInfo(),
+                ])
+                return
+            }
 
             let wavFile = FileManager.default.temporaryDirectory
                 .appendingPathComponent("tapstory-recording-\(UUID().uuidString).wav")
@@ -357,6 +778,7 @@ class TapStoryAudioModule: RCTEventEmitter {
                 rawFile: rawFile,
                 wavFile: wavFile,
                 sampleCount: sampleCount,
+                channelCount: Int(channelCount),
                 sampleRate: engine.sampleRate()
             )
             discardRawRecording()
@@ -365,6 +787,11 @@ class TapStoryAudioModule: RCTEventEmitter {
             let sampleRate = engine.sampleRate()
             let startTimeMs = Double(alignedStartFrame) * 1000 / sampleRate
             let durationMs = Double(sampleCount) * 1000 / sampleRate
+            let punchTakes = try writePunchTakes(
+                engine: engine,
+                wavFile: wavFile,
+                takeStartFrame: alignedStartFrame
+            )
             resolve([
                 "uri": "file://\(wavFile.path)",
                 "startTimeMs": startTimeMs,
@@ -373,6 +800,7 @@ class TapStoryAudioModule: RCTEventEmitter {
                 "captureTimelineEndMs": Double(captureEndFrame) * 1000 / sampleRate,
                 "sampleRate": sampleRate,
                 "overflowFrames": overflowFrames,
+                "punchTakes": punchTakes,
                 "diagnostics": engine.getLatencyInfo(),
             ])
         } catch {
@@ -384,6 +812,54 @@ class TapStoryAudioModule: RCTEventEmitter {
         }
     }
 
+    private func loopLaneTakes(engine: AudioEngineIOS) -> [[String: Any]] {
+        let sampleRate = engine.sampleRate()
+        return engine.loopTakeLanes().map { lane in
+            let startFrame = (lane["startFrame"] as? NSNumber)?.doubleValue ?? 0
+            let endFrame = (lane["endFrame"] as? NSNumber)?.doubleValue ?? 0
+            return [
+                "uri": "file://\(lane["path"] as? String ?? "")",
+                "passIndex": lane["passIndex"] ?? 0,
+                "startTimeMs": startFrame * 1000 / sampleRate,
+                "durationMs": (endFrame - startFrame) * 1000 / sampleRate,
+                "startFrame": startFrame,
+                "frameCount": endFrame - startFrame,
+                "driftFrames": lane["driftFrames"] ?? 0,
+            ]
+        }
+    }
+
+    /// Cut each requested range from the aligned take, whose first frame is
+    /// the requested punch frame.
+    private func writePunchTakes(
+        engine: AudioEngineIOS,
+        wavFile: URL,
+        takeStartFrame: Int64
+    ) throws -> [[String: Any]] {
+        guard let rangeFrames = punchRangeFrames else { return [] }
+        punchRangeFrames = nil
+        let prefix = wavFile.deletingPathExtension().path + "-range-"
+        let takes = try engine.writePunchTakes(
+            fromPath: wavFile.path,
+            takeStartFrame: takeStartFrame,
+            rangeFrames: rangeFrames.map { NSNumber(value: $0) },
+            pathPrefix: prefix
+        )
+        let sampleRate = engine.sampleRate()
+        return takes.map { take in
+            let startFrame = (take["startFrame"] as? NSNumber)?.doubleValue ?? 0
+            let frameCount = (take["frameCount"] as? NSNumber)?.doubleValue ?? 0
+            return [
+                "uri": "file://\(take["path"] as? String ?? "")",
+                "rangeIndex": take["rangeIndex"] ?? 0,
+                "startTimeMs": startFrame * 1000 / sampleRate,
+                "durationMs": frameCount * 1000 / sampleRate,
+                "startFrame": startFrame,
+                "frameCount": frameCount,
+            ]
+        }
+    }
+
     @objc
     func getLatencyInfo(
         _ resolve: @escaping RCTPromiseResolveBlock,
@@ -404,6 +880,73 @@ class TapStoryAudioModule: RCTEventEmitter {
         ])
     }
 
+    @objc
+    func calibrateLatency(
+        _ resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine else {
+            reject("NOT_INITIALIZED", "Audio engine not initialized", nil)
+            return
+        }
+
+        do {
+            var response = try engine.calibrateLatency()
+            response["sampleRate"] = engine.sampleRate()
+            resolve(response)
+        } catch {
+            reject("CALIBRATION_ERROR", "Failed to calibrate latency: \(error.localizedDescription)", error)
+        }
+    }
+
+    @objc
+    func getTakeOnsetEnvelopes(
+        _ resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine, var response = engine.takeOnsetEnvelopes() else {
+            resolve(nil)
+            return
+        }
+        response["sampleRate"] = engine.sampleRate()
+        resolve(response)
+    }
+
+    @objc
+    func getTrackPeaks(
+        _ trackId: String,
+        framesPerBin: NSNumber,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine,
+              var response = engine.trackPeaks(forId: trackId, framesPerBin: framesPerBin.int32Value) else {
+            resolve(nil)
+            return
+        }
+        response["sampleRate"] = engine.sampleRate()
+        resolve(response)
+    }
+
+    @objc
+    func getCapturePeaks(
+        _ framesPerBin: NSNumber,
+        fromBin: NSNumber,
+        resolver resolve: @escaping RCTPromiseResolveBlock,
+        rejecter reject: @escaping RCTPromiseRejectBlock
+    ) {
+        guard let engine = audioEngine,
+              var response = engine.capturePeaks(
+                withFramesPerBin: framesPerBin.int32Value,
+                fromBin: fromBin.int64Value
+              ) else {
+            resolve(nil)
+            return
+        }
+        response["sampleRate"] = engine.sampleRate()
+        resolve(response)
+    }
+
     @objc
     func setLatencyCompensationMs(
         _ milliseconds: Double,
@@ -449,6 +992,15 @@ class TapStoryAudioModule: RCTEventEmitter {
             try? FileManager.default.removeItem(at: rawRecordingFile)
         }
         rawRecordingFile = nil
+        if let loopLanePrefix {
+            let prefix = URL(fileURLWithPath: loopLanePrefix)
+            let directory = prefix.deletingLastPathComponent()
+            let lanes = (try? FileManager.default.contentsOfDirectory(atPath: directory.path)) ?? []
+            for name in lanes where name.hasPrefix(prefix.lastPathComponent) {
+                try? FileManager.default.removeItem(at: directory.appendingPathComponent(name))
+            }
+        }
+        loopLanePrefix = nil
     }
 
     private func startAudioSessionObservers() {
@@ -463,8 +1015,12 @@ class TapStoryAudioModule: RCTEventEmitter {
             AVAudioSession.mediaServicesWereResetNotification,
         ]
         audioSessionObservers = names.map { name in
-            center.addObserver(forName: name, object: session, queue: nil) { [weak self] _ in
-                self?.scheduleAudioSessionInvalidation(for: observedGeneration)
+            // An interruption or lost media services leave no route to reopen
+            // until the app initializes again.
+            let recover = name == AVAudioSession.routeChangeNotification
+                || name == AVAudioSession.mediaServicesWereResetNotification
+            return center.addObserver(forName: name, object: session, queue: nil) { [weak self] _ in
+                self?.scheduleAudioSessionInvalidation(for: observedGeneration, recover: recover)
             }
         }
     }
@@ -476,7 +1032,7 @@ class TapStoryAudioModule: RCTEventEmitter {
         audioSessionObservers.removeAll()
     }
 
-    private func scheduleAudioSessionInvalidation(for generation: UInt64) {
+    private func scheduleAudioSessionInvalidation(for generation: UInt64, recover: Bool) {
         invalidationScheduleLock.lock()
         guard scheduledInvalidationGeneration != generation else {
             invalidationScheduleLock.unlock()
@@ -489,6 +1045,9 @@ class TapStoryAudioModule: RCTEventEmitter {
             guard let self else { return }
             if self.engineGeneration == generation {
                 self.invalidateAudioSessionOnControlQueue()
+                if recover {
+                    self.recoverAudioRouteOnControlQueue()
+                }
             }
             self.invalidationScheduleLock.lock()
             if self.scheduledInvalidationGeneration == generation {
@@ -505,7 +1064,32 @@ class TapStoryAudioModule: RCTEventEmitter {
         engine.stopRecording()
     }
 
-    private func decodeAudioFile(uri: String, targetSampleRate: Double) throws -> [Int16] {
+    /// Reopens the session and RemoteIO on the new route with the loaded
+    /// tracks kept; the mixer converts their PCM to the new rate. The take,
+    /// if any, was already discarded by invalidation, so recovery never waits
+    /// for stopRecording.
+    private func recoverAudioRouteOnControlQueue() {
+        guard let engine = audioEngine else { return }
+        let body: [String: Any]
+        do {
+            var info = try engine.recoverAudioRoute()
+            info["recovered"] = true
+            body = info.reduce(into: [String: Any]()) { result, entry in
+                if let key = entry.key as? String { result[key] = entry.value }
+            }
+        } catch {
+            NSLog("[TapStoryAudio] Route recovery failed: %@", error.localizedDescription)
+            body = ["recovered": false, "error": error.localizedDescription]
+        }
+        DispatchQueue.main.async {
+            guard self.hasListeners else { return }
+            self.sendEvent(withName: "onAudioRouteRecovered", body: body)
+        }
+    }
+
+    /// Interleaved PCM16 at the file's own rate, with the channels it keeps and
+    /// that rate: mono and stereo pass through, wider layouts are downmixed to stereo.
+    private func decodeAudioFile(uri: String) throws -> ([Int16], Int, Int) {
         let url = try localAudioFileURL(from: uri)
 
         let audioFile = try AVAudioFile(forReading: url)
@@ -521,18 +1105,14 @@ class TapStoryAudioModule: RCTEventEmitter {
 
         guard let outputFormat = AVAudioFormat(
             commonFormat: .pcmFormatFloat32,
-            sampleRate: targetSampleRate,
-            channels: 1,
+            sampleRate: inputFormat.sampleRate,
+            channels: min(inputFormat.channelCount, 2),
             interleaved: false
         ), let converter = AVAudioConverter(from: inputFormat, to: outputFormat) else {
             throw ModuleError.converterCreation
         }
 
-        converter.sampleRateConverterQuality = AVAudioQuality.max.rawValue
-        let rateRatio = targetSampleRate / inputFormat.sampleRate
-        let outputCapacity = AVAudioFrameCount(
-            ceil(Double(inputBuffer.frameLength) * rateRatio) + 32
-        )
+        let outputCapacity = inputBuffer.frameLength + 32
         guard let outputBuffer = AVAudioPCMBuffer(
             pcmFormat: outputFormat,
             frameCapacity: outputCapacity
@@ -556,14 +1136,22 @@ class TapStoryAudioModule: RCTEventEmitter {
             throw conversionError ?? ModuleError.conversion
         }
 
-        guard let channel = outputBuffer.floatChannelData?[0] else {
+        guard let channels = outputBuffer.floatChannelData else {
             throw ModuleError.conversion
         }
-        return (0..<Int(outputBuffer.frameLength)).map { frame in
-            let sample = channel[frame].isFinite ? channel[frame] : 0
-            let scaled = Int((sample * 32767).rounded())
-            return Int16(max(Int(Int16.min), min(Int(Int16.max), scaled)))
+        let channelCount = Int(outputFormat.channelCount)
+        let frameCount = Int(outputBuffer.frameLength)
+        var pcm = [Int16](repeating: 0, count: frameCount * channelCount)
+        for channel in 0..<channelCount {
+            let samples = channels[channel]
+            for frame in 0..<frameCount {
+                let sample = samples[frame].isFinite ? samples[frame] : 0
+                let scaled = Int((sample * 32767).rounded())
+                pcm[frame * channelCount + channel] =
+                    Int16(max(Int(Int16.min), min(Int(Int16.max), scaled)))
+            }
         }
+        return (pcm, channelCount, Int(inputFormat.sampleRate.rounded()))
     }
 
     private func localAudioFileURL(from uri: String) throws -> URL {
@@ -617,10 +1205,12 @@ class TapStoryAudioModule: RCTEventEmitter {
         rawFile: URL,
         wavFile: URL,
         sampleCount: Int64,
+        channelCount: Int,
         sampleRate: Double
     ) throws {
         let bytesPerSample: UInt32 = UInt32(MemoryLayout<Int16>.size)
-        let dataSize64 = sampleCount * Int64(bytesPerSample)
+        let bytesPerFrame = bytesPerSample * UInt32(channelCount)
+        let dataSize64 = sampleCount * Int64(bytesPerFrame)
         guard dataSize64 >= 0, dataSize64 <= Int64(UInt32.max - 36) else {
             throw ModuleError.recordingTooLarge
         }
@@ -634,10 +1224,10 @@ class TapStoryAudioModule: RCTEventEmitter {
         header.append("fmt ".data(using: .ascii)!)
         header.appendLittleEndian(UInt32(16))
         header.appendLittleEndian(UInt16(1))
-        header.appendLittleEndian(UInt16(1))
+        header.appendLittleEndian(UInt16(channelCount))
         header.appendLittleEndian(integerSampleRate)
-        header.appendLittleEndian(integerSampleRate * bytesPerSample)
-        header.appendLittleEndian(UInt16(bytesPerSample))
+        header.appendLittleEndian(integerSampleRate * bytesPerFrame)
+        header.appendLittleEndian(UInt16(bytesPerFrame))
         header.appendLittleEndian(UInt16(bytesPerSample * 8))
         header.append("data".data(using: .ascii)!)
         header.appendLittleEndian(dataSize)
@@ -669,6 +1259,7 @@ private enum ModuleError: LocalizedError {
     case conversion
     case rawFileSize(expected: Int64, actual: Int64)
     case recordingTooLarge
+    case noLoopTakes
 
     var errorDescription: String? {
         switch self {
@@ -692,6 +1283,8 @@ private enum ModuleError: LocalizedError {
             return "Raw capture contains \(actual) bytes; expected \(expected)"
         case .recordingTooLarge:
             return "Recording is too large for a PCM WAV file"
+        case .noLoopTakes:
+            return "The looped take produced no pass lanes"
         }
     }
 }
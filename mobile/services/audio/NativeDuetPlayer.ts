@@ -9,7 +9,13 @@
  * - Frame-accurate timestamps
  * - Native multi-track mixing
  */
-import { TapStoryNativeAudio, getTapStoryAudio, TrackInfo, RecordingResult } from './TapStoryNativeAudio';
+import {
+  AudioRouteRecoveredEvent,
+  TapStoryNativeAudio,
+  getTapStoryAudio,
+  TrackInfo,
+  RecordingResult,
+} from './TapStoryNativeAudio';
 import { findCachedAudioPath, downloadAndCacheAudio } from '../audioStorage';
 
 export interface DuetSegment {
@@ -146,6 +152,11 @@ export class NativeDuetPlayer {
     }
     
     await this.nativeAudio.initialize();
+    // Streams stay running silent between takes so each start is one burst.
+    await this.nativeAudio.setHotIdle(true);
+    // A rebuild initializes again without cleanup; keep one subscription.
+    this.nativeAudio.removeAudioRouteRecoveredListener(this.handleAudioRouteRecovered);
+    this.nativeAudio.addAudioRouteRecoveredListener(this.handleAudioRouteRecovered);
     this.initialized = true;
     this.log('Initialized');
   }
@@ -308,6 +319,24 @@ export class NativeDuetPlayer {
     this.assertSessionActive(session);
   }
 
+  /**
+   * The engine reopened its streams on a new route and kept the tracks, but
+   * compensation measured on the old route was dropped; measure it again.
+   * A failed recovery leaves the engine invalidated for the start retry.
+   */
+  private handleAudioRouteRecovered = (event: AudioRouteRecoveredEvent): void => {
+    if (!event.recovered) {
+      this.log(`Route recovery failed; the next start rebuilds the engine: ${event.error}`);
+      return;
+    }
+    this.log(
+      `Route recovered at ${event.sampleRate}Hz in ${event.recoveryMs?.toFixed(1)}ms`
+    );
+    this.reapplyCaptureCompensation().catch(error => {
+      this.log('Failed to re-measure latency after route recovery:', error);
+    });
+  };
+
   private async reapplyCaptureCompensation(): Promise<void> {
     const compensation = this.lastCaptureCompensation;
     if (!compensation) return;
@@ -616,6 +645,7 @@ export class NativeDuetPlayer {
     }
     
     if (this.initialized) {
+      this.nativeAudio.removeAudioRouteRecoveredListener(this.handleAudioRouteRecovered);
       await this.nativeAudio.cleanup();
       this.initialized = false;
     }
@@ -15,26 +15,40 @@ import { NativeModules, NativeEventEmitter, Platform } from 'react-native';
 interface TapStoryAudioModuleInterface {
   initialize(): Promise<void>;
   loadTracks(tracks: NativeTrackInfo[]): Promise<void>;
+  renderMixdown?(
+    startMs: number,
+    endMs: number,
+    format: MixdownFormat
+  ): Promise<MixdownResult>;
+  exportChainMix?(): Promise<ChainMixResult>;
   play(playFromMs: number): Promise<void>;
   playAndRecord(playFromMs: number, recordStartMs: number): Promise<void>;
+  playAndRecordRanges?(playFromMs: number, ranges: PunchRange[]): Promise<void>;
+  playAndRecordLoopTakes?(playFromMs: number, recordStartMs: number): Promise<void>;
   startRecording?(): Promise<void>;
   stop(): Promise<void>;
   stopRecording(): Promise<NativeRecordingResult | null>;
+  stopRecordingAtFrame?(frame: number): Promise<void>;
   getCurrentPositionMs(): Promise<number>;
   seekTo?(positionMs: number): Promise<void>;
+  setLoopRegion?(startMs: number, endMs: number, crossfadeMs: number): Promise<void>;
+  clearLoopRegion?(): Promise<void>;
+  setPlaybackSpeed?(speed: number): Promise<void>;
   pause?(): Promise<void>;
   resume?(): Promise<void>;
   cleanup(): Promise<void>;
   setLatencyCompensationMs?(latencyMs: number): Promise<void>;
+  calibrateLatency?(): Promise<LatencyCalibrationResult>;
+  getTakeOnsetEnvelopes?(): Promise<TakeOnsetEnvelopes | null>;
+  getTrackPeaks?(trackId: string, framesPerBin: number): Promise<WaveformPeaks | null>;
+  getCapturePeaks?(framesPerBin: number, fromBin: number): Promise<WaveformPeaks | null>;
   getEstimatedLatency?(): Promise<number>;
-  getLatencyInfo?(): Promise<{
-    inputLatencyMs?: number;
-    outputLatencyMs?: number;
-  }>;
-  getAudioDiagnostics?(): Promise<{
-    inputLatencyMs?: number;
-    outputLatencyMs?: number;
-  }>;
+  getLatencyInfo?(): Promise<NativeLatencyInfo>;
+  getAudioDiagnostics?(): Promise<NativeLatencyInfo>;
+  setHotIdle?(enabled: boolean): Promise<void>;
+  setStemMixing?(enabled: boolean): Promise<void>;
+  setInputChannelCount?(channelCount: number): Promise<number>;
+  prepareRecording?(): Promise<void>;
   isBluetoothConnected?(): Promise<boolean>;
   addListener(eventName: string): void;
   removeListeners(count: number): void;
@@ -45,6 +59,17 @@ interface TapStoryAudioModuleInterface {
   CHANNELS_IN?: number;
 }
 
+interface NativeLatencyInfo {
+  inputLatencyMs?: number;
+  outputLatencyMs?: number;
+  transportStartedHot?: boolean;
+  transportStartDelayMs?: number;
+  firstAudibleFrameMs?: number;
+  streamReadyMs?: number;
+  streamsOpenedMs?: number;
+  firstCallbackMs?: number;
+}
+
 interface NativeTrackInfo {
   id: string;
   uri: string;
@@ -55,6 +80,100 @@ interface NativeRecordingResult {
   uri: string;
   startTimeMs: number;
   durationMs: number;
+  punchTakes?: PunchTake[];
+  loopTakes?: LoopTake[];
+}
+
+// One loop pass of a take recorded across passes
+export interface LoopTake {
+  uri: string;
+  passIndex: number;
+  /** Pass 0 starts at the punch, later passes at the loop start */
+  startTimeMs: number;
+  durationMs: number;
+  /** Raw input frames minus timeline frames; the lane is not stretched */
+  driftFrames: number;
+}
+
+// A timeline span recorded as its own take in a multi-range pass
+export interface PunchRange {
+  startMs: number;
+  endMs: number;
+}
+
+// One range cut from a multi-range pass; ranges the pass never reached are absent
+export interface PunchTake {
+  uri: string;
+  /** Position of the range in the request */
+  rangeIndex: number;
+  startTimeMs: number;
+  durationMs: number;
+}
+
+export type MixdownFormat = 'wav' | 'flac';
+
+// Offline render of the loaded tracks
+export interface MixdownResult {
+  uri: string;
+  format: MixdownFormat;
+  startFrame: number;
+  frameCount: number;
+  durationMs: number;
+  renderMs: number;
+  /** Seconds of audio rendered per second of wall-clock time */
+  realtimeFactor: number;
+  workerCount: number;
+  sampleRate: number;
+}
+
+// Incrementally maintained WAV of the whole loaded chain
+export interface ChainMixResult {
+  uri: string;
+  frameCount: number;
+  durationMs: number;
+  blockCount: number;
+  /** Blocks re-rendered by this update; the rest were reused */
+  renderedBlocks: number;
+  renderMs: number;
+  sampleRate: number;
+}
+
+// On-device loopback measurement of the route's round trip
+export interface LatencyCalibrationResult {
+  compensationFrames: number;
+  compensationMs: number;
+  /** Normalized correlation of the recorded sweep, 0...1 */
+  confidence: number;
+  shortInputFrames: number;
+  sampleRate: number;
+}
+
+// Streamed while the last take was written; both start at startFrame
+export interface TakeOnsetEnvelopes {
+  sampleRate: number;
+  blockFrames: number;
+  startFrame: number;
+  take: number[];
+  mix: number[];
+}
+
+// One level of a native peak pyramid; bin b covers frames
+// [b * framesPerBin, (b + 1) * framesPerBin)
+export interface WaveformPeaks {
+  sampleRate: number;
+  framesPerBin: number;
+  firstBin: number;
+  /** Interleaved [min, max] PCM16 pairs from firstBin on */
+  minMax: number[];
+}
+
+export interface TransportStartLatency {
+  /** Whether the last start resumed streams kept running in hot idle */
+  startedHot: boolean;
+  /** From the play request to the first rendered callback */
+  startDelayMs: number;
+  /** Start delay plus output latency: when the first played frame is heard */
+  firstAudibleFrameMs: number;
 }
 
 // Event types
@@ -66,6 +185,22 @@ export interface RecordingStartedEvent {
   actualStartMs: number;
 }
 
+/**
+ * Streams reopened after a route change with the loaded tracks kept. Latency
+ * compensation from the old route no longer applies and must be configured
+ * again. When recovery fails the engine stays invalidated.
+ */
+export interface AudioRouteRecoveredEvent {
+  recovered: boolean;
+  sampleRate?: number;
+  recoveryMs?: number;
+  // Android only: warmup until the reopened streams were stable, -1 on timeout.
+  streamReadyMs?: number;
+  inputLatencyMs?: number;
+  outputLatencyMs?: number;
+  error?: string;
+}
+
 // Track info for loading
 export interface TrackInfo {
   id: string;
@@ -78,12 +213,24 @@ export interface RecordingResult {
   uri: string;
   startTimeMs: number;
   durationMs: number;
+  /** Set for a multi-range pass: one take per reached range */
+  punchTakes?: PunchTake[];
+  /** Set for a take recorded across loop passes: one take per pass */
+  loopTakes?: LoopTake[];
 }
 
 // Event listener types
 type PositionUpdateListener = (event: PositionUpdateEvent) => void;
 type RecordingStartedListener = (event: RecordingStartedEvent) => void;
 type PlaybackCompleteListener = () => void;
+type AudioRouteRecoveredListener = (event: AudioRouteRecoveredEvent) => void;
+
+// Below this the sweep was masked by noise or never reached the microphone.
+const LOOPBACK_MIN_CONFIDENCE = 0.3;
+// A performance only loosely follows the mix, so ask for a clearer match.
+const TAKE_ALIGNMENT_MIN_CONFIDENCE = 0.5;
+// About 21ms per bin at 48kHz: finer than any timeline zoom draws.
+export const WAVEFORM_FRAMES_PER_BIN = 1_024;
 
 export function getAdjustedLatencyCompensationMs(
   automaticMs: number,
@@ -96,6 +243,92 @@ export function getAdjustedLatencyCompensationMs(
   return Math.max(1, Math.min(1_000, automatic + adjustment));
 }
 
+/**
+ * How far the take's onsets trail the mix it was played over, by normalized
+ * correlation of the two envelopes (mean removed) over the first 10 seconds.
+ * A positive lag means the take is late, so the fine-tune should grow by it.
+ */
+export function estimateTakeLagMs(
+  envelopes: TakeOnsetEnvelopes,
+  maxLagMs = 100
+): { lagMs: number; confidence: number } | null {
+  const blockMs = envelopes.blockFrames * 1_000 / envelopes.sampleRate;
+  if (!(blockMs > 0)) return null;
+  const maxBlocks = Math.ceil(10_000 / blockMs);
+  const take = envelopes.take.slice(0, maxBlocks);
+  const mix = envelopes.mix.slice(0, maxBlocks);
+  const maxLag = Math.max(0, Math.floor(maxLagMs / blockMs));
+  const minimumOverlap = Math.max(32, Math.floor(Math.min(take.length, mix.length) / 4));
+  const mean = (values: number[]) =>
+    values.reduce((sum, value) => sum + value, 0) / Math.max(1, values.length);
+  const takeMean = mean(take);
+  const mixMean = mean(mix);
+
+  let best: { lagMs: number; confidence: number } | null = null;
+  for (let lag = -maxLag; lag <= maxLag; lag++) {
+    const mixStart = Math.max(0, -lag);
+    const takeStart = Math.max(0, lag);
+    const overlap = Math.min(mix.length - mixStart, take.length - takeStart);
+    if (overlap < minimumOverlap) continue;
+
+    let dotProduct = 0;
+    let mixEnergy = 0;
+    let takeEnergy = 0;
+    for (let index = 0; index < overlap; index++) {
+      const mixValue = mix[mixStart + index] - mixMean;
+      const takeValue = take[takeStart + index] - takeMean;
+      dotProduct += mixValue * takeValue;
+      mixEnergy += mixValue * mixValue;
+      takeEnergy += takeValue * takeValue;
+    }
+    const energy = Math.sqrt(mixEnergy * takeEnergy);
+    const confidence = energy > 0 ? dotProduct / energy : 0;
+    if (!best || confidence > best.confidence) {
+      best = { lagMs: lag * blockMs, confidence };
+    }
+  }
+  return best;
+}
+
+/**
+ * Extend live capture peaks with the bins fetched since the last poll. An
+ * update that does not continue `previous` replaces it.
+ */
+export function appendWaveformPeaks(
+  previous: WaveformPeaks | null,
+  update: WaveformPeaks
+): WaveformPeaks {
+  if (
+    !previous ||
+    previous.framesPerBin !== update.framesPerBin ||
+    previous.firstBin + previous.minMax.length / 2 !== update.firstBin
+  ) {
+    return update;
+  }
+  return { ...previous, minMax: previous.minMax.concat(update.minMax) };
+}
+
+/**
+ * Reduce min/max pairs to `barCount` bar heights in 0...1, each the largest
+ * magnitude among the bins it covers.
+ */
+export function getWaveformBarHeights(minMax: number[], barCount: number): number[] {
+  const binCount = Math.floor(minMax.length / 2);
+  if (binCount === 0 || barCount <= 0) return [];
+  const bars = Math.min(barCount, binCount);
+  const heights: number[] = [];
+  for (let bar = 0; bar < bars; bar++) {
+    const first = Math.floor((bar * binCount) / bars);
+    const end = Math.floor(((bar + 1) * binCount) / bars);
+    let peak = 0;
+    for (let value = first * 2; value < end * 2; value++) {
+      peak = Math.max(peak, Math.abs(minMax[value]));
+    }
+    heights.push(Math.min(1, peak / 32_768));
+  }
+  return heights;
+}
+
 /**
  * Get the native module (with fallback for platforms where it's not available)
  */
@@ -127,6 +360,7 @@ export class TapStoryNativeAudio {
   private positionListeners: PositionUpdateListener[] = [];
   private recordingStartedListeners: RecordingStartedListener[] = [];
   private playbackCompleteListeners: PlaybackCompleteListener[] = [];
+  private audioRouteRecoveredListeners: AudioRouteRecoveredListener[] = [];
   private pendingRecordingStartedListener: RecordingStartedListener | null = null;
   private subscriptions: { remove: () => void }[] = [];
   
@@ -208,6 +442,53 @@ export class TapStoryNativeAudio {
     console.log('[TapStoryNativeAudio] Tracks loaded');
   }
   
+  /**
+   * Render the loaded tracks between two positions to a local WAV or FLAC
+   * file, faster than realtime, with the same mixer used for playback.
+   */
+  async renderMixdown(
+    startMs: number,
+    endMs: number,
+    format: MixdownFormat = 'wav'
+  ): Promise<MixdownResult> {
+    if (!this.nativeModule?.renderMixdown) {
+      throw new Error('Native mixdown is not available on this platform');
+    }
+
+    const result = await this.nativeModule.renderMixdown(startMs, endMs, format);
+    console.log(
+      '[TapStoryNativeAudio] Mixdown rendered',
+      result.durationMs,
+      'ms at',
+      result.realtimeFactor.toFixed(1),
+      'x realtime'
+    );
+    return result;
+  }
+
+  /**
+   * Update the cached WAV of the whole loaded chain. Only the parts touched by
+   * tracks added or removed since the previous call are re-rendered, and the
+   * same file is rewritten in place on the next call.
+   */
+  async exportChainMix(): Promise<ChainMixResult> {
+    if (!this.nativeModule?.exportChainMix) {
+      throw new Error('Native chain mix is not available on this platform');
+    }
+
+    const result = await this.nativeModule.exportChainMix();
+    console.log(
+      '[TapStoryNativeAudio] Chain mix updated,',
+      result.renderedBlocks,
+      'of',
+      result.blockCount,
+      'blocks in',
+      result.renderMs.toFixed(1),
+      'ms'
+    );
+    return result;
+  }
+
   /**
    * Start playback from a position
    */
@@ -240,7 +521,70 @@ export class TapStoryNativeAudio {
     
     console.log('[TapStoryNativeAudio] Play and record: playFrom=', playFromMs, ', recordAt=', recordStartMs);
     
-    // Add one-time listener for recording started
+    this.setPendingRecordingStartedListener(onRecordingStarted);
+    try {
+      await this.nativeModule.playAndRecord(playFromMs, recordStartMs);
+    } catch (error) {
+      this.clearPendingRecordingStartedListener();
+      throw error;
+    }
+  }
+
+  /**
+   * Record several ranges in one pass of playback. Capture runs from the
+   * first range start and ends by itself at the last range end while
+   * playback continues; stopRecording returns one take per range in
+   * `punchTakes`. Ranges must be non-empty, ascending and non-overlapping.
+   */
+  async playAndRecordRanges(
+    playFromMs: number,
+    ranges: PunchRange[],
+    onRecordingStarted?: (actualStartMs: number) => void
+  ): Promise<void> {
+    if (!this.nativeModule?.playAndRecordRanges) {
+      throw new Error('Multi-range recording is not available');
+    }
+
+    console.log('[TapStoryNativeAudio] Play and record ranges: playFrom=', playFromMs, ', ranges=', ranges.length);
+
+    this.setPendingRecordingStartedListener(onRecordingStarted);
+    try {
+      await this.nativeModule.playAndRecordRanges(playFromMs, ranges);
+    } catch (error) {
+      this.clearPendingRecordingStartedListener();
+      throw error;
+    }
+  }
+
+  /**
+   * Record a looped take across passes instead of ending it at the loop end.
+   * It runs until stopRecording, which returns every pass in `loopTakes` so
+   * the best one can be kept without recording again; `uri` is the first.
+   */
+  async playAndRecordLoopTakes(
+    playFromMs: number,
+    recordStartMs: number,
+    onRecordingStarted?: (actualStartMs: number) => void
+  ): Promise<void> {
+    if (!this.nativeModule?.playAndRecordLoopTakes) {
+      throw new Error('Loop take recording is not available');
+    }
+
+    console.log('[TapStoryNativeAudio] Play and record loop takes: playFrom=', playFromMs, ', recordAt=', recordStartMs);
+
+    this.setPendingRecordingStartedListener(onRecordingStarted);
+    try {
+      await this.nativeModule.playAndRecordLoopTakes(playFromMs, recordStartMs);
+    } catch (error) {
+      this.clearPendingRecordingStartedListener();
+      throw error;
+    }
+  }
+
+  // One-time listener for the take's first accepted input frame
+  private setPendingRecordingStartedListener(
+    onRecordingStarted?: (actualStartMs: number) => void
+  ): void {
     if (onRecordingStarted) {
       this.clearPendingRecordingStartedListener();
       const listener = (event: RecordingStartedEvent) => {
@@ -253,13 +597,6 @@ export class TapStoryNativeAudio {
       this.pendingRecordingStartedListener = listener;
       this.addRecordingStartedListener(listener);
     }
-
-    try {
-      await this.nativeModule.playAndRecord(playFromMs, recordStartMs);
-    } catch (error) {
-      this.clearPendingRecordingStartedListener();
-      throw error;
-    }
   }
   
   /**
@@ -334,6 +671,132 @@ export class TapStoryNativeAudio {
       : compensationMs;
   }
 
+  /**
+   * Measure the current route on device: the engine plays a short sweep,
+   * records it in the same duplex session and correlates natively, so no
+   * upload is needed and it can be repeated after every route change. The
+   * measured round trip is applied as compensation only when the sweep was
+   * heard clearly enough.
+   */
+  async calibrateLoopbackLatency(
+    minimumConfidence: number = LOOPBACK_MIN_CONFIDENCE
+  ): Promise<LatencyCalibrationResult & { applied: boolean }> {
+    if (!this.nativeModule?.calibrateLatency) {
+      throw new Error('Loopback calibration is not available on this platform');
+    }
+
+    const result = await this.nativeModule.calibrateLatency();
+    const applied = result.confidence >= minimumConfidence
+      && result.shortInputFrames === 0
+      && Boolean(this.nativeModule.setLatencyCompensationMs);
+    if (applied) {
+      await this.nativeModule.setLatencyCompensationMs!(result.compensationMs);
+    }
+    console.log(
+      '[TapStoryNativeAudio] Loopback calibration',
+      result.compensationMs.toFixed(2),
+      'ms, confidence',
+      result.confidence.toFixed(3),
+      applied ? '(applied)' : '(not applied)'
+    );
+    return { ...result, applied };
+  }
+
+  /**
+   * Suggest a fine-tune change from the last take: the engine streamed onset
+   * envelopes of the take and of the mix under it while recording, so the
+   * comparison needs no file reads. Returns null for a standalone take, an
+   * unsupported platform, or a weak match.
+   */
+  async suggestLatencyNudgeMs(
+    minimumConfidence: number = TAKE_ALIGNMENT_MIN_CONFIDENCE
+  ): Promise<number | null> {
+    if (!this.nativeModule?.getTakeOnsetEnvelopes) return null;
+    const envelopes = await this.nativeModule.getTakeOnsetEnvelopes();
+    if (!envelopes || !envelopes.mix.some(value => value > 0)) return null;
+
+    const estimate = estimateTakeLagMs(envelopes);
+    if (!estimate || estimate.confidence < minimumConfidence) return null;
+    return Math.round(estimate.lagMs);
+  }
+
+  /**
+   * Waveform peaks of a loaded track, computed natively when it was loaded.
+   * Track ids are segment ids. Returns null until the track is loaded.
+   */
+  async getTrackPeaks(
+    trackId: string,
+    framesPerBin: number = WAVEFORM_FRAMES_PER_BIN
+  ): Promise<WaveformPeaks | null> {
+    if (!this.nativeModule?.getTrackPeaks) return null;
+    return this.nativeModule.getTrackPeaks(trackId, framesPerBin);
+  }
+
+  /**
+   * Peaks of the take being recorded from bin `fromBin` on; the capture
+   * thread builds them as it writes, so polling only transfers new bins.
+   */
+  async getCapturePeaks(
+    fromBin: number = 0,
+    framesPerBin: number = WAVEFORM_FRAMES_PER_BIN
+  ): Promise<WaveformPeaks | null> {
+    if (!this.nativeModule?.getCapturePeaks) return null;
+    return this.nativeModule.getCapturePeaks(framesPerBin, fromBin);
+  }
+
+  /**
+   * Keep the native streams running silent between takes, so play and record
+   * start at the next audio burst instead of restarting the streams.
+   */
+  async setHotIdle(enabled: boolean): Promise<void> {
+    await this.nativeModule?.setHotIdle?.(enabled);
+  }
+
+  /**
+   * Play loaded chains from two pre-mixed lanes, even and odd turns, so the
+   * audio callback's cost stays flat however many segments a chain has. Each
+   * lane spans the whole chain, about 460MB for both on a 10-minute stereo
+   * chain at 48kHz; stops playback when switching.
+   */
+  async setStemMixing(enabled: boolean): Promise<void> {
+    await this.nativeModule?.setStemMixing?.(enabled);
+  }
+
+  /**
+   * Record takes with one or two channels, for stereo interfaces. The input
+   * is reopened on the current route; resolves with the channels it now
+   * delivers, or 1 when the native module cannot record stereo.
+   */
+  async setInputChannelCount(channelCount: 1 | 2): Promise<number> {
+    return (await this.nativeModule?.setInputChannelCount?.(channelCount)) ?? 1;
+  }
+
+  /**
+   * Allocate the native capture buffers ahead of the first take. Opening the
+   * streams only sizes them, so playback-only sessions never pay for them;
+   * without this call the first take allocates them when it is armed.
+   */
+  async prepareRecording(): Promise<void> {
+    await this.nativeModule?.prepareRecording?.();
+  }
+
+  /** Time to the first audible frame of the last play or take, once it has played. */
+  async getTransportStartLatency(): Promise<TransportStartLatency | null> {
+    const info = this.nativeModule?.getLatencyInfo
+      ? await this.nativeModule.getLatencyInfo()
+      : this.nativeModule?.getAudioDiagnostics
+        ? await this.nativeModule.getAudioDiagnostics()
+        : null;
+    if (!info || info.transportStartDelayMs === undefined || info.transportStartDelayMs < 0) {
+      return null;
+    }
+    return {
+      startedHot: info.transportStartedHot ?? false,
+      startDelayMs: info.transportStartDelayMs,
+      firstAudibleFrameMs: info.firstAudibleFrameMs ?? -1,
+    };
+  }
+
   /**
    * A standalone first take has no output reference. Its timeline must be
    * gated and tailed by microphone input latency only.
@@ -389,6 +852,8 @@ export class TapStoryNativeAudio {
           uri: result.uri,
           startTimeMs: result.startTimeMs,
           durationMs: result.durationMs,
+          ...(result.punchTakes?.length ? { punchTakes: result.punchTakes } : {}),
+          ...(result.loopTakes?.length ? { loopTakes: result.loopTakes } : {}),
         };
       }
 
@@ -398,6 +863,19 @@ export class TapStoryNativeAudio {
     }
   }
   
+  /**
+   * End the take at a timeline frame (at the engine sample rate) inside the
+   * native audio callback, so where it ends never depends on when JS ran.
+   * Playback continues; call stopRecording once the frame has played to
+   * collect the take.
+   */
+  async stopRecordingAtFrame(frame: number): Promise<void> {
+    if (!this.nativeModule?.stopRecordingAtFrame) {
+      throw new Error('Native scheduled recording stop not available');
+    }
+    await this.nativeModule.stopRecordingAtFrame(frame);
+  }
+
   /**
    * Stop both playback and recording
    * Returns recording result if recording was active
@@ -433,6 +911,33 @@ export class TapStoryNativeAudio {
     }
   }
   
+  /**
+   * Loop playback over [startMs, endMs) inside the native callback, so the
+   * wrap is gapless; a take recorded inside the loop ends with its pass.
+   */
+  async setLoopRegion(startMs: number, endMs: number, crossfadeMs = 0): Promise<void> {
+    if (!this.nativeModule?.setLoopRegion) {
+      throw new Error('Native loop playback not available');
+    }
+    await this.nativeModule.setLoopRegion(startMs, endMs, crossfadeMs);
+  }
+
+  async clearLoopRegion(): Promise<void> {
+    await this.nativeModule?.clearLoopRegion?.();
+  }
+
+  /**
+   * Practice playback at 0.5x to 1.0x, resampled in the native mixer from the
+   * next callback without decoding the tracks again; pitch follows speed.
+   * Positions stay on the timeline. Takes only record at 1.0.
+   */
+  async setPlaybackSpeed(speed: number): Promise<void> {
+    if (!this.nativeModule?.setPlaybackSpeed) {
+      throw new Error('Native practice speed not available');
+    }
+    await this.nativeModule.setPlaybackSpeed(speed);
+  }
+
   /**
    * Pause playback
    */
@@ -540,6 +1045,20 @@ export class TapStoryNativeAudio {
     }
   }
   
+  /**
+   * Add a listener for streams reopened after an audio route change
+   */
+  addAudioRouteRecoveredListener(listener: AudioRouteRecoveredListener): void {
+    this.audioRouteRecoveredListeners.push(listener);
+  }
+
+  removeAudioRouteRecoveredListener(listener: AudioRouteRecoveredListener): void {
+    const index = this.audioRouteRecoveredListeners.indexOf(listener);
+    if (index !== -1) {
+      this.audioRouteRecoveredListeners.splice(index, 1);
+    }
+  }
+
   /**
    * Setup native event listeners
    */
@@ -563,6 +1082,15 @@ export class TapStoryNativeAudio {
       this.playbackCompleteListeners.forEach(listener => listener());
     });
     this.subscriptions.push(completeSub);
+
+    // Route recovered
+    const routeSub = this.eventEmitter.addListener(
+      'onAudioRouteRecovered',
+      (event: AudioRouteRecoveredEvent) => {
+        this.audioRouteRecoveredListeners.forEach(listener => listener(event));
+      }
+    );
+    this.subscriptions.push(routeSub);
   }
   
   /**
@@ -574,6 +1102,7 @@ export class TapStoryNativeAudio {
     this.positionListeners = [];
     this.recordingStartedListeners = [];
     this.playbackCompleteListeners = [];
+    this.audioRouteRecoveredListeners = [];
     this.pendingRecordingStartedListener = null;
     TapStoryNativeAudio.instance = null;
   }
@@ -13,6 +13,7 @@ let failNextPlayAndRecordForRouteChange = false;
 let failNextRecordArmForRouteChange = false;
 let failNextStopWithTransportError = false;
 let currentPositionMs = 0;
+const routeRecoveredListeners: ((event: { recovered: boolean }) => void)[] = [];
 
 const recordingResult = {
   uri: 'file:///recording.wav',
@@ -74,6 +75,14 @@ const mockNativeAudio = {
   pause: jest.fn(async () => undefined),
   resume: jest.fn(async () => undefined),
   seekTo: jest.fn(async () => undefined),
+  setHotIdle: jest.fn(async () => undefined),
+  addAudioRouteRecoveredListener: jest.fn((listener: (event: { recovered: boolean }) => void) => {
+    routeRecoveredListeners.push(listener);
+  }),
+  removeAudioRouteRecoveredListener: jest.fn((listener: (event: { recovered: boolean }) => void) => {
+    const index = routeRecoveredListeners.indexOf(listener);
+    if (index !== -1) routeRecoveredListeners.splice(index, 1);
+  }),
   getCurrentPositionMs: jest.fn(async () => currentPositionMs),
   startRecording: jest.fn(async () => {
     callOrder.push('startRecording');
@@ -138,6 +147,7 @@ describe('NativeDuetPlayer session lifecycle', () => {
     failNextRecordArmForRouteChange = false;
     failNextStopWithTransportError = false;
     currentPositionMs = 0;
+    routeRecoveredListeners.length = 0;
   });
 
   it('reinitializes, reloads, and retries playback once after a route change', async () => {
@@ -228,6 +238,31 @@ describe('NativeDuetPlayer session lifecycle', () => {
     await player.stop();
   });
 
+  it('re-measures latency in place when the engine recovers a changed route', async () => {
+    const player = new NativeDuetPlayer();
+    await player.loadChain([{
+      id: 'segment-1',
+      audioUrl: 'https://example.test/segment.wav',
+      localUri: 'file:///segment.wav',
+      duration: 1,
+      startTime: 0,
+    }]);
+    await player.configureLatencyCompensation(37);
+    expect(routeRecoveredListeners).toHaveLength(1);
+
+    routeRecoveredListeners.forEach(listener => listener({ recovered: true }));
+    await Promise.resolve();
+
+    // Tracks survive recovery: no rebuild, only the compensation is re-applied.
+    expect(mockNativeAudio.configureLatencyCompensation).toHaveBeenCalledTimes(2);
+    expect(mockNativeAudio.configureLatencyCompensation).toHaveBeenLastCalledWith(37);
+    expect(mockNativeAudio.cleanup).not.toHaveBeenCalled();
+    expect(mockNativeAudio.loadTracks).toHaveBeenCalledTimes(1);
+
+    await player.cleanup();
+    expect(routeRecoveredListeners).toHaveLength(0);
+  });
+
   it('retries a first-take record after a route change and re-applies capture compensation', async () => {
     emitRecordingStarted = false;
     const player = new NativeDuetPlayer();
@@ -1,4 +1,9 @@
-import { getAdjustedLatencyCompensationMs } from '../TapStoryNativeAudio';
+import {
+  appendWaveformPeaks,
+  estimateTakeLagMs,
+  getAdjustedLatencyCompensationMs,
+  getWaveformBarHeights,
+} from '../TapStoryNativeAudio';
 
 describe('latency fine-tuning', () => {
   it('applies signed adjustments around the automatic route estimate', () => {
@@ -11,3 +16,60 @@ describe('latency fine-tuning', () => {
     expect(getAdjustedLatencyCompensationMs(900, 250)).toBe(1_000);
   });
 });
+
+describe('take onset envelopes', () => {
+  const mix = Array.from({ length: 2_000 }, (_, index) =>
+    index % 97 === 0 || index % 61 === 0 ? 1_000 : 10
+  );
+
+  it('finds how far the take trails the mix', () => {
+    const take = [...new Array(24).fill(0), ...mix].slice(0, mix.length);
+    const estimate = estimateTakeLagMs({
+      sampleRate: 48_000,
+      blockFrames: 24,
+      startFrame: 0,
+      take,
+      mix,
+    });
+    expect(estimate?.lagMs).toBe(12);
+    expect(estimate?.confidence).toBeGreaterThan(0.9);
+  });
+
+  it('reports an early take as a negative lag', () => {
+    const estimate = estimateTakeLagMs({
+      sampleRate: 48_000,
+      blockFrames: 24,
+      startFrame: 0,
+      take: mix.slice(10),
+      mix,
+    });
+    expect(estimate?.lagMs).toBe(-5);
+  });
+});
+
+describe('waveform peaks', () => {
+  const peaks = (firstBin: number, minMax: number[]) => ({
+    sampleRate: 48_000,
+    framesPerBin: 1_024,
+    firstBin,
+    minMax,
+  });
+
+  it('appends polled capture bins that continue the waveform', () => {
+    const merged = appendWaveformPeaks(peaks(0, [-1, 1, -2, 2]), peaks(2, [-3, 3]));
+    expect(merged.firstBin).toBe(0);
+    expect(merged.minMax).toEqual([-1, 1, -2, 2, -3, 3]);
+  });
+
+  it('restarts from an update that does not continue the waveform', () => {
+    const update = peaks(0, [-5, 5]);
+    expect(appendWaveformPeaks(peaks(0, [-1, 1, -2, 2]), update)).toBe(update);
+  });
+
+  it('reduces bins to bars of the largest magnitude they cover', () => {
+    const minMax = [-16_384, 100, -10, 10, 0, 32_767, -32_768, 0];
+    expect(getWaveformBarHeights(minMax, 2)).toEqual([0.5, 1]);
+    expect(getWaveformBarHeights(minMax, 10)).toHaveLength(4);
+    expect(getWaveformBarHeights([], 4)).toEqual([]);
+  });
+});
@@ -0,0 +1,167 @@
+#include "audio/CaptureWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "audio/PcmConversion.h"
+
+namespace tapstory {
+
+CaptureWriter::~CaptureWriter() {
+    stop();
+}
+
+void CaptureWriter::prepare(size_t ringFrames, int32_t sampleRate, int32_t channelCount) {
+    if (isActive()) return;
+    mEnvelopeBlockFrames = OnsetEnvelope::blockFramesForRate(sampleRate);
+    mSampleRate = sampleRate;
+    mRingFrames = std::max<size_t>(1, ringFrames);
+    mChannelCount = std::max(1, channelCount);
+}
+
+void CaptureWriter::allocateBuffers() {
+    if (isActive() || !isPrepared()) return;
+    // Both are value-initialized, so every page is written once here rather
+    // than faulted in by the first callbacks of a take.
+    if (mPeaks.capacityFrames() != peakCapacityFrames()) mPeaks.allocate(peakCapacityFrames());
+    if (!mRing || mRing->capacity() != mRingFrames || mRing->channelCount() != mChannelCount) {
+        mRing = std::make_unique<SpscPcmRing>(mRingFrames, mChannelCount);
+    }
+}
+
+bool CaptureWriter::hasBuffers() const noexcept {
+    return mRing && mRing->capacity() == mRingFrames && mRing->channelCount() == mChannelCount
+            && mPeaks.capacityFrames() == peakCapacityFrames();
+}
+
+bool CaptureWriter::start(
+        const std::string &filePath,
+        DrainHook hook,
+        const std::string &lanePathPrefix) {
+    stop();
+    if (!isPrepared()) return false;
+    allocateBuffers();
+    if (!lanePathPrefix.empty() && mSampleRate <= 0) return false;
+
+    mFile.clear();
+    mFile.open(filePath, std::ios::binary | std::ios::trunc);
+    if (!mFile.is_open()) return false;
+
+    mRing->reset();
+    mEnvelope.reset(mEnvelopeBlockFrames);
+    mPeaks.clear();
+    mHook = std::move(hook);
+    mLanePathPrefix = lanePathPrefix;
+    mLaneSplitCount.store(0, std::memory_order_release);
+    mLaneIndex = 0;
+    mLaneStreamFrames = 0;
+    mFramesWritten.store(0, std::memory_order_release);
+    mFailed.store(false, std::memory_order_release);
+    mStopRequested.store(false, std::memory_order_release);
+    mActive.store(true, std::memory_order_release);
+    mThread = std::thread(&CaptureWriter::run, this);
+    return true;
+}
+
+void CaptureWriter::stop() {
+    if (!mThread.joinable()) return;
+    mStopRequested.store(true, std::memory_order_release);
+    mThread.join();
+
+    if (mFile.is_open()) {
+        mFile.flush();
+        if (!mFile.good()) mFailed.store(true, std::memory_order_release);
+        mFile.close();
+        if (mFile.fail()) mFailed.store(true, std::memory_order_release);
+    }
+    if (mLane.isOpen() && !mLane.close()) mFailed.store(true, std::memory_order_release);
+    mHook = nullptr;
+    mActive.store(false, std::memory_order_release);
+}
+
+bool CaptureWriter::splitLane(const LaneSplit &split) noexcept {
+    if (!writesLanes()) return false;
+    const size_t count = mLaneSplitCount.load(std::memory_order_relaxed);
+    if (count >= kMaxLaneSplits) return false;
+    mLaneSplits[count] = split;
+    mLaneSplitCount.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+std::string CaptureWriter::lanePath(size_t index) const {
+    return mLanePathPrefix + std::to_string(index) + ".wav";
+}
+
+void CaptureWriter::writeLanes(const int16_t *samples, size_t frameCount) {
+    // The ring read that returned these frames happened first, so every split
+    // the producer marked before writing them is visible here.
+    const size_t splitCount = mLaneSplitCount.load(std::memory_order_acquire);
+    while (frameCount > 0) {
+        while (mLaneIndex < splitCount && mLaneStreamFrames >= mLaneSplits[mLaneIndex].rawFrame) {
+            if (mLane.isOpen() && !mLane.close()) mFailed.store(true, std::memory_order_release);
+            ++mLaneIndex;
+        }
+        size_t frames = frameCount;
+        if (mLaneIndex < splitCount) {
+            frames = static_cast<size_t>(std::min<int64_t>(
+                    static_cast<int64_t>(frames),
+                    mLaneSplits[mLaneIndex].rawFrame - mLaneStreamFrames));
+        }
+        if (!mLane.isOpen() && !mLane.open(lanePath(mLaneIndex), mSampleRate, mChannelCount)) {
+            mFailed.store(true, std::memory_order_release);
+            return;
+        }
+        if (!mLane.write(samples, frames)) {
+            mFailed.store(true, std::memory_order_release);
+            return;
+        }
+        mLaneStreamFrames += static_cast<int64_t>(frames);
+        samples += frames * static_cast<size_t>(mChannelCount);
+        frameCount -= frames;
+    }
+}
+
+void CaptureWriter::run() {
+    const auto channels = static_cast<size_t>(mChannelCount);
+    std::vector<int16_t> buffer(kChunkFrames * channels);
+    // Analysis reads the mono fold; mono captures use the buffer as is.
+    std::vector<int16_t> mono(channels == 1 ? 0 : kChunkFrames);
+    for (;;) {
+        const size_t framesRead = mRing->read(buffer.data(), kChunkFrames);
+        const int16_t *analysed = buffer.data();
+        if (channels != 1) {
+            downmixPcm16ToMono(buffer.data(), mChannelCount, mono.data(), framesRead);
+            analysed = mono.data();
+        }
+        mEnvelope.append(analysed, framesRead);
+        mPeaks.append(analysed, framesRead);
+        if (framesRead > 0 && !mFailed.load(std::memory_order_relaxed)) {
+            mFile.write(
+                    reinterpret_cast<const char *>(buffer.data()),
+                    static_cast<std::streamsize>(framesRead * channels * sizeof(int16_t)));
+            if (writesLanes()) writeLanes(buffer.data(), framesRead);
+            if (mFile.good()) {
+                mFramesWritten.fetch_add(
+                        static_cast<int64_t>(framesRead),
+                        std::memory_order_release);
+            } else {
+                // Keep draining so the producer never sees a full ring; the
+                // owner observes failed() and ends the take.
+                mFailed.store(true, std::memory_order_release);
+            }
+        }
+        if (mHook) mHook();
+        if (framesRead > 0) continue;
+
+        if (mStopRequested.load(std::memory_order_acquire) && mRing->availableToRead() == 0) {
+            mEnvelope.finish();
+            mPeaks.finish();
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+}  // namespace tapstory
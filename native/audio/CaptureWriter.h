@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "audio/OnsetEnvelope.h"
+#include "audio/PeakPyramid.h"
+#include "audio/SpscPcmRing.h"
+#include "audio/WavWriter.h"
+
+namespace tapstory {
+
+/**
+ * Raw interleaved PCM16 capture sink: a preallocated SPSC ring filled by the
+ * realtime callback and drained to disk by a dedicated writer thread. The
+ * writer thread also streams the mono fold of every drained chunk into an
+ * onset envelope and a waveform peak pyramid of the take.
+ *
+ * Started with a lane prefix, the writer also splits the stream into lanes:
+ * PCM16 WAVs `prefix` + index + ".wav" with the capture's channel count that
+ * end where the callback marked a split, so each loop pass of one continuous
+ * capture becomes its own take.
+ *
+ * `prepare`, `start` and `stop` are control-thread operations. `writeGenerated`
+ * and `splitLane` are the realtime entry points and never block.
+ */
+class CaptureWriter {
+public:
+    /** Invoked on the writer thread after every drain pass. */
+    using DrainHook = std::function<void()>;
+
+    /** The end of one lane, in raw frames, and the owner's timeline frames around it. */
+    struct LaneSplit {
+        int64_t rawFrame = 0;
+        int64_t endFrame = 0;
+        int64_t nextStartFrame = 0;
+    };
+    static constexpr size_t kMaxLaneSplits = 255;
+
+    CaptureWriter() = default;
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    /**
+     * Size the ring and the take analysis for `sampleRate` and frames of
+     * `channelCount` samples. Nothing is allocated yet, so playback-only
+     * sessions never pay for capture buffers. Must not be called while the
+     * writer is active.
+     */
+    void prepare(size_t ringFrames, int32_t sampleRate, int32_t channelCount = 1);
+    bool isPrepared() const noexcept { return mRingFrames > 0; }
+    /**
+     * Allocate and pre-fault the ring and live peaks at the prepared sizes,
+     * keeping buffers an earlier session left when the sizes still match.
+     * `start` does this itself when needed; calling it earlier from a
+     * background thread takes that cost off arming. Must not be called while
+     * the writer is active or peaks are being read.
+     */
+    void allocateBuffers();
+    bool hasBuffers() const noexcept;
+
+    /** A non-empty `lanePathPrefix` also writes the stream as lanes. */
+    bool start(
+            const std::string &filePath,
+            DrainHook hook = {},
+            const std::string &lanePathPrefix = {});
+    /** Drain everything the producer published, then join and close the file. */
+    void stop();
+
+    template <typename Generator>
+    size_t writeGenerated(size_t frameCount, Generator &&generator) noexcept {
+        return mRing ? mRing->writeGenerated(frameCount, std::forward<Generator>(generator)) : 0;
+    }
+    /**
+     * End the current lane after `split.rawFrame` frames of the stream. Call
+     * after writing those frames and before any of the next lane. Returns
+     * false when lanes are off or the split table is full.
+     */
+    bool splitLane(const LaneSplit &split) noexcept;
+
+    bool writesLanes() const noexcept { return !mLanePathPrefix.empty(); }
+    std::string lanePath(size_t index) const;
+    /** Splits marked so far; lane i ends at split i, the last lane at the stream end. */
+    size_t laneSplitCount() const noexcept {
+        return mLaneSplitCount.load(std::memory_order_acquire);
+    }
+    const LaneSplit &laneSplit(size_t index) const noexcept { return mLaneSplits[index]; }
+
+    bool isActive() const noexcept { return mActive.load(std::memory_order_acquire); }
+    bool failed() const noexcept { return mFailed.load(std::memory_order_acquire); }
+    int64_t framesWritten() const noexcept {
+        return mFramesWritten.load(std::memory_order_acquire);
+    }
+    int32_t channelCount() const noexcept { return mChannelCount; }
+    /** The prepared ring size, whether or not it has been allocated yet. */
+    size_t ringCapacity() const noexcept { return mRingFrames; }
+    size_t bufferedFrames() const noexcept { return mRing ? mRing->availableToRead() : 0; }
+    /** Envelope of everything drained; only read it while the writer is stopped. */
+    const OnsetEnvelope &onsetEnvelope() const noexcept { return mEnvelope; }
+    /** Peaks of the take so far; readable while the writer runs. */
+    const PeakPyramid &peaks() const noexcept { return mPeaks; }
+
+private:
+    static constexpr size_t kChunkFrames = 4096;
+    // Live peaks cover this much of a take; the file itself is unbounded.
+    static constexpr int64_t kPeakCapacitySeconds = 30 * 60;
+
+    void run();
+    void writeLanes(const int16_t *samples, size_t frameCount);
+    int64_t peakCapacityFrames() const noexcept {
+        return static_cast<int64_t>(std::max(0, mSampleRate)) * kPeakCapacitySeconds;
+    }
+
+    std::unique_ptr<SpscPcmRing> mRing;
+    size_t mRingFrames = 0;
+    int32_t mChannelCount = 1;
+    std::thread mThread;
+    std::ofstream mFile;
+    OnsetEnvelope mEnvelope;
+    PeakPyramid mPeaks;
+    int32_t mEnvelopeBlockFrames = 0;
+    int32_t mSampleRate = 0;
+    // Lanes: splits are published by the producer, files are writer-thread state.
+    std::string mLanePathPrefix;
+    std::array<LaneSplit, kMaxLaneSplits> mLaneSplits{};
+    std::atomic<size_t> mLaneSplitCount{0};
+    WavWriter mLane;
+    size_t mLaneIndex = 0;
+    int64_t mLaneStreamFrames = 0;
+    DrainHook mHook;
+    std::atomic<bool> mActive{false};
+    std::atomic<bool> mStopRequested{false};
+    std::atomic<bool> mFailed{false};
+    std::atomic<int64_t> mFramesWritten{0};
+};
+
+}  // namespace tapstory
@@ -0,0 +1,349 @@
+#include "audio/ChainContainer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "audio/LinearResampler.h"
+#include "audio/TrackStore.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr std::array<char, 4> kMagic{{'T', 'S', 'C', 'H'}};
+constexpr uint16_t kVersion = 1;
+constexpr size_t kFixedHeaderBytes = 16;
+constexpr size_t kCountOffset = 12;
+constexpr size_t kEntryBytes = 128;
+constexpr size_t kIdBytes = 64;
+constexpr uint32_t kFlagLoudnessMeasured = 1;
+
+static_assert(kFixedHeaderBytes + ChainContainer::kDefaultIndexCapacity * kEntryBytes
+        <= ChainContainer::kBlockAlignment);
+
+uint64_t alignUp(uint64_t value) noexcept {
+    const uint64_t alignment = ChainContainer::kBlockAlignment;
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint64_t headerBytes(uint32_t capacity) noexcept {
+    return alignUp(kFixedHeaderBytes + static_cast<uint64_t>(capacity) * kEntryBytes);
+}
+
+uint64_t readLe(const uint8_t *bytes, size_t size) noexcept {
+    uint64_t value = 0;
+    for (size_t index = 0; index < size; ++index) {
+        value |= static_cast<uint64_t>(bytes[index]) << (8 * index);
+    }
+    return value;
+}
+
+void writeLe(uint8_t *bytes, uint64_t value, size_t size) noexcept {
+    for (size_t index = 0; index < size; ++index) {
+        bytes[index] = static_cast<uint8_t>(value >> (8 * index));
+    }
+}
+
+double readDouble(const uint8_t *bytes) noexcept {
+    const uint64_t bits = readLe(bytes, 8);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void writeDouble(uint8_t *bytes, double value) noexcept {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writeLe(bytes, bits, 8);
+}
+
+float readFloat(const uint8_t *bytes) noexcept {
+    const auto bits = static_cast<uint32_t>(readLe(bytes, 4));
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void writeFloat(uint8_t *bytes, float value) noexcept {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writeLe(bytes, bits, 4);
+}
+
+std::array<uint8_t, kEntryBytes> encodeEntry(const ChainSegment &segment, uint64_t offset) {
+    std::array<uint8_t, kEntryBytes> entry{};
+    std::memcpy(entry.data(), segment.id.data(), segment.id.size());
+    writeLe(entry.data() + 64, static_cast<uint64_t>(segment.startFrame), 8);
+    writeLe(entry.data() + 72, static_cast<uint64_t>(segment.lengthFrames), 8);
+    writeLe(entry.data() + 80, offset, 8);
+    writeLe(entry.data() + 88, segment.fingerprint, 8);
+    writeDouble(entry.data() + 96, segment.loudness.integratedLufs);
+    writeDouble(entry.data() + 104, segment.loudness.truePeakDbtp);
+    writeLe(entry.data() + 112, static_cast<uint32_t>(segment.sampleRate), 4);
+    writeFloat(entry.data() + 116, segment.gain);
+    writeLe(entry.data() + 120, segment.loudness.measured ? kFlagLoudnessMeasured : 0, 4);
+    writeLe(entry.data() + 124, static_cast<uint32_t>(segment.channelCount), 4);
+    return entry;
+}
+
+uint64_t blockBytes(const ChainSegment &segment) noexcept {
+    return static_cast<uint64_t>(segment.lengthFrames) * segment.channelCount * sizeof(float);
+}
+
+bool writeAll(int descriptor, const void *data, size_t size, uint64_t offset) noexcept {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t written = ::pwrite(descriptor, bytes, size, static_cast<off_t>(offset));
+        if (written <= 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool writeCount(int descriptor, uint32_t count) noexcept {
+    std::array<uint8_t, 4> bytes{};
+    writeLe(bytes.data(), count, bytes.size());
+    return writeAll(descriptor, bytes.data(), bytes.size(), kCountOffset);
+}
+
+bool writeEmptyHeader(int descriptor, uint32_t capacity) {
+    std::vector<uint8_t> header(static_cast<size_t>(headerBytes(capacity)), 0);
+    std::memcpy(header.data(), kMagic.data(), kMagic.size());
+    writeLe(header.data() + 4, kVersion, 2);
+    writeLe(header.data() + 8, capacity, 4);
+    return writeAll(descriptor, header.data(), header.size(), 0);
+}
+
+// The block lands past everything written so far, so no live mapping or
+// entry of the file is touched. Host byte order is little endian on every
+// platform the engine ships on, so PCM is written as is.
+bool writeSegment(int descriptor, uint32_t slot, const ChainSegment &segment) {
+    struct stat info {};
+    if (::fstat(descriptor, &info) != 0) return false;
+    const uint64_t offset = alignUp(static_cast<uint64_t>(info.st_size));
+    if (!writeAll(descriptor, segment.samples, static_cast<size_t>(blockBytes(segment)), offset)) {
+        return false;
+    }
+    const std::array<uint8_t, kEntryBytes> entry = encodeEntry(segment, offset);
+    return writeAll(descriptor, entry.data(), entry.size(), kFixedHeaderBytes + slot * kEntryBytes);
+}
+
+// Copies `segments` into a fresh file with room for `capacity` entries and
+// moves it over `path`.
+bool rewrite(
+        const std::string &path,
+        const std::vector<const ChainSegment *> &segments,
+        uint32_t capacity) {
+    const std::string temporary = path + ".tmp";
+    const int descriptor = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0) return false;
+    bool ok = writeEmptyHeader(descriptor, capacity);
+    uint32_t count = 0;
+    for (const ChainSegment *segment : segments) {
+        ok = ok && writeSegment(descriptor, count++, *segment);
+    }
+    ok = ok && writeCount(descriptor, count) && ::fsync(descriptor) == 0;
+    ::close(descriptor);
+    if (ok && ::rename(temporary.c_str(), path.c_str()) == 0) return true;
+    ::unlink(temporary.c_str());
+    return false;
+}
+
+}  // namespace
+
+bool ChainContainer::append(const std::string &path, const Track &track, int32_t sampleRate) {
+    if (track.id.empty() || track.id.size() > kMaxIdBytes || track.lengthFrames <= 0
+            || sampleRate <= 0) {
+        return false;
+    }
+    // The segment keeps the track's own rate, placement included.
+    const int32_t segmentRate = track.sampleRate > 0 ? track.sampleRate : sampleRate;
+    ChainSegment segment;
+    segment.id = track.id;
+    segment.startFrame = rescaleFrame(track.startFrame, sampleRate, segmentRate);
+    segment.lengthFrames = track.lengthFrames;
+    segment.sampleRate = segmentRate;
+    segment.channelCount = track.channelCount;
+    segment.loudness = track.loudness;
+    segment.gain = track.gain;
+    segment.fingerprint = track.sourceFingerprint;
+    segment.samples = track.pcm();
+
+    ChainContainer previous;
+    struct stat existing {};
+    if (::stat(path.c_str(), &existing) == 0 && existing.st_size > 0) {
+        if (!previous.open(path)) return false;
+        const ChainSegment *stored = previous.find(segment.id);
+        // A load that could not map the segment for another reason, such as
+        // placement rounding, must not store the same PCM again.
+        if (stored != nullptr && stored->fingerprint == segment.fingerprint) return true;
+
+        std::vector<const ChainSegment *> live;
+        uint64_t liveBytes = blockBytes(segment);
+        uint64_t deadBytes = 0;
+        for (const ChainSegment &candidate : previous.segments()) {
+            if (candidate.id != segment.id && previous.find(candidate.id) == &candidate) {
+                live.push_back(&candidate);
+                liveBytes += blockBytes(candidate);
+            } else {
+                deadBytes += blockBytes(candidate);
+            }
+        }
+        if (deadBytes > liveBytes) {
+            live.push_back(&segment);
+            uint32_t capacity = kDefaultIndexCapacity;
+            while (capacity < live.size()) capacity *= 2;
+            return rewrite(path, live, capacity);
+        }
+    }
+
+    const int descriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (descriptor < 0) return false;
+    struct stat info {};
+    if (::fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    uint32_t capacity = kDefaultIndexCapacity;
+    uint32_t count = 0;
+    if (info.st_size == 0) {
+        if (!writeEmptyHeader(descriptor, capacity)) {
+            ::close(descriptor);
+            return false;
+        }
+    } else {
+        std::array<uint8_t, kFixedHeaderBytes> header{};
+        if (::pread(descriptor, header.data(), header.size(), 0)
+                        != static_cast<ssize_t>(header.size())
+                || std::memcmp(header.data(), kMagic.data(), kMagic.size()) != 0
+                || readLe(header.data() + 4, 2) != kVersion) {
+            ::close(descriptor);
+            return false;
+        }
+        capacity = static_cast<uint32_t>(readLe(header.data() + 8, 4));
+        count = static_cast<uint32_t>(readLe(header.data() + kCountOffset, 4));
+        if (capacity == 0) {
+            ::close(descriptor);
+            return false;
+        }
+    }
+
+    if (count >= capacity) {
+        ::close(descriptor);
+        std::vector<const ChainSegment *> segments;
+        for (const ChainSegment &stored : previous.segments()) segments.push_back(&stored);
+        segments.push_back(&segment);
+        return previous.isOpen() && rewrite(path, segments, capacity * 2);
+    }
+    // The count is only bumped once block and entry are durable.
+    const bool ok = writeSegment(descriptor, count, segment)
+            && ::fsync(descriptor) == 0
+            && writeCount(descriptor, count + 1)
+            && ::fsync(descriptor) == 0;
+    ::close(descriptor);
+    return ok;
+}
+
+bool ChainContainer::open(const std::string &path) {
+    close();
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return fail("Cannot open file");
+
+    struct stat info {};
+    if (::fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+        ::close(descriptor);
+        return fail("File is empty");
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) return fail("Cannot map file");
+    mMapping = mapping;
+    mMappingBytes = size;
+
+    const auto *bytes = static_cast<const uint8_t *>(mapping);
+    if (size < kFixedHeaderBytes || std::memcmp(bytes, kMagic.data(), kMagic.size()) != 0) {
+        close();
+        return fail("Not a chain container");
+    }
+    if (readLe(bytes + 4, 2) != kVersion) {
+        close();
+        return fail("Unsupported chain container version");
+    }
+    const auto capacity = static_cast<uint32_t>(readLe(bytes + 8, 4));
+    const auto count = static_cast<uint32_t>(readLe(bytes + kCountOffset, 4));
+    if (count > capacity || headerBytes(capacity) > size) {
+        close();
+        return fail("Chain index is truncated");
+    }
+
+    mSegments.reserve(count);
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        const uint8_t *entry = bytes + kFixedHeaderBytes + slot * kEntryBytes;
+        ChainSegment segment;
+        const auto *id = reinterpret_cast<const char *>(entry);
+        segment.id.assign(id, ::strnlen(id, kIdBytes));
+        segment.startFrame = static_cast<int64_t>(readLe(entry + 64, 8));
+        segment.lengthFrames = static_cast<int64_t>(readLe(entry + 72, 8));
+        const uint64_t offset = readLe(entry + 80, 8);
+        segment.fingerprint = readLe(entry + 88, 8);
+        segment.loudness.integratedLufs = readDouble(entry + 96);
+        segment.loudness.truePeakDbtp = readDouble(entry + 104);
+        segment.sampleRate = static_cast<int32_t>(readLe(entry + 112, 4));
+        segment.gain = readFloat(entry + 116);
+        segment.loudness.measured = (readLe(entry + 120, 4) & kFlagLoudnessMeasured) != 0;
+        // Containers written before tracks had channels left the field zero.
+        segment.channelCount = std::max<int32_t>(1, static_cast<int32_t>(readLe(entry + 124, 4)));
+
+        const uint64_t maxFrames =
+                size / sizeof(float) / static_cast<uint64_t>(segment.channelCount);
+        if (segment.id.empty() || segment.id.size() == kIdBytes || segment.sampleRate <= 0
+                || segment.channelCount > kMaxTrackChannelCount || segment.lengthFrames <= 0
+                || static_cast<uint64_t>(segment.lengthFrames) > maxFrames
+                || offset % kBlockAlignment != 0 || offset < headerBytes(capacity)
+                || offset > size - static_cast<uint64_t>(segment.lengthFrames)
+                        * segment.channelCount * sizeof(float)) {
+            close();
+            return fail("Chain segment is out of bounds");
+        }
+        segment.samples = reinterpret_cast<const float *>(bytes + offset);
+        mSegments.push_back(std::move(segment));
+    }
+    mPath = path;
+    mOpen = true;
+    return true;
+}
+
+void ChainContainer::close() noexcept {
+    if (mMapping != nullptr) ::munmap(mMapping, mMappingBytes);
+    mMapping = nullptr;
+    mMappingBytes = 0;
+    mOpen = false;
+    mError = "";
+    mPath.clear();
+    mSegments.clear();
+}
+
+const ChainSegment *ChainContainer::find(const std::string &id) const noexcept {
+    for (auto segment = mSegments.rbegin(); segment != mSegments.rend(); ++segment) {
+        if (segment->id == id) return &*segment;
+    }
+    return nullptr;
+}
+
+bool ChainContainer::fail(const char *error) noexcept {
+    mOpen = false;
+    mError = error;
+    return false;
+}
+
+}  // namespace tapstory
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio/Loudness.h"
+
+namespace tapstory {
+
+struct Track;
+
+/** One index entry of a chain container, with its PCM block resolved. */
+struct ChainSegment {
+    std::string id;
+    int64_t startFrame = 0;
+    int64_t lengthFrames = 0;
+    int32_t sampleRate = 0;
+    int32_t channelCount = 1;
+    LoudnessInfo loudness;
+    float gain = 1.0f;
+    uint64_t fingerprint = 0;
+    /** Interleaved float PCM inside the mapping, `lengthFrames` frames long. */
+    const float *samples = nullptr;
+};
+
+/**
+ * A whole chain in one file, so loading it is a single mapping rather than
+ * opening and decoding a file per segment. Little endian:
+ *
+ *   header  "TSCH", u16 version, u16 reserved, u32 index capacity,
+ *           u32 segment count, then `capacity` 128-byte index entries
+ *   entry   char[64] id (NUL padded), i64 start frame, i64 length frames,
+ *           u64 block offset, u64 fingerprint, f64 integrated LUFS,
+ *           f64 true peak dBTP, u32 sample rate, f32 gain, u32 flags
+ *           (bit 0: loudness measured), u32 channel count (0 reads as 1)
+ *   blocks  each segment's interleaved float32 PCM, starting on a
+ *           kBlockAlignment boundary
+ *
+ * Blocks hold PCM exactly as the mixer reads it and the index carries what
+ * `TrackStore::load` would otherwise measure, so a segment is usable the
+ * moment the file is mapped. `open` copies the index out of the mapping;
+ * `segments` stay valid until `close`.
+ */
+class ChainContainer {
+public:
+    /** 16 KiB pages are the largest that iOS and Android devices map. */
+    static constexpr size_t kBlockAlignment = 16'384;
+    /** Entries that fit the first page after the fixed header. */
+    static constexpr uint32_t kDefaultIndexCapacity = 127;
+    static constexpr size_t kMaxIdBytes = 63;
+
+    ChainContainer() = default;
+    ChainContainer(const ChainContainer &) = delete;
+    ChainContainer &operator=(const ChainContainer &) = delete;
+    ~ChainContainer() { close(); }
+
+    /**
+     * Append `track`, placed on a timeline at `sampleRate`, as a new segment
+     * of the container at `path`, creating the file when missing. The segment
+     * is stored at the track's own rate, its start frame rescaled to it. The
+     * block is written past the current end and its entry before the count is
+     * bumped, so a concurrent reader or a crash mid-append still sees the
+     * previous chain. A full index is rewritten with twice the capacity into a
+     * new file that replaces the old one by rename; mappings of the old file
+     * stay valid.
+     *
+     * A segment whose id is already stored with the same fingerprint is not
+     * written again. One stored under its id with another fingerprint is
+     * superseded: `find` returns the newest entry, and once superseded blocks
+     * outweigh the live ones the live segments are compacted into a new file
+     * the same way. Returns false when the file cannot be written or the id
+     * is longer than kMaxIdBytes.
+     */
+    static bool append(const std::string &path, const Track &track, int32_t sampleRate);
+
+    /** Map and validate `path`; on failure `error` says why. */
+    bool open(const std::string &path);
+    void close() noexcept;
+
+    bool isOpen() const noexcept { return mOpen; }
+    const char *error() const noexcept { return mError; }
+    const std::string &path() const noexcept { return mPath; }
+    const std::vector<ChainSegment> &segments() const noexcept { return mSegments; }
+    /** Last segment stored under `id`, or null. */
+    const ChainSegment *find(const std::string &id) const noexcept;
+
+private:
+    bool fail(const char *error) noexcept;
+
+    void *mMapping = nullptr;
+    size_t mMappingBytes = 0;
+    bool mOpen = false;
+    const char *mError = "";
+    std::string mPath;
+    std::vector<ChainSegment> mSegments;
+};
+
+}  // namespace tapstory
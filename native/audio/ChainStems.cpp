@@ -0,0 +1,129 @@
+#include "audio/ChainStems.h"
+
+#include <algorithm>
+
+#include "audio/MixKernels.h"
+#include "audio/Mixer.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr int64_t kRenderChunkFrames = 1 << 20;
+
+}  // namespace
+
+ChainStems::UpdateResult ChainStems::update(const TrackStore &store) {
+    UpdateResult result;
+    const std::vector<Track> &tracks = store.tracks();
+    const bool multichannel = std::any_of(tracks.begin(), tracks.end(), [](const Track &track) {
+        return track.channelCount != 1;
+    });
+    const int32_t channelCount = multichannel ? 2 : 1;
+    const bool appendedOnly = channelCount == mLanes[0].channelCount
+            && tracks.size() >= mFingerprints.size()
+            && std::equal(
+                    mFingerprints.begin(),
+                    mFingerprints.end(),
+                    tracks.begin(),
+                    [](uint64_t fingerprint, const Track &track) {
+                        return fingerprint == track.fingerprint;
+                    });
+    if (!appendedOnly) {
+        clear();
+        for (Lane &lane : mLanes) lane.channelCount = channelCount;
+        result.rebuilt = true;
+    }
+    for (size_t index = mFingerprints.size(); index < tracks.size(); ++index) {
+        render(tracks[index], mLanes[index % kLaneCount]);
+        mFingerprints.push_back(tracks[index].fingerprint);
+        ++result.renderedTracks;
+    }
+    return result;
+}
+
+void ChainStems::clear() noexcept {
+    for (Lane &lane : mLanes) {
+        lane.startFrame = 0;
+        lane.channelCount = 1;
+        std::vector<float>().swap(lane.samples);
+    }
+    mFingerprints.clear();
+}
+
+// Tracks arrive in timeline order, so a lane only ever grows at its end.
+void ChainStems::render(const Track &track, Lane &lane) {
+    const float *samples = track.pcm();
+    if (samples == nullptr || track.timelineFrames <= 0) return;
+    if (lane.samples.empty()) lane.startFrame = track.startFrame;
+    const int64_t endFrame = std::max(lane.endFrame(), track.endFrame());
+    lane.samples.resize(
+            static_cast<size_t>(endFrame - lane.startFrame) * lane.channelCount,
+            0.0f);
+
+    float *destination = lane.samples.data()
+            + static_cast<size_t>(track.startFrame - lane.startFrame) * lane.channelCount;
+    const float gain = track.gain;
+    if (track.resampler) {
+        // Rendered through the same kernel the mixer would use.
+        for (int64_t first = 0; first < track.timelineFrames; first += kRenderChunkFrames) {
+            const auto frames = static_cast<int32_t>(
+                    std::min<int64_t>(kRenderChunkFrames, track.timelineFrames - first));
+            float *chunk = destination + first * lane.channelCount;
+            if (lane.channelCount == 1) {
+                track.resampler->addMono(samples, track.lengthFrames, first, chunk, frames, gain);
+            } else {
+                track.resampler->addToStereo(
+                        samples,
+                        track.channelCount,
+                        track.lengthFrames,
+                        first,
+                        chunk,
+                        frames,
+                        gain);
+            }
+        }
+        return;
+    }
+    if (lane.channelCount == 1) {
+        for (int64_t frame = 0; frame < track.lengthFrames; ++frame) {
+            destination[frame] += samples[frame] * gain;
+        }
+        return;
+    }
+    // Stereo lanes fold each track exactly as the mixer does.
+    for (int64_t first = 0; first < track.lengthFrames; first += kRenderChunkFrames) {
+        const auto frames = static_cast<int32_t>(
+                std::min<int64_t>(kRenderChunkFrames, track.lengthFrames - first));
+        addFramesToStereo(
+                samples,
+                track.channelCount,
+                track.lengthFrames,
+                first,
+                destination + first * kMixOutputChannelCount,
+                frames,
+                gain);
+    }
+}
+
+void mixStems(
+        const ChainStems &stems,
+        int64_t timelineFrame,
+        float *stereoOutput,
+        int32_t frameCount) noexcept {
+    if (stereoOutput == nullptr || frameCount <= 0) return;
+    const size_t sampleCount = static_cast<size_t>(frameCount) * kMixOutputChannelCount;
+    std::fill_n(stereoOutput, sampleCount, 0.0f);
+    for (const ChainStems::Lane &lane : stems.lanes()) {
+        addFramesToStereo(
+                lane.samples.data(),
+                lane.channelCount,
+                lane.frameCount(),
+                timelineFrame - lane.startFrame,
+                stereoOutput,
+                frameCount);
+    }
+    clampSamples(stereoOutput, sampleCount);
+}
+
+}  // namespace tapstory
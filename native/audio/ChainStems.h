@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "audio/TrackStore.h"
+
+namespace tapstory {
+
+/**
+ * A chain pre-mixed into two contiguous lanes, so a callback mixes two
+ * buffers however many segments are loaded. Lanes are at the timeline's rate,
+ * mono while every track is and interleaved stereo once any track has more
+ * channels. Track i in timeline order goes to lane i % 2. That assumes turns
+ * alternate between partners; no partner data is consulted, so a partner who
+ * takes two turns in a row lands in both lanes. Tracks are summed into their
+ * lane with their gain, as `mixTracks` scales them, and left unclamped;
+ * `mixStems` adds the lanes and clamps. Where at most one track per lane
+ * overlaps a frame, which is the duet case, the result equals `mixTracks` bit
+ * for bit.
+ *
+ * Lanes are addressed by timeline frame: each runs from its first track's
+ * start to its last track's end and holds silence through the other lane's
+ * turns. Both lanes therefore span about the whole chain, and each costs
+ * chain frames x lane channels floats: a 10-minute stereo chain at 48kHz
+ * takes about 230MB per lane, 460MB for both, twice the loaded PCM of its
+ * non-overlapping turns and more when mono turns are widened to stereo. The
+ * mode trades that memory for a callback cost that does not grow with the
+ * chain.
+ */
+class ChainStems {
+public:
+    static constexpr size_t kLaneCount = 2;
+
+    struct Lane {
+        int64_t startFrame = 0;
+        int32_t channelCount = 1;
+        std::vector<float> samples;
+
+        int64_t frameCount() const noexcept {
+            return static_cast<int64_t>(samples.size()) / channelCount;
+        }
+        int64_t endFrame() const noexcept { return startFrame + frameCount(); }
+    };
+
+    struct UpdateResult {
+        size_t renderedTracks = 0;
+        /** True when the lanes were cleared and rendered from scratch. */
+        bool rebuilt = false;
+    };
+
+    /**
+     * Bring the lanes up to date with `store`. Tracks are identified by
+     * fingerprint; when the store only gained tracks after the ones already
+     * rendered, just those are summed onto the end of their lanes, otherwise
+     * every lane is rebuilt, as it is when the first multichannel track turns
+     * the lanes stereo. Control thread only, while no callback reads the
+     * stems.
+     */
+    UpdateResult update(const TrackStore &store);
+    /** Drop the lanes and their memory. */
+    void clear() noexcept;
+
+    const std::array<Lane, kLaneCount> &lanes() const noexcept { return mLanes; }
+    size_t trackCount() const noexcept { return mFingerprints.size(); }
+
+private:
+    void render(const Track &track, Lane &lane);
+
+    std::array<Lane, kLaneCount> mLanes;
+    /** Fingerprints of the rendered tracks, in timeline order. */
+    std::vector<uint64_t> mFingerprints;
+};
+
+/**
+ * Render timeline frames [timelineFrame, timelineFrame + frameCount) of both
+ * lanes into interleaved stereo, overwriting `stereoOutput` and clamping like
+ * `mixTracks`. Realtime safe: no allocation, locking, or I/O.
+ */
+void mixStems(
+        const ChainStems &stems,
+        int64_t timelineFrame,
+        float *stereoOutput,
+        int32_t frameCount) noexcept;
+
+}  // namespace tapstory
@@ -0,0 +1,758 @@
+#include "audio/DuplexCore.h"
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "audio/MixKernels.h"
+#include "audio/PcmConversion.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr auto kCaptureStopTimeout = std::chrono::milliseconds(500);
+constexpr float kHalfPi = 1.57079632679f;
+
+int64_t steadyNanos() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class CallbackActivityGuard {
+public:
+    explicit CallbackActivityGuard(std::atomic<uint32_t> &counter) noexcept
+        : mCounter(counter) {
+        // Sequentially consistent with the park flag: see parkTransport.
+        mCounter.fetch_add(1, std::memory_order_seq_cst);
+    }
+    ~CallbackActivityGuard() { mCounter.fetch_sub(1, std::memory_order_acq_rel); }
+
+private:
+    std::atomic<uint32_t> &mCounter;
+};
+
+}  // namespace
+
+DuplexCore::~DuplexCore() {
+    abortCapture();
+    waitForCallbacks();
+    mWriter.stop();
+}
+
+void DuplexCore::setStemMixing(bool enabled) {
+    mStemMixing = enabled;
+    if (enabled) {
+        mStems.update(mTracks);
+    } else {
+        mStems.clear();
+    }
+}
+
+ChainStems::UpdateResult DuplexCore::refreshStems() {
+    return mStemMixing ? mStems.update(mTracks) : ChainStems::UpdateResult{};
+}
+
+void DuplexCore::prepareCapture(
+        size_t ringFrames,
+        int32_t sampleRate,
+        int32_t inputChannelCount) {
+    if (isCaptureArmed() || mWriter.isActive()) return;
+    mWriter.prepare(ringFrames, sampleRate, inputChannelCount);
+}
+
+void DuplexCore::allocateCaptureBuffers() {
+    if (isCaptureArmed() || mWriter.isActive()) return;
+    mWriter.allocateBuffers();
+}
+
+bool DuplexCore::armCapture(
+        const std::string &filePath,
+        int64_t requestedPunchFrame,
+        int64_t compensationFrames,
+        int64_t requestedPunchOutFrame,
+        const std::string &lanePathPrefix) {
+    if (!mWriter.isPrepared() || isCaptureArmed() || mWriter.isActive()) return false;
+    if (playbackSpeed() != kPlaybackSpeedScale) return false;
+
+    const int64_t requested = std::max<int64_t>(0, requestedPunchFrame);
+    const int64_t compensation = std::max<int64_t>(0, compensationFrames);
+    // A loop pass must outlast the input delay, or no input reaches the take.
+    const LoopRegion loop = loopRegion();
+    if (loop.active() && loop.endFrame - loop.startFrame <= compensation) return false;
+    const bool hasPunchOut = requestedPunchOutFrame != kUnsetFrame;
+    if (hasPunchOut && requestedPunchOutFrame <= requested) return false;
+    mRequestedPunchFrame.store(requested, std::memory_order_release);
+    mCompensationFrames.store(compensation, std::memory_order_release);
+    mGateFrame.store(compensatedPunchFrame(requested, compensation), std::memory_order_release);
+    mPunchOutFrame.store(
+            hasPunchOut ? compensatedPunchFrame(requestedPunchOutFrame, compensation) : kUnsetFrame,
+            std::memory_order_release);
+    mActualStartFrame.store(kUnsetFrame, std::memory_order_release);
+    mEndFrame.store(kUnsetFrame, std::memory_order_release);
+    mDroppedFrames.store(0, std::memory_order_release);
+    mCapturedFrames.store(0, std::memory_order_release);
+    mShortInputFrames.store(0, std::memory_order_release);
+    mCaptureStopRequested.store(false, std::memory_order_release);
+    mScheduledStopFrame.store(kUnsetFrame, std::memory_order_release);
+
+    CaptureStartedHandler handler = mCaptureStartedHandler;
+    auto notifyStarted = [this, handler = std::move(handler), notified = false]() mutable {
+        if (notified || !handler) return;
+        const int64_t startFrame = actualCaptureStartFrame();
+        if (startFrame < 0) return;
+        notified = true;
+        handler(startFrame);
+    };
+    if (!mWriter.start(filePath, std::move(notifyStarted), lanePathPrefix)) return false;
+
+    mStartState.store(CaptureStartState::Pending, std::memory_order_release);
+    mCaptureArmed.store(true, std::memory_order_release);
+    return true;
+}
+
+void DuplexCore::cancelPendingStart() noexcept {
+    // The callback claims Pending -> Started at the punch boundary. Winning this
+    // exchange first guarantees no raced callback publishes a start afterward.
+    CaptureStartState pending = CaptureStartState::Pending;
+    mStartState.compare_exchange_strong(
+            pending,
+            CaptureStartState::Cancelled,
+            std::memory_order_acq_rel,
+            std::memory_order_acquire);
+}
+
+bool DuplexCore::beginTransportStop() noexcept {
+    cancelPendingStart();
+    const bool shouldDrainTail = isCaptureArmed()
+            && mStartState.load(std::memory_order_acquire) == CaptureStartState::Started
+            && !mCaptureStopRequested.load(std::memory_order_acquire)
+            && mCompensationFrames.load(std::memory_order_acquire) > 0;
+    if (!shouldDrainTail) return false;
+
+    // The first muted callback fixes the tail end, so its frame is the stop
+    // boundary regardless of how long the control thread took to get here.
+    mTailStopFrame.store(kPendingStopFrame, std::memory_order_release);
+    mOutputMuted.store(true, std::memory_order_release);
+    return true;
+}
+
+void DuplexCore::onTransportStopped() noexcept {
+    cancelPendingStart();
+    if (isCaptureArmed()) finishCaptureAt(captureFrameFor(currentFrame()));
+    // Callbacks are quiet, so a seek none of them applied lands here, where
+    // playheadFrame already reported it.
+    const int64_t seekFrame = mPendingSeekFrame.exchange(kUnsetFrame, std::memory_order_acq_rel);
+    if (seekFrame != kUnsetFrame) seek(seekFrame);
+    mCaptureLagFrames = 0;
+    mOutputMuted.store(false, std::memory_order_release);
+    mTailStopFrame.store(kUnsetFrame, std::memory_order_release);
+}
+
+void DuplexCore::requestCaptureStop() noexcept {
+    if (isCaptureArmed()) mCaptureStopRequested.store(true, std::memory_order_release);
+}
+
+bool DuplexCore::scheduleCaptureStop(int64_t requestedStopFrame) noexcept {
+    if (!isCaptureArmed() || requestedStopFrame <= requestedPunchFrame()) return false;
+    mScheduledStopFrame.store(
+            compensatedPunchFrame(requestedStopFrame, captureCompensationFrames()),
+            std::memory_order_release);
+    return true;
+}
+
+bool DuplexCore::finishCapture(bool callbacksRunning) {
+    cancelPendingStart();
+    if (!isCaptureArmed() && !mWriter.isActive()) return false;
+
+    if (isCaptureArmed()) {
+        requestCaptureStop();
+        if (callbacksRunning) {
+            // If the device stops delivering callbacks, fall back to the last
+            // completed frame below.
+            const auto deadline = std::chrono::steady_clock::now() + kCaptureStopTimeout;
+            while (isCaptureArmed() && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        if (isCaptureArmed()) finishCaptureAt(currentFrame());
+    }
+
+    waitForCallbacks();
+    mWriter.stop();
+    return true;
+}
+
+bool DuplexCore::abortCapture() noexcept {
+    cancelPendingStart();
+    const bool wasArmed = mCaptureArmed.exchange(false, std::memory_order_acq_rel);
+    if (wasArmed) {
+        mEndFrame.store(currentFrame(), std::memory_order_release);
+        mCaptureStopRequested.store(false, std::memory_order_release);
+    }
+    return wasArmed || mWriter.isActive();
+}
+
+void DuplexCore::waitForCallbacks() const noexcept {
+    while (mCallbackActivity.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+DuplexCore::TakeOnsetEnvelopes DuplexCore::takeOnsetEnvelopes() const {
+    TakeOnsetEnvelopes envelopes;
+    const int64_t startFrame = actualCaptureStartFrame();
+    const OnsetEnvelope &takeEnvelope = mWriter.onsetEnvelope();
+    if (isCaptureArmed() || mWriter.isActive() || startFrame < 0
+            || takeEnvelope.blockFrames() <= 0) {
+        return envelopes;
+    }
+
+    const int64_t endFrame = captureEndFrame();
+    envelopes.blockFrames = takeEnvelope.blockFrames();
+    envelopes.startFrame = startFrame;
+    envelopes.take = takeEnvelope.values();
+    envelopes.mix = computeMixOnsetEnvelope(
+            mTracks,
+            startFrame,
+            endFrame > startFrame
+                    ? endFrame
+                    : startFrame + static_cast<int64_t>(envelopes.take.size())
+                            * envelopes.blockFrames,
+            envelopes.blockFrames);
+    return envelopes;
+}
+
+std::vector<DuplexCore::LoopTakeLane> DuplexCore::loopTakeLanes() const {
+    std::vector<LoopTakeLane> lanes;
+    const int64_t startFrame = actualCaptureStartFrame();
+    if (!mWriter.writesLanes() || isCaptureArmed() || mWriter.isActive() || startFrame < 0) {
+        return lanes;
+    }
+
+    // Capture frames run the compensation ahead of the timeline frames whose
+    // input they carry.
+    const int64_t compensation = captureCompensationFrames();
+    const size_t splitCount = mWriter.laneSplitCount();
+    int64_t passStart = startFrame;
+    int64_t rawStart = 0;
+    for (size_t index = 0; index <= splitCount; ++index) {
+        const bool last = index == splitCount;
+        const int64_t passEnd = last ? captureEndFrame() : mWriter.laneSplit(index).endFrame;
+        const int64_t rawEnd = last ? recordedFrameCount() : mWriter.laneSplit(index).rawFrame;
+        if (rawEnd > rawStart) {
+            LoopTakeLane lane;
+            lane.passIndex = static_cast<int32_t>(index);
+            lane.path = mWriter.lanePath(index);
+            lane.startFrame = passStart - compensation;
+            lane.endFrame = passEnd - compensation;
+            lane.rawFrameCount = rawEnd - rawStart;
+            lane.driftFrames = lane.rawFrameCount - (passEnd - passStart);
+            lanes.push_back(std::move(lane));
+        }
+        if (last) break;
+        passStart = mWriter.laneSplit(index).nextStartFrame;
+        rawStart = rawEnd;
+    }
+    return lanes;
+}
+
+int64_t DuplexCore::captureTimelineFrameCount() const {
+    if (mWriter.writesLanes()) {
+        int64_t frames = 0;
+        for (const LoopTakeLane &lane : loopTakeLanes()) frames += lane.endFrame - lane.startFrame;
+        return frames;
+    }
+    const int64_t startFrame = actualCaptureStartFrame();
+    const int64_t endFrame = captureEndFrame();
+    return startFrame >= 0 && endFrame > startFrame ? endFrame - startFrame : 0;
+}
+
+bool DuplexCore::beginCalibration(int32_t sampleRate) {
+    if (sampleRate <= 0 || isCalibrating() || isCaptureArmed() || mWriter.isActive()) return false;
+    mCalibration.prepare(sampleRate);
+    mCalibrating.store(true, std::memory_order_release);
+    return true;
+}
+
+LoopbackCalibration::Result DuplexCore::finishCalibration() {
+    if (!mCalibrating.exchange(false, std::memory_order_acq_rel)) return {};
+    waitForCallbacks();
+    return mCalibration.analyze();
+}
+
+void DuplexCore::resumeTransport() noexcept {
+    mTransportRequestedNanos.store(steadyNanos(), std::memory_order_relaxed);
+    mTransportStartedNanos.store(-1, std::memory_order_relaxed);
+    mTransportParked.store(false, std::memory_order_release);
+}
+
+int64_t DuplexCore::transportStartDelayNanos() const noexcept {
+    const int64_t started = mTransportStartedNanos.load(std::memory_order_acquire);
+    if (started < 0) return -1;
+    return started - mTransportRequestedNanos.load(std::memory_order_relaxed);
+}
+
+void DuplexCore::seek(int64_t frame) noexcept {
+    mPendingSeekFrame.store(kUnsetFrame, std::memory_order_release);
+    mJumpFadeRemaining = 0;
+    mCaptureLagFrames = 0;
+    mSpeedRemainder = 0;
+    mCurrentFrame.store(std::max<int64_t>(0, frame), std::memory_order_release);
+}
+
+bool DuplexCore::requestSeek(int64_t frame) noexcept {
+    if (isCaptureArmed()) return false;
+    mPendingSeekFrame.store(std::max<int64_t>(0, frame), std::memory_order_release);
+    return true;
+}
+
+bool DuplexCore::setPlaybackSpeed(int32_t speed) noexcept {
+    if (speed < kMinPlaybackSpeed || speed > kPlaybackSpeedScale) return false;
+    if (isCaptureArmed() && speed != kPlaybackSpeedScale) return false;
+    mPlaybackSpeed.store(speed, std::memory_order_release);
+    return true;
+}
+
+bool DuplexCore::setLoopRegion(
+        int64_t startFrame,
+        int64_t endFrame,
+        int32_t crossfadeFrames) noexcept {
+    LoopRegion region;
+    region.startFrame = std::max<int64_t>(0, startFrame);
+    region.endFrame = endFrame;
+    region.crossfadeFrames = std::clamp(crossfadeFrames, 0, kMaxLoopCrossfadeFrames);
+    const int64_t length = region.endFrame - region.startFrame;
+    if (length <= region.crossfadeFrames) return false;
+    if (isCaptureArmed() && length <= captureCompensationFrames()) return false;
+    publishLoopRegion(region);
+    return true;
+}
+
+DuplexCore::LoopRegion DuplexCore::loopRegion() const noexcept {
+    LoopRegion region;
+    region.startFrame = mLoopStartFrame.load(std::memory_order_acquire);
+    region.endFrame = mLoopEndFrame.load(std::memory_order_acquire);
+    region.crossfadeFrames = mLoopCrossfadeFrames.load(std::memory_order_acquire);
+    return region;
+}
+
+void DuplexCore::publishLoopRegion(const LoopRegion &region) noexcept {
+    // Sequence lock: odd while the fields change, so the callback only ever
+    // adopts a region whose three fields belong together.
+    const uint32_t sequence = mLoopSequence.load(std::memory_order_relaxed);
+    mLoopSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mLoopStartFrame.store(region.startFrame, std::memory_order_relaxed);
+    mLoopEndFrame.store(region.endFrame, std::memory_order_relaxed);
+    mLoopCrossfadeFrames.store(region.crossfadeFrames, std::memory_order_relaxed);
+    mLoopSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void DuplexCore::refreshLoopRegion() noexcept {
+    const uint32_t sequence = mLoopSequence.load(std::memory_order_acquire);
+    if ((sequence & 1) != 0 || sequence == mActiveLoopSequence) return;
+    LoopRegion region;
+    region.startFrame = mLoopStartFrame.load(std::memory_order_relaxed);
+    region.endFrame = mLoopEndFrame.load(std::memory_order_relaxed);
+    region.crossfadeFrames = mLoopCrossfadeFrames.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // A write in progress is picked up by a later callback instead.
+    if (mLoopSequence.load(std::memory_order_relaxed) != sequence) return;
+    mActiveLoop = region;
+    mActiveLoopSequence = sequence;
+}
+
+void DuplexCore::mixPlayback(int64_t frame, float *stereoOutput, int32_t frames) noexcept {
+    if (mStemMixing) {
+        mixStems(mStems, frame, stereoOutput, frames);
+    } else {
+        mixTracks(mTracks, frame, stereoOutput, frames);
+    }
+}
+
+void DuplexCore::mixLoopedPlayback(
+        int64_t frame,
+        float *stereoOutput,
+        int32_t frames,
+        bool wrapBefore) noexcept {
+    const int64_t start = mActiveLoop.startFrame;
+    const int64_t end = mActiveLoop.endFrame;
+    const int64_t length = end - start;
+    int32_t done = 0;
+    while (done < frames) {
+        int64_t source = frame + done;
+        if (source >= end) {
+            source = start + (source - start) % length;
+        } else if (wrapBefore && source < start) {
+            source = end - 1 - (start - 1 - source) % length;
+        }
+        // Up to the loop end, or up to its start when reading plainly before it.
+        const int64_t limit = source < start ? start : end;
+        const auto count = static_cast<int32_t>(std::min<int64_t>(frames - done, limit - source));
+        mixPlayback(source, stereoOutput + static_cast<size_t>(done) * kOutputChannelCount, count);
+        done += count;
+    }
+}
+
+void DuplexCore::startJumpFade(int64_t originFrame, int32_t fadeFrames) noexcept {
+    mJumpOriginFrame = originFrame;
+    mJumpFadeFrames = fadeFrames;
+    mJumpFadeRemaining = fadeFrames;
+}
+
+void DuplexCore::crossfadeFromJumpOrigin(float *stereoOutput, int32_t frames) noexcept {
+    const int32_t fadeFrames = std::min(frames, mJumpFadeRemaining);
+    int32_t done = 0;
+    while (stereoOutput != nullptr && done < fadeFrames) {
+        const int32_t chunk = std::min(fadeFrames - done, kSeekCrossfadeFrames);
+        float *origin = mJumpFadeScratch.data();
+        float *output = stereoOutput + static_cast<size_t>(done) * kOutputChannelCount;
+        mixPlayback(mJumpOriginFrame + done, origin, chunk);
+        const int32_t faded = mJumpFadeFrames - mJumpFadeRemaining + done;
+        for (int32_t frame = 0; frame < chunk; ++frame) {
+            // Equal power: the two positions are uncorrelated audio.
+            const float angle = kHalfPi * static_cast<float>(faded + frame + 1)
+                    / static_cast<float>(mJumpFadeFrames + 1);
+            const float fadeIn = std::sin(angle);
+            const float fadeOut = std::cos(angle);
+            for (int32_t channel = 0; channel < kOutputChannelCount; ++channel) {
+                float &sample = output[frame * kOutputChannelCount + channel];
+                sample = sample * fadeIn + origin[frame * kOutputChannelCount + channel] * fadeOut;
+            }
+        }
+        clampSamples(output, static_cast<size_t>(chunk) * kOutputChannelCount);
+        done += chunk;
+    }
+    mJumpOriginFrame += fadeFrames;
+    mJumpFadeRemaining -= fadeFrames;
+}
+
+void DuplexCore::finishCaptureAt(int64_t endFrame) noexcept {
+    mEndFrame.store(endFrame, std::memory_order_release);
+    mCaptureArmed.store(false, std::memory_order_release);
+    mCaptureStopRequested.store(false, std::memory_order_release);
+}
+
+void DuplexCore::claimScheduledStop(int64_t captureFrame) noexcept {
+    const int64_t stopFrame = mScheduledStopFrame.exchange(kUnsetFrame, std::memory_order_acq_rel);
+    if (stopFrame == kUnsetFrame || !isCaptureArmed()) return;
+    if (stopFrame <= captureFrame && !mActiveLoop.active()) {
+        finishCaptureAt(captureFrame);
+        return;
+    }
+    // From here on the stop is an ordinary punch-out, which the runs split at.
+    const int64_t punchOutFrame = mPunchOutFrame.load(std::memory_order_relaxed);
+    if (punchOutFrame == kUnsetFrame || stopFrame < punchOutFrame) {
+        mPunchOutFrame.store(stopFrame, std::memory_order_release);
+    }
+}
+
+void DuplexCore::endLoopedTake(int64_t captureEndFrame, int64_t nextPassFrame) noexcept {
+    // A take is one pass: it ends where its input reaches the loop end. A
+    // pending punch stays armed for the next pass. A take recorded as lanes
+    // runs on and only marks where the pass ended.
+    if (!isCaptureArmed()
+            || mStartState.load(std::memory_order_acquire) != CaptureStartState::Started) {
+        return;
+    }
+    const CaptureWriter::LaneSplit split{
+        mCapturedFrames.load(std::memory_order_relaxed),
+        captureEndFrame,
+        nextPassFrame,
+    };
+    if (!mWriter.splitLane(split)) finishCaptureAt(captureEndFrame);
+}
+
+void DuplexCore::process(
+        const float *input,
+        int32_t inputFrames,
+        float *stereoOutput,
+        int32_t outputFrames) noexcept {
+    CallbackActivityGuard activity(mCallbackActivity);
+    if (mTransportParked.load(std::memory_order_seq_cst)) {
+        if (stereoOutput != nullptr) {
+            std::fill_n(stereoOutput, static_cast<size_t>(std::max(0, outputFrames))
+                    * kOutputChannelCount, 0.0f);
+        }
+        return;
+    }
+    if (mTransportStartedNanos.load(std::memory_order_relaxed) < 0) {
+        mTransportStartedNanos.store(steadyNanos(), std::memory_order_release);
+    }
+    if (mCalibrating.load(std::memory_order_acquire)) {
+        mCalibration.process(
+                input, inputFrames, stereoOutput, outputFrames, inputChannelCount());
+        return;
+    }
+
+    int64_t callbackFrame = mCurrentFrame.load(std::memory_order_relaxed);
+    const int32_t frames = std::max(0, outputFrames);
+    const int32_t availableInputFrames = input == nullptr ? 0 : std::max(0, inputFrames);
+    const bool muted = mOutputMuted.load(std::memory_order_acquire);
+    refreshLoopRegion();
+
+    // Seeks land on a callback boundary, so capture and the timeline never
+    // see a jump inside one callback. A draining tail keeps the seek pending
+    // for onTransportStopped. A take armed since the request has captured
+    // nothing yet, so it starts from the seek target the playhead reported.
+    const int64_t seekFrame = muted
+            ? kUnsetFrame
+            : mPendingSeekFrame.exchange(kUnsetFrame, std::memory_order_acq_rel);
+    if (seekFrame != kUnsetFrame && seekFrame != callbackFrame) {
+        startJumpFade(callbackFrame, kSeekCrossfadeFrames);
+        mCaptureLagFrames = 0;
+        mSpeedRemainder = 0;
+        callbackFrame = seekFrame;
+    }
+
+    if (isCaptureArmed()
+            && (mCaptureStopRequested.load(std::memory_order_acquire) || mWriter.failed())) {
+        finishCaptureAt(captureFrameFor(callbackFrame));
+    }
+    claimScheduledStop(captureFrameFor(callbackFrame));
+
+    // Takes only arm at the nominal speed, so a practice speed never meets capture.
+    const int32_t speed = mPlaybackSpeed.load(std::memory_order_acquire);
+    if (speed == kPlaybackSpeedScale) mSpeedRemainder = 0;
+    int64_t nextFrame = 0;
+    if (muted) {
+        nextFrame = drainTail(input, availableInputFrames, callbackFrame, stereoOutput, frames);
+    } else if (speed != kPlaybackSpeedScale) {
+        nextFrame = playAtSpeed(callbackFrame, stereoOutput, frames, speed);
+    } else {
+        nextFrame = playRuns(input, availableInputFrames, callbackFrame, stereoOutput, frames);
+    }
+    mCurrentFrame.store(nextFrame, std::memory_order_release);
+}
+
+int64_t DuplexCore::playRuns(
+        const float *input,
+        int32_t availableInputFrames,
+        int64_t frame,
+        float *stereoOutput,
+        int32_t frames) noexcept {
+    // Runs end where the output wraps, where the delayed input catches up and
+    // at the punch-out, so every run maps to one contiguous stretch of each
+    // timeline.
+    const int64_t punchOutFrame = mPunchOutFrame.load(std::memory_order_acquire);
+    int32_t offset = 0;
+    while (offset < frames) {
+        int32_t run = frames - offset;
+        if (mActiveLoop.active() && frame < mActiveLoop.endFrame) {
+            run = static_cast<int32_t>(std::min<int64_t>(run, mActiveLoop.endFrame - frame));
+        }
+        if (mCaptureLagFrames > 0) {
+            run = static_cast<int32_t>(std::min<int64_t>(run, mCaptureLagFrames));
+        }
+        const int64_t captureFrame = captureFrameFor(frame);
+        const bool punchOutAhead = isCaptureArmed() && punchOutFrame > captureFrame;
+        if (punchOutAhead) {
+            run = static_cast<int32_t>(std::min<int64_t>(run, punchOutFrame - captureFrame));
+        }
+
+        float *output = stereoOutput == nullptr
+                ? nullptr
+                : stereoOutput + static_cast<size_t>(offset) * kOutputChannelCount;
+        mixPlayback(frame, output, run);
+        if (mJumpFadeRemaining > 0) crossfadeFromJumpOrigin(output, run);
+
+        if (isCaptureArmed()) {
+            captureSlice(
+                    input == nullptr
+                            ? nullptr
+                            : input + static_cast<size_t>(offset) * inputChannelCount(),
+                    std::clamp(availableInputFrames - offset, 0, run),
+                    captureFrame,
+                    run);
+            if (punchOutAhead && captureFrame + run == punchOutFrame) {
+                finishCaptureAt(punchOutFrame);
+            }
+        }
+        frame += run;
+        offset += run;
+
+        if (mCaptureLagFrames > 0) {
+            mCaptureLagFrames -= run;
+            if (mCaptureLagFrames == 0) endLoopedTake(captureFrame + run, frame);
+        }
+        if (mActiveLoop.active() && frame == mActiveLoop.endFrame) {
+            // Input lags output by the compensation, so it keeps following
+            // the pass that just ended until it reaches the loop end too.
+            const int64_t compensation = captureCompensationFrames();
+            if (isCaptureArmed() && compensation > 0) {
+                mCaptureLagFrames = compensation;
+                mCaptureLead = mActiveLoop.endFrame - mActiveLoop.startFrame;
+            } else {
+                endLoopedTake(frame, mActiveLoop.startFrame);
+            }
+            if (mActiveLoop.crossfadeFrames > 0) {
+                startJumpFade(frame, mActiveLoop.crossfadeFrames);
+            }
+            frame = mActiveLoop.startFrame;
+        }
+    }
+    return frame;
+}
+
+int64_t DuplexCore::playAtSpeed(
+        int64_t frame,
+        float *stereoOutput,
+        int32_t frames,
+        int32_t speed) noexcept {
+    // The playhead is at frame + mSpeedRemainder / kPlaybackSpeedScale, and
+    // each output frame moves it speed / kPlaybackSpeedScale further. Slices
+    // end where it reaches the loop end, as runs do at the nominal rate.
+    constexpr int32_t kHalfTaps = PolyphaseResampler::kTaps / 2;
+    int32_t offset = 0;
+    while (offset < frames) {
+        int32_t run = std::min(frames - offset, kVarispeedSliceFrames);
+        const bool loopAhead = mActiveLoop.active() && frame < mActiveLoop.endFrame;
+        if (loopAhead) {
+            const int64_t untilEnd =
+                    (mActiveLoop.endFrame - frame) * kPlaybackSpeedScale - mSpeedRemainder;
+            run = static_cast<int32_t>(std::min<int64_t>(run, (untilEnd + speed - 1) / speed));
+        }
+
+        float *output = stereoOutput == nullptr
+                ? nullptr
+                : stereoOutput + static_cast<size_t>(offset) * kOutputChannelCount;
+        if (output != nullptr) {
+            // The timeline span the slice reads, with the kernel's taps either
+            // side. Inside a loop the taps wrap with the playhead, so no audio
+            // from outside the region bleeds into either side of a wrap.
+            const int64_t lastFrame =
+                    (mSpeedRemainder + static_cast<int64_t>(run - 1) * speed) / kPlaybackSpeedScale;
+            const auto span = static_cast<int32_t>(lastFrame) + PolyphaseResampler::kTaps + 1;
+            float *timeline = mVarispeedScratch.data();
+            if (loopAhead) {
+                mixLoopedPlayback(
+                        frame - kHalfTaps, timeline, span, frame >= mActiveLoop.startFrame);
+            } else {
+                mixPlayback(frame - kHalfTaps, timeline, span);
+            }
+            std::fill_n(output, static_cast<size_t>(run) * kOutputChannelCount, 0.0f);
+            mVarispeed.addStereoAt(
+                    timeline,
+                    span,
+                    kHalfTaps,
+                    mSpeedRemainder,
+                    speed,
+                    kPlaybackSpeedScale,
+                    output,
+                    run);
+            clampSamples(output, static_cast<size_t>(run) * kOutputChannelCount);
+        }
+        // The old position fades out at the nominal rate; it lasts milliseconds.
+        if (mJumpFadeRemaining > 0) crossfadeFromJumpOrigin(output, run);
+
+        const int64_t advanced = mSpeedRemainder + static_cast<int64_t>(run) * speed;
+        frame += advanced / kPlaybackSpeedScale;
+        mSpeedRemainder = advanced % kPlaybackSpeedScale;
+        offset += run;
+        // Speeds never pass one timeline frame per output frame, so the slice
+        // stops right at the loop end and the wrap keeps the fraction.
+        if (loopAhead && frame >= mActiveLoop.endFrame) {
+            if (mActiveLoop.crossfadeFrames > 0) {
+                startJumpFade(frame, mActiveLoop.crossfadeFrames);
+            }
+            frame -= mActiveLoop.endFrame - mActiveLoop.startFrame;
+        }
+    }
+    return frame;
+}
+
+int64_t DuplexCore::drainTail(
+        const float *input,
+        int32_t availableInputFrames,
+        int64_t frame,
+        float *stereoOutput,
+        int32_t frames) noexcept {
+    if (stereoOutput != nullptr) {
+        std::fill_n(stereoOutput, static_cast<size_t>(frames) * kOutputChannelCount, 0.0f);
+    }
+    mJumpFadeRemaining = 0;
+
+    const int64_t captureFrame = captureFrameFor(frame);
+    int64_t tailStopFrame = mTailStopFrame.load(std::memory_order_acquire);
+    if (tailStopFrame == kPendingStopFrame) {
+        tailStopFrame = compensatedPunchFrame(captureFrame, captureCompensationFrames());
+        // Input still finishing a loop pass reaches the loop end first.
+        if (mCaptureLagFrames > 0) {
+            tailStopFrame = std::min(tailStopFrame, captureFrame + mCaptureLagFrames);
+        }
+        const int64_t punchOutFrame = mPunchOutFrame.load(std::memory_order_acquire);
+        if (punchOutFrame != kUnsetFrame) tailStopFrame = std::min(tailStopFrame, punchOutFrame);
+        mTailStopFrame.store(tailStopFrame, std::memory_order_release);
+    }
+    // Advance only by delivered input so the take ends exactly at S + C.
+    const int32_t timelineFrames = computeTailDrainSlice(
+            tailStopFrame - captureFrame,
+            availableInputFrames).timelineFrames;
+    if (isCaptureArmed()) {
+        captureSlice(input, availableInputFrames, captureFrame, timelineFrames);
+    }
+    mCaptureLagFrames = std::max<int64_t>(0, mCaptureLagFrames - timelineFrames);
+    if (captureFrame + timelineFrames >= tailStopFrame && isCaptureArmed()) {
+        finishCaptureAt(tailStopFrame);
+    }
+    return frame + timelineFrames;
+}
+
+void DuplexCore::captureSlice(
+        const float *input,
+        int32_t availableInputFrames,
+        int64_t callbackFrame,
+        int32_t timelineFrames) noexcept {
+    const int32_t alignedInputFrames = std::min(availableInputFrames, timelineFrames);
+    const bool started = mActualStartFrame.load(std::memory_order_acquire) >= 0;
+    const int64_t gateFrame = mGateFrame.load(std::memory_order_acquire);
+    const CaptureSlice expectedSlice = computeCaptureSlice(
+            callbackFrame,
+            timelineFrames,
+            gateFrame,
+            started);
+    const CaptureSlice slice = computeCaptureSlice(
+            callbackFrame,
+            alignedInputFrames,
+            gateFrame,
+            started);
+    if (slice.frameCount < expectedSlice.frameCount) {
+        mShortInputFrames.fetch_add(
+                expectedSlice.frameCount - slice.frameCount,
+                std::memory_order_release);
+    }
+    if (slice.frameCount <= 0 || input == nullptr) return;
+
+    CaptureStartState state = mStartState.load(std::memory_order_acquire);
+    if (state == CaptureStartState::Pending
+        && mStartState.compare_exchange_strong(
+                state,
+                CaptureStartState::Started,
+                std::memory_order_acq_rel,
+                std::memory_order_acquire)) {
+        state = CaptureStartState::Started;
+    }
+    if (state != CaptureStartState::Started) return;
+
+    const float *source = input + static_cast<size_t>(slice.offsetFrames) * inputChannelCount();
+    const size_t written = mWriter.writeGenerated(
+            static_cast<size_t>(slice.frameCount),
+            [source](size_t index) noexcept { return floatToPcm16(source[index]); });
+    mCapturedFrames.fetch_add(static_cast<int64_t>(written), std::memory_order_relaxed);
+    if (written > 0) {
+        int64_t unset = kUnsetFrame;
+        mActualStartFrame.compare_exchange_strong(
+                unset,
+                slice.firstTimelineFrame,
+                std::memory_order_release,
+                std::memory_order_relaxed);
+    }
+    if (written < static_cast<size_t>(slice.frameCount)) {
+        mDroppedFrames.fetch_add(
+                static_cast<int64_t>(slice.frameCount - written),
+                std::memory_order_release);
+    }
+}
+
+}  // namespace tapstory
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "audio/CaptureWriter.h"
+#include "audio/ChainStems.h"
+#include "audio/LoopbackCalibration.h"
+#include "audio/Mixer.h"
+#include "audio/PolyphaseResampler.h"
+#include "audio/PunchCapture.h"
+#include "audio/TrackStore.h"
+
+namespace tapstory {
+
+/**
+ * Platform-neutral duplex transport shared by the Android (Oboe) and iOS
+ * (RemoteIO) adapters.
+ *
+ * The adapters own device streams, sessions and diagnostics. They forward each
+ * duplex callback to `process`, which mixes the track store, gates captured
+ * input at the latency-compensated punch frame and advances the timeline.
+ *
+ * Settled cross-platform semantics:
+ * - The mix is hard-clamped to [-1, 1].
+ * - The capture ring is the exact-capacity `SpscPcmRing`.
+ * - Seeking while callbacks run is a transport command: the next callback
+ *   jumps at its first frame and crossfades out of the old position.
+ * - Stopping the transport ends the take. A started take with compensation C
+ *   keeps callbacks running with silent output until the input heard at the
+ *   stop frame S has arrived, and ends exactly at S + C. A take whose punch has
+ *   not been reached is cancelled and reports no start frame.
+ */
+class DuplexCore {
+public:
+    static constexpr int32_t kOutputChannelCount = kMixOutputChannelCount;
+    static constexpr int64_t kUnsetFrame = -1;
+    /** Length of the equal-power crossfade out of the old position after a seek. */
+    static constexpr int32_t kSeekCrossfadeFrames = 256;
+    static constexpr int32_t kMaxLoopCrossfadeFrames = 4'096;
+    /** Playback speeds are whole multiples of 1 / kPlaybackSpeedScale. */
+    static constexpr int32_t kPlaybackSpeedScale = 1'000;
+    static constexpr int32_t kMinPlaybackSpeed = 500;
+    /** Output frames resampled per slice at a practice speed; sizes its scratch. */
+    static constexpr int32_t kVarispeedSliceFrames = 512;
+
+    /** Playback wraps from `endFrame` back to `startFrame`; inactive when empty. */
+    struct LoopRegion {
+        int64_t startFrame = 0;
+        int64_t endFrame = 0;
+        int32_t crossfadeFrames = 0;
+
+        bool active() const noexcept { return endFrame > startFrame; }
+    };
+
+    using CaptureStartedHandler = std::function<void(int64_t timelineFrame)>;
+
+    /** One loop pass of a take recorded as lanes; frames are on the timeline. */
+    struct LoopTakeLane {
+        int32_t passIndex = 0;
+        std::string path;
+        int64_t startFrame = 0;
+        int64_t endFrame = 0;
+        int64_t rawFrameCount = 0;
+        /** Raw input frames minus timeline frames; negative when input fell short. */
+        int64_t driftFrames = 0;
+    };
+
+    /** Onset envelopes of a finished take and of the loaded mix under it. */
+    struct TakeOnsetEnvelopes {
+        int32_t blockFrames = 0;
+        /** Timeline frame of block 0 of both envelopes. */
+        int64_t startFrame = kUnsetFrame;
+        std::vector<float> take;
+        std::vector<float> mix;
+    };
+
+    DuplexCore() = default;
+    ~DuplexCore();
+
+    DuplexCore(const DuplexCore &) = delete;
+    DuplexCore &operator=(const DuplexCore &) = delete;
+
+    /** Track mutation is only valid while no callback is running. */
+    TrackStore &trackStore() noexcept { return mTracks; }
+    const TrackStore &trackStore() const noexcept { return mTracks; }
+
+    /**
+     * Play from pre-mixed `ChainStems` instead of mixing every track per
+     * callback. Enabling renders the stems; disabling frees them. Like track
+     * mutation, only valid while no callback is running, and `refreshStems`
+     * must follow every track change while the mode is on.
+     */
+    void setStemMixing(bool enabled);
+    bool isStemMixing() const noexcept { return mStemMixing; }
+    /** Catch the stems up with the track store; a no-op unless stem mixing is on. */
+    ChainStems::UpdateResult refreshStems();
+
+    /**
+     * Size the capture ring and take analysis for `sampleRate` and input
+     * frames of `inputChannelCount` interleaved samples; takes keep every
+     * channel. Ignored while a take is being written. The buffers are
+     * allocated by `allocateCaptureBuffers` or, at the latest, by the first
+     * `armCapture`.
+     */
+    void prepareCapture(size_t ringFrames, int32_t sampleRate, int32_t inputChannelCount = 1);
+    /** Samples per frame of the `input` that `process` expects. */
+    int32_t inputChannelCount() const noexcept { return mWriter.channelCount(); }
+    /**
+     * Allocate and pre-fault the capture buffers ahead of the first take.
+     * Control thread only; ignored while a take is armed or being written.
+     */
+    void allocateCaptureBuffers();
+    bool hasCaptureBuffers() const noexcept { return mWriter.hasBuffers(); }
+    /** Invoked once per take on the writer thread after the first frame is accepted. */
+    void setCaptureStartedHandler(CaptureStartedHandler handler) {
+        mCaptureStartedHandler = std::move(handler);
+    }
+
+    /**
+     * Arm a take at `requestedPunchFrame`. With `requestedPunchOutFrame` set,
+     * the take ends by itself once the input heard at that frame has arrived,
+     * while playback runs on; it must lie after the punch. With a
+     * `lanePathPrefix`, a looped take keeps recording across passes instead
+     * of ending at the loop end, and the writer splits it into one lane file
+     * per pass (see `loopTakeLanes`).
+     */
+    bool armCapture(
+            const std::string &filePath,
+            int64_t requestedPunchFrame,
+            int64_t compensationFrames,
+            int64_t requestedPunchOutFrame = kUnsetFrame,
+            const std::string &lanePathPrefix = {});
+    /**
+     * First half of a transport stop. Cancels a pending punch; for a started
+     * take with compensation, mutes output and returns true so the caller can
+     * wait for `isDrainingTail` to clear before stopping the device.
+     */
+    bool beginTransportStop() noexcept;
+    /** Second half of a transport stop, once callbacks have quiesced. */
+    void onTransportStopped() noexcept;
+    /** Ask the next callback to end the take at its first frame. */
+    void requestCaptureStop() noexcept;
+    /**
+     * End the armed take at timeline frame `requestedStopFrame` from inside
+     * the callback, like a punch-out: the take ends exactly where the input
+     * heard at that frame arrives, and playback runs on. The next callback
+     * claims the request, so the end frame does not depend on when this call
+     * ran as long as it ran before that callback. A stop the playhead has
+     * already passed ends the take at that callback's first frame, unless a
+     * loop brings it round again. An earlier punch-out still wins. Refused
+     * when no take is armed or the frame does not lie after the punch.
+     */
+    bool scheduleCaptureStop(int64_t requestedStopFrame) noexcept;
+    /**
+     * End the take and finalize the writer. When callbacks are still running,
+     * the end frame is the next callback boundary; otherwise it is the current
+     * frame. Returns false when there was nothing to finalize.
+     */
+    bool finishCapture(bool callbacksRunning);
+    /** Disarm immediately after a route loss; returns whether a take was armed. */
+    bool abortCapture() noexcept;
+    void waitForCallbacks() const noexcept;
+    /**
+     * Envelopes for the last take that started, computed without re-reading its
+     * file: the take's own was streamed by the writer thread, the mix is
+     * rendered from the track store. Empty while a take is armed or writing.
+     */
+    TakeOnsetEnvelopes takeOnsetEnvelopes() const;
+    /**
+     * The passes of the last take armed with lanes, once its writer stopped.
+     * Pass 0 starts at the punch; later passes start at the loop start. Empty
+     * otherwise.
+     */
+    std::vector<LoopTakeLane> loopTakeLanes() const;
+    /**
+     * Timeline frames the last take covered: its end minus its start, or the
+     * sum of its passes when it was recorded as lanes. Compare with
+     * `recordedFrameCount` for drift.
+     */
+    int64_t captureTimelineFrameCount() const;
+    /**
+     * Waveform peaks of the take being captured, or of the last one. The view
+     * stays valid while the writer appends; bins only ever get added.
+     */
+    PeakPyramid::Level capturePeaks(size_t level) const noexcept {
+        return mWriter.peaks().level(level);
+    }
+
+    /**
+     * Route callbacks to a loopback latency measurement instead of the mix.
+     * The timeline does not advance while calibrating. Refused while a take is
+     * armed or still being written.
+     */
+    bool beginCalibration(int32_t sampleRate);
+    bool isCalibrating() const noexcept { return mCalibrating.load(std::memory_order_acquire); }
+    bool isCalibrationComplete() const noexcept {
+        return isCalibrating() && mCalibration.isComplete();
+    }
+    /** Leave calibration mode and analyze; callbacks must have quiesced. */
+    LoopbackCalibration::Result finishCalibration();
+
+    /**
+     * Hold the transport while the streams keep running ("hot idle"):
+     * callbacks output silence and touch neither the timeline, the tracks nor
+     * capture, so once `waitForCallbacks()` returns the control thread may
+     * seek, load and arm exactly as if the streams were stopped.
+     *
+     * Parking is a store-then-load handshake on both sides: this store, then
+     * the activity load in `waitForCallbacks`; the callback's activity
+     * increment, then its load of this flag. Acquire/release does not order a
+     * store before a later load, so all four are sequentially consistent:
+     * either the callback sees the flag, or the wait sees the callback.
+     */
+    void parkTransport() noexcept { mTransportParked.store(true, std::memory_order_seq_cst); }
+    bool isTransportParked() const noexcept {
+        return mTransportParked.load(std::memory_order_acquire);
+    }
+    /**
+     * Let the next callback play from the playhead. Call before starting cold
+     * streams too: it is the reference for `transportStartDelayNanos`.
+     */
+    void resumeTransport() noexcept;
+    /**
+     * Steady-clock nanoseconds from the last `resumeTransport()` to the start
+     * of the first callback that rendered the transport, or -1 until one has.
+     * Adding the output latency gives the time to the first audible frame.
+     */
+    int64_t transportStartDelayNanos() const noexcept;
+
+    /** Move the playhead while no callback is running; drops any pending seek. */
+    void seek(int64_t frame) noexcept;
+    /**
+     * Move the playhead while callbacks run. The next callback starts at
+     * `frame` and fades the old position out over `kSeekCrossfadeFrames`; a
+     * newer request replaces one not yet applied. Refused while a take is
+     * armed, because the punch and tail are timeline-exact; a take armed
+     * after the request starts from its target. A request still pending when
+     * the transport stops is applied by `onTransportStopped`.
+     */
+    bool requestSeek(int64_t frame) noexcept;
+    /** The requested frame until a callback applies it, else `kUnsetFrame`. */
+    int64_t pendingSeekFrame() const noexcept {
+        return mPendingSeekFrame.load(std::memory_order_acquire);
+    }
+    /**
+     * Loop [startFrame, endFrame) inside the callback. When playback reaches
+     * `endFrame` the same callback continues from `startFrame`, so wrapping
+     * costs no restart; with a crossfade the audio past the end fades out
+     * under the loop start. A playhead already past the end plays on.
+     * Capture follows the loop: the punch gate is checked on every pass, and
+     * a take ends once its compensated input reaches the loop end, unless it
+     * was armed with lanes. Refused
+     * when the loop is no longer than its crossfade, or than the armed
+     * take's compensation. Control thread only.
+     */
+    bool setLoopRegion(int64_t startFrame, int64_t endFrame, int32_t crossfadeFrames) noexcept;
+    void clearLoopRegion() noexcept { publishLoopRegion(LoopRegion{}); }
+    LoopRegion loopRegion() const noexcept;
+
+    /**
+     * Practice playback at `speed` / kPlaybackSpeedScale of the nominal rate,
+     * from kMinPlaybackSpeed up: each callback mixes the timeline span it
+     * covers and resamples it to the output, so pitch follows speed as on
+     * tape and nothing is decoded again. The playhead stays a timeline frame
+     * and carries its fraction between callbacks, so loops and positions stay
+     * exact. Takes effect on the next callback. Capture only runs at the
+     * nominal rate: refused while a take is armed, and `armCapture` refuses
+     * while the speed is not nominal.
+     */
+    bool setPlaybackSpeed(int32_t speed) noexcept;
+    int32_t playbackSpeed() const noexcept {
+        return mPlaybackSpeed.load(std::memory_order_acquire);
+    }
+
+    /** Where the transport is, or is about to jump to while a seek is pending. */
+    int64_t playheadFrame() const noexcept {
+        const int64_t pending = pendingSeekFrame();
+        return pending != kUnsetFrame ? pending : currentFrame();
+    }
+
+    /**
+     * Realtime entry point. `input` holds interleaved frames of
+     * `inputChannelCount` samples and may be null when the device delivered
+     * none.
+     */
+    void process(
+            const float *input,
+            int32_t inputFrames,
+            float *stereoOutput,
+            int32_t outputFrames) noexcept;
+
+    int64_t currentFrame() const noexcept {
+        return mCurrentFrame.load(std::memory_order_acquire);
+    }
+    bool isCaptureArmed() const noexcept {
+        return mCaptureArmed.load(std::memory_order_acquire);
+    }
+    bool isDrainingTail() const noexcept {
+        return mOutputMuted.load(std::memory_order_acquire) && isCaptureArmed();
+    }
+    bool isWriterActive() const noexcept { return mWriter.isActive(); }
+    int64_t requestedPunchFrame() const noexcept {
+        return mRequestedPunchFrame.load(std::memory_order_acquire);
+    }
+    int64_t captureGateFrame() const noexcept {
+        return mGateFrame.load(std::memory_order_acquire);
+    }
+    int64_t captureCompensationFrames() const noexcept {
+        return mCompensationFrames.load(std::memory_order_acquire);
+    }
+    int64_t actualCaptureStartFrame() const noexcept {
+        return mActualStartFrame.load(std::memory_order_acquire);
+    }
+    int64_t captureEndFrame() const noexcept {
+        return mEndFrame.load(std::memory_order_acquire);
+    }
+    int64_t recordedFrameCount() const noexcept { return mWriter.framesWritten(); }
+    int64_t droppedCaptureFrameCount() const noexcept {
+        return mDroppedFrames.load(std::memory_order_acquire);
+    }
+    int64_t shortInputFrameCount() const noexcept {
+        return mShortInputFrames.load(std::memory_order_acquire);
+    }
+    bool writerFailed() const noexcept { return mWriter.failed(); }
+    size_t captureRingCapacity() const noexcept { return mWriter.ringCapacity(); }
+    size_t captureBufferedFrames() const noexcept { return mWriter.bufferedFrames(); }
+
+private:
+    enum class CaptureStartState : uint8_t {
+        Pending,
+        Started,
+        Cancelled,
+    };
+    static_assert(std::atomic<CaptureStartState>::is_always_lock_free);
+
+    static constexpr int64_t kPendingStopFrame = -2;
+
+    void finishCaptureAt(int64_t endFrame) noexcept;
+    void claimScheduledStop(int64_t captureFrame) noexcept;
+    void endLoopedTake(int64_t captureEndFrame, int64_t nextPassFrame) noexcept;
+    void publishLoopRegion(const LoopRegion &region) noexcept;
+    void refreshLoopRegion() noexcept;
+    void startJumpFade(int64_t originFrame, int32_t fadeFrames) noexcept;
+    void crossfadeFromJumpOrigin(float *stereoOutput, int32_t frames) noexcept;
+    void mixPlayback(int64_t frame, float *stereoOutput, int32_t frames) noexcept;
+    /**
+     * `mixPlayback` with frames past the active loop's end read from its
+     * start and, when `wrapBefore`, frames before its start read from its
+     * end, so kernel taps around a wrap stay inside the region.
+     */
+    void mixLoopedPlayback(
+            int64_t frame,
+            float *stereoOutput,
+            int32_t frames,
+            bool wrapBefore) noexcept;
+    /** Timeline frame of the input arriving with output frame `frame`. */
+    int64_t captureFrameFor(int64_t frame) const noexcept {
+        return mCaptureLagFrames > 0 ? frame + mCaptureLead : frame;
+    }
+    int64_t playRuns(
+            const float *input,
+            int32_t availableInputFrames,
+            int64_t frame,
+            float *stereoOutput,
+            int32_t frames) noexcept;
+    int64_t drainTail(
+            const float *input,
+            int32_t availableInputFrames,
+            int64_t frame,
+            float *stereoOutput,
+            int32_t frames) noexcept;
+    int64_t playAtSpeed(int64_t frame, float *stereoOutput, int32_t frames, int32_t speed) noexcept;
+    void cancelPendingStart() noexcept;
+    void captureSlice(
+            const float *input,
+            int32_t availableInputFrames,
+            int64_t callbackFrame,
+            int32_t timelineFrames) noexcept;
+
+    TrackStore mTracks;
+    ChainStems mStems;
+    bool mStemMixing = false;
+    CaptureWriter mWriter;
+    CaptureStartedHandler mCaptureStartedHandler;
+    LoopbackCalibration mCalibration;
+    std::atomic<bool> mCalibrating{false};
+
+    std::atomic<int64_t> mCurrentFrame{0};
+    std::atomic<bool> mTransportParked{false};
+    std::atomic<int64_t> mTransportRequestedNanos{0};
+    std::atomic<int64_t> mTransportStartedNanos{-1};
+    std::atomic<int64_t> mPendingSeekFrame{kUnsetFrame};
+    // Callback-thread state of a seek or loop crossfade in progress.
+    int64_t mJumpOriginFrame = 0;
+    int32_t mJumpFadeFrames = 0;
+    int32_t mJumpFadeRemaining = 0;
+    std::array<float, kSeekCrossfadeFrames * kOutputChannelCount> mJumpFadeScratch{};
+
+    std::atomic<int32_t> mPlaybackSpeed{kPlaybackSpeedScale};
+    // Callback-thread state of practice playback: the playhead's fraction of
+    // a frame in 1 / kPlaybackSpeedScale, and the timeline mix it reads from.
+    int64_t mSpeedRemainder = 0;
+    PolyphaseResampler mVarispeed{kPlaybackSpeedScale, kPlaybackSpeedScale};
+    std::array<float, (kVarispeedSliceFrames + PolyphaseResampler::kTaps) * kOutputChannelCount>
+            mVarispeedScratch{};
+
+    // Loop region, published by the control thread under a sequence lock and
+    // copied by the callback when consistent.
+    std::atomic<uint32_t> mLoopSequence{0};
+    std::atomic<int64_t> mLoopStartFrame{0};
+    std::atomic<int64_t> mLoopEndFrame{0};
+    std::atomic<int32_t> mLoopCrossfadeFrames{0};
+    LoopRegion mActiveLoop;
+    uint32_t mActiveLoopSequence = 0;
+    // After a wrap, input still carries the previous pass for the
+    // compensation; its timeline runs one loop length ahead of the output.
+    int64_t mCaptureLagFrames = 0;
+    int64_t mCaptureLead = 0;
+    mutable std::atomic<uint32_t> mCallbackActivity{0};
+    std::atomic<bool> mOutputMuted{false};
+    std::atomic<int64_t> mTailStopFrame{kUnsetFrame};
+
+    std::atomic<bool> mCaptureArmed{false};
+    std::atomic<bool> mCaptureStopRequested{false};
+    std::atomic<CaptureStartState> mStartState{CaptureStartState::Cancelled};
+    std::atomic<int64_t> mRequestedPunchFrame{0};
+    std::atomic<int64_t> mGateFrame{0};
+    // Compensated punch-out, or kUnsetFrame when the take runs until stopped.
+    std::atomic<int64_t> mPunchOutFrame{kUnsetFrame};
+    // Compensated stop scheduled by the control thread, until a callback
+    // folds it into the punch-out.
+    std::atomic<int64_t> mScheduledStopFrame{kUnsetFrame};
+    std::atomic<int64_t> mCompensationFrames{0};
+    std::atomic<int64_t> mActualStartFrame{kUnsetFrame};
+    std::atomic<int64_t> mEndFrame{kUnsetFrame};
+    std::atomic<int64_t> mDroppedFrames{0};
+    // Frames the callback handed to the writer; lane splits are marked in them.
+    std::atomic<int64_t> mCapturedFrames{0};
+    std::atomic<int64_t> mShortInputFrames{0};
+};
+
+}  // namespace tapstory
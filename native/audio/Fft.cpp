@@ -0,0 +1,76 @@
+#include "audio/Fft.h"
+
+#include <cmath>
+#include <utility>
+
+namespace tapstory {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+}  // namespace
+
+size_t Fft::nextPowerOfTwo(size_t value) noexcept {
+    size_t size = 2;
+    while (size < value) size <<= 1;
+    return size;
+}
+
+Fft::Fft(size_t size) : mSize(nextPowerOfTwo(size)) {
+    int bits = 0;
+    while ((size_t{1} << bits) < mSize) ++bits;
+    mBitReverse.resize(mSize);
+    for (size_t index = 0; index < mSize; ++index) {
+        size_t reversed = 0;
+        for (int bit = 0; bit < bits; ++bit) {
+            reversed |= ((index >> bit) & 1U) << (bits - 1 - bit);
+        }
+        mBitReverse[index] = reversed;
+    }
+
+    mTwiddles.resize(mSize / 2);
+    const double step = -2.0 * kPi / static_cast<double>(mSize);
+    for (size_t index = 0; index < mTwiddles.size(); ++index) {
+        const double angle = step * static_cast<double>(index);
+        mTwiddles[index] = {std::cos(angle), std::sin(angle)};
+    }
+}
+
+void Fft::forward(std::complex<double> *data) const noexcept {
+    transform(data, false);
+}
+
+void Fft::inverse(std::complex<double> *data) const noexcept {
+    transform(data, true);
+    const double scale = 1.0 / static_cast<double>(mSize);
+    for (size_t index = 0; index < mSize; ++index) data[index] *= scale;
+}
+
+void Fft::transform(std::complex<double> *data, bool inverse) const noexcept {
+    for (size_t index = 0; index < mSize; ++index) {
+        const size_t reversed = mBitReverse[index];
+        if (index < reversed) std::swap(data[index], data[reversed]);
+    }
+
+    for (size_t length = 2; length <= mSize; length <<= 1) {
+        const size_t half = length / 2;
+        const size_t twiddleStride = mSize / length;
+        for (size_t start = 0; start < mSize; start += length) {
+            for (size_t offset = 0; offset < half; ++offset) {
+                const std::complex<double> twiddle = mTwiddles[offset * twiddleStride];
+                const double twiddleImag = inverse ? -twiddle.imag() : twiddle.imag();
+                // Spelled out: std::complex operator* takes a slow NaN-checking path.
+                const std::complex<double> odd = data[start + offset + half];
+                const std::complex<double> product(
+                        odd.real() * twiddle.real() - odd.imag() * twiddleImag,
+                        odd.real() * twiddleImag + odd.imag() * twiddle.real());
+                const std::complex<double> even = data[start + offset];
+                data[start + offset] = even + product;
+                data[start + offset + half] = even - product;
+            }
+        }
+    }
+}
+
+}  // namespace tapstory
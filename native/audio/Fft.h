@@ -0,0 +1,40 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace tapstory {
+
+/**
+ * In-place iterative radix-2 complex FFT of a fixed power-of-two size.
+ *
+ * Twiddles and the bit-reversal permutation are computed once at
+ * construction, so one instance can transform many buffers of its size.
+ * Double precision keeps correlation sums of long 16-bit signals exact to
+ * well below one LSB.
+ */
+class Fft {
+public:
+    /** `size` is rounded up to a power of two (minimum 2). */
+    explicit Fft(size_t size);
+
+    size_t size() const noexcept { return mSize; }
+
+    /** X[k] = sum x[n] e^(-2 pi i k n / N). */
+    void forward(std::complex<double> *data) const noexcept;
+    /** Inverse transform including the 1/N scale. */
+    void inverse(std::complex<double> *data) const noexcept;
+
+    static size_t nextPowerOfTwo(size_t value) noexcept;
+
+private:
+    void transform(std::complex<double> *data, bool inverse) const noexcept;
+
+    size_t mSize = 0;
+    std::vector<size_t> mBitReverse;
+    // e^(-2 pi i k / N) for k in [0, N/2).
+    std::vector<std::complex<double>> mTwiddles;
+};
+
+}  // namespace tapstory
@@ -0,0 +1,424 @@
+#include "audio/FlacReader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "audio/PcmConversion.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr size_t kStreamInfoBytes = 34;
+constexpr int32_t kMaxChannels = 8;
+constexpr int32_t kMaxFixedOrder = 4;
+constexpr int32_t kMaxLpcOrder = 32;
+
+enum class ChannelAssignment { Independent, LeftSide, RightSide, MidSide };
+
+// MSB-first reader over the mapped stream with a 64-bit cache refilled a byte
+// at a time. Reads past the end return zero bits and mark the reader
+// exhausted, so decoding loops need no bounds checks of their own; callers
+// test `exhausted` once per frame.
+class BitReader {
+public:
+    BitReader(const uint8_t *bytes, size_t size) noexcept : mBytes(bytes), mSize(size) {}
+
+    /** Up to 32 bits. */
+    uint32_t read(int32_t count) noexcept {
+        if (count == 0) return 0;
+        if (mCacheBits < count) refill();
+        const auto value = static_cast<uint32_t>(mCache >> (64 - count));
+        mCache <<= count;
+        mCacheBits -= count;
+        return value;
+    }
+
+    int32_t readSigned(int32_t count) noexcept {
+        if (count == 0) return 0;
+        const uint32_t value = read(count);
+        const int32_t shift = 32 - count;
+        return static_cast<int32_t>(value << shift) >> shift;
+    }
+
+    /** Zero bits before the next one bit, which is consumed. */
+    uint32_t readUnary() noexcept {
+        uint32_t zeros = 0;
+        // Bits past the valid ones are zero, so a set bit is always valid.
+        while (mCache == 0) {
+            zeros += static_cast<uint32_t>(mCacheBits);
+            mCacheBits = 0;
+            if (exhausted()) return zeros;
+            refill();
+        }
+        const auto leading = static_cast<int32_t>(__builtin_clzll(mCache));
+        mCache <<= leading;
+        mCache <<= 1;
+        mCacheBits -= leading + 1;
+        return zeros + static_cast<uint32_t>(leading);
+    }
+
+    void alignToByte() noexcept {
+        const int32_t partial = mCacheBits & 7;
+        mCache <<= partial;
+        mCacheBits -= partial;
+    }
+    size_t bytePosition() const noexcept { return bitPosition() >> 3; }
+    bool exhausted() const noexcept { return bitPosition() > mSize * 8; }
+
+private:
+    size_t bitPosition() const noexcept {
+        return mNextByte * 8 - static_cast<size_t>(mCacheBits);
+    }
+
+    void refill() noexcept {
+        while (mCacheBits <= 56) {
+            const uint64_t byte = mNextByte < mSize ? mBytes[mNextByte] : 0;
+            mCache |= byte << (56 - mCacheBits);
+            mCacheBits += 8;
+            ++mNextByte;
+        }
+    }
+
+    const uint8_t *mBytes;
+    size_t mSize;
+    size_t mNextByte = 0;
+    uint64_t mCache = 0;
+    int32_t mCacheBits = 0;
+};
+
+bool readResidual(BitReader &bits, int32_t blockFrames, int32_t order, int32_t *residual) {
+    const uint32_t method = bits.read(2);
+    if (method > 1) return false;
+    const int32_t parameterBits = method == 0 ? 4 : 5;
+    const uint32_t escape = method == 0 ? 15 : 31;
+    const uint32_t partitionOrder = bits.read(4);
+    const int32_t partitionFrames = blockFrames >> partitionOrder;
+    if ((partitionFrames << partitionOrder) != blockFrames || partitionFrames < order) return false;
+
+    int32_t *output = residual + order;
+    for (uint32_t partition = 0; partition < (1u << partitionOrder); ++partition) {
+        const int32_t count = partitionFrames - (partition == 0 ? order : 0);
+        const uint32_t parameter = bits.read(parameterBits);
+        if (parameter == escape) {
+            const auto rawBits = static_cast<int32_t>(bits.read(5));
+            for (int32_t index = 0; index < count; ++index) output[index] = bits.readSigned(rawBits);
+        } else {
+            for (int32_t index = 0; index < count; ++index) {
+                const uint32_t value = (bits.readUnary() << parameter) | bits.read(
+                        static_cast<int32_t>(parameter));
+                output[index] = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+            }
+        }
+        output += count;
+    }
+    return true;
+}
+
+// Residuals are decoded in place after the warm-up samples, then each sample
+// adds the prediction from the ones already restored before it.
+void restoreFixed(int32_t *samples, int32_t blockFrames, int32_t order) noexcept {
+    for (int32_t index = order; index < blockFrames; ++index) {
+        const int32_t *previous = samples + index;
+        int64_t prediction = 0;
+        switch (order) {
+            case 1:
+                prediction = previous[-1];
+                break;
+            case 2:
+                prediction = 2 * int64_t{previous[-1]} - previous[-2];
+                break;
+            case 3:
+                prediction = 3 * int64_t{previous[-1]} - 3 * int64_t{previous[-2]} + previous[-3];
+                break;
+            case 4:
+                prediction = 4 * int64_t{previous[-1]} - 6 * int64_t{previous[-2]}
+                        + 4 * int64_t{previous[-3]} - previous[-4];
+                break;
+            default:
+                break;
+        }
+        samples[index] = static_cast<int32_t>(samples[index] + prediction);
+    }
+}
+
+void restoreLpc(
+        int32_t *samples,
+        int32_t blockFrames,
+        const int32_t *coefficients,
+        int32_t order,
+        int32_t shift) noexcept {
+    for (int32_t index = order; index < blockFrames; ++index) {
+        int64_t sum = 0;
+        for (int32_t tap = 0; tap < order; ++tap) {
+            sum += int64_t{coefficients[tap]} * samples[index - 1 - tap];
+        }
+        samples[index] = static_cast<int32_t>(samples[index] + (sum >> shift));
+    }
+}
+
+bool readSubframe(BitReader &bits, int32_t blockFrames, int32_t sampleBits, int32_t *samples) {
+    if (bits.read(1) != 0) return false;
+    const uint32_t type = bits.read(6);
+    int32_t wastedBits = 0;
+    if (bits.read(1) != 0) {
+        wastedBits = static_cast<int32_t>(bits.readUnary()) + 1;
+        sampleBits -= wastedBits;
+    }
+    if (sampleBits <= 0) return false;
+
+    if (type == 0) {
+        std::fill_n(samples, blockFrames, bits.readSigned(sampleBits));
+    } else if (type == 1) {
+        for (int32_t index = 0; index < blockFrames; ++index) {
+            samples[index] = bits.readSigned(sampleBits);
+        }
+    } else if (type >= 8 && type <= 8 + kMaxFixedOrder) {
+        const auto order = static_cast<int32_t>(type - 8);
+        if (order > blockFrames) return false;
+        for (int32_t index = 0; index < order; ++index) samples[index] = bits.readSigned(sampleBits);
+        if (!readResidual(bits, blockFrames, order, samples)) return false;
+        restoreFixed(samples, blockFrames, order);
+    } else if (type >= 32) {
+        const auto order = static_cast<int32_t>(type - 31);
+        if (order > blockFrames) return false;
+        for (int32_t index = 0; index < order; ++index) samples[index] = bits.readSigned(sampleBits);
+        const uint32_t precision = bits.read(4) + 1;
+        const int32_t shift = bits.readSigned(5);
+        if (precision == 16 || shift < 0) return false;
+        std::array<int32_t, kMaxLpcOrder> coefficients{};
+        for (int32_t tap = 0; tap < order; ++tap) {
+            coefficients[static_cast<size_t>(tap)] = bits.readSigned(static_cast<int32_t>(precision));
+        }
+        if (!readResidual(bits, blockFrames, order, samples)) return false;
+        restoreLpc(samples, blockFrames, coefficients.data(), order, shift);
+    } else {
+        return false;
+    }
+
+    if (wastedBits > 0) {
+        for (int32_t index = 0; index < blockFrames; ++index) {
+            samples[index] = static_cast<int32_t>(static_cast<uint32_t>(samples[index]) << wastedBits);
+        }
+    }
+    return true;
+}
+
+int32_t blockFramesFor(uint32_t code, BitReader &bits) noexcept {
+    if (code == 1) return 192;
+    if (code >= 2 && code <= 5) return 576 << (code - 2);
+    if (code == 6) return static_cast<int32_t>(bits.read(8)) + 1;
+    if (code == 7) return static_cast<int32_t>(bits.read(16)) + 1;
+    if (code >= 8) return 256 << (code - 8);
+    return 0;
+}
+
+int32_t sampleBitsFor(uint32_t code, int32_t streamBits) noexcept {
+    static constexpr std::array<int32_t, 8> kBits{{0, 8, 12, 0, 16, 20, 24, 0}};
+    return code == 0 ? streamBits : kBits[code];
+}
+
+}  // namespace
+
+bool FlacReader::open(const std::string &path) {
+    close();
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return fail("Cannot open file");
+
+    struct stat info {};
+    if (::fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+        ::close(descriptor);
+        return fail("File is empty");
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) return fail("Cannot map file");
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+    mMapping = mapping;
+    mMappingBytes = size;
+    return parseOrClose(static_cast<const uint8_t *>(mapping), size);
+}
+
+bool FlacReader::openMemory(const uint8_t *bytes, size_t size) {
+    close();
+    if (bytes == nullptr) return fail("File is empty");
+    return parseOrClose(bytes, size);
+}
+
+bool FlacReader::parseOrClose(const uint8_t *bytes, size_t size) {
+    if (parse(bytes, size)) return true;
+    const char *error = mError;
+    close();
+    return fail(error);
+}
+
+void FlacReader::close() noexcept {
+    if (mMapping != nullptr) ::munmap(mMapping, mMappingBytes);
+    mMapping = nullptr;
+    mMappingBytes = 0;
+    mOpen = false;
+    mError = "";
+    mFormat = {};
+    mFrameCount = 0;
+    mFrames = nullptr;
+    mFramesBytes = 0;
+}
+
+bool FlacReader::fail(const char *error) noexcept {
+    mOpen = false;
+    mError = error;
+    return false;
+}
+
+bool FlacReader::parse(const uint8_t *bytes, size_t size) {
+    if (size < 8 || std::memcmp(bytes, "fLaC", 4) != 0) return fail("Not a FLAC file");
+
+    // STREAMINFO is always the first metadata block; the rest are skipped.
+    size_t offset = 4;
+    bool last = false;
+    bool haveStreamInfo = false;
+    while (!last) {
+        if (offset + 4 > size) return fail("FLAC metadata is truncated");
+        const uint8_t *header = bytes + offset;
+        last = (header[0] & 0x80) != 0;
+        const uint8_t type = header[0] & 0x7f;
+        const size_t length = (size_t{header[1]} << 16) | (size_t{header[2]} << 8) | header[3];
+        offset += 4;
+        if (offset + length > size) return fail("FLAC metadata is truncated");
+        if (!haveStreamInfo) {
+            if (type != 0 || length < kStreamInfoBytes) return fail("FLAC STREAMINFO not found");
+            const uint8_t *info = bytes + offset;
+            mFormat.maxBlockFrames = (info[2] << 8) | info[3];
+            mFormat.sampleRate = (info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+            mFormat.channelCount = ((info[12] >> 1) & 0x07) + 1;
+            mFormat.bitsPerSample = (((info[12] & 0x01) << 4) | (info[13] >> 4)) + 1;
+            mFrameCount = static_cast<int64_t>(
+                    (uint64_t{info[13] & 0x0fu} << 32) | (uint64_t{info[14]} << 24)
+                    | (uint64_t{info[15]} << 16) | (uint64_t{info[16]} << 8) | info[17]);
+            haveStreamInfo = true;
+        }
+        offset += length;
+    }
+
+    if (mFormat.sampleRate <= 0 || mFormat.maxBlockFrames <= 0) return fail("Invalid FLAC format");
+    if (mFormat.bitsPerSample < 8 || mFormat.bitsPerSample > 24) {
+        return fail("Unsupported FLAC sample size");
+    }
+    if (mFrameCount <= 0) return fail("FLAC stream length is unknown");
+    mFrames = bytes + offset;
+    mFramesBytes = size - offset;
+    mOpen = true;
+    mError = "";
+    return true;
+}
+
+size_t FlacReader::readMonoPcm16(int16_t *destination, size_t frameCount) {
+    return decode(destination, frameCount, false);
+}
+
+size_t FlacReader::readPcm16(int16_t *destination, size_t frameCount) {
+    return decode(destination, frameCount, true);
+}
+
+size_t FlacReader::decode(int16_t *destination, size_t frameCount, bool interleaved) {
+    if (!mOpen || destination == nullptr) return 0;
+    const int32_t channelCount = mFormat.channelCount;
+    const auto maxBlock = static_cast<size_t>(mFormat.maxBlockFrames);
+    std::vector<int32_t> planar(maxBlock * static_cast<size_t>(channelCount));
+    std::array<int32_t *, kMaxChannels> channels{};
+    for (int32_t channel = 0; channel < channelCount; ++channel) {
+        channels[static_cast<size_t>(channel)] = planar.data() + static_cast<size_t>(channel) * maxBlock;
+    }
+
+    BitReader bits(mFrames, mFramesBytes);
+    size_t written = 0;
+    const auto corrupt = [&] {
+        mError = "Corrupt FLAC frame";
+        return written;
+    };
+    while (written < frameCount && bits.bytePosition() + 2 <= mFramesBytes) {
+        if (bits.read(15) != 0x7ffc) return corrupt();
+        bits.read(1);  // blocking strategy: frames are decoded in order either way
+        const uint32_t blockCode = bits.read(4);
+        const uint32_t rateCode = bits.read(4);
+        const uint32_t assignment = bits.read(4);
+        const int32_t sampleBits = sampleBitsFor(bits.read(3), mFormat.bitsPerSample);
+        bits.read(1);
+        // UTF-8 style frame or sample number, only needed for seeking.
+        const uint32_t lead = bits.read(8);
+        for (uint32_t mask = 0x40; (lead & 0x80) != 0 && (lead & mask) != 0; mask >>= 1) bits.read(8);
+        const int32_t blockFrames = blockFramesFor(blockCode, bits);
+        if (rateCode == 12) bits.read(8);
+        if (rateCode == 13 || rateCode == 14) bits.read(16);
+        bits.read(8);  // header CRC-8
+
+        ChannelAssignment mode = ChannelAssignment::Independent;
+        int32_t frameChannels = static_cast<int32_t>(assignment) + 1;
+        if (assignment >= 8 && assignment <= 10) {
+            mode = assignment == 8 ? ChannelAssignment::LeftSide
+                    : assignment == 9 ? ChannelAssignment::RightSide : ChannelAssignment::MidSide;
+            frameChannels = 2;
+        }
+        if (blockFrames <= 0 || static_cast<size_t>(blockFrames) > maxBlock || sampleBits <= 0
+                || assignment > 10 || frameChannels != channelCount) {
+            return corrupt();
+        }
+
+        for (int32_t channel = 0; channel < channelCount; ++channel) {
+            // The side channel carries one extra bit.
+            const bool side = (mode == ChannelAssignment::RightSide && channel == 0)
+                    || ((mode == ChannelAssignment::LeftSide || mode == ChannelAssignment::MidSide)
+                            && channel == 1);
+            if (!readSubframe(bits, blockFrames, sampleBits + (side ? 1 : 0),
+                        channels[static_cast<size_t>(channel)])) {
+                return corrupt();
+            }
+        }
+        bits.alignToByte();
+        bits.read(16);  // frame CRC-16
+        if (bits.exhausted()) return corrupt();
+
+        int32_t *left = channels[0];
+        int32_t *right = channels[1];
+        for (int32_t index = 0; mode != ChannelAssignment::Independent && index < blockFrames;
+                ++index) {
+            if (mode == ChannelAssignment::LeftSide) {
+                right[index] = left[index] - right[index];
+            } else if (mode == ChannelAssignment::RightSide) {
+                left[index] += right[index];
+            } else {
+                const int32_t side = right[index];
+                const int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(left[index]) << 1)
+                        | (side & 1);
+                left[index] = (mid + side) >> 1;
+                right[index] = (mid - side) >> 1;
+            }
+        }
+
+        const size_t frames = std::min(static_cast<size_t>(blockFrames), frameCount - written);
+        if (interleaved) {
+            interleavePlanarToPcm16(
+                    channels.data(),
+                    channelCount,
+                    sampleBits,
+                    destination + written * static_cast<size_t>(channelCount),
+                    frames);
+        } else {
+            downmixPlanarToMonoPcm16(
+                    channels.data(), channelCount, sampleBits, destination + written, frames);
+        }
+        written += frames;
+    }
+    return written;
+}
+
+}  // namespace tapstory
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tapstory {
+
+/**
+ * Read-only FLAC file with the same open/close shape as WavReader. `open`
+ * maps the file and parses STREAMINFO; `readMonoPcm16` then decodes the
+ * frames straight out of the mapping. Handles every subframe type (constant,
+ * verbatim, fixed and LPC predictors, wasted bits), both Rice residual
+ * codings and all stereo decorrelation modes, for 8- to 24-bit streams.
+ * Frame checksums are not verified. Only streams that record their total
+ * length are accepted, so callers can size the output up front.
+ */
+class FlacReader {
+public:
+    struct Format {
+        int32_t sampleRate = 0;
+        int32_t channelCount = 0;
+        int32_t bitsPerSample = 0;
+        int32_t maxBlockFrames = 0;
+    };
+
+    FlacReader() = default;
+    FlacReader(const FlacReader &) = delete;
+    FlacReader &operator=(const FlacReader &) = delete;
+    ~FlacReader() { close(); }
+
+    /** Map and parse `path`; on failure `error` says why. */
+    bool open(const std::string &path);
+    /** Parse a file already in memory; `bytes` must outlive the reader. */
+    bool openMemory(const uint8_t *bytes, size_t size);
+    void close() noexcept;
+
+    bool isOpen() const noexcept { return mOpen; }
+    const char *error() const noexcept { return mError; }
+    const Format &format() const noexcept { return mFormat; }
+    int64_t frameCount() const noexcept { return mFrameCount; }
+
+    /**
+     * Decode from the start of the stream, averaging the channels of each
+     * frame into mono PCM16 exactly as `WavReader::readMonoPcm16` does, so a
+     * 16-bit file decodes to the same samples as its WAV original. Returns the
+     * frames written; fewer than asked only at the end of the stream or when a
+     * frame is corrupt, which also sets `error`.
+     */
+    size_t readMonoPcm16(int16_t *destination, size_t frameCount);
+    /**
+     * `readMonoPcm16` keeping every channel: frames are interleaved PCM16,
+     * wider samples keeping their top 16 bits.
+     */
+    size_t readPcm16(int16_t *destination, size_t frameCount);
+
+private:
+    size_t decode(int16_t *destination, size_t frameCount, bool interleaved);
+    bool parse(const uint8_t *bytes, size_t size);
+    bool parseOrClose(const uint8_t *bytes, size_t size);
+    bool fail(const char *error) noexcept;
+
+    void *mMapping = nullptr;
+    size_t mMappingBytes = 0;
+    bool mOpen = false;
+    const char *mError = "";
+    Format mFormat;
+    int64_t mFrameCount = 0;
+    /** First audio frame, after the metadata blocks. */
+    const uint8_t *mFrames = nullptr;
+    size_t mFramesBytes = 0;
+};
+
+}  // namespace tapstory
@@ -0,0 +1,526 @@
+#include "audio/FlacWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace tapstory {
+
+namespace {
+
+constexpr int32_t kSampleBits = 16;
+constexpr int32_t kMaxFixedOrder = 4;
+constexpr int32_t kMaxPartitionOrder = 8;
+constexpr uint32_t kMaxRiceParameter = 14;
+constexpr int32_t kMaxFrameSamples = 65'536;
+
+constexpr uint32_t kLeftSideAssignment = 8;
+constexpr uint32_t kRightSideAssignment = 9;
+constexpr uint32_t kMidSideAssignment = 10;
+
+constexpr std::array<uint8_t, 256> makeCrc8Table() {
+    std::array<uint8_t, 256> table{};
+    for (uint32_t index = 0; index < 256; ++index) {
+        uint32_t crc = index;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) != 0 ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+        table[index] = static_cast<uint8_t>(crc);
+    }
+    return table;
+}
+
+constexpr std::array<uint16_t, 256> makeCrc16Table() {
+    std::array<uint16_t, 256> table{};
+    for (uint32_t index = 0; index < 256; ++index) {
+        uint32_t crc = index << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) != 0 ? ((crc << 1) ^ 0x8005) : (crc << 1);
+        }
+        table[index] = static_cast<uint16_t>(crc);
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> kCrc8Table = makeCrc8Table();
+constexpr std::array<uint16_t, 256> kCrc16Table = makeCrc16Table();
+
+uint8_t crc8(const uint8_t *bytes, size_t count) {
+    uint8_t crc = 0;
+    for (size_t index = 0; index < count; ++index) crc = kCrc8Table[crc ^ bytes[index]];
+    return crc;
+}
+
+uint16_t crc16(const uint8_t *bytes, size_t count) {
+    uint16_t crc = 0;
+    for (size_t index = 0; index < count; ++index) {
+        crc = static_cast<uint16_t>((crc << 8) ^ kCrc16Table[(crc >> 8) ^ bytes[index]]);
+    }
+    return crc;
+}
+
+/** MSB-first bit packer appending to a byte vector. */
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t> &output) : mOutput(output) {}
+
+    /** Append the low `bits` (0-32) bits of `value`. */
+    void put(uint32_t value, int32_t bits) {
+        if (bits <= 0) return;
+        const uint64_t mask = (uint64_t{1} << bits) - 1;
+        mAccumulator = (mAccumulator << bits) | (value & mask);
+        mPendingBits += bits;
+        while (mPendingBits >= 8) {
+            mPendingBits -= 8;
+            mOutput.push_back(static_cast<uint8_t>(mAccumulator >> mPendingBits));
+        }
+    }
+
+    void putSigned(int32_t value, int32_t bits) { put(static_cast<uint32_t>(value), bits); }
+
+    void putUnary(uint32_t zeros) {
+        while (zeros >= 32) {
+            put(0, 32);
+            zeros -= 32;
+        }
+        put(1, static_cast<int32_t>(zeros) + 1);
+    }
+
+    void putRice(int32_t residual, uint32_t parameter) {
+        const uint32_t folded = (static_cast<uint32_t>(residual) << 1)
+                ^ static_cast<uint32_t>(residual >> 31);
+        putUnary(folded >> parameter);
+        put(folded, static_cast<int32_t>(parameter));
+    }
+
+    void alignToByte() {
+        if (mPendingBits > 0) put(0, 8 - mPendingBits);
+    }
+
+private:
+    std::vector<uint8_t> &mOutput;
+    uint64_t mAccumulator = 0;
+    int32_t mPendingBits = 0;
+};
+
+int64_t fixedPrediction(const int32_t *samples, int32_t index, int32_t order) {
+    switch (order) {
+        case 0:
+            return 0;
+        case 1:
+            return samples[index - 1];
+        case 2:
+            return 2 * int64_t{samples[index - 1]} - samples[index - 2];
+        case 3:
+            return 3 * int64_t{samples[index - 1]} - 3 * int64_t{samples[index - 2]}
+                    + samples[index - 3];
+        default:
+            return 4 * int64_t{samples[index - 1]} - 6 * int64_t{samples[index - 2]}
+                    + 4 * int64_t{samples[index - 3]} - samples[index - 4];
+    }
+}
+
+struct SubframePlan {
+    enum class Kind : uint8_t { Constant, Verbatim, Fixed };
+
+    Kind kind = Kind::Verbatim;
+    int32_t order = 0;
+    int32_t partitionOrder = 0;
+    std::array<uint8_t, 1 << kMaxPartitionOrder> parameters{};
+    uint64_t bits = 0;
+};
+
+uint32_t bestRiceParameter(uint64_t foldedSum, uint64_t count, uint64_t &bits) {
+    uint32_t best = 0;
+    bits = std::numeric_limits<uint64_t>::max();
+    for (uint32_t parameter = 0; parameter <= kMaxRiceParameter; ++parameter) {
+        const uint64_t candidate = count * (parameter + 1) + (foldedSum >> parameter);
+        if (candidate < bits) {
+            bits = candidate;
+            best = parameter;
+        }
+    }
+    return best;
+}
+
+/** Pick the partition order and Rice parameters for residuals of `order`. */
+void planResidual(
+        const std::vector<int32_t> &residual,
+        int32_t frameCount,
+        int32_t order,
+        SubframePlan &plan) {
+    int32_t maxPartitionOrder = 0;
+    while (maxPartitionOrder < kMaxPartitionOrder
+           && frameCount % (1 << (maxPartitionOrder + 1)) == 0
+           && (frameCount >> (maxPartitionOrder + 1)) > order) {
+        ++maxPartitionOrder;
+    }
+
+    // Sum folded residuals per finest partition, then merge pairs upward.
+    std::array<uint64_t, 1 << kMaxPartitionOrder> sums{};
+    const int32_t finestSize = frameCount >> maxPartitionOrder;
+    for (int32_t index = order; index < frameCount; ++index) {
+        const int32_t value = residual[static_cast<size_t>(index - order)];
+        const uint32_t folded = (static_cast<uint32_t>(value) << 1)
+                ^ static_cast<uint32_t>(value >> 31);
+        sums[static_cast<size_t>(index / finestSize)] += folded;
+    }
+
+    plan.bits = std::numeric_limits<uint64_t>::max();
+    for (int32_t partitionOrder = maxPartitionOrder; partitionOrder >= 0; --partitionOrder) {
+        const int32_t partitions = 1 << partitionOrder;
+        const int32_t partitionSize = frameCount >> partitionOrder;
+        std::array<uint8_t, 1 << kMaxPartitionOrder> parameters{};
+        uint64_t bits = 6;  // coding method + partition order
+        for (int32_t partition = 0; partition < partitions; ++partition) {
+            const uint64_t count = static_cast<uint64_t>(
+                    partition == 0 ? partitionSize - order : partitionSize);
+            uint64_t partitionBits = 0;
+            parameters[static_cast<size_t>(partition)] = static_cast<uint8_t>(
+                    bestRiceParameter(sums[static_cast<size_t>(partition)], count, partitionBits));
+            bits += 4 + partitionBits;
+        }
+        if (bits < plan.bits) {
+            plan.bits = bits;
+            plan.partitionOrder = partitionOrder;
+            plan.parameters = parameters;
+        }
+        for (int32_t partition = 0; partition < partitions / 2; ++partition) {
+            sums[static_cast<size_t>(partition)] = sums[static_cast<size_t>(2 * partition)]
+                    + sums[static_cast<size_t>(2 * partition + 1)];
+        }
+    }
+}
+
+void computeResidual(
+        const int32_t *samples,
+        int32_t frameCount,
+        int32_t order,
+        std::vector<int32_t> &residual) {
+    residual.resize(static_cast<size_t>(frameCount - order));
+    for (int32_t index = order; index < frameCount; ++index) {
+        residual[static_cast<size_t>(index - order)] = static_cast<int32_t>(
+                samples[index] - fixedPrediction(samples, index, order));
+    }
+}
+
+SubframePlan planSubframe(
+        const int32_t *samples,
+        int32_t frameCount,
+        int32_t bitsPerSample,
+        std::vector<int32_t> &residual) {
+    SubframePlan plan;
+    const uint64_t headerBits = 8;
+    if (std::all_of(samples, samples + frameCount, [first = samples[0]](int32_t value) {
+            return value == first;
+        })) {
+        plan.kind = SubframePlan::Kind::Constant;
+        plan.bits = headerBits + static_cast<uint64_t>(bitsPerSample);
+        return plan;
+    }
+
+    plan.kind = SubframePlan::Kind::Verbatim;
+    plan.bits = headerBits + static_cast<uint64_t>(frameCount) * bitsPerSample;
+    if (frameCount <= kMaxFixedOrder) return plan;
+
+    // Absolute residual sums for every order in one pass choose the predictor.
+    std::array<uint64_t, kMaxFixedOrder + 1> errorSums{};
+    for (int32_t index = kMaxFixedOrder; index < frameCount; ++index) {
+        for (int32_t order = 0; order <= kMaxFixedOrder; ++order) {
+            const int64_t error = samples[index] - fixedPrediction(samples, index, order);
+            errorSums[static_cast<size_t>(order)] += static_cast<uint64_t>(error < 0 ? -error : error);
+        }
+    }
+    const int32_t order = static_cast<int32_t>(
+            std::min_element(errorSums.begin(), errorSums.end()) - errorSums.begin());
+
+    computeResidual(samples, frameCount, order, residual);
+    SubframePlan fixed;
+    fixed.kind = SubframePlan::Kind::Fixed;
+    fixed.order = order;
+    planResidual(residual, frameCount, order, fixed);
+    fixed.bits += headerBits + static_cast<uint64_t>(order) * bitsPerSample;
+    return fixed.bits < plan.bits ? fixed : plan;
+}
+
+void writeSubframe(
+        BitWriter &bits,
+        const SubframePlan &plan,
+        const int32_t *samples,
+        int32_t frameCount,
+        int32_t bitsPerSample,
+        std::vector<int32_t> &residual) {
+    bits.put(0, 1);
+    switch (plan.kind) {
+        case SubframePlan::Kind::Constant:
+            bits.put(0b000000, 6);
+            bits.put(0, 1);
+            bits.putSigned(samples[0], bitsPerSample);
+            return;
+        case SubframePlan::Kind::Verbatim:
+            bits.put(0b000001, 6);
+            bits.put(0, 1);
+            for (int32_t index = 0; index < frameCount; ++index) {
+                bits.putSigned(samples[index], bitsPerSample);
+            }
+            return;
+        case SubframePlan::Kind::Fixed:
+            break;
+    }
+
+    bits.put(0b001000 | static_cast<uint32_t>(plan.order), 6);
+    bits.put(0, 1);
+    for (int32_t index = 0; index < plan.order; ++index) {
+        bits.putSigned(samples[index], bitsPerSample);
+    }
+    computeResidual(samples, frameCount, plan.order, residual);
+    bits.put(0, 2);  // Rice coding with 4-bit parameters
+    bits.put(static_cast<uint32_t>(plan.partitionOrder), 4);
+    const int32_t partitionSize = frameCount >> plan.partitionOrder;
+    size_t next = 0;
+    for (int32_t partition = 0; partition < (1 << plan.partitionOrder); ++partition) {
+        const uint32_t parameter = plan.parameters[static_cast<size_t>(partition)];
+        bits.put(parameter, 4);
+        const int32_t count = partition == 0 ? partitionSize - plan.order : partitionSize;
+        for (int32_t index = 0; index < count; ++index) {
+            bits.putRice(residual[next++], parameter);
+        }
+    }
+}
+
+void putFrameIndex(BitWriter &bits, uint64_t value) {
+    // FLAC's extended UTF-8 coding of the frame number.
+    if (value < 0x80) {
+        bits.put(static_cast<uint32_t>(value), 8);
+        return;
+    }
+    int32_t continuationBytes = 1;
+    while (continuationBytes < 6 && value >= (uint64_t{1} << (5 * continuationBytes + 6))) {
+        ++continuationBytes;
+    }
+    const uint32_t leading = (0xff00u >> (continuationBytes + 1)) & 0xffu;
+    bits.put(leading | static_cast<uint32_t>(value >> (6 * continuationBytes)), 8);
+    for (int32_t byte = continuationBytes - 1; byte >= 0; --byte) {
+        bits.put(0x80u | static_cast<uint32_t>((value >> (6 * byte)) & 0x3f), 8);
+    }
+}
+
+}  // namespace
+
+void encodeFlacFrame(
+        const int16_t *interleaved,
+        int32_t frameCount,
+        int32_t channelCount,
+        uint64_t frameIndex,
+        std::vector<uint8_t> &output) {
+    if (interleaved == nullptr || frameCount <= 0 || frameCount > kMaxFrameSamples
+        || channelCount <= 0 || channelCount > 8) {
+        return;
+    }
+    const size_t frames = static_cast<size_t>(frameCount);
+    const size_t channels = static_cast<size_t>(channelCount);
+
+    // Planar channels, plus mid and side candidates for stereo.
+    std::vector<int32_t> planar(frames * (channels == 2 ? 4 : channels));
+    for (size_t frame = 0; frame < frames; ++frame) {
+        for (size_t channel = 0; channel < channels; ++channel) {
+            planar[channel * frames + frame] = interleaved[frame * channels + channel];
+        }
+    }
+    std::vector<int32_t> residual;
+    std::vector<const int32_t *> sources(channels);
+    std::vector<int32_t> depths(channels, kSampleBits);
+    std::vector<SubframePlan> plans(channels);
+    uint32_t assignment = static_cast<uint32_t>(channelCount - 1);
+
+    if (channels == 2) {
+        int32_t *left = planar.data();
+        int32_t *right = left + frames;
+        int32_t *mid = right + frames;
+        int32_t *side = mid + frames;
+        for (size_t frame = 0; frame < frames; ++frame) {
+            mid[frame] = (left[frame] + right[frame]) >> 1;
+            side[frame] = left[frame] - right[frame];
+        }
+        const SubframePlan leftPlan = planSubframe(left, frameCount, kSampleBits, residual);
+        const SubframePlan rightPlan = planSubframe(right, frameCount, kSampleBits, residual);
+        const SubframePlan midPlan = planSubframe(mid, frameCount, kSampleBits, residual);
+        const SubframePlan sidePlan = planSubframe(side, frameCount, kSampleBits + 1, residual);
+
+        const std::array<uint64_t, 4> costs = {
+            leftPlan.bits + rightPlan.bits,
+            leftPlan.bits + sidePlan.bits,
+            sidePlan.bits + rightPlan.bits,
+            midPlan.bits + sidePlan.bits,
+        };
+        switch (std::min_element(costs.begin(), costs.end()) - costs.begin()) {
+            case 0:
+                sources = {left, right};
+                plans = {leftPlan, rightPlan};
+                break;
+            case 1:
+                assignment = kLeftSideAssignment;
+                sources = {left, side};
+                depths = {kSampleBits, kSampleBits + 1};
+                plans = {leftPlan, sidePlan};
+                break;
+            case 2:
+                assignment = kRightSideAssignment;
+                sources = {side, right};
+                depths = {kSampleBits + 1, kSampleBits};
+                plans = {sidePlan, rightPlan};
+                break;
+            default:
+                assignment = kMidSideAssignment;
+                sources = {mid, side};
+                depths = {kSampleBits, kSampleBits + 1};
+                plans = {midPlan, sidePlan};
+                break;
+        }
+    } else {
+        for (size_t channel = 0; channel < channels; ++channel) {
+            sources[channel] = planar.data() + channel * frames;
+            plans[channel] = planSubframe(sources[channel], frameCount, kSampleBits, residual);
+        }
+    }
+
+    const size_t frameStart = output.size();
+    BitWriter bits(output);
+    bits.put(0xfff8, 16);  // sync code, fixed-blocksize stream
+    bits.put(0b0111, 4);   // 16-bit (blocksize - 1) follows the frame number
+    bits.put(0b0000, 4);   // sample rate from STREAMINFO
+    bits.put(assignment, 4);
+    bits.put(0b100, 3);    // 16 bits per sample
+    bits.put(0, 1);
+    putFrameIndex(bits, frameIndex);
+    bits.put(static_cast<uint32_t>(frameCount - 1), 16);
+    output.push_back(crc8(output.data() + frameStart, output.size() - frameStart));
+
+    for (size_t channel = 0; channel < channels; ++channel) {
+        writeSubframe(bits, plans[channel], sources[channel], frameCount, depths[channel], residual);
+    }
+    bits.alignToByte();
+    const uint16_t frameCrc = crc16(output.data() + frameStart, output.size() - frameStart);
+    output.push_back(static_cast<uint8_t>(frameCrc >> 8));
+    output.push_back(static_cast<uint8_t>(frameCrc & 0xff));
+}
+
+bool FlacWriter::open(const std::string &path, int32_t sampleRate, int32_t channelCount) {
+    close();
+    if (sampleRate <= 0 || sampleRate > 655'350 || channelCount <= 0 || channelCount > 8) {
+        return false;
+    }
+    mSampleRate = sampleRate;
+    mChannelCount = channelCount;
+    mFramesWritten = 0;
+    mFlacFrameCount = 0;
+    mMinFrameBytes = 0;
+    mMaxFrameBytes = 0;
+    mSawPartialFrame = false;
+    mFailed = false;
+    mPending.assign(static_cast<size_t>(kFlacBlockFrames) * channelCount, 0);
+    mPendingFrames = 0;
+    mFile.clear();
+    mFile.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!mFile.is_open()) return false;
+    writeHeader();
+    return mFile.good();
+}
+
+bool FlacWriter::write(const int16_t *samples, size_t frameCount) {
+    if (!mFile.is_open() || mFailed || mSawPartialFrame) return false;
+    if (samples == nullptr || frameCount == 0) return true;
+    const size_t channels = static_cast<size_t>(mChannelCount);
+    while (frameCount > 0) {
+        const size_t take = std::min(
+                frameCount,
+                static_cast<size_t>(kFlacBlockFrames) - mPendingFrames);
+        std::copy_n(samples, take * channels, mPending.data() + mPendingFrames * channels);
+        samples += take * channels;
+        frameCount -= take;
+        mPendingFrames += take;
+        if (mPendingFrames == static_cast<size_t>(kFlacBlockFrames) && !flushPending()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FlacWriter::flushPending() {
+    if (mPendingFrames == 0) return true;
+    const int32_t frames = static_cast<int32_t>(mPendingFrames);
+    mEncoded.clear();
+    encodeFlacFrame(mPending.data(), frames, mChannelCount, mFlacFrameCount, mEncoded);
+    mPendingFrames = 0;
+    return appendEncodedFrame(mEncoded.data(), mEncoded.size(), frames);
+}
+
+bool FlacWriter::appendEncodedFrame(
+        const uint8_t *bytes,
+        size_t byteCount,
+        int32_t frameCount) {
+    if (!mFile.is_open() || mFailed || mSawPartialFrame || mPendingFrames > 0) return false;
+    if (bytes == nullptr || byteCount == 0 || frameCount <= 0 || frameCount > kFlacBlockFrames
+        || byteCount > 0xffffff) {
+        return false;
+    }
+    if (static_cast<uint64_t>(frameCount) > kMaxTotalFrames - mFramesWritten) {
+        mFailed = true;
+        return false;
+    }
+    mFile.write(reinterpret_cast<const char *>(bytes), static_cast<std::streamsize>(byteCount));
+    if (!mFile.good()) {
+        mFailed = true;
+        return false;
+    }
+    const uint32_t size = static_cast<uint32_t>(byteCount);
+    mMinFrameBytes = mFlacFrameCount == 0 ? size : std::min(mMinFrameBytes, size);
+    mMaxFrameBytes = std::max(mMaxFrameBytes, size);
+    mFramesWritten += static_cast<uint64_t>(frameCount);
+    ++mFlacFrameCount;
+    mSawPartialFrame = frameCount < kFlacBlockFrames;
+    return true;
+}
+
+bool FlacWriter::close() {
+    if (!mFile.is_open()) return !mFailed;
+    if (!mFailed) flushPending();
+    if (!mFailed) {
+        mFile.seekp(0, std::ios::beg);
+        writeHeader();
+        mFile.flush();
+        if (!mFile.good()) mFailed = true;
+    }
+    mFile.close();
+    if (mFile.fail()) mFailed = true;
+    return !mFailed;
+}
+
+void FlacWriter::writeHeader() {
+    std::array<uint8_t, kHeaderBytes> header{};
+    std::copy_n("fLaC", 4, header.begin());
+    header[4] = 0x80;  // last metadata block, STREAMINFO
+    header[7] = 34;
+    uint8_t *info = header.data() + 8;
+    info[0] = static_cast<uint8_t>(kFlacBlockFrames >> 8);
+    info[1] = static_cast<uint8_t>(kFlacBlockFrames & 0xff);
+    info[2] = info[0];
+    info[3] = info[1];
+    for (int byte = 0; byte < 3; ++byte) {
+        info[4 + byte] = static_cast<uint8_t>(mMinFrameBytes >> (16 - 8 * byte));
+        info[7 + byte] = static_cast<uint8_t>(mMaxFrameBytes >> (16 - 8 * byte));
+    }
+    const uint64_t packed = (static_cast<uint64_t>(mSampleRate) << 44)
+            | (static_cast<uint64_t>(mChannelCount - 1) << 41)
+            | (static_cast<uint64_t>(kSampleBits - 1) << 36)
+            | mFramesWritten;
+    for (int byte = 0; byte < 8; ++byte) {
+        info[10 + byte] = static_cast<uint8_t>(packed >> (56 - 8 * byte));
+    }
+    mFile.write(
+            reinterpret_cast<const char *>(header.data()),
+            static_cast<std::streamsize>(header.size()));
+    if (!mFile.good()) mFailed = true;
+}
+
+}  // namespace tapstory
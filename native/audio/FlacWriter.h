@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace tapstory {
+
+/** Samples per FLAC frame. Every frame but the last uses exactly this size. */
+constexpr int32_t kFlacBlockFrames = 4'096;
+
+/**
+ * Encode one FLAC frame of interleaved PCM16 into `output` (appended).
+ *
+ * Frames are self-contained: fixed predictors of order 0-4 with partitioned
+ * Rice residuals, and for stereo the cheapest of independent, left/side,
+ * right/side or mid/side decorrelation. Because nothing is carried between
+ * frames, workers may encode disjoint blocks concurrently and hand the bytes
+ * to `FlacWriter::appendEncodedFrame` in order. `frameIndex` is the frame's
+ * position in the stream (sample offset / kFlacBlockFrames).
+ */
+void encodeFlacFrame(
+        const int16_t *interleaved,
+        int32_t frameCount,
+        int32_t channelCount,
+        uint64_t frameIndex,
+        std::vector<uint8_t> &output);
+
+/**
+ * Streaming 16-bit FLAC writer with the same open/write/close shape as
+ * WavWriter. STREAMINFO is written on open and patched on close with the total
+ * sample count and frame size bounds; the MD5 signature is left unset.
+ */
+class FlacWriter {
+public:
+    static constexpr size_t kHeaderBytes = 42;
+
+    FlacWriter() = default;
+    FlacWriter(const FlacWriter &) = delete;
+    FlacWriter &operator=(const FlacWriter &) = delete;
+    ~FlacWriter() { close(); }
+
+    bool open(const std::string &path, int32_t sampleRate, int32_t channelCount);
+
+    bool isOpen() const { return mFile.is_open(); }
+    bool failed() const { return mFailed; }
+    uint64_t frameCount() const { return mFramesWritten + mPendingFrames; }
+
+    /** Append interleaved PCM16 frames, encoding each completed block in place. */
+    bool write(const int16_t *samples, size_t frameCount);
+    /**
+     * Append one frame produced by `encodeFlacFrame`. Only full blocks may be
+     * followed by more frames, and buffered `write` input must not be pending.
+     */
+    bool appendEncodedFrame(const uint8_t *bytes, size_t byteCount, int32_t frameCount);
+
+    /** Flush the partial block, patch STREAMINFO and close. */
+    bool close();
+
+private:
+    static constexpr uint64_t kMaxTotalFrames = (uint64_t{1} << 36) - 1;
+
+    bool flushPending();
+    void writeHeader();
+
+    std::ofstream mFile;
+    int32_t mSampleRate = 0;
+    int32_t mChannelCount = 0;
+    uint64_t mFramesWritten = 0;
+    uint64_t mFlacFrameCount = 0;
+    uint32_t mMinFrameBytes = 0;
+    uint32_t mMaxFrameBytes = 0;
+    bool mSawPartialFrame = false;
+    bool mFailed = false;
+    std::vector<int16_t> mPending;
+    size_t mPendingFrames = 0;
+    std::vector<uint8_t> mEncoded;
+};
+
+}  // namespace tapstory
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace tapstory {
+
+/** Output length used by the load path: nearest frame at the target rate. */
+inline size_t resampledFrameCount(
+        size_t inputFrames,
+        int32_t inputSampleRate,
+        int32_t outputSampleRate) noexcept {
+    if (inputSampleRate <= 0 || outputSampleRate <= 0) return 0;
+    if (inputSampleRate == outputSampleRate) return inputFrames;
+    const uint64_t input = static_cast<uint64_t>(inputFrames);
+    return static_cast<size_t>((input * static_cast<uint64_t>(outputSampleRate)
+            + static_cast<uint64_t>(inputSampleRate / 2))
+            / static_cast<uint64_t>(inputSampleRate));
+}
+
+/** Nearest frame at `outputSampleRate` to `frame` at `inputSampleRate`. */
+inline int64_t rescaleFrame(int64_t frame, int32_t inputSampleRate, int32_t outputSampleRate) noexcept {
+    if (inputSampleRate <= 0 || outputSampleRate <= 0 || inputSampleRate == outputSampleRate) {
+        return frame;
+    }
+    const int64_t half = frame < 0 ? -(inputSampleRate / 2) : inputSampleRate / 2;
+    return (frame * outputSampleRate + half) / inputSampleRate;
+}
+
+/**
+ * Offline linear interpolation where output frame `i` reads source position
+ * `i * stepNumerator / stepDenominator`. Positions are stepped in integer
+ * arithmetic so long files do not accumulate floating-point phase error. The
+ * final source frame is held rather than read past the end. Frames hold
+ * `channelCount` interleaved samples that share one position.
+ */
+inline void resampleLinear(
+        const float *input,
+        size_t inputFrames,
+        float *output,
+        size_t outputFrames,
+        uint64_t stepNumerator,
+        uint64_t stepDenominator,
+        size_t channelCount = 1) noexcept {
+    if (input == nullptr || output == nullptr || inputFrames == 0 || stepDenominator == 0
+            || channelCount == 0) {
+        return;
+    }
+    const size_t last = inputFrames - 1;
+    const uint64_t wholeStep = stepNumerator / stepDenominator;
+    const uint64_t remainderStep = stepNumerator % stepDenominator;
+    const float denominator = static_cast<float>(stepDenominator);
+    uint64_t whole = 0;
+    uint64_t remainder = 0;
+    for (size_t frame = 0; frame < outputFrames; ++frame) {
+        const size_t lower = static_cast<size_t>(std::min<uint64_t>(whole, last));
+        const size_t upper = std::min(lower + 1, last);
+        const float fraction = lower == whole
+                ? static_cast<float>(remainder) / denominator
+                : 0.0f;
+        const float *lowerFrame = input + lower * channelCount;
+        const float *upperFrame = input + upper * channelCount;
+        float *outputFrame = output + frame * channelCount;
+        for (size_t channel = 0; channel < channelCount; ++channel) {
+            outputFrame[channel] = lowerFrame[channel]
+                    + (upperFrame[channel] - lowerFrame[channel]) * fraction;
+        }
+
+        whole += wholeStep;
+        remainder += remainderStep;
+        if (remainder >= stepDenominator) {
+            remainder -= stepDenominator;
+            ++whole;
+        }
+    }
+}
+
+/** Convert decoded interleaved audio at `inputSampleRate` to the negotiated device rate. */
+inline void resampleToRate(
+        const float *input,
+        size_t inputFrames,
+        int32_t inputSampleRate,
+        float *output,
+        size_t outputFrames,
+        int32_t outputSampleRate,
+        int32_t channelCount = 1) noexcept {
+    if (inputSampleRate <= 0 || outputSampleRate <= 0 || channelCount <= 0) return;
+    resampleLinear(
+            input,
+            inputFrames,
+            output,
+            outputFrames,
+            static_cast<uint64_t>(inputSampleRate),
+            static_cast<uint64_t>(outputSampleRate),
+            static_cast<size_t>(channelCount));
+}
+
+/**
+ * Stretch a raw capture to its exact timeline length. This is the native form
+ * of the bounded clock-drift correction applied when a take is finalized.
+ */
+inline void resampleToFrameCount(
+        const float *input,
+        size_t inputFrames,
+        float *output,
+        size_t outputFrames) noexcept {
+    if (outputFrames == 0) return;
+    resampleLinear(input, inputFrames, output, outputFrames, inputFrames, outputFrames);
+}
+
+}  // namespace tapstory
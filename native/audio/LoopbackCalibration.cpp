@@ -0,0 +1,109 @@
+#include "audio/LoopbackCalibration.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio/Mixer.h"
+#include "audio/OffsetEstimator.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kFadeSeconds = 0.005;
+
+int64_t secondsToFrames(double seconds, int32_t sampleRate) {
+    return static_cast<int64_t>(std::llround(seconds * sampleRate));
+}
+
+}  // namespace
+
+void LoopbackCalibration::prepare(int32_t sampleRate) {
+    mSampleRate = std::max<int32_t>(1, sampleRate);
+    mLeadInFrames = secondsToFrames(kLeadInSeconds, mSampleRate);
+    mMaxLatencyFrames = secondsToFrames(kMaxLatencySeconds, mSampleRate);
+
+    // Exponential sweep, limited to what phone speakers and mics reproduce and
+    // kept below Nyquist for low device rates.
+    const int64_t probeFrames = secondsToFrames(kProbeSeconds, mSampleRate);
+    const double endHz = std::min(kProbeEndHz, 0.45 * mSampleRate);
+    const double sweepRate = std::log(endHz / kProbeStartHz);
+    const double fadeFrames = kFadeSeconds * mSampleRate;
+    mProbe.assign(static_cast<size_t>(probeFrames), 0.0f);
+    for (int64_t frame = 0; frame < probeFrames; ++frame) {
+        const double time = static_cast<double>(frame) / mSampleRate;
+        const double phase = 2.0 * kPi * kProbeStartHz * kProbeSeconds / sweepRate
+                * (std::exp(sweepRate * time / kProbeSeconds) - 1.0);
+        const double edge = std::min<double>(frame, probeFrames - 1 - frame);
+        const double fade = edge < fadeFrames
+                ? 0.5 - 0.5 * std::cos(kPi * edge / fadeFrames)
+                : 1.0;
+        mProbe[static_cast<size_t>(frame)] =
+                static_cast<float>(kProbeAmplitude * fade * std::sin(phase));
+    }
+
+    mRecording.assign(static_cast<size_t>(mLeadInFrames + probeFrames + mMaxLatencyFrames), 0.0f);
+    mFramesProcessed.store(0, std::memory_order_release);
+    mShortInputFrames.store(0, std::memory_order_release);
+}
+
+void LoopbackCalibration::process(
+        const float *input,
+        int32_t inputFrames,
+        float *stereoOutput,
+        int32_t outputFrames,
+        int32_t inputChannelCount) noexcept {
+    const int32_t frames = std::max(0, outputFrames);
+    const int32_t available = input == nullptr ? 0 : std::clamp(inputFrames, 0, frames);
+    const int64_t first = mFramesProcessed.load(std::memory_order_relaxed);
+    const int64_t total = sessionFrames();
+    const int64_t probeFrames = static_cast<int64_t>(mProbe.size());
+
+    for (int32_t index = 0; index < frames; ++index) {
+        const int64_t frame = first + index;
+        const int64_t probeIndex = frame - mLeadInFrames;
+        const float sample = probeIndex >= 0 && probeIndex < probeFrames
+                ? mProbe[static_cast<size_t>(probeIndex)]
+                : 0.0f;
+        if (stereoOutput != nullptr) {
+            for (int32_t channel = 0; channel < kMixOutputChannelCount; ++channel) {
+                stereoOutput[index * kMixOutputChannelCount + channel] = sample;
+            }
+        }
+        if (frame < total && index < available) {
+            mRecording[static_cast<size_t>(frame)] =
+                    input[static_cast<size_t>(index) * inputChannelCount];
+        }
+    }
+
+    if (first < total) {
+        // Input frame i belongs to callback frame first + i, as in captureSlice.
+        const int64_t wanted = std::min<int64_t>(frames, total - first);
+        if (available < wanted) {
+            mShortInputFrames.fetch_add(wanted - available, std::memory_order_relaxed);
+        }
+        mFramesProcessed.store(first + frames, std::memory_order_release);
+    }
+}
+
+LoopbackCalibration::Result LoopbackCalibration::analyze() const {
+    Result result;
+    result.shortInputFrames = mShortInputFrames.load(std::memory_order_acquire);
+    if (mProbe.empty() || !isComplete()) return result;
+
+    const float *heard = mRecording.data() + mLeadInFrames;
+    const size_t heardFrames = mRecording.size() - static_cast<size_t>(mLeadInFrames);
+    const OffsetEstimate estimate = estimateAudioOffset(
+            mProbe.data(), mProbe.size(), heard, heardFrames, mMaxLatencyFrames);
+    // Output cannot be heard before it was written.
+    if (estimate.offsetSamples < 0) return result;
+
+    result.ok = true;
+    result.fractionalFrames = std::max(0.0, estimate.fractionalOffsetSamples);
+    result.compensationFrames = std::llround(result.fractionalFrames);
+    result.confidence = estimate.confidence;
+    return result;
+}
+
+}  // namespace tapstory
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace tapstory {
+
+/**
+ * On-device round-trip latency measurement through the duplex session.
+ *
+ * After a short silent lead-in the callback plays a band-limited exponential
+ * sweep on both output channels and records the input against the same
+ * callback frame counter the capture gate uses. Correlating the recording with
+ * the sweep therefore yields the compensation that `armCapture` expects: the
+ * number of frames between writing a sample and reading it back. A session
+ * lasts well under a second.
+ *
+ * `prepare` and `analyze` are control-thread operations; `process` is the only
+ * realtime entry point and never allocates.
+ */
+class LoopbackCalibration {
+public:
+    static constexpr double kLeadInSeconds = 0.1;
+    static constexpr double kProbeSeconds = 0.25;
+    /** Longest round trip that can be measured. */
+    static constexpr double kMaxLatencySeconds = 0.5;
+    static constexpr double kSessionSeconds = kLeadInSeconds + kProbeSeconds + kMaxLatencySeconds;
+    static constexpr double kProbeStartHz = 500.0;
+    static constexpr double kProbeEndHz = 8'000.0;
+    static constexpr float kProbeAmplitude = 0.5f;
+
+    struct Result {
+        bool ok = false;
+        int64_t compensationFrames = 0;
+        /** Round trip refined to a fraction of a frame. */
+        double fractionalFrames = 0.0;
+        /** Normalized correlation of the recording with the probe, 0...1. */
+        double confidence = 0.0;
+        /** Callback frames for which the device delivered no input. */
+        int64_t shortInputFrames = 0;
+    };
+
+    /** Allocate the probe and recording for a new session at `sampleRate`. */
+    void prepare(int32_t sampleRate);
+
+    /** Records the first of `inputChannelCount` interleaved input channels. */
+    void process(
+            const float *input,
+            int32_t inputFrames,
+            float *stereoOutput,
+            int32_t outputFrames,
+            int32_t inputChannelCount = 1) noexcept;
+
+    /** True once the listening window after the probe has been recorded. */
+    bool isComplete() const noexcept {
+        return mFramesProcessed.load(std::memory_order_acquire) >= sessionFrames();
+    }
+    int64_t sessionFrames() const noexcept { return static_cast<int64_t>(mRecording.size()); }
+    int32_t sampleRate() const noexcept { return mSampleRate; }
+
+    /** Correlate the recording with the probe; callbacks must have quiesced. */
+    Result analyze() const;
+
+private:
+    int32_t mSampleRate = 0;
+    int64_t mLeadInFrames = 0;
+    int64_t mMaxLatencyFrames = 0;
+    std::vector<float> mProbe;
+    std::vector<float> mRecording;
+    std::atomic<int64_t> mFramesProcessed{0};
+    std::atomic<int64_t> mShortInputFrames{0};
+};
+
+}  // namespace tapstory
@@ -0,0 +1,65 @@
+#include "audio/LosslessDecoder.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "audio/FlacReader.h"
+#include "audio/TrackStore.h"
+#include "audio/WavReader.h"
+
+namespace tapstory {
+
+namespace {
+
+bool decodeAtFileRate(
+        const std::string &path,
+        std::vector<int16_t> &pcm,
+        int32_t &channelCount,
+        int32_t &fileRate) {
+    char magic[4] = {};
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.read(magic, sizeof(magic))) return false;
+    }
+
+    if (std::memcmp(magic, "RIFF", 4) == 0) {
+        WavReader reader;
+        if (!reader.open(path) || reader.frameCount() <= 0) return false;
+        channelCount = reader.format().channelCount;
+        if (channelCount > kMaxTrackChannelCount) return false;
+        const auto frames = static_cast<size_t>(reader.frameCount());
+        pcm.resize(frames * static_cast<size_t>(channelCount));
+        fileRate = reader.format().sampleRate;
+        return reader.readPcm16(0, pcm.data(), frames) == frames;
+    }
+    if (std::memcmp(magic, "fLaC", 4) == 0) {
+        FlacReader reader;
+        if (!reader.open(path)) return false;
+        channelCount = reader.format().channelCount;
+        const auto channels = static_cast<size_t>(channelCount);
+        pcm.resize(static_cast<size_t>(reader.frameCount()) * channels);
+        fileRate = reader.format().sampleRate;
+        pcm.resize(reader.readPcm16(pcm.data(), pcm.size() / channels) * channels);
+        return !pcm.empty() && std::strlen(reader.error()) == 0;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool decodeLosslessFileAtFileRate(
+        const std::string &path,
+        std::vector<int16_t> &pcm,
+        int32_t &channelCount,
+        int32_t &sampleRate) {
+    pcm.clear();
+    channelCount = 0;
+    sampleRate = 0;
+    if (!decodeAtFileRate(path, pcm, channelCount, sampleRate) || sampleRate <= 0) {
+        pcm.clear();
+        return false;
+    }
+    return true;
+}
+
+}  // namespace tapstory
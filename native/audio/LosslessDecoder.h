@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tapstory {
+
+/**
+ * Decode a WAV or FLAC file, the formats the app writes itself, into
+ * interleaved PCM16 for `TrackStore::load`, keeping the file's channels and
+ * rate and reporting them in `channelCount` and `sampleRate`; the mixer
+ * converts the rate as the track plays. The file is mapped and decoded in
+ * place; wider samples keep their top 16 bits as `WavReader::readMonoPcm16`
+ * does. Returns false for any other format, leaving compressed audio to the
+ * platform decoders, for more channels than a track holds, or when the file
+ * is unreadable.
+ */
+bool decodeLosslessFileAtFileRate(
+        const std::string &path,
+        std::vector<int16_t> &pcm,
+        int32_t &channelCount,
+        int32_t &sampleRate);
+
+}  // namespace tapstory
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tapstory {
+
+/** Reported for signals with no block above the absolute gate. */
+constexpr double kSilenceLufs = -70.0;
+/** Level every track is normalized towards; leaves headroom for overlapping segments. */
+constexpr double kLoudnessTargetLufs = -18.0;
+/** Normalization never pushes a track's true peak above this. */
+constexpr double kTruePeakCeilingDbtp = -1.0;
+/** Quiet takes are lifted at most this far so room noise is not brought up with them. */
+constexpr double kMaxLoudnessGainDb = 12.0;
+
+struct LoudnessInfo {
+    /** Gated integrated loudness (ITU-R BS.1770 / EBU R128) over all channels. */
+    double integratedLufs = kSilenceLufs;
+    /** Peak of the 4x oversampled signal, in dB relative to full scale. */
+    double truePeakDbtp = kSilenceLufs;
+    /** False when the signal was too short or too quiet to gate. */
+    bool measured = false;
+};
+
+/**
+ * Measure integrated loudness and true peak of interleaved PCM16 at
+ * `sampleRate`. K-weighting is derived for the actual rate, so 44.1 kHz and
+ * 48 kHz tracks measure alike. Channel energies are summed with unit weights,
+ * and the true peak is the loudest channel's. Blocks are 400 ms with 75%
+ * overlap, gated at -70 LUFS and then 10 LU below the ungated mean. Signals
+ * shorter than one block report `measured == false`.
+ */
+LoudnessInfo measureLoudness(
+        const int16_t *pcm,
+        size_t frameCount,
+        int32_t sampleRate,
+        int32_t channelCount = 1);
+
+/**
+ * Linear gain that brings a measured track to `kLoudnessTargetLufs`, limited
+ * by the true-peak ceiling and the maximum boost. Unmeasured tracks get 1.
+ */
+float loudnessNormalizationGain(const LoudnessInfo &loudness) noexcept;
+
+}  // namespace tapstory
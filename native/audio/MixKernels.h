@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace tapstory {
+
+/** Callback frames [first, end) that a track covers; empty when `first >= end`. */
+struct TrackOverlap {
+    int32_t first = 0;
+    int32_t end = 0;
+};
+
+inline TrackOverlap trackOverlap(
+        int64_t lengthFrames,
+        int64_t trackOffset,
+        int32_t frameCount) noexcept {
+    if (frameCount <= 0 || trackOffset >= lengthFrames || trackOffset + frameCount <= 0) return {};
+    return {trackOffset < 0 ? static_cast<int32_t>(-trackOffset) : 0,
+            static_cast<int32_t>(std::min<int64_t>(frameCount, lengthFrames - trackOffset))};
+}
+
+/**
+ * Add the part of a mono track that overlaps one callback to an interleaved
+ * stereo buffer. `trackOffset` is the callback's first timeline frame minus
+ * the track's start frame and may be negative or past the end. `gain` scales
+ * the track as it is summed.
+ */
+inline void addMonoToStereo(
+        const float *samples,
+        int64_t lengthFrames,
+        int64_t trackOffset,
+        float *output,
+        int32_t frameCount,
+        float gain = 1.0f) noexcept {
+    if (samples == nullptr) return;
+    const TrackOverlap overlap = trackOverlap(lengthFrames, trackOffset, frameCount);
+    const float *source = samples + (trackOffset + overlap.first);
+    float *destination = output + static_cast<size_t>(overlap.first) * 2;
+    for (int32_t frame = overlap.first; frame < overlap.end; ++frame) {
+        const float sample = *source++ * gain;
+        destination[0] += sample;
+        destination[1] += sample;
+        destination += 2;
+    }
+}
+
+/** `addMonoToStereo` for an interleaved stereo track: a straight scaled add. */
+inline void addStereoToStereo(
+        const float *samples,
+        int64_t lengthFrames,
+        int64_t trackOffset,
+        float *output,
+        int32_t frameCount,
+        float gain = 1.0f) noexcept {
+    if (samples == nullptr) return;
+    const TrackOverlap overlap = trackOverlap(lengthFrames, trackOffset, frameCount);
+    const float *source = samples + (trackOffset + overlap.first) * 2;
+    float *destination = output + static_cast<size_t>(overlap.first) * 2;
+    const size_t count = static_cast<size_t>(std::max(0, overlap.end - overlap.first)) * 2;
+    for (size_t index = 0; index < count; ++index) destination[index] += source[index] * gain;
+}
+
+/**
+ * `addMonoToStereo` for interleaved tracks of any channel count, dispatching
+ * to the kernels above for one and two channels. Wider tracks are averaged
+ * to mono as they are summed, the same fold `downmixPcm16ToMono` applies.
+ */
+inline void addFramesToStereo(
+        const float *samples,
+        int32_t channelCount,
+        int64_t lengthFrames,
+        int64_t trackOffset,
+        float *output,
+        int32_t frameCount,
+        float gain = 1.0f) noexcept {
+    if (channelCount == 1) {
+        addMonoToStereo(samples, lengthFrames, trackOffset, output, frameCount, gain);
+        return;
+    }
+    if (channelCount == 2) {
+        addStereoToStereo(samples, lengthFrames, trackOffset, output, frameCount, gain);
+        return;
+    }
+    if (samples == nullptr || channelCount <= 0) return;
+    const TrackOverlap overlap = trackOverlap(lengthFrames, trackOffset, frameCount);
+    const auto channels = static_cast<size_t>(channelCount);
+    const float scale = gain / static_cast<float>(channelCount);
+    const float *source = samples + static_cast<size_t>(trackOffset + overlap.first) * channels;
+    float *destination = output + static_cast<size_t>(overlap.first) * 2;
+    for (int32_t frame = overlap.first; frame < overlap.end; ++frame) {
+        float sum = 0.0f;
+        for (size_t channel = 0; channel < channels; ++channel) sum += source[channel];
+        const float sample = sum * scale;
+        destination[0] += sample;
+        destination[1] += sample;
+        source += channels;
+        destination += 2;
+    }
+}
+
+inline void clampSamples(float *samples, size_t count) noexcept {
+    for (size_t index = 0; index < count; ++index) {
+        samples[index] = std::max(-1.0f, std::min(1.0f, samples[index]));
+    }
+}
+
+}  // namespace tapstory
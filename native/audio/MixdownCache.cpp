@@ -0,0 +1,145 @@
+#include "audio/MixdownCache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <utility>
+
+#include "audio/Mixer.h"
+#include "audio/OfflineMixdown.h"
+#include "audio/OrderedBlockPool.h"
+#include "audio/WavWriter.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr int64_t kBytesPerFrame = kMixOutputChannelCount * sizeof(int16_t);
+
+struct CachedBlock {
+    std::vector<int16_t> pcm;
+    int64_t blockIndex = 0;
+};
+
+}  // namespace
+
+MixdownCache::MixdownCache(std::string path, int32_t sampleRate, int32_t blockFrames)
+    : mPath(std::move(path)),
+      mSampleRate(sampleRate),
+      mBlockFrames(std::max<int32_t>(1'024, blockFrames)) {}
+
+std::vector<MixdownCache::BlockState> MixdownCache::describeBlocks(
+        const TrackStore &store) const {
+    const int64_t totalFrames = store.endFrame();
+    const int64_t blockCount = (totalFrames + mBlockFrames - 1) / mBlockFrames;
+    std::vector<BlockState> blocks(static_cast<size_t>(blockCount));
+    for (int64_t block = 0; block < blockCount; ++block) {
+        blocks[static_cast<size_t>(block)].frameCount = static_cast<int32_t>(
+                std::min<int64_t>(mBlockFrames, totalFrames - block * mBlockFrames));
+    }
+    // Store order is mix order, so each list matches the summation order.
+    for (const Track &track : store.tracks()) {
+        if (track.endFrame() <= 0) continue;
+        const int64_t first = std::max<int64_t>(0, track.startFrame) / mBlockFrames;
+        const int64_t last = (track.endFrame() - 1) / mBlockFrames;
+        for (int64_t block = first; block <= last; ++block) {
+            blocks[static_cast<size_t>(block)].contributors.push_back(track.fingerprint);
+        }
+    }
+    return blocks;
+}
+
+bool MixdownCache::fileMatchesBlocks() const {
+    if (mBlocks.empty()) return false;
+    int64_t frames = 0;
+    for (const BlockState &block : mBlocks) frames += block.frameCount;
+    std::ifstream file(mPath, std::ios::binary | std::ios::ate);
+    return file.is_open()
+            && static_cast<int64_t>(file.tellg())
+                    == static_cast<int64_t>(WavWriter::kHeaderBytes) + frames * kBytesPerFrame;
+}
+
+MixdownCache::UpdateResult MixdownCache::update(const TrackStore &store, int32_t workerCount) {
+    UpdateResult result;
+    if (mSampleRate <= 0) return result;
+    const auto renderStart = std::chrono::steady_clock::now();
+
+    std::vector<BlockState> blocks = describeBlocks(store);
+    const int64_t totalFrames = store.endFrame();
+    const uint64_t dataBytes = static_cast<uint64_t>(totalFrames) * kBytesPerFrame;
+    if (dataBytes > WavWriter::kMaxDataBytes) return result;
+
+    const bool incremental = fileMatchesBlocks();
+    std::vector<int64_t> dirty;
+    for (size_t block = 0; block < blocks.size(); ++block) {
+        if (!incremental || block >= mBlocks.size() || mBlocks[block] != blocks[block]) {
+            dirty.push_back(static_cast<int64_t>(block));
+        }
+    }
+
+    // Until this update succeeds the file contents are unknown.
+    mBlocks.clear();
+    std::fstream file;
+    file.open(
+            mPath,
+            incremental
+                    ? std::ios::binary | std::ios::in | std::ios::out
+                    : std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file.is_open()) return result;
+
+    const int32_t workers = resolveWorkerCount(workerCount, static_cast<int64_t>(dirty.size()));
+    auto produce = [&](int64_t item, CachedBlock &slot, std::vector<float> &scratch) {
+        const int64_t block = dirty[static_cast<size_t>(item)];
+        const int32_t frames = blocks[static_cast<size_t>(block)].frameCount;
+        slot.blockIndex = block;
+        slot.pcm.resize(static_cast<size_t>(frames) * kMixOutputChannelCount);
+        mixTracksToPcm16(store, block * mBlockFrames, frames, scratch, slot.pcm.data());
+    };
+    auto consume = [&](int64_t, const CachedBlock &slot) {
+        const int64_t offset = static_cast<int64_t>(WavWriter::kHeaderBytes)
+                + slot.blockIndex * mBlockFrames * kBytesPerFrame;
+        file.seekp(offset, std::ios::beg);
+        file.write(
+                reinterpret_cast<const char *>(slot.pcm.data()),
+                static_cast<std::streamsize>(slot.pcm.size() * sizeof(int16_t)));
+        return file.good();
+    };
+    bool succeeded = runOrderedBlocks<CachedBlock>(
+            static_cast<int64_t>(dirty.size()),
+            workers,
+            [] { return std::vector<float>(); },
+            produce,
+            consume);
+
+    if (succeeded) {
+        const auto header = WavWriter::makeHeader(
+                mSampleRate,
+                kMixOutputChannelCount,
+                static_cast<uint32_t>(dataBytes));
+        file.seekp(0, std::ios::beg);
+        file.write(
+                reinterpret_cast<const char *>(header.data()),
+                static_cast<std::streamsize>(header.size()));
+        file.flush();
+        succeeded = file.good();
+    }
+    file.close();
+    // A shorter chain leaves stale samples past the new end.
+    const off_t fileBytes = static_cast<off_t>(WavWriter::kHeaderBytes + dataBytes);
+    succeeded = succeeded && !file.fail() && ::truncate(mPath.c_str(), fileBytes) == 0;
+    if (!succeeded) return result;
+
+    mBlocks = std::move(blocks);
+    result.ok = true;
+    result.frameCount = totalFrames;
+    result.blockCount = static_cast<int64_t>(mBlocks.size());
+    result.renderedBlocks = static_cast<int64_t>(dirty.size());
+    result.workerCount = dirty.empty() ? 0 : workers;
+    result.renderSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - renderStart).count();
+    return result;
+}
+
+}  // namespace tapstory
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio/TrackStore.h"
+
+namespace tapstory {
+
+/**
+ * Incrementally maintained whole-chain mixdown.
+ *
+ * The cache owns a 16-bit stereo WAV covering timeline [0, store.endFrame())
+ * and splits it into fixed blocks. For every block it records the fingerprints
+ * of the tracks that overlapped it (in mix order) and the block's length. An
+ * update recomputes those lists, which is cheap, and re-renders only blocks
+ * whose list or length changed, writing them in place and patching the RIFF
+ * sizes. Appending a segment therefore costs the blocks that segment touches
+ * rather than the whole chain.
+ *
+ * Block bookkeeping lives in memory, so a new instance rebuilds the file once.
+ * Callers that need a stable snapshot copy the file before the next update.
+ */
+class MixdownCache {
+public:
+    static constexpr int32_t kDefaultBlockFrames = 65'536;
+
+    struct UpdateResult {
+        bool ok = false;
+        int64_t frameCount = 0;
+        int64_t blockCount = 0;
+        int64_t renderedBlocks = 0;
+        int32_t workerCount = 0;
+        double renderSeconds = 0.0;
+    };
+
+    MixdownCache(std::string path, int32_t sampleRate, int32_t blockFrames = kDefaultBlockFrames);
+
+    /** Bring the file up to date with `store`; the store must not change meanwhile. */
+    UpdateResult update(const TrackStore &store, int32_t workerCount = 0);
+    /** Forget block contents so the next update renders everything. */
+    void invalidate() noexcept { mBlocks.clear(); }
+
+    const std::string &path() const noexcept { return mPath; }
+    int32_t sampleRate() const noexcept { return mSampleRate; }
+    int32_t blockFrames() const noexcept { return mBlockFrames; }
+
+private:
+    struct BlockState {
+        int32_t frameCount = 0;
+        std::vector<uint64_t> contributors;
+
+        bool operator==(const BlockState &other) const {
+            return frameCount == other.frameCount && contributors == other.contributors;
+        }
+        bool operator!=(const BlockState &other) const { return !(*this == other); }
+    };
+
+    std::vector<BlockState> describeBlocks(const TrackStore &store) const;
+    bool fileMatchesBlocks() const;
+
+    std::string mPath;
+    int32_t mSampleRate = 0;
+    int32_t mBlockFrames = kDefaultBlockFrames;
+    // What the file on disk currently holds; empty means unknown.
+    std::vector<BlockState> mBlocks;
+};
+
+}  // namespace tapstory
@@ -0,0 +1,47 @@
+#include "audio/Mixer.h"
+
+#include <algorithm>
+
+#include "audio/MixKernels.h"
+
+namespace tapstory {
+
+void mixTracks(
+        const TrackStore &store,
+        int64_t timelineFrame,
+        float *stereoOutput,
+        int32_t frameCount) noexcept {
+    if (stereoOutput == nullptr || frameCount <= 0) return;
+    const size_t sampleCount = static_cast<size_t>(frameCount) * kMixOutputChannelCount;
+    std::fill_n(stereoOutput, sampleCount, 0.0f);
+
+    const int64_t endFrame = timelineFrame + frameCount;
+    const std::vector<Track> &tracks = store.tracks();
+    for (size_t index = store.firstTrackEndingAfter(timelineFrame); index < tracks.size(); ++index) {
+        const Track &track = tracks[index];
+        // Tracks are ordered by start frame, so nothing later can overlap.
+        if (track.startFrame >= endFrame) break;
+        if (track.resampler) {
+            track.resampler->addToStereo(
+                    track.pcm(),
+                    track.channelCount,
+                    track.lengthFrames,
+                    timelineFrame - track.startFrame,
+                    stereoOutput,
+                    frameCount,
+                    track.gain);
+            continue;
+        }
+        addFramesToStereo(
+                track.pcm(),
+                track.channelCount,
+                track.lengthFrames,
+                timelineFrame - track.startFrame,
+                stereoOutput,
+                frameCount,
+                track.gain);
+    }
+    clampSamples(stereoOutput, sampleCount);
+}
+
+}  // namespace tapstory
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+#include "audio/TrackStore.h"
+
+namespace tapstory {
+
+constexpr int32_t kMixOutputChannelCount = 2;
+
+/**
+ * Render timeline frames [timelineFrame, timelineFrame + frameCount) of every
+ * track, scaled by its gain and folded to stereo by `addFramesToStereo`, into
+ * interleaved stereo, overwriting `stereoOutput` and clamping the sum to
+ * [-1, 1]. Tracks at another rate than the timeline go through their
+ * resampler. Realtime safe: no allocation, locking, or I/O.
+ */
+void mixTracks(
+        const TrackStore &store,
+        int64_t timelineFrame,
+        float *stereoOutput,
+        int32_t frameCount) noexcept;
+
+}  // namespace tapstory
@@ -0,0 +1,123 @@
+#include "audio/OfflineMixdown.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "audio/FlacWriter.h"
+#include "audio/Mixer.h"
+#include "audio/OrderedBlockPool.h"
+#include "audio/PcmConversion.h"
+#include "audio/WavWriter.h"
+
+namespace tapstory {
+
+namespace {
+
+struct RenderedBlock {
+    std::vector<int16_t> pcm;
+    std::vector<uint8_t> encoded;
+    std::vector<uint32_t> encodedFrameBytes;
+    int32_t frameCount = 0;
+};
+
+}  // namespace
+
+void mixTracksToPcm16(
+        const TrackStore &store,
+        int64_t timelineFrame,
+        int32_t frameCount,
+        std::vector<float> &scratch,
+        int16_t *stereoOutput) {
+    if (stereoOutput == nullptr || frameCount <= 0) return;
+    const size_t samples = static_cast<size_t>(frameCount) * kMixOutputChannelCount;
+    if (scratch.size() < samples) scratch.resize(samples);
+    mixTracks(store, timelineFrame, scratch.data(), frameCount);
+    convertFloatToPcm16(scratch.data(), stereoOutput, samples);
+}
+
+MixdownResult renderMixdown(
+        const TrackStore &store,
+        int64_t startFrame,
+        int64_t endFrame,
+        const std::string &path,
+        const MixdownOptions &options) {
+    MixdownResult result;
+    if (startFrame < 0 || endFrame <= startFrame || options.sampleRate <= 0) return result;
+
+    const auto renderStart = std::chrono::steady_clock::now();
+    const bool flac = options.format == MixdownFormat::Flac;
+    const int64_t totalFrames = endFrame - startFrame;
+    const int32_t requestedBlock = std::max(options.blockFrames, kFlacBlockFrames);
+    const int32_t blockFrames = (requestedBlock + kFlacBlockFrames - 1)
+            / kFlacBlockFrames * kFlacBlockFrames;
+    const int64_t blockCount = (totalFrames + blockFrames - 1) / blockFrames;
+    const int32_t workerCount = resolveWorkerCount(options.workerCount, blockCount);
+
+    WavWriter wav;
+    FlacWriter flacWriter;
+    const bool opened = flac
+            ? flacWriter.open(path, options.sampleRate, kMixOutputChannelCount)
+            : wav.open(path, options.sampleRate, kMixOutputChannelCount);
+    if (!opened) return result;
+
+    auto produce = [&](int64_t block, RenderedBlock &slot, std::vector<float> &scratch) {
+        const int64_t blockStart = block * blockFrames;
+        const int32_t frames = static_cast<int32_t>(
+                std::min<int64_t>(blockFrames, totalFrames - blockStart));
+        slot.pcm.resize(static_cast<size_t>(frames) * kMixOutputChannelCount);
+        mixTracksToPcm16(store, startFrame + blockStart, frames, scratch, slot.pcm.data());
+        slot.frameCount = frames;
+        if (!flac) return;
+
+        slot.encoded.clear();
+        slot.encodedFrameBytes.clear();
+        for (int32_t offset = 0; offset < frames; offset += kFlacBlockFrames) {
+            const size_t before = slot.encoded.size();
+            encodeFlacFrame(
+                    slot.pcm.data() + static_cast<size_t>(offset) * kMixOutputChannelCount,
+                    std::min(kFlacBlockFrames, frames - offset),
+                    kMixOutputChannelCount,
+                    static_cast<uint64_t>((blockStart + offset) / kFlacBlockFrames),
+                    slot.encoded);
+            slot.encodedFrameBytes.push_back(static_cast<uint32_t>(slot.encoded.size() - before));
+        }
+    };
+    auto consume = [&](int64_t, const RenderedBlock &slot) {
+        if (!flac) return wav.write(slot.pcm.data(), static_cast<size_t>(slot.frameCount));
+        const uint8_t *bytes = slot.encoded.data();
+        int32_t remaining = slot.frameCount;
+        for (const uint32_t frameBytes : slot.encodedFrameBytes) {
+            const int32_t frames = std::min(kFlacBlockFrames, remaining);
+            if (!flacWriter.appendEncodedFrame(bytes, frameBytes, frames)) return false;
+            bytes += frameBytes;
+            remaining -= frames;
+        }
+        return true;
+    };
+
+    bool succeeded = runOrderedBlocks<RenderedBlock>(
+            blockCount,
+            workerCount,
+            [] { return std::vector<float>(); },
+            produce,
+            consume);
+    succeeded = (flac ? flacWriter.close() : wav.close()) && succeeded;
+    if (!succeeded) {
+        std::remove(path.c_str());
+        return result;
+    }
+
+    const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - renderStart).count();
+    result.ok = true;
+    result.frameCount = totalFrames;
+    result.workerCount = workerCount;
+    result.renderSeconds = seconds;
+    result.realtimeFactor = seconds > 0.0
+            ? static_cast<double>(totalFrames) / options.sampleRate / seconds
+            : 0.0;
+    return result;
+}
+
+}  // namespace tapstory
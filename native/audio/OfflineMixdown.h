@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio/TrackStore.h"
+
+namespace tapstory {
+
+enum class MixdownFormat : uint8_t {
+    Wav,
+    Flac,
+};
+
+struct MixdownOptions {
+    MixdownFormat format = MixdownFormat::Wav;
+    int32_t sampleRate = 48'000;
+    /** Render threads; zero uses the hardware concurrency. */
+    int32_t workerCount = 0;
+    /** Timeline frames per work item, rounded up to whole FLAC blocks. */
+    int32_t blockFrames = 65'536;
+};
+
+struct MixdownResult {
+    bool ok = false;
+    int64_t frameCount = 0;
+    int32_t workerCount = 0;
+    double renderSeconds = 0.0;
+    /** Seconds of audio rendered per second of wall-clock time. */
+    double realtimeFactor = 0.0;
+};
+
+/**
+ * Mix timeline frames [timelineFrame, timelineFrame + frameCount) with
+ * `mixTracks` and convert to the interleaved stereo PCM16 written by exports.
+ * `scratch` is grown as needed so workers can reuse it across blocks.
+ */
+void mixTracksToPcm16(
+        const TrackStore &store,
+        int64_t timelineFrame,
+        int32_t frameCount,
+        std::vector<float> &scratch,
+        int16_t *stereoOutput);
+
+/**
+ * Render timeline frames [startFrame, endFrame) of `store` to a 16-bit stereo
+ * WAV or FLAC file at `path`.
+ *
+ * Each work item is a block of timeline frames rendered with `mixTracks`, the
+ * same mixer the realtime callback uses, so the file matches what playback
+ * produces sample for sample. Workers render and encode blocks in parallel
+ * while the calling thread appends finished blocks in timeline order; at most
+ * two blocks per worker are held in memory at once.
+ *
+ * The store must not be mutated until this returns.
+ */
+MixdownResult renderMixdown(
+        const TrackStore &store,
+        int64_t startFrame,
+        int64_t endFrame,
+        const std::string &path,
+        const MixdownOptions &options);
+
+}  // namespace tapstory
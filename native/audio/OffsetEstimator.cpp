@@ -0,0 +1,159 @@
+#include "audio/OffsetEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "audio/Fft.h"
+
+namespace tapstory {
+
+namespace {
+
+template <typename Sample>
+std::vector<double> removeMean(const Sample *samples, size_t count) {
+    double sum = 0.0;
+    for (size_t index = 0; index < count; ++index) sum += samples[index];
+    const double mean = sum / static_cast<double>(count);
+    std::vector<double> centered(count);
+    for (size_t index = 0; index < count; ++index) centered[index] = samples[index] - mean;
+    return centered;
+}
+
+/** energy[i] is the sum of squares of samples[0, i). */
+std::vector<double> prefixEnergy(const std::vector<double> &samples) {
+    std::vector<double> energy(samples.size() + 1, 0.0);
+    for (size_t index = 0; index < samples.size(); ++index) {
+        energy[index + 1] = energy[index] + samples[index] * samples[index];
+    }
+    return energy;
+}
+
+template <typename Sample>
+OffsetEstimate estimate(
+        const Sample *referenceSamples,
+        size_t referenceCount,
+        const Sample *testSamples,
+        size_t testCount,
+        int64_t maxOffsetSamples) {
+    OffsetEstimate result;
+    if (referenceSamples == nullptr || testSamples == nullptr
+        || referenceCount == 0 || testCount == 0) {
+        return result;
+    }
+
+    const int64_t referenceLength = static_cast<int64_t>(referenceCount);
+    const int64_t testLength = static_cast<int64_t>(testCount);
+    const int64_t maxOffset = std::max<int64_t>(0, maxOffsetSamples);
+    const int64_t minimumOverlap = std::max<int64_t>(
+            32, std::min(referenceLength, testLength) / 4);
+    // Lags whose overlap could reach the minimum.
+    const int64_t lowestLag = std::max(-maxOffset, minimumOverlap - referenceLength);
+    const int64_t highestLag = std::min(maxOffset, testLength - minimumOverlap);
+    if (lowestLag > highestLag) return result;
+
+    const std::vector<double> reference = removeMean(referenceSamples, referenceCount);
+    const std::vector<double> test = removeMean(testSamples, testCount);
+    const std::vector<double> referenceEnergy = prefixEnergy(reference);
+    const std::vector<double> testEnergy = prefixEnergy(test);
+
+    // Circular correlation equals the linear one for the wanted lags as long
+    // as no other nonzero lag wraps onto them.
+    const Fft fft(static_cast<size_t>(std::max(
+            highestLag + referenceLength, testLength - lowestLag)));
+    const size_t size = fft.size();
+    std::vector<std::complex<double>> spectrum(size);
+    for (size_t index = 0; index < referenceCount; ++index) spectrum[index].real(reference[index]);
+    for (size_t index = 0; index < testCount; ++index) spectrum[index].imag(test[index]);
+    fft.forward(spectrum.data());
+
+    // Split the packed spectrum into R and T and form conj(R) * T. Both inputs
+    // are real, so the product is Hermitian and each pair is filled together.
+    for (size_t bin = 0; bin <= size / 2; ++bin) {
+        const size_t mirror = (size - bin) % size;
+        const std::complex<double> packed = spectrum[bin];
+        const std::complex<double> mirrored = std::conj(spectrum[mirror]);
+        const std::complex<double> referenceBin = 0.5 * (packed + mirrored);
+        const std::complex<double> differenceBin = 0.5 * (packed - mirrored);
+        // T = (packed - mirrored) / 2i
+        const std::complex<double> testBin(differenceBin.imag(), -differenceBin.real());
+        const std::complex<double> product(
+                referenceBin.real() * testBin.real() + referenceBin.imag() * testBin.imag(),
+                referenceBin.real() * testBin.imag() - referenceBin.imag() * testBin.real());
+        spectrum[bin] = product;
+        spectrum[mirror] = std::conj(product);
+    }
+    fft.inverse(spectrum.data());
+
+    // Negative for lags that are skipped.
+    const auto correlationAt = [&](int64_t lag) {
+        const int64_t referenceStart = std::max<int64_t>(0, -lag);
+        const int64_t testStart = std::max<int64_t>(0, lag);
+        const int64_t overlap = std::min(referenceLength - referenceStart, testLength - testStart);
+        if (lag < lowestLag || lag > highestLag || overlap < minimumOverlap) return -1.0;
+        const double energy = std::sqrt(
+                (referenceEnergy[static_cast<size_t>(referenceStart + overlap)]
+                        - referenceEnergy[static_cast<size_t>(referenceStart)])
+                * (testEnergy[static_cast<size_t>(testStart + overlap)]
+                        - testEnergy[static_cast<size_t>(testStart)]));
+        const size_t bin = lag >= 0
+                ? static_cast<size_t>(lag)
+                : size - static_cast<size_t>(-lag);
+        return energy > 0.0 ? std::abs(spectrum[bin].real() / energy) : 0.0;
+    };
+
+    double bestCorrelation = 0.0;
+    for (int64_t lag = lowestLag; lag <= highestLag; ++lag) {
+        const double correlation = correlationAt(lag);
+        if (correlation > bestCorrelation) {
+            bestCorrelation = correlation;
+            result.offsetSamples = lag;
+        }
+    }
+    result.confidence = std::min(1.0, bestCorrelation);
+    result.fractionalOffsetSamples = static_cast<double>(result.offsetSamples);
+
+    const int64_t peak = result.offsetSamples;
+    const double before = correlationAt(peak - 1);
+    const double after = correlationAt(peak + 1);
+    if (bestCorrelation > 0.0 && before >= 0.0 && after >= 0.0) {
+        const double curvature = before - 2.0 * bestCorrelation + after;
+        if (curvature < 0.0) {
+            const double shift = 0.5 * (before - after) / curvature;
+            result.fractionalOffsetSamples += std::clamp(shift, -0.5, 0.5);
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+OffsetEstimate estimateAudioOffset(
+        const double *reference,
+        size_t referenceCount,
+        const double *test,
+        size_t testCount,
+        int64_t maxOffsetSamples) {
+    return estimate(reference, referenceCount, test, testCount, maxOffsetSamples);
+}
+
+OffsetEstimate estimateAudioOffset(
+        const float *reference,
+        size_t referenceCount,
+        const float *test,
+        size_t testCount,
+        int64_t maxOffsetSamples) {
+    return estimate(reference, referenceCount, test, testCount, maxOffsetSamples);
+}
+
+OffsetEstimate estimateAudioOffset(
+        const int16_t *reference,
+        size_t referenceCount,
+        const int16_t *test,
+        size_t testCount,
+        int64_t maxOffsetSamples) {
+    return estimate(reference, referenceCount, test, testCount, maxOffsetSamples);
+}
+
+}  // namespace tapstory
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tapstory {
+
+struct OffsetEstimate {
+    /** Lag with the highest correlation; positive when `test` occurs later. */
+    int64_t offsetSamples = 0;
+    /** `offsetSamples` refined by a parabola through the neighbouring lags. */
+    double fractionalOffsetSamples = 0.0;
+    /** Absolute normalized correlation at the peak, 0...1. */
+    double confidence = 0.0;
+};
+
+/**
+ * Estimate the offset between two related signals by normalized
+ * cross-correlation over lags [-maxOffsetSamples, maxOffsetSamples].
+ *
+ * Matches `estimateAudioOffset` in backend/src/utils/audioCorrelation.ts: both
+ * signals have their global mean removed, each lag is normalized by the
+ * energy of the overlapping parts only, and lags overlapping fewer than
+ * max(32, shorter / 4) samples are skipped. The dot products for every lag
+ * come from one FFT of both signals packed as real and imaginary parts, so the
+ * cost is O(N log N) in the padded length instead of O(lags x overlap), and
+ * per-lag energies come from prefix sums.
+ *
+ * Allocates; not for the audio callback.
+ */
+OffsetEstimate estimateAudioOffset(
+        const double *reference,
+        size_t referenceCount,
+        const double *test,
+        size_t testCount,
+        int64_t maxOffsetSamples);
+OffsetEstimate estimateAudioOffset(
+        const float *reference,
+        size_t referenceCount,
+        const float *test,
+        size_t testCount,
+        int64_t maxOffsetSamples);
+OffsetEstimate estimateAudioOffset(
+        const int16_t *reference,
+        size_t referenceCount,
+        const int16_t *test,
+        size_t testCount,
+        int64_t maxOffsetSamples);
+
+}  // namespace tapstory
@@ -0,0 +1,125 @@
+#include "audio/OnsetEnvelope.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "audio/Mixer.h"
+
+namespace tapstory {
+
+namespace {
+
+// Keeps the int32 sum of PCM16 differences (at most 65'535 each) exact.
+constexpr size_t kMaxRunFrames = 32'768;
+constexpr int32_t kMixChunkFrames = 4'096;
+constexpr float kFloatToEnvelopeScale = 32'768.0f;
+
+// Each run is a plain reduction over adjacent samples so the compiler can
+// vectorize it; `previous` is the sample before `samples[0]`.
+int32_t sumAbsDifferences(const int16_t *samples, size_t count, int16_t previous) noexcept {
+    int32_t sum = std::abs(static_cast<int32_t>(samples[0]) - previous);
+    for (size_t index = 1; index < count; ++index) {
+        sum += std::abs(static_cast<int32_t>(samples[index]) - samples[index - 1]);
+    }
+    return sum;
+}
+
+float sumAbsDifferences(const float *samples, size_t count, float previous) noexcept {
+    float sum = std::fabs(samples[0] - previous);
+    for (size_t index = 1; index < count; ++index) {
+        sum += std::fabs(samples[index] - samples[index - 1]);
+    }
+    return sum * kFloatToEnvelopeScale;
+}
+
+}  // namespace
+
+int32_t OnsetEnvelope::blockFramesForRate(int32_t sampleRate) noexcept {
+    if (sampleRate <= 0) return 0;
+    return std::max<int32_t>(1, static_cast<int32_t>(std::lround(sampleRate / 2'000.0)));
+}
+
+void OnsetEnvelope::reset(int32_t blockFrames) {
+    mBlockFrames = std::max<int32_t>(0, blockFrames);
+    mBlockFill = 0;
+    mBlockSum = 0.0;
+    mPrevious = 0.0f;
+    mHasPrevious = false;
+    mValues.clear();
+}
+
+void OnsetEnvelope::reserveFrames(int64_t frameCount) {
+    if (mBlockFrames <= 0 || frameCount <= 0) return;
+    mValues.reserve(static_cast<size_t>((frameCount + mBlockFrames - 1) / mBlockFrames));
+}
+
+template <typename Sample>
+void OnsetEnvelope::appendSamples(const Sample *samples, size_t count) {
+    if (mBlockFrames <= 0 || samples == nullptr) return;
+    // Like the backend, the first sample of a signal has no onset.
+    if (!mHasPrevious && count > 0) {
+        mPrevious = static_cast<float>(samples[0]);
+        mHasPrevious = true;
+    }
+
+    size_t offset = 0;
+    while (offset < count) {
+        const size_t run = std::min({
+                count - offset,
+                static_cast<size_t>(mBlockFrames - mBlockFill),
+                kMaxRunFrames});
+        mBlockSum += sumAbsDifferences(samples + offset, run, static_cast<Sample>(mPrevious));
+        mPrevious = static_cast<float>(samples[offset + run - 1]);
+        mBlockFill += static_cast<int32_t>(run);
+        offset += run;
+        if (mBlockFill == mBlockFrames) {
+            mValues.push_back(static_cast<float>(mBlockSum));
+            mBlockSum = 0.0;
+            mBlockFill = 0;
+        }
+    }
+}
+
+void OnsetEnvelope::append(const int16_t *samples, size_t count) {
+    appendSamples(samples, count);
+}
+
+void OnsetEnvelope::append(const float *samples, size_t count) {
+    appendSamples(samples, count);
+}
+
+void OnsetEnvelope::finish() {
+    if (mBlockFill == 0) return;
+    mValues.push_back(static_cast<float>(mBlockSum));
+    mBlockSum = 0.0;
+    mBlockFill = 0;
+}
+
+std::vector<float> computeMixOnsetEnvelope(
+        const TrackStore &store,
+        int64_t startFrame,
+        int64_t endFrame,
+        int32_t blockFrames) {
+    OnsetEnvelope envelope(blockFrames);
+    if (blockFrames <= 0 || endFrame <= startFrame) return {};
+    envelope.reserveFrames(endFrame - startFrame);
+
+    // Both output channels carry the same mono sum, so the left one is the mix.
+    std::vector<float> stereo(static_cast<size_t>(kMixChunkFrames) * kMixOutputChannelCount);
+    std::vector<float> mono(kMixChunkFrames);
+    for (int64_t frame = startFrame; frame < endFrame; frame += kMixChunkFrames) {
+        const int32_t frames = static_cast<int32_t>(
+                std::min<int64_t>(kMixChunkFrames, endFrame - frame));
+        mixTracks(store, frame, stereo.data(), frames);
+        for (int32_t index = 0; index < frames; ++index) {
+            mono[static_cast<size_t>(index)] =
+                    stereo[static_cast<size_t>(index) * kMixOutputChannelCount];
+        }
+        envelope.append(mono.data(), static_cast<size_t>(frames));
+    }
+    envelope.finish();
+    return envelope.values();
+}
+
+}  // namespace tapstory
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "audio/TrackStore.h"
+
+namespace tapstory {
+
+/**
+ * Streaming onset envelope: the sum of absolute sample-to-sample differences
+ * over fixed blocks, in PCM16 units. This is the measure the backend's
+ * `createOnsetEnvelope` computes on whole files, so envelopes built here can be
+ * correlated against each other or against backend output directly.
+ *
+ * Samples may arrive in chunks of any size. The previous sample and the
+ * partial block carry across calls, so a signal fed in pieces produces the same
+ * envelope as the whole signal fed at once. Not thread-safe.
+ */
+class OnsetEnvelope {
+public:
+    /** 2 kHz blocks, matching the backend envelope correlation; zero for no rate. */
+    static int32_t blockFramesForRate(int32_t sampleRate) noexcept;
+
+    explicit OnsetEnvelope(int32_t blockFrames = 0) { reset(blockFrames); }
+
+    /** Clear the envelope; a non-positive block size disables accumulation. */
+    void reset(int32_t blockFrames);
+    /** Reserve room for `frameCount` input frames so appends do not reallocate. */
+    void reserveFrames(int64_t frameCount);
+
+    void append(const int16_t *samples, size_t count);
+    /** Float input is scaled to PCM16 units first. */
+    void append(const float *samples, size_t count);
+    /** Close the trailing partial block, if any. */
+    void finish();
+
+    int32_t blockFrames() const noexcept { return mBlockFrames; }
+    const std::vector<float> &values() const noexcept { return mValues; }
+
+private:
+    template <typename Sample>
+    void appendSamples(const Sample *samples, size_t count);
+
+    int32_t mBlockFrames = 0;
+    int32_t mBlockFill = 0;
+    double mBlockSum = 0.0;
+    float mPrevious = 0.0f;
+    bool mHasPrevious = false;
+    std::vector<float> mValues;
+};
+
+/**
+ * Envelope of the loaded tracks summed and clamped as the realtime mix plays
+ * them, over timeline frames [startFrame, endFrame). Block 0 starts at
+ * `startFrame`, so the result lines up with the envelope of a take that began
+ * there.
+ */
+std::vector<float> computeMixOnsetEnvelope(
+        const TrackStore &store,
+        int64_t startFrame,
+        int64_t endFrame,
+        int32_t blockFrames);
+
+}  // namespace tapstory
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tapstory {
+
+/** Worker threads for `itemCount` items: `requested`, or the hardware concurrency when zero. */
+inline int32_t resolveWorkerCount(int32_t requested, int64_t itemCount) {
+    const int32_t hardware = static_cast<int32_t>(std::thread::hardware_concurrency());
+    const int32_t workers = requested > 0 ? requested : std::max(1, hardware);
+    return static_cast<int32_t>(std::max<int64_t>(1, std::min<int64_t>(itemCount, workers)));
+}
+
+/**
+ * Run `produce(item, slot)` for items [0, itemCount) on `workerCount` threads
+ * and `consume(item, slot)` on the calling thread in ascending item order.
+ *
+ * Each worker keeps its own scratch state via `makeScratch()`, passed to
+ * `produce` as a third argument. At most two slots per worker are in flight, so
+ * memory stays bounded however many items there are. A `consume` returning
+ * false stops the remaining work; the function then returns false.
+ */
+template <typename Slot, typename MakeScratch, typename Produce, typename Consume>
+bool runOrderedBlocks(
+        int64_t itemCount,
+        int32_t workerCount,
+        MakeScratch &&makeScratch,
+        Produce &&produce,
+        Consume &&consume) {
+    if (itemCount <= 0) return true;
+    const int64_t window = std::min<int64_t>(
+            itemCount,
+            static_cast<int64_t>(std::max(1, workerCount)) * 2);
+
+    struct Entry {
+        Slot slot;
+        bool ready = false;
+    };
+    std::vector<Entry> entries(static_cast<size_t>(window));
+    std::mutex mutex;
+    std::condition_variable changed;
+    int64_t nextItem = 0;
+    int64_t consumedItems = 0;
+    bool aborted = false;
+
+    auto worker = [&] {
+        auto scratch = makeScratch();
+        for (;;) {
+            int64_t item = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                // An entry is reusable only once the item `window` positions
+                // earlier has been consumed.
+                changed.wait(lock, [&] {
+                    return aborted || nextItem >= itemCount || nextItem < consumedItems + window;
+                });
+                if (aborted || nextItem >= itemCount) return;
+                item = nextItem++;
+            }
+            Entry &entry = entries[static_cast<size_t>(item % window)];
+            produce(item, entry.slot, scratch);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            entry.ready = true;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(workerCount));
+    for (int32_t index = 0; index < std::max(1, workerCount); ++index) threads.emplace_back(worker);
+
+    bool succeeded = true;
+    for (int64_t item = 0; item < itemCount && succeeded; ++item) {
+        Entry &entry = entries[static_cast<size_t>(item % window)];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return entry.ready; });
+        }
+        succeeded = consume(item, entry.slot);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        entry.ready = false;
+        ++consumedItems;
+        aborted = !succeeded;
+        changed.notify_all();
+    }
+    for (std::thread &thread : threads) thread.join();
+    return succeeded;
+}
+
+}  // namespace tapstory
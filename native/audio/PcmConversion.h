@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace tapstory {
+
+constexpr float kPcm16ToFloatScale = 1.0f / 32768.0f;
+constexpr float kFloatToPcm16Scale = 32767.0f;
+
+inline float pcm16ToFloat(int16_t sample) noexcept {
+    return static_cast<float>(sample) * kPcm16ToFloatScale;
+}
+
+/** Clamp and truncate exactly as the capture path has always written PCM. */
+inline int16_t floatToPcm16(float sample) noexcept {
+    const float value = std::max(-1.0f, std::min(1.0f, sample));
+    return static_cast<int16_t>(value * kFloatToPcm16Scale);
+}
+
+inline void convertPcm16ToFloat(
+        const int16_t *source,
+        float *destination,
+        size_t count) noexcept {
+    for (size_t index = 0; index < count; ++index) {
+        destination[index] = pcm16ToFloat(source[index]);
+    }
+}
+
+inline void convertFloatToPcm16(
+        const float *source,
+        int16_t *destination,
+        size_t count) noexcept {
+    for (size_t index = 0; index < count; ++index) {
+        destination[index] = floatToPcm16(source[index]);
+    }
+}
+
+/**
+ * Average interleaved PCM16 frames into mono with the rounding
+ * `WavReader::readMonoPcm16` has always used: the floor of the mean for mono
+ * and stereo. Those two are plain add-and-shift loops that vectorize; other
+ * channel counts take the general path.
+ */
+inline void downmixPcm16ToMono(
+        const int16_t *interleaved,
+        int32_t channelCount,
+        int16_t *mono,
+        size_t frameCount) noexcept {
+    if (channelCount == 1) {
+        std::copy_n(interleaved, frameCount, mono);
+    } else if (channelCount == 2) {
+        for (size_t frame = 0; frame < frameCount; ++frame) {
+            const int32_t sum = int32_t{interleaved[2 * frame]} + interleaved[2 * frame + 1];
+            mono[frame] = static_cast<int16_t>(sum >> 1);
+        }
+    } else {
+        const auto channels = static_cast<size_t>(channelCount);
+        for (size_t frame = 0; frame < frameCount; ++frame) {
+            int64_t sum = 0;
+            for (size_t channel = 0; channel < channels; ++channel) {
+                sum += int64_t{interleaved[frame * channels + channel]} * 65'536;
+            }
+            mono[frame] = static_cast<int16_t>((sum / channelCount) >> 16);
+        }
+    }
+}
+
+/**
+ * `downmixPcm16ToMono` for planar integer channels of `bitsPerSample` bits,
+ * as lossless decoders produce them. Wider samples keep their top 16 bits.
+ */
+inline void downmixPlanarToMonoPcm16(
+        const int32_t *const *channels,
+        int32_t channelCount,
+        int32_t bitsPerSample,
+        int16_t *mono,
+        size_t frameCount) noexcept {
+    if (bitsPerSample == 16 && channelCount <= 2) {
+        const int32_t *left = channels[0];
+        const int32_t *right = channels[channelCount - 1];
+        for (size_t frame = 0; frame < frameCount; ++frame) {
+            mono[frame] = static_cast<int16_t>((left[frame] + right[frame]) >> 1);
+        }
+        return;
+    }
+    const int32_t scale = 32 - bitsPerSample;
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        int64_t sum = 0;
+        for (int32_t channel = 0; channel < channelCount; ++channel) {
+            sum += static_cast<int64_t>(channels[channel][frame]) * (int64_t{1} << scale);
+        }
+        mono[frame] = static_cast<int16_t>((sum / channelCount) >> 16);
+    }
+}
+
+/**
+ * Interleave planar integer channels of `bitsPerSample` bits into PCM16
+ * frames, keeping the top 16 bits of wider samples as the mono fold does.
+ */
+inline void interleavePlanarToPcm16(
+        const int32_t *const *channels,
+        int32_t channelCount,
+        int32_t bitsPerSample,
+        int16_t *interleaved,
+        size_t frameCount) noexcept {
+    const auto stride = static_cast<size_t>(channelCount);
+    for (int32_t channel = 0; channel < channelCount; ++channel) {
+        const int32_t *source = channels[channel];
+        int16_t *destination = interleaved + channel;
+        if (bitsPerSample <= 16) {
+            const int32_t shift = 16 - bitsPerSample;
+            for (size_t frame = 0; frame < frameCount; ++frame) {
+                destination[frame * stride] = static_cast<int16_t>(source[frame] * (1 << shift));
+            }
+        } else {
+            const int32_t shift = bitsPerSample - 16;
+            for (size_t frame = 0; frame < frameCount; ++frame) {
+                destination[frame * stride] = static_cast<int16_t>(source[frame] >> shift);
+            }
+        }
+    }
+}
+
+}  // namespace tapstory
@@ -0,0 +1,174 @@
+#include "audio/PeakPyramid.h"
+
+#include <algorithm>
+
+#include "audio/PcmConversion.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr uint16_t kPeakFileVersion = 1;
+
+int16_t toPcm16(int16_t sample) noexcept { return sample; }
+int16_t toPcm16(float sample) noexcept { return floatToPcm16(sample); }
+
+void putLittleEndian(std::vector<uint8_t> &bytes, uint64_t value, size_t width) {
+    for (size_t byte = 0; byte < width; ++byte) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+    }
+}
+
+}  // namespace
+
+size_t PeakPyramid::levelIndexFor(int32_t framesPerBin) noexcept {
+    size_t index = 0;
+    while (index + 1 < kLevelCount && kLevelFrames[index + 1] <= framesPerBin) ++index;
+    return index;
+}
+
+void PeakPyramid::allocate(int64_t capacityFrames) {
+    mCapacityFrames = std::max<int64_t>(0, capacityFrames);
+    for (size_t level = 0; level < kLevelCount; ++level) {
+        const int64_t bins = (mCapacityFrames + kLevelFrames[level] - 1) / kLevelFrames[level];
+        mBins[level].assign(static_cast<size_t>(bins) * 2, 0);
+    }
+    clear();
+}
+
+void PeakPyramid::clear() noexcept {
+    for (size_t level = 0; level < kLevelCount; ++level) {
+        mBinCounts[level].store(0, std::memory_order_release);
+        mPending[level] = Accumulator{};
+    }
+    mFrameCount.store(0, std::memory_order_release);
+    mTruncated.store(false, std::memory_order_release);
+}
+
+void PeakPyramid::closeBin(size_t level, int16_t minimum, int16_t maximum, int32_t frames) noexcept {
+    const size_t bin = mBinCounts[level].load(std::memory_order_relaxed);
+    mBins[level][bin * 2] = minimum;
+    mBins[level][bin * 2 + 1] = maximum;
+    mBinCounts[level].store(bin + 1, std::memory_order_release);
+    if (level + 1 < kLevelCount) fold(level + 1, minimum, maximum, frames);
+}
+
+void PeakPyramid::fold(size_t level, int16_t minimum, int16_t maximum, int32_t frames) noexcept {
+    Accumulator &pending = mPending[level];
+    if (pending.frames == 0) {
+        pending.minimum = minimum;
+        pending.maximum = maximum;
+    } else {
+        pending.minimum = std::min(pending.minimum, minimum);
+        pending.maximum = std::max(pending.maximum, maximum);
+    }
+    pending.frames += frames;
+    if (pending.frames < kLevelFrames[level]) return;
+
+    const Accumulator full = pending;
+    pending = Accumulator{};
+    closeBin(level, full.minimum, full.maximum, full.frames);
+}
+
+template <typename Sample>
+void PeakPyramid::appendSamples(const Sample *samples, size_t count) noexcept {
+    if (samples == nullptr || count == 0) return;
+    const int64_t frames = mFrameCount.load(std::memory_order_relaxed);
+    const auto room = static_cast<size_t>(std::max<int64_t>(0, mCapacityFrames - frames));
+    if (count > room) {
+        mTruncated.store(true, std::memory_order_release);
+        count = room;
+    }
+
+    size_t offset = 0;
+    while (offset < count) {
+        const size_t run = std::min(
+                count - offset,
+                static_cast<size_t>(kLevelFrames[0] - mPending[0].frames));
+        // A plain min/max reduction over the run, which the compiler vectorizes.
+        Sample minimum = samples[offset];
+        Sample maximum = minimum;
+        for (size_t index = offset + 1; index < offset + run; ++index) {
+            minimum = std::min(minimum, samples[index]);
+            maximum = std::max(maximum, samples[index]);
+        }
+        fold(0, toPcm16(minimum), toPcm16(maximum), static_cast<int32_t>(run));
+        offset += run;
+    }
+    mFrameCount.store(frames + static_cast<int64_t>(count), std::memory_order_release);
+}
+
+void PeakPyramid::append(const int16_t *samples, size_t count) noexcept {
+    appendSamples(samples, count);
+}
+
+void PeakPyramid::append(const float *samples, size_t count) noexcept {
+    appendSamples(samples, count);
+}
+
+void PeakPyramid::appendExtremes(int16_t minimum, int16_t maximum, int32_t frames) noexcept {
+    if (frames <= 0) return;
+    const int64_t done = mFrameCount.load(std::memory_order_relaxed);
+    const int64_t room = std::max<int64_t>(0, mCapacityFrames - done);
+    if (frames > room) {
+        mTruncated.store(true, std::memory_order_release);
+        frames = static_cast<int32_t>(room);
+    }
+
+    int32_t remaining = frames;
+    while (remaining > 0) {
+        const int32_t run = std::min(remaining, kLevelFrames[0] - mPending[0].frames);
+        fold(0, minimum, maximum, run);
+        remaining -= run;
+    }
+    mFrameCount.store(done + frames, std::memory_order_release);
+}
+
+void PeakPyramid::finish() noexcept {
+    // Closing a partial bin folds it into the next level, which is then
+    // partial itself and closed on the next iteration.
+    for (size_t level = 0; level < kLevelCount; ++level) {
+        const Accumulator partial = mPending[level];
+        if (partial.frames == 0) continue;
+        mPending[level] = Accumulator{};
+        closeBin(level, partial.minimum, partial.maximum, partial.frames);
+    }
+}
+
+PeakPyramid::Level PeakPyramid::level(size_t index) const noexcept {
+    if (index >= kLevelCount) return {};
+    Level view;
+    view.framesPerBin = kLevelFrames[index];
+    view.binCount = mBinCounts[index].load(std::memory_order_acquire);
+    view.minMax = mBins[index].data();
+    return view;
+}
+
+std::vector<uint8_t> encodePeakFile(const PeakPyramid &peaks, int32_t sampleRate) {
+    std::array<PeakPyramid::Level, PeakPyramid::kLevelCount> levels;
+    size_t pairCount = 0;
+    for (size_t index = 0; index < levels.size(); ++index) {
+        levels[index] = peaks.level(index);
+        pairCount += levels[index].binCount;
+    }
+
+    std::vector<uint8_t> bytes;
+    bytes.reserve(20 + levels.size() * 8 + pairCount * 4);
+    for (const char magic : {'T', 'S', 'P', 'K'}) bytes.push_back(static_cast<uint8_t>(magic));
+    putLittleEndian(bytes, kPeakFileVersion, 2);
+    putLittleEndian(bytes, levels.size(), 2);
+    putLittleEndian(bytes, static_cast<uint32_t>(std::max(0, sampleRate)), 4);
+    putLittleEndian(bytes, static_cast<uint64_t>(peaks.frameCount()), 8);
+    for (const PeakPyramid::Level &level : levels) {
+        putLittleEndian(bytes, static_cast<uint32_t>(level.framesPerBin), 4);
+        putLittleEndian(bytes, static_cast<uint32_t>(level.binCount), 4);
+    }
+    for (const PeakPyramid::Level &level : levels) {
+        for (size_t sample = 0; sample < level.binCount * 2; ++sample) {
+            putLittleEndian(bytes, static_cast<uint16_t>(level.minMax[sample]), 2);
+        }
+    }
+    return bytes;
+}
+
+}  // namespace tapstory
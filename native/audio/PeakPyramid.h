@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tapstory {
+
+/**
+ * Min/max waveform peaks at several resolutions, for drawing long chains
+ * without touching PCM.
+ *
+ * Storage is allocated once for a fixed number of input frames, so the level
+ * views handed to readers stay valid while a single producer keeps appending:
+ * each level publishes its completed bin count with release ordering after the
+ * bins are written. Samples past the capacity are dropped and reported by
+ * `truncated`. Appends never allocate.
+ */
+class PeakPyramid {
+public:
+    static constexpr size_t kLevelCount = 3;
+    /** Each level's bins are exactly four bins of the level below. */
+    static constexpr std::array<int32_t, kLevelCount> kLevelFrames{{256, 1'024, 4'096}};
+
+    struct Level {
+        int32_t framesPerBin = 0;
+        /** Interleaved [min, max] PCM16 pairs, one per completed bin. */
+        const int16_t *minMax = nullptr;
+        size_t binCount = 0;
+    };
+
+    /** The coarsest level whose bins are no wider than `framesPerBin`. */
+    static size_t levelIndexFor(int32_t framesPerBin) noexcept;
+
+    PeakPyramid() = default;
+    explicit PeakPyramid(int64_t capacityFrames) { allocate(capacityFrames); }
+
+    PeakPyramid(const PeakPyramid &) = delete;
+    PeakPyramid &operator=(const PeakPyramid &) = delete;
+
+    /** Size storage for `capacityFrames` input frames and clear. No readers may be active. */
+    void allocate(int64_t capacityFrames);
+    /** Start a new signal. Readers see empty levels from here on. */
+    void clear() noexcept;
+
+    void append(const int16_t *samples, size_t count) noexcept;
+    /** Float input is converted per bin exactly as capture converts samples. */
+    void append(const float *samples, size_t count) noexcept;
+    /**
+     * Append `frames` frames whose extremes are already known, such as PCM at
+     * another rate reduced per output bin. Every finest bin the frames reach
+     * takes these extremes, so spans should not cross a finest bin boundary.
+     */
+    void appendExtremes(int16_t minimum, int16_t maximum, int32_t frames) noexcept;
+    /** End the signal, publishing the trailing partial bin of every level. */
+    void finish() noexcept;
+
+    /** Safe to call while the producer appends. */
+    Level level(size_t index) const noexcept;
+    int64_t frameCount() const noexcept { return mFrameCount.load(std::memory_order_acquire); }
+    int64_t capacityFrames() const noexcept { return mCapacityFrames; }
+    bool truncated() const noexcept { return mTruncated.load(std::memory_order_acquire); }
+
+private:
+    struct Accumulator {
+        int16_t minimum = 0;
+        int16_t maximum = 0;
+        int32_t frames = 0;
+    };
+
+    template <typename Sample>
+    void appendSamples(const Sample *samples, size_t count) noexcept;
+    void closeBin(size_t level, int16_t minimum, int16_t maximum, int32_t frames) noexcept;
+    void fold(size_t level, int16_t minimum, int16_t maximum, int32_t frames) noexcept;
+
+    int64_t mCapacityFrames = 0;
+    std::array<std::vector<int16_t>, kLevelCount> mBins;
+    std::array<std::atomic<size_t>, kLevelCount> mBinCounts{};
+    std::array<Accumulator, kLevelCount> mPending{};
+    std::atomic<int64_t> mFrameCount{0};
+    std::atomic<bool> mTruncated{false};
+};
+
+/**
+ * Peak file shared by the backend CLI and the Node addon, little endian:
+ * "TSPK", u16 version, u16 level count, u32 sample rate, u64 frame count, then
+ * per level u32 frames per bin and u32 bin count, then each level's
+ * [min, max] int16 pairs in level order.
+ */
+std::vector<uint8_t> encodePeakFile(const PeakPyramid &peaks, int32_t sampleRate);
+
+}  // namespace tapstory
@@ -0,0 +1,255 @@
+#include "audio/PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio/LinearResampler.h"
+#include "audio/MixKernels.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+// About 60 dB of stopband for a window this short.
+constexpr double kKaiserBeta = 6.0;
+// Passband edge as a fraction of the lower rate's Nyquist frequency.
+constexpr double kPassband = 0.9;
+// Tap 0 reads this many frames before the frame an output position falls in.
+constexpr int32_t kTapsBefore = PolyphaseResampler::kTaps / 2 - 1;
+
+double besselI0(double x) {
+    const double quarterSquare = x * x / 4.0;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int index = 1; index < 64 && term > sum * 1e-12; ++index) {
+        term *= quarterSquare / (static_cast<double>(index) * index);
+        sum += term;
+    }
+    return sum;
+}
+
+}  // namespace
+
+PolyphaseResampler::PolyphaseResampler(int32_t inputSampleRate, int32_t outputSampleRate)
+        : mInputRate(std::max(0, inputSampleRate)),
+          mOutputRate(std::max(0, outputSampleRate)),
+          mTable(static_cast<size_t>(kPhases + 1) * kTaps, 0.0f) {
+    if (mInputRate == 0 || mOutputRate == 0) return;
+    // In cycles per input frame; downsampling moves it below the output's Nyquist.
+    const double cutoff = 0.5 * kPassband
+            * std::min(1.0, static_cast<double>(mOutputRate) / mInputRate);
+    const double halfSpan = kTaps / 2.0;
+    const double windowScale = 1.0 / besselI0(kKaiserBeta);
+    for (int32_t phase = 0; phase <= kPhases; ++phase) {
+        const double fraction = static_cast<double>(phase) / kPhases;
+        double coefficients[kTaps];
+        double sum = 0.0;
+        for (int32_t tap = 0; tap < kTaps; ++tap) {
+            const double distance = tap - kTapsBefore - fraction;
+            const double span = distance / halfSpan;
+            const double window = std::fabs(span) >= 1.0
+                    ? 0.0
+                    : besselI0(kKaiserBeta * std::sqrt(1.0 - span * span)) * windowScale;
+            const double argument = 2.0 * cutoff * distance;
+            const double sinc = argument == 0.0
+                    ? 1.0
+                    : std::sin(kPi * argument) / (kPi * argument);
+            coefficients[tap] = sinc * window;
+            sum += coefficients[tap];
+        }
+        // Unity gain at DC in every phase, so silence and offsets stay put.
+        float *row = mTable.data() + static_cast<size_t>(phase) * kTaps;
+        for (int32_t tap = 0; tap < kTaps; ++tap) {
+            row[tap] = static_cast<float>(coefficients[tap] / sum);
+        }
+    }
+}
+
+int64_t PolyphaseResampler::outputFrameCount(int64_t inputFrames) const noexcept {
+    if (inputFrames <= 0) return 0;
+    return static_cast<int64_t>(
+            resampledFrameCount(static_cast<size_t>(inputFrames), mInputRate, mOutputRate));
+}
+
+template <typename Emit>
+void PolyphaseResampler::render(
+        const float *samples,
+        int32_t channelCount,
+        int64_t lengthFrames,
+        int64_t outputOffset,
+        int32_t frameCount,
+        Emit emit) const noexcept {
+    if (samples == nullptr || channelCount <= 0 || mInputRate == 0 || mOutputRate == 0) return;
+    const TrackOverlap overlap =
+            trackOverlap(outputFrameCount(lengthFrames), outputOffset, frameCount);
+    if (overlap.first >= overlap.end) return;
+
+    const auto input = static_cast<uint64_t>(mInputRate);
+    const auto output = static_cast<uint64_t>(mOutputRate);
+    // Output frame n reads input position n * input / output, kept as a whole
+    // frame plus a remainder over `output` so it never drifts.
+    const uint64_t start = static_cast<uint64_t>(outputOffset + overlap.first) * input;
+    Cursor cursor;
+    cursor.whole = static_cast<int64_t>(start / output);
+    cursor.remainder = start % output;
+    cursor.wholeStep = input / output;
+    cursor.remainderStep = input % output;
+    cursor.denominator = output;
+    renderFrom(cursor, samples, channelCount, lengthFrames, overlap.first, overlap.end, emit);
+}
+
+template <typename Emit>
+void PolyphaseResampler::renderFrom(
+        Cursor cursor,
+        const float *samples,
+        int32_t channelCount,
+        int64_t lengthFrames,
+        int32_t firstFrame,
+        int32_t endFrame,
+        Emit emit) const noexcept {
+    const auto channels = static_cast<size_t>(channelCount);
+    int64_t whole = cursor.whole;
+    uint64_t remainder = cursor.remainder;
+    const uint64_t denominator = cursor.denominator;
+    const float phaseScale = static_cast<float>(kPhases) / static_cast<float>(denominator);
+
+    float coefficients[kTaps];
+    for (int32_t frame = firstFrame; frame < endFrame; ++frame) {
+        const float phasePosition = static_cast<float>(remainder) * phaseScale;
+        const auto phase = std::min(kPhases - 1, static_cast<int32_t>(phasePosition));
+        const float blend = phasePosition - static_cast<float>(phase);
+        const float *lower = mTable.data() + static_cast<size_t>(phase) * kTaps;
+        const float *upper = lower + kTaps;
+        for (int32_t tap = 0; tap < kTaps; ++tap) {
+            coefficients[tap] = lower[tap] + (upper[tap] - lower[tap]) * blend;
+        }
+
+        // Taps outside the track read silence.
+        const int64_t firstTap = whole - kTapsBefore;
+        const auto skipped = static_cast<int32_t>(std::max<int64_t>(0, -firstTap));
+        const auto used = static_cast<int32_t>(
+                std::min<int64_t>(kTaps, lengthFrames - firstTap)) - skipped;
+        if (used > 0) {
+            emit(frame,
+                 samples + static_cast<size_t>(firstTap + skipped) * channels,
+                 coefficients + skipped,
+                 used);
+        }
+
+        whole += static_cast<int64_t>(cursor.wholeStep);
+        remainder += cursor.remainderStep;
+        if (remainder >= denominator) {
+            remainder -= denominator;
+            ++whole;
+        }
+    }
+}
+
+void PolyphaseResampler::addToStereo(
+        const float *samples,
+        int32_t channelCount,
+        int64_t lengthFrames,
+        int64_t outputOffset,
+        float *output,
+        int32_t frameCount,
+        float gain) const noexcept {
+    if (output == nullptr) return;
+    if (channelCount == 1) {
+        render(samples, 1, lengthFrames, outputOffset, frameCount,
+               [output, gain](
+                       int32_t frame, const float *source, const float *taps, int32_t count) {
+                   float sum = 0.0f;
+                   for (int32_t tap = 0; tap < count; ++tap) sum += source[tap] * taps[tap];
+                   const float sample = sum * gain;
+                   output[frame * 2] += sample;
+                   output[frame * 2 + 1] += sample;
+               });
+        return;
+    }
+    if (channelCount == 2) {
+        render(samples, 2, lengthFrames, outputOffset, frameCount,
+               [output, gain](
+                       int32_t frame, const float *source, const float *taps, int32_t count) {
+                   float left = 0.0f;
+                   float right = 0.0f;
+                   for (int32_t tap = 0; tap < count; ++tap) {
+                       left += source[tap * 2] * taps[tap];
+                       right += source[tap * 2 + 1] * taps[tap];
+                   }
+                   output[frame * 2] += left * gain;
+                   output[frame * 2 + 1] += right * gain;
+               });
+        return;
+    }
+    // Wider tracks fold to mono, as addFramesToStereo folds them.
+    const auto channels = static_cast<size_t>(std::max(1, channelCount));
+    const float scale = gain / static_cast<float>(channels);
+    render(samples, channelCount, lengthFrames, outputOffset, frameCount,
+           [output, channels, scale](
+                   int32_t frame, const float *source, const float *taps, int32_t count) {
+               float sum = 0.0f;
+               for (int32_t tap = 0; tap < count; ++tap) {
+                   float fold = 0.0f;
+                   for (size_t channel = 0; channel < channels; ++channel) {
+                       fold += source[tap * channels + channel];
+                   }
+                   sum += fold * taps[tap];
+               }
+               const float sample = sum * scale;
+               output[frame * 2] += sample;
+               output[frame * 2 + 1] += sample;
+           });
+}
+
+void PolyphaseResampler::addMono(
+        const float *samples,
+        int64_t lengthFrames,
+        int64_t outputOffset,
+        float *output,
+        int32_t frameCount,
+        float gain) const noexcept {
+    if (output == nullptr) return;
+    render(samples, 1, lengthFrames, outputOffset, frameCount,
+           [output, gain](
+                   int32_t frame, const float *source, const float *taps, int32_t count) {
+               float sum = 0.0f;
+               for (int32_t tap = 0; tap < count; ++tap) sum += source[tap] * taps[tap];
+               output[frame] += sum * gain;
+           });
+}
+
+void PolyphaseResampler::addStereoAt(
+        const float *samples,
+        int64_t lengthFrames,
+        int64_t frame,
+        int64_t remainder,
+        int64_t step,
+        int64_t denominator,
+        float *output,
+        int32_t frameCount) const noexcept {
+    if (samples == nullptr || output == nullptr || frameCount <= 0 || step < 0
+            || denominator <= 0 || remainder < 0 || remainder >= denominator) {
+        return;
+    }
+    Cursor cursor;
+    cursor.whole = frame;
+    cursor.remainder = static_cast<uint64_t>(remainder);
+    cursor.wholeStep = static_cast<uint64_t>(step / denominator);
+    cursor.remainderStep = static_cast<uint64_t>(step % denominator);
+    cursor.denominator = static_cast<uint64_t>(denominator);
+    renderFrom(cursor, samples, 2, lengthFrames, 0, frameCount,
+               [output](
+                       int32_t outputFrame, const float *source, const float *taps, int32_t count) {
+                   float left = 0.0f;
+                   float right = 0.0f;
+                   for (int32_t tap = 0; tap < count; ++tap) {
+                       left += source[tap * 2] * taps[tap];
+                       right += source[tap * 2 + 1] * taps[tap];
+                   }
+                   output[outputFrame * 2] += left;
+                   output[outputFrame * 2 + 1] += right;
+               });
+}
+
+}  // namespace tapstory
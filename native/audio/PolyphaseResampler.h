@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tapstory {
+
+/**
+ * Streaming rate conversion for tracks whose PCM is at another rate than the
+ * timeline. A Kaiser-windowed sinc of kTaps taps, low-passed below the lower
+ * rate's Nyquist, is tabulated at kPhases fractional positions and adjacent
+ * phases are interpolated.
+ *
+ * The converter keeps no history between bursts: a track's PCM is entirely in
+ * memory, so the taps read the frames around each output position straight
+ * from it, and that position follows from the output frame in exact integer
+ * arithmetic. Seeks, loops and bursts of any size therefore render the same
+ * samples one long burst would. Immutable once built, so tracks at the same
+ * rate share one.
+ */
+class PolyphaseResampler {
+public:
+    static constexpr int32_t kTaps = 16;
+    static constexpr int32_t kPhases = 128;
+
+    PolyphaseResampler(int32_t inputSampleRate, int32_t outputSampleRate);
+
+    int32_t inputSampleRate() const noexcept { return mInputRate; }
+    int32_t outputSampleRate() const noexcept { return mOutputRate; }
+    /** Output frames covering `inputFrames`, rounded as `resampledFrameCount` does. */
+    int64_t outputFrameCount(int64_t inputFrames) const noexcept;
+
+    /**
+     * `addFramesToStereo` for a track at the input rate: output frames
+     * [outputOffset, outputOffset + frameCount) of the converted track are
+     * folded to stereo, scaled by `gain` and added to interleaved `output`.
+     * `outputOffset` may be negative or past the end. Realtime safe.
+     */
+    void addToStereo(
+            const float *samples,
+            int32_t channelCount,
+            int64_t lengthFrames,
+            int64_t outputOffset,
+            float *output,
+            int32_t frameCount,
+            float gain = 1.0f) const noexcept;
+    /** `addToStereo` for a mono track into a mono buffer. */
+    void addMono(
+            const float *samples,
+            int64_t lengthFrames,
+            int64_t outputOffset,
+            float *output,
+            int32_t frameCount,
+            float gain = 1.0f) const noexcept;
+    /**
+     * Varispeed reading of interleaved stereo `samples` with this converter's
+     * kernel: output frame k reads input position
+     * `frame + (remainder + k * step) / denominator`, so the caller carries
+     * the position across bursts exactly. Taps outside `lengthFrames` read
+     * silence. Adds to interleaved `output` like `addToStereo`. Realtime safe.
+     */
+    void addStereoAt(
+            const float *samples,
+            int64_t lengthFrames,
+            int64_t frame,
+            int64_t remainder,
+            int64_t step,
+            int64_t denominator,
+            float *output,
+            int32_t frameCount) const noexcept;
+
+private:
+    /** Input position of an output frame: `whole + remainder / denominator`. */
+    struct Cursor {
+        int64_t whole = 0;
+        uint64_t remainder = 0;
+        uint64_t wholeStep = 0;
+        uint64_t remainderStep = 0;
+        uint64_t denominator = 1;
+    };
+
+    template <typename Emit>
+    void render(
+            const float *samples,
+            int32_t channelCount,
+            int64_t lengthFrames,
+            int64_t outputOffset,
+            int32_t frameCount,
+            Emit emit) const noexcept;
+    template <typename Emit>
+    void renderFrom(
+            Cursor cursor,
+            const float *samples,
+            int32_t channelCount,
+            int64_t lengthFrames,
+            int32_t firstFrame,
+            int32_t endFrame,
+            Emit emit) const noexcept;
+
+    int32_t mInputRate = 0;
+    int32_t mOutputRate = 0;
+    /** kPhases + 1 rows of kTaps coefficients; row p is for fraction p / kPhases. */
+    std::vector<float> mTable;
+};
+
+}  // namespace tapstory
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 
@@ -12,6 +13,19 @@ struct CaptureSlice {
     int64_t firstTimelineFrame = -1;
 };
 
+/** A timeline span [startFrame, endFrame) kept as its own take. */
+struct PunchRange {
+    int64_t startFrame = 0;
+    int64_t endFrame = 0;
+};
+
+/** Where one punch range lies inside a finished, timeline-aligned take. */
+struct PunchTakeSpan {
+    int64_t offsetFrames = 0;
+    int64_t frameCount = 0;
+    int64_t firstTimelineFrame = -1;
+};
+
 struct TailDrainSlice {
     int32_t timelineFrames = 0;
     int64_t remainingFrames = 0;
@@ -58,6 +72,37 @@ inline CaptureSlice computeCaptureSlice(
     };
 }
 
+/**
+ * Ranges of one pass must be non-empty, start at or after zero, and be
+ * strictly ordered without overlap; adjacent ranges may share a boundary.
+ */
+inline bool arePunchRangesOrdered(const PunchRange *ranges, size_t count) noexcept {
+    if (ranges == nullptr || count == 0) return false;
+    int64_t previousEnd = 0;
+    for (size_t index = 0; index < count; ++index) {
+        const PunchRange &range = ranges[index];
+        if (range.startFrame < previousEnd || range.endFrame <= range.startFrame) return false;
+        previousEnd = range.endFrame;
+    }
+    return true;
+}
+
+/**
+ * Select `range` from a take whose frame 0 is timeline frame `takeStartFrame`
+ * and which holds `takeFrames` frames. A range the take only partly covers is
+ * clipped; one it never reached comes back empty.
+ */
+inline PunchTakeSpan punchTakeSpan(
+        const PunchRange &range,
+        int64_t takeStartFrame,
+        int64_t takeFrames) noexcept {
+    const int64_t first = std::max(range.startFrame, takeStartFrame);
+    const int64_t takeEnd = takeStartFrame + std::max<int64_t>(0, takeFrames);
+    const int64_t last = std::min(range.endFrame, takeEnd);
+    if (last <= first) return {};
+    return {first - takeStartFrame, last - first, first};
+}
+
 inline bool isExactCaptureOnset(
         int64_t actualStartFrame,
         int64_t compensatedPunchFrame) noexcept {
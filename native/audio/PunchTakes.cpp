@@ -0,0 +1,60 @@
+#include "audio/PunchTakes.h"
+
+#include <cstdio>
+#include <utility>
+
+#include "audio/WavReader.h"
+#include "audio/WavWriter.h"
+
+namespace tapstory {
+
+namespace {
+
+void removeTakes(std::vector<PunchTake> &takes) {
+    for (const PunchTake &take : takes) std::remove(take.path.c_str());
+    takes.clear();
+}
+
+}  // namespace
+
+bool writePunchTakes(
+        const std::string &takePath,
+        int64_t takeStartFrame,
+        const std::vector<PunchRange> &ranges,
+        const std::string &pathPrefix,
+        std::vector<PunchTake> &takes) {
+    takes.clear();
+    if (!arePunchRangesOrdered(ranges.data(), ranges.size())) return false;
+
+    WavReader reader;
+    if (!reader.open(takePath)) return false;
+    const int16_t *pcm = reader.pcm16();
+    if (pcm == nullptr) return false;
+    const int32_t channelCount = reader.format().channelCount;
+
+    for (size_t index = 0; index < ranges.size(); ++index) {
+        const PunchTakeSpan span =
+                punchTakeSpan(ranges[index], takeStartFrame, reader.frameCount());
+        if (span.frameCount <= 0) continue;
+
+        PunchTake take;
+        take.path = pathPrefix + std::to_string(index) + ".wav";
+        take.rangeIndex = index;
+        take.startFrame = span.firstTimelineFrame;
+        take.frameCount = span.frameCount;
+        WavWriter writer;
+        const bool written = writer.open(take.path, reader.format().sampleRate, channelCount)
+                && writer.write(
+                        pcm + static_cast<size_t>(span.offsetFrames) * channelCount,
+                        static_cast<size_t>(span.frameCount))
+                && writer.close();
+        takes.push_back(std::move(take));
+        if (!written) {
+            removeTakes(takes);
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace tapstory
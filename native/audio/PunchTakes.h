@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio/PunchCapture.h"
+
+namespace tapstory {
+
+/** One range cut from a multi-range pass, written as its own WAV. */
+struct PunchTake {
+    std::string path;
+    /** Index of the range this take was cut for. */
+    size_t rangeIndex = 0;
+    int64_t startFrame = 0;
+    int64_t frameCount = 0;
+};
+
+/**
+ * Cut each punch range out of a finished take: a PCM16 WAV whose frame 0
+ * is timeline frame `takeStartFrame`. Range i is written to
+ * `pathPrefix` + i + ".wav" with the take's channel count, reading the take
+ * in place through its mapping.
+ * Ranges the take never reached are skipped, so `takes` may be shorter than
+ * `ranges`. Returns false, removing what it wrote, when the ranges are not
+ * ordered or any file cannot be read or written.
+ */
+bool writePunchTakes(
+        const std::string &takePath,
+        int64_t takeStartFrame,
+        const std::vector<PunchRange> &ranges,
+        const std::string &pathPrefix,
+        std::vector<PunchTake> &takes);
+
+}  // namespace tapstory
@@ -9,23 +9,27 @@
 namespace tapstory {
 
 /**
- * Preallocated lock-free single-producer/single-consumer PCM ring.
+ * Preallocated lock-free single-producer/single-consumer PCM ring of
+ * interleaved frames with `channelCount` samples each. Counts and capacities
+ * are in frames; transfers always move whole frames.
  * `reset` must only be called while producer and consumer are quiescent.
  */
 class SpscPcmRing {
 public:
-    explicit SpscPcmRing(size_t capacityFrames)
-        : mStorage(std::max<size_t>(1, capacityFrames)) {}
+    explicit SpscPcmRing(size_t capacityFrames, int32_t channelCount = 1)
+        : mChannelCount(static_cast<size_t>(std::max(1, channelCount))),
+          mStorage(std::max<size_t>(1, capacityFrames) * mChannelCount) {}
 
     SpscPcmRing(const SpscPcmRing &) = delete;
     SpscPcmRing &operator=(const SpscPcmRing &) = delete;
 
-    size_t capacity() const noexcept { return mStorage.size(); }
+    size_t capacity() const noexcept { return mStorage.size() / mChannelCount; }
+    int32_t channelCount() const noexcept { return static_cast<int32_t>(mChannelCount); }
 
     size_t availableToRead() const noexcept {
         const uint64_t write = mWriteIndex.load(std::memory_order_acquire);
         const uint64_t read = mReadIndex.load(std::memory_order_acquire);
-        return static_cast<size_t>(write - read);
+        return static_cast<size_t>(write - read) / mChannelCount;
     }
 
     size_t availableToWrite() const noexcept {
@@ -38,18 +42,19 @@ public:
         const uint64_t write = mWriteIndex.load(std::memory_order_relaxed);
         const uint64_t read = mReadIndex.load(std::memory_order_acquire);
         const size_t writable = std::min(
-                frameCount,
-                capacity() - static_cast<size_t>(write - read));
+                frameCount * mChannelCount,
+                mStorage.size() - static_cast<size_t>(write - read));
         if (writable == 0) return 0;
 
-        const size_t start = static_cast<size_t>(write % capacity());
-        const size_t first = std::min(writable, capacity() - start);
+        const size_t start = static_cast<size_t>(write % mStorage.size());
+        const size_t first = std::min(writable, mStorage.size() - start);
         std::copy_n(source, first, mStorage.data() + start);
         std::copy_n(source + first, writable - first, mStorage.data());
         mWriteIndex.store(write + writable, std::memory_order_release);
-        return writable;
+        return writable / mChannelCount;
     }
 
+    /** `generator(i)` yields interleaved sample `i` of the frames being written. */
     template <typename Generator>
     size_t writeGenerated(size_t frameCount, Generator &&generator) noexcept {
         if (frameCount == 0) return 0;
@@ -57,12 +62,12 @@ public:
         const uint64_t write = mWriteIndex.load(std::memory_order_relaxed);
         const uint64_t read = mReadIndex.load(std::memory_order_acquire);
         const size_t writable = std::min(
-                frameCount,
-                capacity() - static_cast<size_t>(write - read));
+                frameCount * mChannelCount,
+                mStorage.size() - static_cast<size_t>(write - read));
         if (writable == 0) return 0;
 
-        const size_t start = static_cast<size_t>(write % capacity());
-        const size_t first = std::min(writable, capacity() - start);
+        const size_t start = static_cast<size_t>(write % mStorage.size());
+        const size_t first = std::min(writable, mStorage.size() - start);
         for (size_t index = 0; index < first; ++index) {
             mStorage[start + index] = generator(index);
         }
@@ -70,7 +75,7 @@ public:
             mStorage[index - first] = generator(index);
         }
         mWriteIndex.store(write + writable, std::memory_order_release);
-        return writable;
+        return writable / mChannelCount;
     }
 
     size_t read(int16_t *destination, size_t frameCount) noexcept {
@@ -78,15 +83,17 @@ public:
 
         const uint64_t read = mReadIndex.load(std::memory_order_relaxed);
         const uint64_t write = mWriteIndex.load(std::memory_order_acquire);
-        const size_t readable = std::min(frameCount, static_cast<size_t>(write - read));
+        const size_t readable = std::min(
+                frameCount * mChannelCount,
+                static_cast<size_t>(write - read));
         if (readable == 0) return 0;
 
-        const size_t start = static_cast<size_t>(read % capacity());
-        const size_t first = std::min(readable, capacity() - start);
+        const size_t start = static_cast<size_t>(read % mStorage.size());
+        const size_t first = std::min(readable, mStorage.size() - start);
         std::copy_n(mStorage.data() + start, first, destination);
         std::copy_n(mStorage.data(), readable - first, destination + first);
         mReadIndex.store(read + readable, std::memory_order_release);
-        return readable;
+        return readable / mChannelCount;
     }
 
     void reset() noexcept {
@@ -95,6 +102,8 @@ public:
     }
 
 private:
+    // Indices count samples and only ever advance by whole frames.
+    size_t mChannelCount;
     std::vector<int16_t> mStorage;
     alignas(64) std::atomic<uint64_t> mWriteIndex{0};
     alignas(64) std::atomic<uint64_t> mReadIndex{0};
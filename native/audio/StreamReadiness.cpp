@@ -0,0 +1,116 @@
+#include "audio/StreamReadiness.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tapstory {
+
+namespace {
+
+bool isValid(const StreamReadiness::Timestamp &timestamp) noexcept {
+    return timestamp.frame >= 0 && timestamp.nanos > 0;
+}
+
+bool movesForward(
+        const StreamReadiness::Timestamp &previous,
+        const StreamReadiness::Timestamp &current) noexcept {
+    return !isValid(previous)
+            || (current.frame >= previous.frame && current.nanos >= previous.nanos);
+}
+
+}  // namespace
+
+void StreamReadiness::arm(
+        int32_t expectedBurstFrames,
+        int32_t sampleRate,
+        int64_t startNanos,
+        int32_t requiredCallbacks) noexcept {
+    mExpectedBurstFrames = std::max(0, expectedBurstFrames);
+    mSampleRate = std::max(0, sampleRate);
+    mRequiredCallbacks = std::max(1, requiredCallbacks);
+    mStartNanos = startNanos;
+    mStableCallbacks = 0;
+    mUntimed = false;
+    mLastXrunCount = -1;
+    mRunOutput = {};
+    mRunInput = {};
+    mLastOutput = {};
+    mLastInput = {};
+    mReadyAfterNanos.store(-1, std::memory_order_release);
+}
+
+void StreamReadiness::observe(const Observation &observation) noexcept {
+    if (isReady()) return;
+    const int64_t elapsed = observation.nowNanos - mStartNanos;
+    if (observation.output.unimplemented || observation.input.unimplemented) {
+        mUntimed = true;
+    } else if (!mUntimed && elapsed >= kUntimedCeilingNanos
+            && (!isValid(observation.output) || !isValid(observation.input))) {
+        // Implemented but never valid on this route: treat it as absent.
+        mUntimed = true;
+    }
+    if (mUntimed && elapsed >= kUntimedCeilingNanos) {
+        markReady(observation.nowNanos);
+        return;
+    }
+
+    const bool stable = isStable(observation);
+    mLastXrunCount = observation.xrunCount;
+    mLastOutput = observation.output;
+    mLastInput = observation.input;
+    if (!stable) {
+        mStableCallbacks = 0;
+        return;
+    }
+
+    if (mStableCallbacks == 0) {
+        mRunOutput = observation.output;
+        mRunInput = observation.input;
+    }
+    if (++mStableCallbacks < mRequiredCallbacks) return;
+    // Timestamps are checked over the whole run: a single interval is only a
+    // burst or two long, so its rate is too coarse to judge.
+    if (!mUntimed
+            && (!progressesAtNominalRate(mRunOutput, observation.output)
+                    || !progressesAtNominalRate(mRunInput, observation.input))) {
+        mStableCallbacks = 1;
+        mRunOutput = observation.output;
+        mRunInput = observation.input;
+        return;
+    }
+    markReady(observation.nowNanos);
+}
+
+void StreamReadiness::markReady(int64_t nowNanos) noexcept {
+    mReadyAfterNanos.store(
+            std::max<int64_t>(0, nowNanos - mStartNanos), std::memory_order_release);
+}
+
+bool StreamReadiness::isStable(const Observation &observation) const noexcept {
+    const bool delivered = observation.frames > 0
+            && (mExpectedBurstFrames <= 0
+                    || observation.frames <= mExpectedBurstFrames * kMaxBurstMultiple);
+    // The first observation only establishes the xrun baseline.
+    const bool noNewXruns = observation.xrunCount < 0
+            ? mLastXrunCount < 0
+            : observation.xrunCount == mLastXrunCount;
+    if (mUntimed) return delivered && noNewXruns;
+    return delivered
+            && noNewXruns
+            && isValid(observation.output)
+            && isValid(observation.input)
+            && movesForward(mLastOutput, observation.output)
+            && movesForward(mLastInput, observation.input);
+}
+
+bool StreamReadiness::progressesAtNominalRate(
+        const Timestamp &first,
+        const Timestamp &last) const noexcept {
+    const int64_t frames = last.frame - first.frame;
+    const int64_t nanos = last.nanos - first.nanos;
+    if (frames <= 0 || nanos <= 0 || mSampleRate <= 0) return false;
+    const double rate = static_cast<double>(frames) * 1e9 / static_cast<double>(nanos);
+    return std::fabs(rate - mSampleRate) <= kRateTolerance * mSampleRate;
+}
+
+}  // namespace tapstory
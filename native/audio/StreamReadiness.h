@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace tapstory {
+
+/**
+ * Decides from the duplex callbacks themselves when freshly started streams
+ * have settled, instead of waiting a fixed time.
+ *
+ * The streams count as ready after `requiredCallbacks` consecutive callbacks
+ * that each deliver audio, at most kMaxBurstMultiple expected bursts, with no
+ * new xruns, and with the presentation timestamps of both streams valid and
+ * moving forward at the nominal rate. Any callback that breaks the run starts
+ * it again. Device timestamps only become valid once both streams have moved
+ * audio, so readiness also means route latency can be measured.
+ *
+ * Some routes have no presentation clock (OpenSL ES, some Bluetooth). When a
+ * stream reports timestamps as unimplemented, or they are still invalid after
+ * kUntimedCeilingNanos, the run only checks sizes and xruns, and the streams
+ * count as ready by kUntimedCeilingNanos at the latest, the fixed warmup this
+ * replaced.
+ *
+ * `arm` is a control-thread operation made while no callback runs; `observe`
+ * is the only realtime entry point.
+ */
+class StreamReadiness {
+public:
+    static constexpr int32_t kDefaultRequiredCallbacks = 8;
+    /** Timestamp progress may deviate this much from the nominal rate. */
+    static constexpr double kRateTolerance = 0.05;
+    /** Callbacks are not sized to the burst, so any up to this many bursts count. */
+    static constexpr int32_t kMaxBurstMultiple = 4;
+    static constexpr int64_t kUntimedCeilingNanos = 250'000'000;
+
+    /** Presentation clock of one stream; `frame` < 0 when unavailable. */
+    struct Timestamp {
+        int64_t frame = -1;
+        int64_t nanos = 0;
+        /** The stream has no presentation clock at all, not just none yet. */
+        bool unimplemented = false;
+    };
+
+    struct Observation {
+        int32_t frames = 0;
+        Timestamp output;
+        Timestamp input;
+        /** Input and output xruns so far, or -1 when the device does not report them. */
+        int32_t xrunCount = -1;
+        int64_t nowNanos = 0;
+    };
+
+    /** Start a new readiness run; `startNanos` is the reference for `readyAfterNanos`. */
+    void arm(
+            int32_t expectedBurstFrames,
+            int32_t sampleRate,
+            int64_t startNanos,
+            int32_t requiredCallbacks = kDefaultRequiredCallbacks) noexcept;
+    void observe(const Observation &observation) noexcept;
+
+    bool isReady() const noexcept { return readyAfterNanos() >= 0; }
+    /** Nanoseconds from `arm` to the callback that completed the run, else -1. */
+    int64_t readyAfterNanos() const noexcept {
+        return mReadyAfterNanos.load(std::memory_order_acquire);
+    }
+
+private:
+    bool isStable(const Observation &observation) const noexcept;
+    bool progressesAtNominalRate(const Timestamp &first, const Timestamp &last) const noexcept;
+    void markReady(int64_t nowNanos) noexcept;
+
+    int32_t mExpectedBurstFrames = 0;
+    int32_t mSampleRate = 0;
+    int32_t mRequiredCallbacks = kDefaultRequiredCallbacks;
+    int64_t mStartNanos = 0;
+    // Callback-thread state of the current run.
+    int32_t mStableCallbacks = 0;
+    bool mUntimed = false;
+    int32_t mLastXrunCount = -1;
+    Timestamp mRunOutput;
+    Timestamp mRunInput;
+    Timestamp mLastOutput;
+    Timestamp mLastInput;
+    std::atomic<int64_t> mReadyAfterNanos{-1};
+};
+
+}  // namespace tapstory
@@ -0,0 +1,285 @@
+#include "audio/TrackStore.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <future>
+
+#include "audio/ChainContainer.h"
+#include "audio/LinearResampler.h"
+#include "audio/PcmConversion.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001b3ULL;
+// Shorter tracks measure faster than a thread starts.
+constexpr int32_t kConcurrentLoudnessSeconds = 2;
+
+uint64_t mixFingerprint(uint64_t hash, uint64_t value) {
+    return (hash ^ value) * kFnvPrime;
+}
+
+uint64_t fingerprintTrack(
+        const std::string &trackId,
+        const int16_t *pcm,
+        int64_t sampleCount,
+        int64_t startFrame) {
+    uint64_t hash = kFnvOffsetBasis;
+    for (const char character : trackId) {
+        hash = mixFingerprint(hash, static_cast<unsigned char>(character));
+    }
+    hash = mixFingerprint(hash, static_cast<uint64_t>(startFrame));
+    hash = mixFingerprint(hash, static_cast<uint64_t>(sampleCount));
+    for (int64_t index = 0; index < sampleCount; ++index) {
+        hash = mixFingerprint(hash, static_cast<uint16_t>(pcm[index]));
+    }
+    return hash;
+}
+
+float monoSample(const float *frame, int32_t channelCount) noexcept {
+    float sum = 0.0f;
+    for (int32_t channel = 0; channel < channelCount; ++channel) sum += frame[channel];
+    return sum / static_cast<float>(channelCount);
+}
+
+// Peaks describe the mono fold on the timeline, so multichannel PCM is
+// averaged on the way in. PCM at another rate is never converted: each
+// finest timeline bin takes the extremes of the source frames it covers, so
+// building stays a single pass over the PCM however the rates differ.
+std::shared_ptr<const PeakPyramid> buildPeaks(const Track &track) {
+    auto peaks = std::make_shared<PeakPyramid>(track.timelineFrames);
+    const float *pcm = track.pcm();
+    const auto frames = static_cast<size_t>(track.lengthFrames);
+    if (track.resampler) {
+        constexpr int32_t kBinFrames = PeakPyramid::kLevelFrames[0];
+        int64_t sourceFirst = 0;
+        for (int64_t first = 0; first < track.timelineFrames; first += kBinFrames) {
+            const int64_t end = std::min<int64_t>(first + kBinFrames, track.timelineFrames);
+            // Every bin covers at least one source frame, even when upsampling.
+            const int64_t from = std::min(sourceFirst, track.lengthFrames - 1);
+            const int64_t sourceEnd = std::clamp<int64_t>(
+                    end * track.lengthFrames / track.timelineFrames, from + 1, track.lengthFrames);
+            float minimum = monoSample(pcm + from * track.channelCount, track.channelCount);
+            float maximum = minimum;
+            for (int64_t frame = from + 1; frame < sourceEnd; ++frame) {
+                const float sample =
+                        monoSample(pcm + frame * track.channelCount, track.channelCount);
+                minimum = std::min(minimum, sample);
+                maximum = std::max(maximum, sample);
+            }
+            peaks->appendExtremes(
+                    floatToPcm16(minimum),
+                    floatToPcm16(maximum),
+                    static_cast<int32_t>(end - first));
+            sourceFirst = sourceEnd;
+        }
+    } else if (track.channelCount == 1) {
+        peaks->append(pcm, frames);
+    } else {
+        const auto channels = static_cast<size_t>(track.channelCount);
+        std::array<float, 4'096> mono{};
+        for (size_t first = 0; first < frames; first += mono.size()) {
+            const size_t count = std::min(mono.size(), frames - first);
+            for (size_t frame = 0; frame < count; ++frame) {
+                mono[frame] = monoSample(pcm + (first + frame) * channels, track.channelCount);
+            }
+            peaks->append(mono.data(), count);
+        }
+    }
+    peaks->finish();
+    return peaks;
+}
+
+}  // namespace
+
+bool TrackStore::load(
+        const std::string &trackId,
+        const int16_t *pcm,
+        int32_t frameCount,
+        int64_t startFrame,
+        int32_t channelCount,
+        int32_t pcmSampleRate) {
+    if (pcm == nullptr || frameCount <= 0 || channelCount <= 0
+            || channelCount > kMaxTrackChannelCount) {
+        return false;
+    }
+
+    // Loudness reads the same PCM as conversion, so long tracks measure it on
+    // a second thread while this one converts.
+    const int32_t sampleRate = pcmSampleRate > 0 ? pcmSampleRate : mSampleRate;
+    const auto measure = [pcm, frameCount, sampleRate, channelCount] {
+        return measureLoudness(pcm, static_cast<size_t>(frameCount), sampleRate, channelCount);
+    };
+    std::future<LoudnessInfo> loudness;
+    if (sampleRate > 0 && frameCount >= sampleRate * kConcurrentLoudnessSeconds) {
+        loudness = std::async(std::launch::async, measure);
+    }
+
+    Track track;
+    track.id = trackId;
+    track.startFrame = startFrame;
+    track.lengthFrames = frameCount;
+    track.channelCount = channelCount;
+    track.sampleRate = sampleRate;
+    const size_t sampleCount = static_cast<size_t>(frameCount) * channelCount;
+    track.samples.resize(sampleCount);
+    convertPcm16ToFloat(pcm, track.samples.data(), sampleCount);
+    uint64_t fingerprint = fingerprintTrack(
+            trackId, pcm, static_cast<int64_t>(sampleCount), startFrame);
+    // Mono fingerprints predate channel counts and stay as they were.
+    if (channelCount != 1) {
+        fingerprint = mixFingerprint(fingerprint, static_cast<uint64_t>(channelCount));
+    }
+
+    if (loudness.valid()) {
+        track.loudness = loudness.get();
+    } else if (sampleRate > 0) {
+        track.loudness = measure();
+    }
+    track.gain = loudnessNormalizationGain(track.loudness);
+    // Renders depend on the gain too, so a changed target re-renders the track.
+    uint32_t gainBits = 0;
+    std::memcpy(&gainBits, &track.gain, sizeof(gainBits));
+    track.sourceFingerprint = mixFingerprint(fingerprint, gainBits);
+
+    place(track);
+    if (!track.resampler && channelCount == 1) {
+        auto peaks = std::make_shared<PeakPyramid>(frameCount);
+        peaks->append(pcm, static_cast<size_t>(frameCount));
+        peaks->finish();
+        track.peaks = std::move(peaks);
+    } else {
+        track.peaks = buildPeaks(track);
+    }
+    insert(std::move(track));
+    return true;
+}
+
+bool TrackStore::loadMapped(const std::shared_ptr<const ChainContainer> &chain, size_t index) {
+    if (!chain || index >= chain->segments().size()) return false;
+    const ChainSegment &segment = chain->segments()[index];
+
+    Track track;
+    track.id = segment.id;
+    // Segments store their placement at their own rate.
+    track.startFrame = rescaleFrame(segment.startFrame, segment.sampleRate, mSampleRate);
+    track.lengthFrames = segment.lengthFrames;
+    track.channelCount = segment.channelCount;
+    track.sampleRate = segment.sampleRate;
+    track.sourceFingerprint = segment.fingerprint;
+    track.loudness = segment.loudness;
+    track.gain = segment.gain;
+    track.mappedSamples = segment.samples;
+    track.chain = chain;
+    place(track);
+    insert(std::move(track));
+    return true;
+}
+
+size_t TrackStore::loadChain(const std::shared_ptr<const ChainContainer> &chain) {
+    if (!chain) return 0;
+    size_t loaded = 0;
+    for (size_t index = 0; index < chain->segments().size(); ++index) {
+        if (loadMapped(chain, index)) ++loaded;
+    }
+    return loaded;
+}
+
+void TrackStore::insert(Track track) {
+    // Keep insertion order among equal start frames so mixing stays stable.
+    // Chains load in timeline order, which makes this an append.
+    const auto position = std::upper_bound(
+            mTracks.begin(),
+            mTracks.end(),
+            track.startFrame,
+            [](int64_t frame, const Track &candidate) {
+                return frame < candidate.startFrame;
+            });
+    const auto index = static_cast<size_t>(position - mTracks.begin());
+    mTracks.insert(position, std::move(track));
+    mReachEnds.resize(mTracks.size());
+    for (size_t later = index; later < mTracks.size(); ++later) {
+        const int64_t previous = later > 0 ? mReachEnds[later - 1] : 0;
+        mReachEnds[later] = std::max(previous, mTracks[later].endFrame());
+    }
+}
+
+void TrackStore::place(Track &track) {
+    if (mSampleRate <= 0 || track.sampleRate <= 0 || track.sampleRate == mSampleRate) {
+        track.timelineFrames = track.lengthFrames;
+        track.resampler.reset();
+        track.fingerprint = track.sourceFingerprint;
+        return;
+    }
+    const auto shared = std::find_if(
+            mResamplers.begin(),
+            mResamplers.end(),
+            [&track](const std::shared_ptr<const PolyphaseResampler> &resampler) {
+                return resampler->inputSampleRate() == track.sampleRate;
+            });
+    if (shared != mResamplers.end()) {
+        track.resampler = *shared;
+    } else {
+        track.resampler = std::make_shared<PolyphaseResampler>(track.sampleRate, mSampleRate);
+        mResamplers.push_back(track.resampler);
+    }
+    track.timelineFrames = track.resampler->outputFrameCount(track.lengthFrames);
+    // Same content at another rate renders to different blocks.
+    track.fingerprint =
+            mixFingerprint(track.sourceFingerprint, static_cast<uint64_t>(mSampleRate));
+}
+
+void TrackStore::setTimelineRate(int32_t sampleRate) {
+    if (sampleRate <= 0) return;
+    if (mSampleRate <= 0) {
+        for (Track &track : mTracks) {
+            if (track.sampleRate <= 0) track.sampleRate = sampleRate;
+        }
+    } else if (mSampleRate != sampleRate) {
+        const int32_t previousRate = mSampleRate;
+        mSampleRate = sampleRate;
+        mResamplers.clear();
+        for (Track &track : mTracks) {
+            track.startFrame = rescaleFrame(track.startFrame, previousRate, sampleRate);
+            place(track);
+            track.peaks.reset();
+        }
+        // Rescaling is monotonic, so timeline order holds; only the ends move.
+        int64_t reach = 0;
+        for (size_t index = 0; index < mTracks.size(); ++index) {
+            reach = std::max(reach, mTracks[index].endFrame());
+            mReachEnds[index] = reach;
+        }
+    }
+    mSampleRate = sampleRate;
+}
+
+const Track *TrackStore::find(const std::string &trackId) const noexcept {
+    for (const Track &track : mTracks) {
+        if (track.id == trackId) return &track;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const PeakPyramid> TrackStore::peaks(const std::string &trackId) {
+    for (Track &track : mTracks) {
+        if (track.id != trackId) continue;
+        if (!track.peaks) track.peaks = buildPeaks(track);
+        return track.peaks;
+    }
+    return nullptr;
+}
+
+int64_t TrackStore::endFrame() const noexcept {
+    return mReachEnds.empty() ? 0 : mReachEnds.back();
+}
+
+size_t TrackStore::firstTrackEndingAfter(int64_t frame) const noexcept {
+    return static_cast<size_t>(
+            std::upper_bound(mReachEnds.begin(), mReachEnds.end(), frame) - mReachEnds.begin());
+}
+
+}  // namespace tapstory
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio/Loudness.h"
+#include "audio/PeakPyramid.h"
+#include "audio/PolyphaseResampler.h"
+
+namespace tapstory {
+
+class ChainContainer;
+
+/** Widest track `TrackStore::load` accepts, matching the WAV and FLAC writers. */
+constexpr int32_t kMaxTrackChannelCount = 8;
+
+struct Track {
+    std::string id;
+    /** Interleaved owned PCM; empty while the track views a mapped chain container. */
+    std::vector<float> samples;
+    /** PCM inside `chain`'s mapping, or null when the track owns `samples`. */
+    const float *mappedSamples = nullptr;
+    /** Keeps the mapping alive while the track views it. */
+    std::shared_ptr<const ChainContainer> chain;
+    /** Placement on the timeline, at the store's rate. */
+    int64_t startFrame = 0;
+    /** Frames of PCM, at `sampleRate`. */
+    int64_t lengthFrames = 0;
+    /** Samples per frame of the PCM; the mixer folds it to stereo. */
+    int32_t channelCount = 1;
+    /** Rate of the PCM, or zero while neither it nor the store's is known. */
+    int32_t sampleRate = 0;
+    /** Frames the track covers on the timeline, at the store's rate. */
+    int64_t timelineFrames = 0;
+    /** Converts the PCM to the store's rate as it plays; null when the rates match. */
+    std::shared_ptr<const PolyphaseResampler> resampler;
+    /**
+     * Hash of id, placement and PCM content. Reloading the same segment gives
+     * the same fingerprint, so derived renders can tell what actually changed.
+     */
+    uint64_t fingerprint = 0;
+    /**
+     * `fingerprint` of the PCM at its own rate, which chain containers record.
+     * Converted tracks fold the store's rate into `fingerprint`, so a route
+     * change and back gives the original again.
+     */
+    uint64_t sourceFingerprint = 0;
+    /**
+     * Built at load so timelines can draw the track without reading PCM, in
+     * timeline frames but from the PCM at its own rate, never through the
+     * resampler. Mapped tracks and tracks moved by `setTimelineRate` build theirs
+     * on first request through `TrackStore::peaks`, in one pass over the PCM.
+     */
+    std::shared_ptr<const PeakPyramid> peaks;
+    /** Measured at load when the store knows its sample rate. */
+    LoudnessInfo loudness;
+    /** Linear gain the mixer applies, bringing the track to the normalization target. */
+    float gain = 1.0f;
+
+    int64_t endFrame() const noexcept { return startFrame + timelineFrames; }
+    /** The track's interleaved PCM, `lengthFrames` frames long, wherever it lives. */
+    const float *pcm() const noexcept {
+        return mappedSamples != nullptr ? mappedSamples : samples.data();
+    }
+};
+
+/**
+ * Decoded tracks kept in timeline order. Tracks keep the channel count and
+ * rate of their source, interleaved frame by frame, so stereo imports play
+ * without a downmix and neither loads nor route changes resample PCM: a
+ * track at another rate than the store's plays through a shared
+ * `PolyphaseResampler`. Peaks describe the mono fold on the timeline.
+ *
+ * Mutation is a control-thread operation. Platform adapters only call `load`
+ * or `clear` while no render callback can be reading the store; the mixer then
+ * reads it without locks.
+ */
+class TrackStore {
+public:
+    /**
+     * Load `frameCount` frames of interleaved PCM16 with `channelCount`
+     * channels at `sampleRate`, or at the store's rate when zero. `startFrame`
+     * is at the store's rate.
+     */
+    bool load(
+            const std::string &trackId,
+            const int16_t *pcm,
+            int32_t frameCount,
+            int64_t startFrame,
+            int32_t channelCount = 1,
+            int32_t sampleRate = 0);
+    /**
+     * Add segment `index` of `chain` as a track that views the mapping in
+     * place. Loudness, gain and fingerprint come from the index, so nothing
+     * is converted or measured and the load is O(1) in the segment length,
+     * whatever rate the segment was stored at. Returns false for an unknown
+     * segment.
+     */
+    bool loadMapped(const std::shared_ptr<const ChainContainer> &chain, size_t index);
+    /** `loadMapped` for every segment of `chain`; returns how many loaded. */
+    size_t loadChain(const std::shared_ptr<const ChainContainer> &chain);
+    void clear() noexcept {
+        mTracks.clear();
+        mReachEnds.clear();
+        mResamplers.clear();
+    }
+
+    /**
+     * Rate of the timeline and the default rate of PCM passed to `load`. Once
+     * set, each load also measures the track's loudness, concurrently with its
+     * conversion, and derives its normalization gain. Affects tracks loaded
+     * afterwards.
+     */
+    void setSampleRate(int32_t sampleRate) noexcept { mSampleRate = sampleRate; }
+    int32_t sampleRate() const noexcept { return mSampleRate; }
+    /**
+     * Move the timeline to a new stream rate after the route changed under
+     * the loaded tracks. No PCM is converted: PCM, mappings, loudness and
+     * gain are kept, placements are rescaled to the nearest frame, each track
+     * gets the resampler the mixer converts it through, or none once its rate
+     * matches, and peaks are rebuilt on the next request. Tracks loaded
+     * before any rate was known are only relabelled.
+     */
+    void setTimelineRate(int32_t sampleRate);
+
+    const std::vector<Track> &tracks() const noexcept { return mTracks; }
+    /** First track loaded with `trackId`, or null. */
+    const Track *find(const std::string &trackId) const noexcept;
+    /**
+     * Peaks of the first track loaded with `trackId`, built now if it was
+     * mapped without them. Null for an unknown track. The mixer never reads
+     * peaks, so this may run while it plays.
+     */
+    std::shared_ptr<const PeakPyramid> peaks(const std::string &trackId);
+    size_t size() const noexcept { return mTracks.size(); }
+    bool empty() const noexcept { return mTracks.empty(); }
+    /** Exclusive end of the latest-ending track, or zero when empty. */
+    int64_t endFrame() const noexcept;
+    /**
+     * Index of the first track that can still be sounding at `frame`; every
+     * earlier track has ended by then. A binary search, so repositioning the
+     * mix after a seek is O(log N) however long the chain is.
+     */
+    size_t firstTrackEndingAfter(int64_t frame) const noexcept;
+
+private:
+    void insert(Track track);
+    /** Set `timelineFrames` and `resampler` from the track's rate and the store's. */
+    void place(Track &track);
+
+    std::vector<Track> mTracks;
+    /** mReachEnds[i] is the latest end frame among tracks [0, i]; non-decreasing. */
+    std::vector<int64_t> mReachEnds;
+    int32_t mSampleRate = 0;
+    /** One per source rate in use, converting to mSampleRate. */
+    std::vector<std::shared_ptr<const PolyphaseResampler>> mResamplers;
+};
+
+}  // namespace tapstory
@@ -0,0 +1,270 @@
+#include "audio/WavReader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "audio/PcmConversion.h"
+
+namespace tapstory {
+
+namespace {
+
+constexpr uint16_t kFormatPcm = 1;
+constexpr uint16_t kFormatFloat = 3;
+constexpr uint16_t kFormatExtensible = 0xfffe;
+constexpr float kInt32ToFloatScale = 1.0f / 2'147'483'648.0f;
+
+uint16_t readU16(const uint8_t *bytes) noexcept {
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t readU32(const uint8_t *bytes) noexcept {
+    return static_cast<uint32_t>(bytes[0])
+            | (static_cast<uint32_t>(bytes[1]) << 8)
+            | (static_cast<uint32_t>(bytes[2]) << 16)
+            | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+bool hasId(const uint8_t *bytes, const char *id) noexcept {
+    return std::memcmp(bytes, id, 4) == 0;
+}
+
+// Integer samples scaled to the full int32 range, so every width shares one
+// mixing path and the top 16 bits are the PCM16 value.
+int32_t readScaledInteger(const uint8_t *sample, WavReader::Encoding encoding) noexcept {
+    switch (encoding) {
+        case WavReader::Encoding::Pcm16:
+            return static_cast<int32_t>(static_cast<uint32_t>(readU16(sample)) << 16);
+        case WavReader::Encoding::Pcm24:
+            return static_cast<int32_t>(
+                    (static_cast<uint32_t>(sample[0]) << 8)
+                    | (static_cast<uint32_t>(sample[1]) << 16)
+                    | (static_cast<uint32_t>(sample[2]) << 24));
+        default:
+            return static_cast<int32_t>(readU32(sample));
+    }
+}
+
+float readFloatSample(const uint8_t *sample) noexcept {
+    float value;
+    std::memcpy(&value, sample, sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+bool WavReader::open(const std::string &path) {
+    close();
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return fail("Cannot open file");
+
+    struct stat info {};
+    if (::fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+        ::close(descriptor);
+        return fail("File is empty");
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) return fail("Cannot map file");
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+    mMapping = mapping;
+    mMappingBytes = size;
+    return parseOrClose(static_cast<const uint8_t *>(mapping), size);
+}
+
+bool WavReader::openMemory(const uint8_t *bytes, size_t size) {
+    close();
+    if (bytes == nullptr) return fail("File is empty");
+    return parseOrClose(bytes, size);
+}
+
+bool WavReader::parseOrClose(const uint8_t *bytes, size_t size) {
+    if (parse(bytes, size)) return true;
+    const char *error = mError;
+    close();
+    return fail(error);
+}
+
+void WavReader::close() noexcept {
+    if (mMapping != nullptr) ::munmap(mMapping, mMappingBytes);
+    mMapping = nullptr;
+    mMappingBytes = 0;
+    mOpen = false;
+    mError = "";
+    mFormat = {};
+    mData = nullptr;
+    mDataBytes = 0;
+    mFrameCount = 0;
+}
+
+bool WavReader::fail(const char *error) noexcept {
+    mOpen = false;
+    mError = error;
+    return false;
+}
+
+bool WavReader::parse(const uint8_t *bytes, size_t size) {
+    if (size < 12 || !hasId(bytes, "RIFF") || !hasId(bytes + 8, "WAVE")) {
+        return fail("Not a RIFF/WAVE file");
+    }
+
+    bool haveFormat = false;
+    const uint8_t *data = nullptr;
+    size_t dataBytes = 0;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const uint8_t *chunk = bytes + offset;
+        const size_t body = offset + 8;
+        // Streamed writers leave the size unset; a chunk never extends past the file.
+        const size_t chunkBytes = std::min<size_t>(readU32(chunk + 4), size - body);
+        if (hasId(chunk, "fmt ")) {
+            if (chunkBytes < 16) return fail("WAV fmt chunk is truncated");
+            const uint8_t *format = bytes + body;
+            uint16_t tag = readU16(format);
+            if (tag == kFormatExtensible) {
+                if (chunkBytes < 40) return fail("WAV fmt chunk is truncated");
+                // The sub-format GUID starts with the plain format tag.
+                tag = readU16(format + 24);
+            }
+            const uint16_t bits = readU16(format + 14);
+            mFormat.channelCount = readU16(format + 2);
+            mFormat.sampleRate = static_cast<int32_t>(
+                    std::min<uint32_t>(readU32(format + 4), INT32_MAX));
+            mFormat.bytesPerSample = bits / 8;
+            if (tag == kFormatPcm && bits == 16) {
+                mFormat.encoding = Encoding::Pcm16;
+            } else if (tag == kFormatPcm && bits == 24) {
+                mFormat.encoding = Encoding::Pcm24;
+            } else if (tag == kFormatPcm && bits == 32) {
+                mFormat.encoding = Encoding::Pcm32;
+            } else if (tag == kFormatFloat && bits == 32) {
+                mFormat.encoding = Encoding::Float32;
+            } else {
+                return fail("Unsupported WAV sample encoding");
+            }
+            haveFormat = true;
+        } else if (hasId(chunk, "data") && data == nullptr) {
+            data = bytes + body;
+            dataBytes = chunkBytes;
+        }
+        if (haveFormat && data != nullptr) break;
+        // Chunks are word aligned: odd sizes are followed by a pad byte.
+        offset = body + chunkBytes + (chunkBytes & 1);
+    }
+
+    if (!haveFormat) return fail("WAV fmt chunk not found");
+    if (data == nullptr) return fail("WAV data chunk not found");
+    if (mFormat.channelCount <= 0 || mFormat.sampleRate <= 0) return fail("Invalid WAV format");
+
+    const size_t frameBytes = static_cast<size_t>(mFormat.channelCount) * mFormat.bytesPerSample;
+    mFrameCount = static_cast<int64_t>(dataBytes / frameBytes);
+    mData = data;
+    mDataBytes = static_cast<size_t>(mFrameCount) * frameBytes;
+    mOpen = true;
+    mError = "";
+    return true;
+}
+
+const int16_t *WavReader::pcm16() const noexcept {
+    if (!mOpen || mFormat.encoding != Encoding::Pcm16) return nullptr;
+    if (reinterpret_cast<uintptr_t>(mData) % alignof(int16_t) != 0) return nullptr;
+    return reinterpret_cast<const int16_t *>(mData);
+}
+
+size_t WavReader::clampFrames(int64_t firstFrame, size_t frameCount) const noexcept {
+    if (!mOpen || firstFrame < 0 || firstFrame >= mFrameCount) return 0;
+    return static_cast<size_t>(std::min<int64_t>(
+            static_cast<int64_t>(frameCount), mFrameCount - firstFrame));
+}
+
+size_t WavReader::readFloat(int64_t firstFrame, float *destination, size_t frameCount) const noexcept {
+    const size_t frames = clampFrames(firstFrame, frameCount);
+    if (destination == nullptr || frames == 0) return 0;
+    const size_t sampleCount = frames * static_cast<size_t>(mFormat.channelCount);
+    const uint8_t *source = mData
+            + static_cast<size_t>(firstFrame) * mFormat.channelCount * mFormat.bytesPerSample;
+    if (mFormat.encoding == Encoding::Float32) {
+        std::memcpy(destination, source, sampleCount * sizeof(float));
+        return frames;
+    }
+    for (size_t sample = 0; sample < sampleCount; ++sample) {
+        destination[sample] = static_cast<float>(
+                readScaledInteger(source + sample * mFormat.bytesPerSample, mFormat.encoding))
+                * kInt32ToFloatScale;
+    }
+    return frames;
+}
+
+size_t WavReader::readMonoPcm16(
+        int64_t firstFrame,
+        int16_t *destination,
+        size_t frameCount) const noexcept {
+    const size_t frames = clampFrames(firstFrame, frameCount);
+    if (destination == nullptr || frames == 0) return 0;
+    const auto channels = static_cast<size_t>(mFormat.channelCount);
+    const auto sampleBytes = static_cast<size_t>(mFormat.bytesPerSample);
+    const uint8_t *source = mData + static_cast<size_t>(firstFrame) * channels * sampleBytes;
+    if (mFormat.encoding == Encoding::Pcm16 && channels == 1) {
+        std::memcpy(destination, source, frames * sizeof(int16_t));
+        return frames;
+    }
+    if (const int16_t *pcm = pcm16()) {
+        downmixPcm16ToMono(
+                pcm + static_cast<size_t>(firstFrame) * channels,
+                mFormat.channelCount,
+                destination,
+                frames);
+        return frames;
+    }
+
+    for (size_t frame = 0; frame < frames; ++frame) {
+        const uint8_t *samples = source + frame * channels * sampleBytes;
+        if (mFormat.encoding == Encoding::Float32) {
+            float sum = 0.0f;
+            for (size_t channel = 0; channel < channels; ++channel) {
+                sum += readFloatSample(samples + channel * sampleBytes);
+            }
+            destination[frame] = floatToPcm16(sum / static_cast<float>(channels));
+        } else {
+            int64_t sum = 0;
+            for (size_t channel = 0; channel < channels; ++channel) {
+                sum += readScaledInteger(samples + channel * sampleBytes, mFormat.encoding);
+            }
+            const int64_t mean = sum / static_cast<int64_t>(channels);
+            destination[frame] = static_cast<int16_t>(mean >> 16);
+        }
+    }
+    return frames;
+}
+
+size_t WavReader::readPcm16(
+        int64_t firstFrame,
+        int16_t *destination,
+        size_t frameCount) const noexcept {
+    const size_t frames = clampFrames(firstFrame, frameCount);
+    if (destination == nullptr || frames == 0) return 0;
+    const auto channels = static_cast<size_t>(mFormat.channelCount);
+    const auto sampleBytes = static_cast<size_t>(mFormat.bytesPerSample);
+    const size_t sampleCount = frames * channels;
+    const uint8_t *source = mData + static_cast<size_t>(firstFrame) * channels * sampleBytes;
+    if (mFormat.encoding == Encoding::Pcm16) {
+        std::memcpy(destination, source, sampleCount * sizeof(int16_t));
+        return frames;
+    }
+    for (size_t sample = 0; sample < sampleCount; ++sample) {
+        const uint8_t *bytes = source + sample * sampleBytes;
+        destination[sample] = mFormat.encoding == Encoding::Float32
+                ? floatToPcm16(readFloatSample(bytes))
+                : static_cast<int16_t>(readScaledInteger(bytes, mFormat.encoding) >> 16);
+    }
+    return frames;
+}
+
+}  // namespace tapstory
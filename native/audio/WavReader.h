@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tapstory {
+
+/**
+ * Read-only RIFF/WAVE file. `open` maps the file and walks its chunk list,
+ * honouring pad bytes after odd-sized chunks and WAVE_FORMAT_EXTENSIBLE, so
+ * sample data is read in place: `data` and `pcm16` are views into the mapping
+ * that stay valid until `close`. Supports 16-, 24- and 32-bit integer PCM and
+ * 32-bit float. Reads of an open file may run concurrently.
+ */
+class WavReader {
+public:
+    enum class Encoding { Pcm16, Pcm24, Pcm32, Float32 };
+
+    struct Format {
+        Encoding encoding = Encoding::Pcm16;
+        int32_t sampleRate = 0;
+        int32_t channelCount = 0;
+        int32_t bytesPerSample = 0;
+    };
+
+    WavReader() = default;
+    WavReader(const WavReader &) = delete;
+    WavReader &operator=(const WavReader &) = delete;
+    ~WavReader() { close(); }
+
+    /** Map and parse `path`; on failure `error` says why. */
+    bool open(const std::string &path);
+    /** Parse a file already in memory; `bytes` must outlive the reader. */
+    bool openMemory(const uint8_t *bytes, size_t size);
+    void close() noexcept;
+
+    bool isOpen() const noexcept { return mOpen; }
+    const char *error() const noexcept { return mError; }
+    const Format &format() const noexcept { return mFormat; }
+    int64_t frameCount() const noexcept { return mFrameCount; }
+
+    /** The data chunk as stored: interleaved little-endian samples. */
+    const uint8_t *data() const noexcept { return mData; }
+    size_t dataBytes() const noexcept { return mDataBytes; }
+    /** The data chunk as PCM16 samples, or null unless the file is 16-bit PCM. */
+    const int16_t *pcm16() const noexcept;
+
+    /** Decode interleaved frames to [-1, 1) floats; returns frames read. */
+    size_t readFloat(int64_t firstFrame, float *destination, size_t frameCount) const noexcept;
+    /**
+     * Average the channels of each frame into mono PCM16; integer formats keep
+     * their top 16 bits, so 16-bit mono comes back bit-exact. Returns frames read.
+     */
+    size_t readMonoPcm16(int64_t firstFrame, int16_t *destination, size_t frameCount) const noexcept;
+    /** Interleaved PCM16 frames with the same per-sample conversion as `readMonoPcm16`. */
+    size_t readPcm16(int64_t firstFrame, int16_t *destination, size_t frameCount) const noexcept;
+
+private:
+    bool parse(const uint8_t *bytes, size_t size);
+    bool parseOrClose(const uint8_t *bytes, size_t size);
+    bool fail(const char *error) noexcept;
+    size_t clampFrames(int64_t firstFrame, size_t frameCount) const noexcept;
+
+    void *mMapping = nullptr;
+    size_t mMappingBytes = 0;
+    bool mOpen = false;
+    const char *mError = "";
+    Format mFormat;
+    const uint8_t *mData = nullptr;
+    size_t mDataBytes = 0;
+    int64_t mFrameCount = 0;
+};
+
+}  // namespace tapstory
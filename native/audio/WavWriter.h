@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+
+namespace tapstory {
+
+/**
+ * Streaming PCM16 RIFF/WAVE writer. The header is written with zero sizes on
+ * open and patched on close, so callers can append in any chunk size without
+ * knowing the final length up front.
+ */
+class WavWriter {
+public:
+    static constexpr size_t kHeaderBytes = 44;
+
+    WavWriter() = default;
+    WavWriter(const WavWriter &) = delete;
+    WavWriter &operator=(const WavWriter &) = delete;
+    ~WavWriter() { close(); }
+
+    bool open(const std::string &path, int32_t sampleRate, int32_t channelCount) {
+        close();
+        if (sampleRate <= 0 || channelCount <= 0 || channelCount > 8) return false;
+        mSampleRate = sampleRate;
+        mChannelCount = channelCount;
+        mDataBytes = 0;
+        mFailed = false;
+        mFile.clear();
+        mFile.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!mFile.is_open()) return false;
+        writeHeader();
+        return mFile.good();
+    }
+
+    bool isOpen() const { return mFile.is_open(); }
+    bool failed() const { return mFailed; }
+    uint64_t frameCount() const {
+        return mChannelCount > 0
+                ? mDataBytes / (static_cast<uint64_t>(mChannelCount) * sizeof(int16_t))
+                : 0;
+    }
+
+    /** Append interleaved PCM16 frames; every supported target is little-endian. */
+    bool write(const int16_t *samples, size_t frameCount) {
+        if (!mFile.is_open() || mFailed) return false;
+        if (samples == nullptr || frameCount == 0) return true;
+        const uint64_t bytes = static_cast<uint64_t>(frameCount)
+                * static_cast<uint64_t>(mChannelCount) * sizeof(int16_t);
+        if (bytes > kMaxDataBytes - mDataBytes) {
+            mFailed = true;
+            return false;
+        }
+        mFile.write(
+                reinterpret_cast<const char *>(samples),
+                static_cast<std::streamsize>(bytes));
+        if (!mFile.good()) {
+            mFailed = true;
+            return false;
+        }
+        mDataBytes += bytes;
+        return true;
+    }
+
+    /** Patch the RIFF and data sizes and close. Returns false on any I/O error. */
+    bool close() {
+        if (!mFile.is_open()) return !mFailed;
+        if (!mFailed) {
+            mFile.seekp(0, std::ios::beg);
+            writeHeader();
+            mFile.flush();
+            if (!mFile.good()) mFailed = true;
+        }
+        mFile.close();
+        if (mFile.fail()) mFailed = true;
+        return !mFailed;
+    }
+
+    /** The 44-byte PCM16 header for `dataBytes` of sample data. */
+    static std::array<uint8_t, kHeaderBytes> makeHeader(
+            int32_t sampleRate,
+            int32_t channelCount,
+            uint32_t dataBytes) {
+        std::array<uint8_t, kHeaderBytes> header{};
+        const uint16_t blockAlign = static_cast<uint16_t>(channelCount * sizeof(int16_t));
+        std::copy_n("RIFF", 4, header.begin());
+        putU32(header.data() + 4, 36 + dataBytes);
+        std::copy_n("WAVE", 4, header.begin() + 8);
+        std::copy_n("fmt ", 4, header.begin() + 12);
+        putU32(header.data() + 16, 16);
+        putU16(header.data() + 20, 1);
+        putU16(header.data() + 22, static_cast<uint16_t>(channelCount));
+        putU32(header.data() + 24, static_cast<uint32_t>(sampleRate));
+        putU32(header.data() + 28, static_cast<uint32_t>(sampleRate) * blockAlign);
+        putU16(header.data() + 32, blockAlign);
+        putU16(header.data() + 34, 16);
+        std::copy_n("data", 4, header.begin() + 36);
+        putU32(header.data() + 40, dataBytes);
+        return header;
+    }
+
+    /** Largest data chunk a RIFF size field can describe. */
+    static constexpr uint64_t kMaxDataBytes = std::numeric_limits<uint32_t>::max() - 36;
+
+private:
+    static void putU16(uint8_t *destination, uint16_t value) {
+        destination[0] = static_cast<uint8_t>(value & 0xff);
+        destination[1] = static_cast<uint8_t>((value >> 8) & 0xff);
+    }
+
+    static void putU32(uint8_t *destination, uint32_t value) {
+        for (int byte = 0; byte < 4; ++byte) {
+            destination[byte] = static_cast<uint8_t>((value >> (byte * 8)) & 0xff);
+        }
+    }
+
+    void writeHeader() {
+        const auto header = makeHeader(
+                mSampleRate,
+                mChannelCount,
+                static_cast<uint32_t>(mDataBytes));
+        mFile.write(
+                reinterpret_cast<const char *>(header.data()),
+                static_cast<std::streamsize>(header.size()));
+        if (!mFile.good()) mFailed = true;
+    }
+
+    std::ofstream mFile;
+    int32_t mSampleRate = 0;
+    int32_t mChannelCount = 0;
+    uint64_t mDataBytes = 0;
+    bool mFailed = false;
+};
+
+}  // namespace tapstory
@@ -0,0 +1,248 @@
+// N-API bindings exposing the native audio analysis to the backend. Built by
+// the host CMake project with -DTAPSTORY_BUILD_NODE_ADDON=ON; the backend
+// loads it through src/utils/nativeAudio.ts and falls back to JavaScript when
+// it is absent.
+#include <node_api.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio/OffsetEstimator.h"
+#include "audio/PeakPyramid.h"
+#include "audio/WavReader.h"
+
+namespace {
+
+struct Samples {
+    napi_typedarray_type type = napi_float64_array;
+    const void *data = nullptr;
+    size_t length = 0;
+};
+
+bool throwTypeError(napi_env env, const char *message) {
+    napi_throw_type_error(env, nullptr, message);
+    return false;
+}
+
+bool readSamples(napi_env env, napi_value value, Samples &samples) {
+    bool isTypedArray = false;
+    napi_is_typedarray(env, value, &isTypedArray);
+    if (!isTypedArray) return throwTypeError(env, "Expected an Int16Array, Float32Array or Float64Array");
+
+    void *data = nullptr;
+    napi_get_typedarray_info(env, value, &samples.type, &samples.length, &data, nullptr, nullptr);
+    samples.data = data;
+    if (samples.type != napi_int16_array
+        && samples.type != napi_float32_array
+        && samples.type != napi_float64_array) {
+        return throwTypeError(env, "Expected an Int16Array, Float32Array or Float64Array");
+    }
+    return true;
+}
+
+std::vector<double> toDouble(const Samples &samples) {
+    std::vector<double> converted(samples.length);
+    for (size_t index = 0; index < samples.length; ++index) {
+        switch (samples.type) {
+            case napi_int16_array:
+                converted[index] = static_cast<const int16_t *>(samples.data)[index];
+                break;
+            case napi_float32_array:
+                converted[index] = static_cast<const float *>(samples.data)[index];
+                break;
+            default:
+                converted[index] = static_cast<const double *>(samples.data)[index];
+                break;
+        }
+    }
+    return converted;
+}
+
+tapstory::OffsetEstimate estimate(const Samples &reference, const Samples &test, int64_t maxOffset) {
+    if (reference.type == test.type) {
+        switch (reference.type) {
+            case napi_int16_array:
+                return tapstory::estimateAudioOffset(
+                        static_cast<const int16_t *>(reference.data), reference.length,
+                        static_cast<const int16_t *>(test.data), test.length, maxOffset);
+            case napi_float32_array:
+                return tapstory::estimateAudioOffset(
+                        static_cast<const float *>(reference.data), reference.length,
+                        static_cast<const float *>(test.data), test.length, maxOffset);
+            default:
+                return tapstory::estimateAudioOffset(
+                        static_cast<const double *>(reference.data), reference.length,
+                        static_cast<const double *>(test.data), test.length, maxOffset);
+        }
+    }
+    const std::vector<double> referenceSamples = toDouble(reference);
+    const std::vector<double> testSamples = toDouble(test);
+    return tapstory::estimateAudioOffset(
+            referenceSamples.data(), referenceSamples.size(),
+            testSamples.data(), testSamples.size(), maxOffset);
+}
+
+void setNumber(napi_env env, napi_value object, const char *name, double value) {
+    napi_value number;
+    napi_create_double(env, value, &number);
+    napi_set_named_property(env, object, name, number);
+}
+
+// estimateAudioOffset(reference, test, maxOffsetSamples)
+//   -> { offsetSamples, fractionalOffsetSamples, confidence }
+napi_value EstimateAudioOffset(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value argv[3];
+    napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+    if (argc < 3) {
+        throwTypeError(env, "estimateAudioOffset(reference, test, maxOffsetSamples)");
+        return nullptr;
+    }
+
+    Samples reference;
+    Samples test;
+    if (!readSamples(env, argv[0], reference) || !readSamples(env, argv[1], test)) return nullptr;
+    double maxOffset = 0.0;
+    if (napi_get_value_double(env, argv[2], &maxOffset) != napi_ok) {
+        throwTypeError(env, "maxOffsetSamples must be a number");
+        return nullptr;
+    }
+
+    const tapstory::OffsetEstimate result =
+            estimate(reference, test, static_cast<int64_t>(maxOffset));
+    napi_value object;
+    napi_create_object(env, &object);
+    setNumber(env, object, "offsetSamples", static_cast<double>(result.offsetSamples));
+    setNumber(env, object, "fractionalOffsetSamples", result.fractionalOffsetSamples);
+    setNumber(env, object, "confidence", result.confidence);
+    return object;
+}
+
+// Hand `bytes` at `data` to JavaScript without copying; `owner` keeps them
+// alive and is deleted when the buffer is collected. Runtimes that forbid
+// external buffers get a copy, and `owner` is deleted right away.
+template <typename Owner>
+napi_value makeExternalArrayBuffer(napi_env env, Owner *owner, const void *data, size_t bytes) {
+    napi_value buffer;
+    const napi_status status = bytes == 0
+            ? napi_generic_failure
+            : napi_create_external_arraybuffer(
+                    env,
+                    const_cast<void *>(data),
+                    bytes,
+                    [](napi_env, void *, void *hint) { delete static_cast<Owner *>(hint); },
+                    owner,
+                    &buffer);
+    if (status != napi_ok) {
+        void *copy = nullptr;
+        napi_create_arraybuffer(env, bytes, &copy, &buffer);
+        if (copy != nullptr) {
+            std::copy_n(static_cast<const uint8_t *>(data), bytes, static_cast<uint8_t *>(copy));
+        }
+        delete owner;
+    }
+    return buffer;
+}
+
+// computePeakFile(samples, sampleRate) -> ArrayBuffer holding the peak file
+// documented in audio/PeakPyramid.h. The buffer wraps the encoded bytes
+// directly; they are released when JavaScript collects it.
+napi_value ComputePeakFile(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+    if (argc < 2) {
+        throwTypeError(env, "computePeakFile(samples, sampleRate)");
+        return nullptr;
+    }
+
+    Samples samples;
+    if (!readSamples(env, argv[0], samples)) return nullptr;
+    int32_t sampleRate = 0;
+    if (napi_get_value_int32(env, argv[1], &sampleRate) != napi_ok || sampleRate <= 0) {
+        throwTypeError(env, "sampleRate must be a positive integer");
+        return nullptr;
+    }
+
+    tapstory::PeakPyramid peaks(static_cast<int64_t>(samples.length));
+    if (samples.type == napi_int16_array) {
+        peaks.append(static_cast<const int16_t *>(samples.data), samples.length);
+    } else if (samples.type == napi_float32_array) {
+        peaks.append(static_cast<const float *>(samples.data), samples.length);
+    } else {
+        const std::vector<double> values = toDouble(samples);
+        const std::vector<float> converted(values.begin(), values.end());
+        peaks.append(converted.data(), converted.size());
+    }
+    peaks.finish();
+
+    auto *bytes = new std::vector<uint8_t>(tapstory::encodePeakFile(peaks, sampleRate));
+    return makeExternalArrayBuffer(env, bytes, bytes->data(), bytes->size());
+}
+
+// readWavPcm16(path)
+//   -> { sampleRate, channelCount, bitsPerSample, frameCount, samples: Int16Array }
+// Channels are averaged to mono PCM16. A 16-bit mono file's samples are a view
+// of the mapped file, unmapped when JavaScript collects the array; other
+// formats are decoded once into native memory handed over the same way.
+napi_value ReadWavPcm16(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+    size_t pathLength = 0;
+    if (argc < 1 || napi_get_value_string_utf8(env, argv[0], nullptr, 0, &pathLength) != napi_ok) {
+        throwTypeError(env, "readWavPcm16(path)");
+        return nullptr;
+    }
+    std::string path(pathLength, '\0');
+    napi_get_value_string_utf8(env, argv[0], &path[0], pathLength + 1, nullptr);
+
+    auto *reader = new tapstory::WavReader();
+    if (!reader->open(path)) {
+        napi_throw_error(env, nullptr, reader->error());
+        delete reader;
+        return nullptr;
+    }
+    const tapstory::WavReader::Format format = reader->format();
+    const auto frames = static_cast<size_t>(reader->frameCount());
+    napi_value buffer;
+    if (format.channelCount == 1 && reader->pcm16() != nullptr) {
+        buffer = makeExternalArrayBuffer(env, reader, reader->pcm16(), frames * sizeof(int16_t));
+    } else {
+        auto *decoded = new std::vector<int16_t>(frames);
+        reader->readMonoPcm16(0, decoded->data(), frames);
+        delete reader;
+        buffer = makeExternalArrayBuffer(
+                env, decoded, decoded->data(), decoded->size() * sizeof(int16_t));
+    }
+
+    napi_value samples;
+    napi_create_typedarray(env, napi_int16_array, frames, buffer, 0, &samples);
+    napi_value object;
+    napi_create_object(env, &object);
+    setNumber(env, object, "sampleRate", format.sampleRate);
+    setNumber(env, object, "channelCount", format.channelCount);
+    setNumber(env, object, "bitsPerSample", format.bytesPerSample * 8);
+    setNumber(env, object, "frameCount", static_cast<double>(frames));
+    napi_set_named_property(env, object, "samples", samples);
+    return object;
+}
+
+void exportFunction(napi_env env, napi_value exports, const char *name, napi_callback callback) {
+    napi_value function;
+    napi_create_function(env, name, NAPI_AUTO_LENGTH, callback, nullptr, &function);
+    napi_set_named_property(env, exports, name, function);
+}
+
+napi_value Init(napi_env env, napi_value exports) {
+    exportFunction(env, exports, "estimateAudioOffset", EstimateAudioOffset);
+    exportFunction(env, exports, "computePeakFile", ComputePeakFile);
+    exportFunction(env, exports, "readWavPcm16", ReadWavPcm16);
+    return exports;
+}
+
+}  // namespace
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: run-host-benchmarks.sh [results.json]
+# Writes machine-readable results so releases can be compared for regressions.
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+build_dir="${TMPDIR:-/tmp}/tapstory-native-host-build"
+output="${1:-${PWD}/audio-core-benchmarks.json}"
+
+cmake -S "${script_dir}" -B "${build_dir}" >/dev/null
+cmake --build "${build_dir}" --target tapstory-audio-benchmarks >/dev/null
+"${build_dir}/tapstory-audio-benchmarks" --output "${output}"
+echo "Benchmark results written to ${output}"
@@ -0,0 +1,9 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+build_dir="${TMPDIR:-/tmp}/tapstory-native-host-build"
+
+cmake -S "${script_dir}" -B "${build_dir}" >/dev/null
+cmake --build "${build_dir}" --target tapstory-audio-core-tests >/dev/null
+"${build_dir}/tapstory-audio-core-tests"
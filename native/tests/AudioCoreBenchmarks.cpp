@@ -0,0 +1,939 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "audio/ChainStems.h"
+#include "audio/DuplexCore.h"
+#include "audio/FlacWriter.h"
+#include "audio/LinearResampler.h"
+#include "audio/LosslessDecoder.h"
+#include "audio/Loudness.h"
+#include "audio/MixdownCache.h"
+#include "audio/Mixer.h"
+#include "audio/OfflineMixdown.h"
+#include "audio/OffsetEstimator.h"
+#include "audio/OnsetEnvelope.h"
+#include "audio/PcmConversion.h"
+#include "audio/SpscPcmRing.h"
+#include "audio/WavReader.h"
+#include "audio/WavWriter.h"
+
+namespace {
+
+constexpr int32_t kSampleRate = 48'000;
+constexpr int32_t kOutputChannelCount = 2;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    bool quick = false;
+    std::string outputPath;
+    std::string scratchDirectory;
+};
+
+struct Result {
+    std::string name;
+    std::vector<std::pair<std::string, int64_t>> params;
+    int64_t iterations = 0;
+    double nanosPerIteration = 0.0;
+    double framesPerSecond = 0.0;
+    double realtimeFactor = 0.0;
+    double bytesPerSecond = 0.0;
+};
+
+std::string jsonEscape(const std::string &value) {
+    std::string escaped;
+    for (const char character : value) {
+        if (character == '"' || character == '\\') escaped.push_back('\\');
+        escaped.push_back(character);
+    }
+    return escaped;
+}
+
+/** Keep results observable so the optimizer cannot discard benchmarked work. */
+volatile float gSink = 0.0f;
+
+template <typename Body>
+double medianNanos(int repetitions, Body &&body) {
+    std::vector<double> samples;
+    samples.reserve(static_cast<size_t>(repetitions));
+    body();  // warm caches and page in buffers
+    for (int repetition = 0; repetition < repetitions; ++repetition) {
+        const auto start = Clock::now();
+        body();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+std::vector<float> makeTone(size_t frames, float frequency, float amplitude) {
+    std::vector<float> samples(frames);
+    const float step = 2.0f * 3.14159265f * frequency / static_cast<float>(kSampleRate);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        samples[frame] = amplitude * std::sin(step * static_cast<float>(frame));
+    }
+    return samples;
+}
+
+Result benchmarkRingThroughput(const Options &options, size_t burstFrames) {
+    const size_t totalFrames = static_cast<size_t>(kSampleRate) * (options.quick ? 2 : 60);
+    const std::vector<int16_t> burst(burstFrames, 1'234);
+    const int repetitions = options.quick ? 1 : 5;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        tapstory::SpscPcmRing ring(static_cast<size_t>(kSampleRate) * 10);
+        std::atomic<bool> producerDone{false};
+        std::thread producer([&] {
+            size_t produced = 0;
+            while (produced < totalFrames) {
+                const size_t wanted = std::min(burstFrames, totalFrames - produced);
+                produced += ring.write(burst.data(), wanted);
+            }
+            producerDone.store(true, std::memory_order_release);
+        });
+
+        std::vector<int16_t> chunk(4'096);
+        size_t consumed = 0;
+        while (!producerDone.load(std::memory_order_acquire) || ring.availableToRead() > 0) {
+            const size_t read = ring.read(chunk.data(), chunk.size());
+            if (read == 0) std::this_thread::yield();
+            consumed += read;
+        }
+        producer.join();
+        gSink = gSink + static_cast<float>(consumed);
+    });
+
+    Result result;
+    result.name = "spsc_ring_throughput";
+    result.params = {
+        {"burstFrames", static_cast<int64_t>(burstFrames)},
+        {"totalFrames", static_cast<int64_t>(totalFrames)},
+    };
+    result.iterations = repetitions;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(totalFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    result.bytesPerSecond = result.framesPerSecond * sizeof(int16_t);
+    return result;
+}
+
+Result benchmarkMix(
+        const Options &options,
+        int32_t trackCount,
+        int32_t burstFrames,
+        bool stems = false,
+        int32_t channelCount = 1,
+        int32_t trackSampleRate = kSampleRate) {
+    // Duet chains alternate segments, so every track overlaps only its neighbour.
+    // Tracks at another rate than the timeline play through the resampler.
+    const int64_t segmentFrames = trackSampleRate * 4;
+    tapstory::TrackStore store;
+    if (trackSampleRate != kSampleRate) store.setSampleRate(kSampleRate);
+    std::vector<int16_t> pcm(static_cast<size_t>(segmentFrames) * channelCount);
+    for (int32_t index = 0; index < trackCount; ++index) {
+        const std::vector<float> tone = makeTone(pcm.size(), 220.0f + index, 0.2f);
+        tapstory::convertFloatToPcm16(tone.data(), pcm.data(), pcm.size());
+        store.load(
+                "track-" + std::to_string(index),
+                pcm.data(),
+                static_cast<int32_t>(segmentFrames),
+                index * kSampleRate * 2,
+                channelCount,
+                trackSampleRate);
+    }
+    tapstory::ChainStems chainStems;
+    if (stems) chainStems.update(store);
+    const int64_t timelineFrames = store.endFrame();
+    const int64_t callbacks = std::max<int64_t>(1, timelineFrames / burstFrames);
+    std::vector<float> output(static_cast<size_t>(burstFrames) * kOutputChannelCount);
+    const int repetitions = options.quick ? 1 : 5;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        for (int64_t callback = 0; callback < callbacks; ++callback) {
+            if (stems) {
+                tapstory::mixStems(chainStems, callback * burstFrames, output.data(), burstFrames);
+            } else {
+                tapstory::mixTracks(store, callback * burstFrames, output.data(), burstFrames);
+            }
+        }
+        gSink = gSink + output[0];
+    });
+
+    Result result;
+    result.name = stems ? "mix_stems" : "mix_tracks";
+    result.params = {
+        {"tracks", trackCount},
+        {"channels", channelCount},
+        {"trackSampleRate", trackSampleRate},
+        {"burstFrames", burstFrames},
+        {"callbacks", callbacks},
+    };
+    result.iterations = callbacks;
+    result.nanosPerIteration = nanos / static_cast<double>(callbacks);
+    result.framesPerSecond = static_cast<double>(callbacks * burstFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+Result benchmarkSeekWhileRunning(const Options &options, int32_t segmentCount) {
+    // One callback that applies a seek, including the crossfade's second mix.
+    const int64_t segmentFrames = kSampleRate / 2;
+    constexpr int32_t kBurstFrames = 192;
+    tapstory::DuplexCore core;
+    std::vector<int16_t> pcm(static_cast<size_t>(segmentFrames), 2'000);
+    for (int32_t index = 0; index < segmentCount; ++index) {
+        core.trackStore().load(
+                "segment-" + std::to_string(index),
+                pcm.data(),
+                static_cast<int32_t>(segmentFrames),
+                index * segmentFrames * 3 / 4);
+    }
+    const int64_t timelineFrames = core.trackStore().endFrame();
+    std::vector<float> output(static_cast<size_t>(kBurstFrames) * kOutputChannelCount);
+    const int64_t seeks = options.quick ? 200 : 5'000;
+    const int repetitions = options.quick ? 1 : 5;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        for (int64_t seek = 0; seek < seeks; ++seek) {
+            core.requestSeek((seek * 7'919 * kBurstFrames) % timelineFrames);
+            core.process(nullptr, 0, output.data(), kBurstFrames);
+        }
+        gSink = gSink + output[0];
+    });
+
+    Result result;
+    result.name = "seek_while_running";
+    result.params = {
+        {"segments", segmentCount},
+        {"burstFrames", kBurstFrames},
+        {"crossfadeFrames", tapstory::DuplexCore::kSeekCrossfadeFrames},
+    };
+    result.iterations = seeks;
+    result.nanosPerIteration = nanos / static_cast<double>(seeks);
+    result.framesPerSecond = static_cast<double>(seeks * kBurstFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+Result benchmarkPracticeSpeed(const Options &options, int32_t trackCount, int32_t speed) {
+    // Duet turns played through the core at a practice speed, one burst per call.
+    const int64_t segmentFrames = kSampleRate * 4;
+    constexpr int32_t kBurstFrames = 192;
+    tapstory::DuplexCore core;
+    std::vector<int16_t> pcm(static_cast<size_t>(segmentFrames));
+    for (int32_t index = 0; index < trackCount; ++index) {
+        const std::vector<float> tone = makeTone(pcm.size(), 220.0f + index, 0.2f);
+        tapstory::convertFloatToPcm16(tone.data(), pcm.data(), pcm.size());
+        core.trackStore().load(
+                "track-" + std::to_string(index),
+                pcm.data(),
+                static_cast<int32_t>(segmentFrames),
+                index * segmentFrames / 2);
+    }
+    core.setPlaybackSpeed(speed);
+    const int64_t callbacks = core.trackStore().endFrame() / kBurstFrames;
+    std::vector<float> output(static_cast<size_t>(kBurstFrames) * kOutputChannelCount);
+    const int repetitions = options.quick ? 1 : 5;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        core.seek(0);
+        for (int64_t callback = 0; callback < callbacks; ++callback) {
+            core.process(nullptr, 0, output.data(), kBurstFrames);
+        }
+        gSink = gSink + output[0];
+    });
+
+    Result result;
+    result.name = "practice_speed";
+    result.params = {
+        {"tracks", trackCount},
+        {"speedPermille", speed},
+        {"burstFrames", kBurstFrames},
+        {"callbacks", callbacks},
+    };
+    result.iterations = callbacks;
+    result.nanosPerIteration = nanos / static_cast<double>(callbacks);
+    result.framesPerSecond = static_cast<double>(callbacks * kBurstFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+Result benchmarkCaptureConversion(const Options &options, int32_t burstFrames) {
+    const std::vector<float> input = makeTone(static_cast<size_t>(burstFrames), 440.0f, 0.9f);
+    const int64_t callbacks = static_cast<int64_t>(kSampleRate) * (options.quick ? 2 : 60)
+            / burstFrames;
+    tapstory::SpscPcmRing ring(static_cast<size_t>(burstFrames) * 4);
+    std::vector<int16_t> drain(static_cast<size_t>(burstFrames));
+    const int repetitions = options.quick ? 1 : 5;
+
+    // Mirrors the callback: clamp, truncate and publish through the ring.
+    const double nanos = medianNanos(repetitions, [&] {
+        const float *source = input.data();
+        for (int64_t callback = 0; callback < callbacks; ++callback) {
+            ring.writeGenerated(static_cast<size_t>(burstFrames), [source](size_t index) noexcept {
+                return tapstory::floatToPcm16(source[index]);
+            });
+            ring.read(drain.data(), drain.size());
+        }
+        gSink = gSink + drain[0];
+    });
+
+    Result result;
+    result.name = "capture_conversion";
+    result.params = {
+        {"burstFrames", burstFrames},
+        {"callbacks", callbacks},
+    };
+    result.iterations = callbacks;
+    result.nanosPerIteration = nanos / static_cast<double>(callbacks);
+    result.framesPerSecond = static_cast<double>(callbacks * burstFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+// The writer thread's share of a take: streaming the drained chunks into the
+// onset envelope.
+Result benchmarkOnsetEnvelope(const Options &options, size_t chunkFrames) {
+    const size_t frames = static_cast<size_t>(kSampleRate) * (options.quick ? 5 : 120);
+    std::vector<int16_t> pcm(frames);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        pcm[frame] = static_cast<int16_t>((frame * 7'919) & 0xffff);
+    }
+    tapstory::OnsetEnvelope envelope;
+    const int repetitions = options.quick ? 1 : 7;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        envelope.reset(tapstory::OnsetEnvelope::blockFramesForRate(kSampleRate));
+        for (size_t offset = 0; offset < frames; offset += chunkFrames) {
+            envelope.append(pcm.data() + offset, std::min(chunkFrames, frames - offset));
+        }
+        envelope.finish();
+        gSink = gSink + envelope.values().back();
+    });
+
+    Result result;
+    result.name = "onset_envelope";
+    result.params = {
+        {"frames", static_cast<int64_t>(frames)},
+        {"chunkFrames", static_cast<int64_t>(chunkFrames)},
+    };
+    result.iterations = static_cast<int64_t>(frames);
+    result.nanosPerIteration = nanos / static_cast<double>(frames);
+    result.framesPerSecond = static_cast<double>(frames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    result.bytesPerSecond = result.framesPerSecond * sizeof(int16_t);
+    return result;
+}
+
+Result benchmarkLoadConversion(const Options &options) {
+    const size_t frames = static_cast<size_t>(kSampleRate) * (options.quick ? 5 : 120);
+    std::vector<int16_t> pcm(frames);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        pcm[frame] = static_cast<int16_t>((frame * 37) & 0x7fff);
+    }
+    std::vector<float> converted(frames);
+    const int repetitions = options.quick ? 1 : 7;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        tapstory::convertPcm16ToFloat(pcm.data(), converted.data(), frames);
+        gSink = gSink + converted[frames / 2];
+    });
+
+    Result result;
+    result.name = "load_conversion";
+    result.params = {{"frames", static_cast<int64_t>(frames)}};
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(frames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+Result benchmarkLoudness(const Options &options) {
+    const size_t frames = static_cast<size_t>(kSampleRate) * (options.quick ? 5 : 120);
+    const std::vector<float> tone = makeTone(frames, 440.0f, 0.4f);
+    std::vector<int16_t> pcm(frames);
+    tapstory::convertFloatToPcm16(tone.data(), pcm.data(), frames);
+    const int repetitions = options.quick ? 1 : 5;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        const tapstory::LoudnessInfo info = tapstory::measureLoudness(pcm.data(), frames, kSampleRate);
+        gSink = gSink + static_cast<float>(info.integratedLufs + info.truePeakDbtp);
+    });
+
+    Result result;
+    result.name = "loudness_analysis";
+    result.params = {{"frames", static_cast<int64_t>(frames)}};
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(frames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+Result benchmarkResample(const Options &options, int32_t inputRate) {
+    const size_t inputFrames = static_cast<size_t>(inputRate) * (options.quick ? 5 : 60);
+    const std::vector<float> input = makeTone(inputFrames, 330.0f, 0.5f);
+    const size_t outputFrames = tapstory::resampledFrameCount(inputFrames, inputRate, kSampleRate);
+    std::vector<float> output(outputFrames);
+    const int repetitions = options.quick ? 1 : 5;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        tapstory::resampleToRate(
+                input.data(),
+                inputFrames,
+                inputRate,
+                output.data(),
+                outputFrames,
+                kSampleRate);
+        gSink = gSink + output[outputFrames / 2];
+    });
+
+    Result result;
+    result.name = "resample_linear";
+    result.params = {
+        {"inputSampleRate", inputRate},
+        {"outputSampleRate", kSampleRate},
+        {"outputFrames", static_cast<int64_t>(outputFrames)},
+    };
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(outputFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+Result benchmarkWavWrite(const Options &options, size_t chunkFrames) {
+    const size_t totalFrames = static_cast<size_t>(kSampleRate) * (options.quick ? 5 : 300);
+    std::vector<int16_t> chunk(chunkFrames);
+    for (size_t index = 0; index < chunkFrames; ++index) {
+        chunk[index] = static_cast<int16_t>(index * 13);
+    }
+    const std::string path = options.scratchDirectory + "/tapstory-bench-"
+            + std::to_string(chunkFrames) + ".wav";
+    const int repetitions = options.quick ? 1 : 3;
+    bool succeeded = true;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        tapstory::WavWriter writer;
+        succeeded = writer.open(path, kSampleRate, 1) && succeeded;
+        for (size_t written = 0; written < totalFrames; written += chunkFrames) {
+            writer.write(chunk.data(), std::min(chunkFrames, totalFrames - written));
+        }
+        succeeded = writer.close() && succeeded;
+    });
+    std::remove(path.c_str());
+    if (!succeeded) std::cerr << "WAV benchmark could not write " << path << "\n";
+
+    Result result;
+    result.name = "wav_write";
+    result.params = {
+        {"chunkFrames", static_cast<int64_t>(chunkFrames)},
+        {"totalFrames", static_cast<int64_t>(totalFrames)},
+    };
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(totalFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    result.bytesPerSecond = result.framesPerSecond * sizeof(int16_t);
+    return result;
+}
+
+enum class WavReadMethod { CopyWholeFile, MappedView, MappedMonoDecode };
+
+// Reading a decoded five-minute segment the way the backend did (whole file
+// copied into memory) against the mapped reader, summing every sample so each
+// method touches all of the data.
+Result benchmarkWavRead(const Options &options, WavReadMethod method) {
+    const size_t totalFrames = static_cast<size_t>(kSampleRate) * (options.quick ? 5 : 300);
+    const std::string path = options.scratchDirectory + "/tapstory-bench-read.wav";
+    {
+        std::vector<int16_t> pcm(totalFrames);
+        for (size_t frame = 0; frame < totalFrames; ++frame) {
+            pcm[frame] = static_cast<int16_t>(frame * 31);
+        }
+        tapstory::WavWriter writer;
+        if (!writer.open(path, kSampleRate, 1) || !writer.write(pcm.data(), totalFrames)
+            || !writer.close()) {
+            std::cerr << "WAV read benchmark could not write " << path << "\n";
+        }
+    }
+    const int repetitions = options.quick ? 1 : 7;
+    auto sum = [](const int16_t *samples, size_t count) {
+        int64_t total = 0;
+        for (size_t index = 0; index < count; ++index) total += samples[index];
+        return total;
+    };
+
+    const double nanos = medianNanos(repetitions, [&] {
+        int64_t total = 0;
+        if (method == WavReadMethod::CopyWholeFile) {
+            std::ifstream file(path, std::ios::binary);
+            const std::vector<char> bytes{std::istreambuf_iterator<char>(file), {}};
+            std::vector<int16_t> samples((bytes.size() - tapstory::WavWriter::kHeaderBytes) / 2);
+            std::memcpy(
+                    samples.data(),
+                    bytes.data() + tapstory::WavWriter::kHeaderBytes,
+                    samples.size() * sizeof(int16_t));
+            total = sum(samples.data(), samples.size());
+        } else {
+            tapstory::WavReader reader;
+            reader.open(path);
+            const auto frames = static_cast<size_t>(reader.frameCount());
+            if (method == WavReadMethod::MappedView) {
+                total = sum(reader.pcm16(), frames);
+            } else {
+                std::vector<int16_t> samples(frames);
+                reader.readMonoPcm16(0, samples.data(), frames);
+                total = sum(samples.data(), frames);
+            }
+        }
+        gSink = gSink + static_cast<float>(total);
+    });
+    std::remove(path.c_str());
+
+    Result result;
+    result.name = method == WavReadMethod::CopyWholeFile
+            ? "wav_read_copy_whole_file"
+            : method == WavReadMethod::MappedView ? "wav_read_mapped_view" : "wav_read_mapped_mono";
+    result.params = {{"totalFrames", static_cast<int64_t>(totalFrames)}};
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(totalFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    result.bytesPerSecond = result.framesPerSecond * sizeof(int16_t);
+    return result;
+}
+
+enum class LosslessFormat { Wav, Flac };
+
+// Native decode of a segment we wrote ourselves into the mono PCM16 the track
+// store loads, timed over one minute of stereo audio so nanosPerIteration is
+// the decode cost per minute. Replaces MediaExtractor/MediaCodec for these files.
+Result benchmarkLosslessDecode(const Options &options, LosslessFormat format) {
+    const size_t totalFrames = static_cast<size_t>(kSampleRate) * (options.quick ? 5 : 60);
+    const bool flac = format == LosslessFormat::Flac;
+    const std::string path = options.scratchDirectory
+            + (flac ? "/tapstory-bench-decode.flac" : "/tapstory-bench-decode.wav");
+    {
+        const std::vector<float> left = makeTone(totalFrames, 440.0f, 0.5f);
+        const std::vector<float> right = makeTone(totalFrames, 660.0f, 0.3f);
+        std::vector<int16_t> stereo(totalFrames * 2);
+        for (size_t frame = 0; frame < totalFrames; ++frame) {
+            stereo[2 * frame] = tapstory::floatToPcm16(left[frame]);
+            stereo[2 * frame + 1] = tapstory::floatToPcm16(right[frame]);
+        }
+        bool written = false;
+        if (flac) {
+            tapstory::FlacWriter writer;
+            written = writer.open(path, kSampleRate, 2) && writer.write(stereo.data(), totalFrames)
+                    && writer.close();
+        } else {
+            tapstory::WavWriter writer;
+            written = writer.open(path, kSampleRate, 2) && writer.write(stereo.data(), totalFrames)
+                    && writer.close();
+        }
+        if (!written) std::cerr << "Decode benchmark could not write " << path << "\n";
+    }
+    const int repetitions = options.quick ? 1 : 7;
+
+    std::vector<int16_t> pcm;
+    int32_t channels = 0;
+    int32_t rate = 0;
+    const double nanos = medianNanos(repetitions, [&] {
+        tapstory::decodeLosslessFileAtFileRate(path, pcm, channels, rate);
+        gSink = gSink + static_cast<float>(pcm.empty() ? 0 : pcm[pcm.size() / 2]);
+    });
+    std::remove(path.c_str());
+
+    Result result;
+    result.name = flac ? "lossless_decode_flac_stereo" : "lossless_decode_wav_stereo";
+    result.params = {{"totalFrames", static_cast<int64_t>(totalFrames)}};
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(totalFrames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    result.bytesPerSecond = result.framesPerSecond * 2 * sizeof(int16_t);
+    return result;
+}
+
+Result benchmarkOfflineMixdown(
+        const Options &options,
+        tapstory::MixdownFormat format,
+        int32_t workerCount) {
+    // A five-minute duet chain of alternating four-second segments.
+    const int64_t segmentFrames = kSampleRate * 4;
+    const int32_t segmentCount = options.quick ? 4 : 150;
+    tapstory::TrackStore store;
+    std::vector<int16_t> pcm(static_cast<size_t>(segmentFrames));
+    for (int32_t index = 0; index < segmentCount; ++index) {
+        const std::vector<float> tone = makeTone(pcm.size(), 220.0f + index, 0.2f);
+        tapstory::convertFloatToPcm16(tone.data(), pcm.data(), pcm.size());
+        store.load(
+                "segment-" + std::to_string(index),
+                pcm.data(),
+                static_cast<int32_t>(segmentFrames),
+                index * segmentFrames / 2);
+    }
+    const bool flac = format == tapstory::MixdownFormat::Flac;
+    const std::string path = options.scratchDirectory + "/tapstory-bench-mixdown"
+            + (flac ? ".flac" : ".wav");
+    tapstory::MixdownOptions mixdown;
+    mixdown.format = format;
+    mixdown.sampleRate = kSampleRate;
+    mixdown.workerCount = workerCount;
+    const int repetitions = options.quick ? 1 : 3;
+    bool succeeded = true;
+
+    const double nanos = medianNanos(repetitions, [&] {
+        succeeded = tapstory::renderMixdown(store, 0, store.endFrame(), path, mixdown).ok
+                && succeeded;
+    });
+    std::remove(path.c_str());
+    if (!succeeded) std::cerr << "Mixdown benchmark could not write " << path << "\n";
+
+    Result result;
+    result.name = flac ? "offline_mixdown_flac" : "offline_mixdown_wav";
+    result.params = {
+        {"segments", segmentCount},
+        {"workers", workerCount},
+        {"timelineFrames", store.endFrame()},
+    };
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    result.framesPerSecond = static_cast<double>(store.endFrame()) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    result.bytesPerSecond = result.framesPerSecond * kOutputChannelCount * sizeof(int16_t);
+    return result;
+}
+
+Result benchmarkMixdownCacheAppend(const Options &options, int32_t segmentCount) {
+    // Each turn reloads the chain plus one new segment, as the app does.
+    const int64_t segmentFrames = kSampleRate * 4;
+    std::vector<int16_t> pcm(static_cast<size_t>(segmentFrames));
+    const std::vector<float> tone = makeTone(pcm.size(), 220.0f, 0.2f);
+    tapstory::convertFloatToPcm16(tone.data(), pcm.data(), pcm.size());
+    auto loadChain = [&](tapstory::TrackStore &store, int32_t segments) {
+        store.clear();
+        for (int32_t index = 0; index < segments; ++index) {
+            store.load(
+                    "segment-" + std::to_string(index),
+                    pcm.data(),
+                    static_cast<int32_t>(segmentFrames),
+                    index * segmentFrames / 2);
+        }
+    };
+    const std::string path = options.scratchDirectory + "/tapstory-bench-chain-mix.wav";
+    const int repetitions = options.quick ? 1 : 5;
+    tapstory::TrackStore before;
+    tapstory::TrackStore after;
+    loadChain(before, segmentCount);
+    loadChain(after, segmentCount + 1);
+    int64_t renderedBlocks = 0;
+
+    std::vector<double> samples;
+    for (int repetition = 0; repetition <= repetitions; ++repetition) {
+        tapstory::MixdownCache cache(path, kSampleRate);
+        cache.update(before);
+        const auto start = Clock::now();
+        renderedBlocks = cache.update(after).renderedBlocks;
+        if (repetition > 0) {
+            samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+    }
+    std::remove(path.c_str());
+    std::sort(samples.begin(), samples.end());
+    const double nanos = samples[samples.size() / 2];
+
+    Result result;
+    result.name = "mixdown_cache_append";
+    result.params = {
+        {"segments", segmentCount},
+        {"renderedBlocks", renderedBlocks},
+        {"timelineFrames", after.endFrame()},
+    };
+    result.iterations = 1;
+    result.nanosPerIteration = nanos;
+    // Throughput of the whole exported chain per update.
+    result.framesPerSecond = static_cast<double>(after.endFrame()) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+/** The backend's per-lag NCC loop, ported to measure what the FFT replaces. */
+int64_t bruteForceOffset(
+        const std::vector<double> &reference,
+        const std::vector<double> &test,
+        int64_t maxOffset) {
+    const auto mean = [](const std::vector<double> &samples) {
+        double sum = 0.0;
+        for (const double sample : samples) sum += sample;
+        return sum / static_cast<double>(samples.size());
+    };
+    const double referenceMean = mean(reference);
+    const double testMean = mean(test);
+    const int64_t referenceLength = static_cast<int64_t>(reference.size());
+    const int64_t testLength = static_cast<int64_t>(test.size());
+    const int64_t minimumOverlap = std::max<int64_t>(32, std::min(referenceLength, testLength) / 4);
+    int64_t bestOffset = 0;
+    double bestCorrelation = 0.0;
+    for (int64_t offset = -maxOffset; offset <= maxOffset; ++offset) {
+        const int64_t referenceStart = std::max<int64_t>(0, -offset);
+        const int64_t testStart = std::max<int64_t>(0, offset);
+        const int64_t overlap = std::min(referenceLength - referenceStart, testLength - testStart);
+        if (overlap < minimumOverlap) continue;
+        double dot = 0.0;
+        double referenceEnergy = 0.0;
+        double testEnergy = 0.0;
+        for (int64_t index = 0; index < overlap; ++index) {
+            const double referenceValue = reference[referenceStart + index] - referenceMean;
+            const double testValue = test[testStart + index] - testMean;
+            dot += referenceValue * testValue;
+            referenceEnergy += referenceValue * referenceValue;
+            testEnergy += testValue * testValue;
+        }
+        const double energy = std::sqrt(referenceEnergy * testEnergy);
+        const double correlation = energy > 0.0 ? std::abs(dot / energy) : 0.0;
+        if (correlation > bestCorrelation) {
+            bestCorrelation = correlation;
+            bestOffset = offset;
+        }
+    }
+    return bestOffset;
+}
+
+/** The backend's onset envelope: summed absolute first difference per block. */
+std::vector<double> onsetEnvelope(const std::vector<int16_t> &samples, int32_t blockSize) {
+    std::vector<double> envelope((samples.size() + blockSize - 1) / blockSize, 0.0);
+    int16_t previous = samples.empty() ? 0 : samples[0];
+    for (size_t index = 0; index < samples.size(); ++index) {
+        envelope[index / blockSize] += std::abs(samples[index] - previous);
+        previous = samples[index];
+    }
+    return envelope;
+}
+
+enum class OffsetMethod {
+    // What estimateLatencyMsFromPcm does today: 2 kHz envelopes, direct NCC.
+    BruteForceEnvelope,
+    // Direct NCC on full-rate PCM over a reduced lag window; scale per lag.
+    BruteForceFullRate,
+    // Native FFT correlation on full-rate PCM over the whole window.
+    FftFullRate,
+};
+
+Result benchmarkOffsetEstimation(const Options &options, OffsetMethod method) {
+    // 10 s calibration capture with a 1 s search window at 48 kHz.
+    const size_t frames = static_cast<size_t>(kSampleRate) * 10;
+    const int64_t maxOffset = kSampleRate;
+    const int64_t delay = kSampleRate * 30 / 1'000;
+    std::vector<int16_t> reference(frames);
+    std::vector<int16_t> test(frames + static_cast<size_t>(maxOffset), 0);
+    uint32_t state = 0x12345678;
+    for (size_t index = 0; index < frames; ++index) {
+        state = 1'664'525U * state + 1'013'904'223U;
+        reference[index] = static_cast<int16_t>(static_cast<int32_t>(state >> 20) - 2'048);
+        test[index + static_cast<size_t>(delay)] = static_cast<int16_t>(reference[index] / 2);
+    }
+    const int repetitions = options.quick ? 1 : 5;
+    const int32_t envelopeBlock = kSampleRate / 2'000;
+    const int64_t fullRateLags = options.quick ? 8 : 64;
+
+    int64_t lags = 2 * maxOffset + 1;
+    int64_t found = 0;
+    const char *name = "offset_fft_full_rate";
+    double nanos = 0.0;
+    if (method == OffsetMethod::BruteForceEnvelope) {
+        name = "offset_bruteforce_envelope";
+        lags = 2 * (maxOffset / envelopeBlock) + 1;
+        nanos = medianNanos(repetitions, [&] {
+            const std::vector<double> referenceEnvelope = onsetEnvelope(reference, envelopeBlock);
+            const std::vector<double> testEnvelope = onsetEnvelope(test, envelopeBlock);
+            found = bruteForceOffset(referenceEnvelope, testEnvelope, maxOffset / envelopeBlock)
+                    * envelopeBlock;
+        });
+    } else if (method == OffsetMethod::BruteForceFullRate) {
+        name = "offset_bruteforce_full_rate";
+        lags = 2 * fullRateLags + 1;
+        const std::vector<double> referenceSamples(reference.begin(), reference.end());
+        // Centre the reduced window on the true delay so the work per lag is typical.
+        const std::vector<double> testSamples(test.begin() + delay, test.end());
+        nanos = medianNanos(repetitions, [&] {
+            found = delay + bruteForceOffset(referenceSamples, testSamples, fullRateLags);
+        });
+    } else {
+        nanos = medianNanos(repetitions, [&] {
+            found = tapstory::estimateAudioOffset(
+                    reference.data(), reference.size(), test.data(), test.size(), maxOffset)
+                    .offsetSamples;
+        });
+    }
+    gSink = gSink + static_cast<float>(found);
+
+    Result result;
+    result.name = name;
+    result.params = {
+        {"frames", static_cast<int64_t>(frames)},
+        {"lags", lags},
+        {"foundOffset", found},
+    };
+    result.iterations = lags;
+    result.nanosPerIteration = nanos / static_cast<double>(lags);
+    // Reference audio analysed per second; the brute-force full-rate figure
+    // covers only its reduced lag window.
+    result.framesPerSecond = static_cast<double>(frames) * 1e9 / nanos;
+    result.realtimeFactor = result.framesPerSecond / kSampleRate;
+    return result;
+}
+
+std::string toJson(const Options &options, const std::vector<Result> &results) {
+    std::ostringstream json;
+    json.precision(6);
+    json << std::fixed;
+    json << "{\n  \"suite\": \"tapstory-audio-core\",\n";
+    json << "  \"schemaVersion\": 1,\n";
+    json << "  \"quick\": " << (options.quick ? "true" : "false") << ",\n";
+    json << "  \"sampleRate\": " << kSampleRate << ",\n";
+    json << "  \"compiler\": \"" << jsonEscape(
+#if defined(__clang__)
+            "clang " __clang_version__
+#elif defined(__GNUC__)
+            "gcc " __VERSION__
+#else
+            "unknown"
+#endif
+            ) << "\",\n";
+    json << "  \"results\": [\n";
+    for (size_t index = 0; index < results.size(); ++index) {
+        const Result &result = results[index];
+        json << "    {\"name\": \"" << jsonEscape(result.name) << "\", \"params\": {";
+        for (size_t param = 0; param < result.params.size(); ++param) {
+            if (param > 0) json << ", ";
+            json << "\"" << jsonEscape(result.params[param].first) << "\": "
+                 << result.params[param].second;
+        }
+        json << "}, \"iterations\": " << result.iterations
+             << ", \"nanosPerIteration\": " << result.nanosPerIteration
+             << ", \"framesPerSecond\": " << result.framesPerSecond
+             << ", \"realtimeFactor\": " << result.realtimeFactor
+             << ", \"bytesPerSecond\": " << result.bytesPerSecond << "}"
+             << (index + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    const char *tmp = std::getenv("TMPDIR");
+    options.scratchDirectory = tmp != nullptr && tmp[0] != '\0' ? tmp : "/tmp";
+    for (int index = 1; index < argc; ++index) {
+        const std::string argument = argv[index];
+        if (argument == "--quick") {
+            options.quick = true;
+        } else if (argument == "--output" && index + 1 < argc) {
+            options.outputPath = argv[++index];
+        } else if (argument == "--scratch-dir" && index + 1 < argc) {
+            options.scratchDirectory = argv[++index];
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--quick] [--output results.json] [--scratch-dir dir]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 2;
+
+    std::vector<Result> results;
+    for (const size_t burst : {64, 192, 960}) {
+        results.push_back(benchmarkRingThroughput(options, burst));
+    }
+    for (const int32_t tracks : {1, 4, 16, 64}) {
+        for (const int32_t burst : {64, 192, 480, 960}) {
+            results.push_back(benchmarkMix(options, tracks, burst));
+        }
+    }
+    for (const int32_t tracks : {4, 64}) {
+        results.push_back(benchmarkMix(options, tracks, 192, true));
+    }
+    for (const int32_t channels : {2, 6}) {
+        results.push_back(benchmarkMix(options, 16, 192, false, channels));
+    }
+    for (const int32_t tracks : {4, 16}) {
+        results.push_back(benchmarkMix(options, tracks, 192, false, 1, 44'100));
+        results.push_back(benchmarkMix(options, tracks, 192, true, 1, 44'100));
+    }
+    for (const int32_t segments : {10, 500}) {
+        results.push_back(benchmarkSeekWhileRunning(options, segments));
+    }
+    for (const int32_t speed : {1'000, 750, 500}) {
+        results.push_back(benchmarkPracticeSpeed(options, 16, speed));
+    }
+    for (const int32_t burst : {64, 192, 960}) {
+        results.push_back(benchmarkCaptureConversion(options, burst));
+    }
+    for (const size_t chunk : {size_t{192}, size_t{4'096}}) {
+        results.push_back(benchmarkOnsetEnvelope(options, chunk));
+    }
+    results.push_back(benchmarkLoadConversion(options));
+    results.push_back(benchmarkLoudness(options));
+    for (const int32_t inputRate : {44'100, 32'000, 96'000}) {
+        results.push_back(benchmarkResample(options, inputRate));
+    }
+    for (const size_t chunk : {size_t{1'024}, size_t{4'096}, size_t{65'536}}) {
+        results.push_back(benchmarkWavWrite(options, chunk));
+    }
+    for (const auto method : {WavReadMethod::CopyWholeFile,
+                              WavReadMethod::MappedView,
+                              WavReadMethod::MappedMonoDecode}) {
+        results.push_back(benchmarkWavRead(options, method));
+    }
+    for (const auto format : {LosslessFormat::Wav, LosslessFormat::Flac}) {
+        results.push_back(benchmarkLosslessDecode(options, format));
+    }
+    for (const auto format : {tapstory::MixdownFormat::Wav, tapstory::MixdownFormat::Flac}) {
+        for (const int32_t workers : {1, 4}) {
+            results.push_back(benchmarkOfflineMixdown(options, format, workers));
+        }
+    }
+    for (const int32_t segments : {10, options.quick ? 20 : 150}) {
+        results.push_back(benchmarkMixdownCacheAppend(options, segments));
+    }
+    for (const auto method : {OffsetMethod::BruteForceEnvelope,
+                              OffsetMethod::BruteForceFullRate,
+                              OffsetMethod::FftFullRate}) {
+        results.push_back(benchmarkOffsetEstimation(options, method));
+    }
+
+    const std::string json = toJson(options, results);
+    if (options.outputPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream output(options.outputPath, std::ios::trunc);
+        output << json;
+        if (!output.good()) {
+            std::cerr << "Failed to write " << options.outputPath << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,2029 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio/ChainContainer.h"
+#include "audio/ChainStems.h"
+#include "audio/DuplexCore.h"
+#include "audio/FlacReader.h"
+#include "audio/FlacWriter.h"
+#include "audio/LinearResampler.h"
+#include "audio/LosslessDecoder.h"
+#include "audio/Loudness.h"
+#include "audio/MixKernels.h"
+#include "audio/MixdownCache.h"
+#include "audio/Mixer.h"
+#include "audio/OfflineMixdown.h"
+#include "audio/OffsetEstimator.h"
+#include "audio/OnsetEnvelope.h"
+#include "audio/PcmConversion.h"
+#include "audio/PeakPyramid.h"
+#include "audio/PolyphaseResampler.h"
+#include "audio/PunchCapture.h"
+#include "audio/PunchTakes.h"
+#include "audio/SpscPcmRing.h"
+#include "audio/StreamReadiness.h"
+#include "audio/TrackStore.h"
+#include "audio/WavReader.h"
+#include "audio/WavWriter.h"
+
+namespace {
+
+void testPunchBeforeBufferCapturesWholeInput() {
+    const auto slice = tapstory::computeCaptureSlice(1'000, 128, 900, false);
+    assert(slice.offsetFrames == 0);
+    assert(slice.frameCount == 128);
+    assert(slice.firstTimelineFrame == 1'000);
+}
+
+void testPunchInsideBufferCapturesExactBoundary() {
+    const auto slice = tapstory::computeCaptureSlice(1'000, 128, 1'063, false);
+    assert(slice.offsetFrames == 63);
+    assert(slice.frameCount == 65);
+    assert(slice.firstTimelineFrame == 1'063);
+}
+
+void testCompensatedPunchGatesLaterButExactly() {
+    const int64_t requestedPunch = 1'000;
+    const int64_t compensatedPunch = tapstory::compensatedPunchFrame(requestedPunch, 240);
+    assert(compensatedPunch == 1'240);
+    const auto slice = tapstory::computeCaptureSlice(1'200, 128, compensatedPunch, false);
+    assert(slice.offsetFrames == 40);
+    assert(slice.frameCount == 88);
+    assert(slice.firstTimelineFrame == 1'240);
+}
+
+void testPunchAfterAvailableInputCapturesNothing() {
+    const auto slice = tapstory::computeCaptureSlice(1'000, 32, 1'063, false);
+    assert(slice.offsetFrames == 0);
+    assert(slice.frameCount == 0);
+    assert(slice.firstTimelineFrame == -1);
+}
+
+void testStartedCaptureIgnoresPunch() {
+    const auto slice = tapstory::computeCaptureSlice(1'000, 64, 10'000, true);
+    assert(slice.offsetFrames == 0);
+    assert(slice.frameCount == 64);
+    assert(slice.firstTimelineFrame == 1'000);
+}
+
+void testCaptureOnsetMustMatchCompensatedPunch() {
+    assert(tapstory::isExactCaptureOnset(1'240, 1'240));
+    assert(!tapstory::isExactCaptureOnset(1'368, 1'240));
+    assert(!tapstory::isExactCaptureOnset(-1, 1'240));
+}
+
+void testClockDriftAllowsOneBurstAndBoundedLongTakeRate() {
+    constexpr int32_t burstFrames = 192;
+    assert(tapstory::clockDriftFrameLimit(48'000, burstFrames) == burstFrames);
+    assert(tapstory::isClockDriftWithinLimit(47'808, 48'000, burstFrames));
+    assert(!tapstory::isClockDriftWithinLimit(47'807, 48'000, burstFrames));
+
+    // Five minutes at 48 kHz permits 0.25% correction, but no more.
+    constexpr int64_t fiveMinutes = 14'400'000;
+    assert(tapstory::clockDriftFrameLimit(fiveMinutes, burstFrames) == 36'000);
+    assert(tapstory::isClockDriftWithinLimit(
+            fiveMinutes - 36'000,
+            fiveMinutes,
+            burstFrames));
+    assert(!tapstory::isClockDriftWithinLimit(
+            fiveMinutes - 36'001,
+            fiveMinutes,
+            burstFrames));
+}
+
+void testTailDrainUsesExactPartialFinalCallback() {
+    const auto first = tapstory::computeTailDrainSlice(240, 128);
+    assert(first.timelineFrames == 128);
+    assert(first.remainingFrames == 112);
+    assert(!first.complete);
+
+    const auto final = tapstory::computeTailDrainSlice(first.remainingFrames, 128);
+    assert(final.timelineFrames == 112);
+    assert(final.remainingFrames == 0);
+    assert(final.complete);
+
+    // Advancing the capture end by the compensation preserves the logical span.
+    constexpr int64_t logicalPunch = 1'000;
+    constexpr int64_t compensation = 240;
+    constexpr int64_t transportStop = 10'000;
+    const int64_t actualStart = tapstory::compensatedPunchFrame(
+            logicalPunch,
+            compensation);
+    const int64_t drainedEnd = transportStop + compensation;
+    assert(drainedEnd - actualStart == transportStop - logicalPunch);
+}
+
+void testTailDrainWaitsForShortInputInsteadOfClippingIt() {
+    const auto shortInput = tapstory::computeTailDrainSlice(240, 64);
+    assert(shortInput.timelineFrames == 64);
+    assert(shortInput.remainingFrames == 176);
+    assert(!shortInput.complete);
+
+    const auto nextInput = tapstory::computeTailDrainSlice(shortInput.remainingFrames, 192);
+    assert(nextInput.timelineFrames == 176);
+    assert(nextInput.remainingFrames == 0);
+    assert(nextInput.complete);
+}
+
+void testTailDrainRequiresCaptureToHaveStarted() {
+    assert(!tapstory::shouldDrainCaptureTail(true, -1, false, 240));
+    assert(tapstory::shouldDrainCaptureTail(true, 1'240, false, 240));
+    assert(!tapstory::shouldDrainCaptureTail(false, 1'240, false, 240));
+    assert(!tapstory::shouldDrainCaptureTail(true, 1'240, true, 240));
+    assert(!tapstory::shouldDrainCaptureTail(true, 1'240, false, 0));
+}
+
+void testXRunDeltaIgnoresUnsupportedCounters() {
+    assert(tapstory::countNewXRuns(-1, -1) == -1);
+    assert(tapstory::countNewXRuns(-1, 3) == -1);
+    assert(tapstory::countNewXRuns(3, -1) == -1);
+}
+
+void testXRunDeltaCountsNewDiscontinuities() {
+    assert(tapstory::countNewXRuns(4, 7) == 3);
+    assert(tapstory::countNewXRuns(4, 4) == 0);
+    assert(tapstory::countNewXRuns(4, 2) == 0);
+}
+
+void testRingWrapAndCapacity() {
+    tapstory::SpscPcmRing ring(5);
+    const int16_t first[] = {1, 2, 3, 4};
+    assert(ring.write(first, 4) == 4);
+    assert(ring.availableToRead() == 4);
+
+    int16_t out[5] = {};
+    assert(ring.read(out, 2) == 2);
+    assert(out[0] == 1 && out[1] == 2);
+
+    const int16_t second[] = {5, 6, 7, 8};
+    assert(ring.write(second, 4) == 3);
+    assert(ring.availableToRead() == 5);
+    assert(ring.read(out, 5) == 5);
+    const int16_t expected[] = {3, 4, 5, 6, 7};
+    for (int i = 0; i < 5; ++i) assert(out[i] == expected[i]);
+}
+
+void testRingGeneratedWrite() {
+    tapstory::SpscPcmRing ring(4);
+    assert(ring.writeGenerated(3, [](size_t index) {
+        return static_cast<int16_t>(10 + index);
+    }) == 3);
+    int16_t output[3] = {};
+    assert(ring.read(output, 3) == 3);
+    assert(output[0] == 10 && output[1] == 11 && output[2] == 12);
+}
+
+void testRingSingleProducerSingleConsumer() {
+    constexpr int kCount = 200'000;
+    tapstory::SpscPcmRing ring(257);
+    std::atomic<bool> producerDone{false};
+    std::vector<int16_t> received;
+    received.reserve(kCount);
+
+    std::thread producer([&] {
+        for (int value = 0; value < kCount;) {
+            const int16_t sample = static_cast<int16_t>(value % 30'000);
+            if (ring.write(&sample, 1) == 1) ++value;
+        }
+        producerDone.store(true, std::memory_order_release);
+    });
+
+    while (!producerDone.load(std::memory_order_acquire) || ring.availableToRead() > 0) {
+        int16_t sample = 0;
+        if (ring.read(&sample, 1) == 1) received.push_back(sample);
+    }
+    producer.join();
+
+    assert(received.size() == kCount);
+    for (int i = 0; i < kCount; ++i) {
+        assert(received[i] == static_cast<int16_t>(i % 30'000));
+    }
+}
+
+
+void testMonoTrackMixesOnlyItsOverlap() {
+    const float samples[] = {0.1f, 0.2f, 0.3f, 0.4f};
+    float output[8] = {};
+
+    // The track starts two frames into this four-frame callback.
+    tapstory::addMonoToStereo(samples, 4, -2, output, 4);
+    const float expected[] = {0, 0, 0, 0, 0.1f, 0.1f, 0.2f, 0.2f};
+    for (int i = 0; i < 8; ++i) assert(output[i] == expected[i]);
+
+    // Only the final frame of the track overlaps this callback.
+    float tail[8] = {};
+    tapstory::addMonoToStereo(samples, 4, 3, tail, 4);
+    assert(tail[0] == 0.4f && tail[1] == 0.4f);
+    for (int i = 2; i < 8; ++i) assert(tail[i] == 0.0f);
+
+    float untouched[4] = {};
+    tapstory::addMonoToStereo(samples, 4, 4, untouched, 2);
+    tapstory::addMonoToStereo(samples, 4, -2, untouched, 2);
+    for (float value : untouched) assert(value == 0.0f);
+}
+
+void testMixClampAndCaptureConversionSaturate() {
+    float mixed[] = {1.5f, -2.0f, 0.25f};
+    tapstory::clampSamples(mixed, 3);
+    assert(mixed[0] == 1.0f && mixed[1] == -1.0f && mixed[2] == 0.25f);
+
+    assert(tapstory::floatToPcm16(2.0f) == 32'767);
+    assert(tapstory::floatToPcm16(-2.0f) == -32'767);
+    assert(tapstory::floatToPcm16(0.5f) == 16'383);
+    assert(tapstory::pcm16ToFloat(-32'768) == -1.0f);
+}
+
+void testLinearResamplerMatchesLoadPathLength() {
+    assert(tapstory::resampledFrameCount(44'100, 44'100, 48'000) == 48'000);
+    assert(tapstory::resampledFrameCount(3, 48'000, 48'000) == 3);
+    assert(tapstory::resampledFrameCount(10, 0, 48'000) == 0);
+
+    const float input[] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float doubled[8] = {};
+    tapstory::resampleToRate(input, 4, 24'000, doubled, 8, 48'000);
+    const float expected[] = {0.0f, 0.5f, 1.0f, 1.5f, 2.0f, 2.5f, 3.0f, 3.0f};
+    for (int i = 0; i < 8; ++i) assert(doubled[i] == expected[i]);
+
+    // Drift correction maps the raw span exactly onto the timeline span.
+    float stretched[3] = {};
+    tapstory::resampleToFrameCount(input, 4, stretched, 3);
+    assert(stretched[0] == 0.0f);
+    assert(stretched[1] > 1.33f && stretched[1] < 1.34f);
+    assert(stretched[2] > 2.66f && stretched[2] < 2.67f);
+}
+
+void testWavWriterPatchesSizesOnClose() {
+    const std::string path = "/tmp/tapstory-wav-writer-test.wav";
+    tapstory::WavWriter writer;
+    assert(writer.open(path, 48'000, 1));
+    const int16_t first[] = {1, -2, 3};
+    const int16_t second[] = {4};
+    assert(writer.write(first, 3));
+    assert(writer.write(second, 1));
+    assert(writer.frameCount() == 4);
+    assert(writer.close());
+
+    std::ifstream input(path, std::ios::binary);
+    const std::vector<unsigned char> bytes(
+            (std::istreambuf_iterator<char>(input)),
+            std::istreambuf_iterator<char>());
+    assert(bytes.size() == tapstory::WavWriter::kHeaderBytes + 8);
+    auto u32 = [&bytes](size_t offset) {
+        return static_cast<uint32_t>(bytes[offset])
+                | static_cast<uint32_t>(bytes[offset + 1]) << 8
+                | static_cast<uint32_t>(bytes[offset + 2]) << 16
+                | static_cast<uint32_t>(bytes[offset + 3]) << 24;
+    };
+    assert(u32(4) == 36 + 8);
+    assert(u32(24) == 48'000);
+    assert(u32(40) == 8);
+    assert(bytes[44] == 1 && bytes[46] == 0xfe && bytes[47] == 0xff);
+    std::remove(path.c_str());
+}
+
+void testTrackStoreKeepsTimelineOrder() {
+    const int16_t pcm[] = {16'384, 16'384, 16'384, 16'384};
+    tapstory::TrackStore store;
+    assert(store.load("late", pcm, 4, 100));
+    assert(store.load("first", pcm, 2, 0));
+    assert(store.load("late-overdub", pcm, 4, 100));
+    assert(!store.load("empty", pcm, 0, 0));
+
+    assert(store.size() == 3);
+    assert(store.tracks()[0].id == "first");
+    assert(store.tracks()[1].id == "late");
+    assert(store.tracks()[2].id == "late-overdub");
+    assert(store.tracks()[0].samples[0] == 0.5f);
+    assert(store.endFrame() == 104);
+}
+
+void testTrackStoreFindsFirstSoundingTrackBySearch() {
+    // A long bed under short segments: the bed keeps every frame reachable.
+    std::vector<int16_t> pcm(1'000, 1'000);
+    tapstory::TrackStore store;
+    store.load("bed", pcm.data(), 1'000, 0);
+    for (int32_t segment = 0; segment < 40; ++segment) {
+        store.load("s" + std::to_string(segment), pcm.data(), 30, 100 + segment * 40);
+    }
+    store.load("tail", pcm.data(), 500, 2'000);
+
+    const std::vector<tapstory::Track> &tracks = store.tracks();
+    for (int64_t frame = -10; frame < 2'600; frame += 7) {
+        size_t expected = 0;
+        int64_t reach = 0;
+        while (expected < tracks.size()) {
+            reach = std::max(reach, tracks[expected].endFrame());
+            if (reach > frame) break;
+            ++expected;
+        }
+        assert(store.firstTrackEndingAfter(frame) == expected);
+    }
+    assert(store.firstTrackEndingAfter(500) == 0);
+    assert(tracks[store.firstTrackEndingAfter(1'500)].id == "s35");
+    assert(tracks[store.firstTrackEndingAfter(1'800)].id == "tail");
+    assert(store.firstTrackEndingAfter(2'500) == tracks.size());
+    store.clear();
+    assert(store.firstTrackEndingAfter(0) == 0 && store.endFrame() == 0);
+}
+
+void testMixerSumsOverlappingTracksAndClamps() {
+    const int16_t loud[] = {24'576, 24'576, 24'576};
+    const int16_t quiet[] = {-8'192};
+    tapstory::TrackStore store;
+    store.load("a", loud, 3, 1);
+    store.load("b", loud, 3, 2);
+    store.load("c", quiet, 1, 3);
+    store.load("future", loud, 3, 8);
+
+    float output[8];
+    std::fill_n(output, 8, 9.0f);
+    tapstory::mixTracks(store, 0, output, 4);
+    // Frame 0 is silent, frame 1 has one track, and frames 2-3 saturate.
+    const float expected[] = {0, 0, 0.75f, 0.75f, 1.0f, 1.0f, 1.0f, 1.0f};
+    for (int i = 0; i < 8; ++i) assert(output[i] == expected[i]);
+}
+
+float timelineSample(int64_t frame) {
+    return static_cast<float>(frame) / 1'000.0f;
+}
+
+void processRamp(tapstory::DuplexCore &core, int32_t frames) {
+    std::vector<float> input(static_cast<size_t>(frames));
+    for (int32_t i = 0; i < frames; ++i) input[i] = timelineSample(core.currentFrame() + i);
+    std::vector<float> output(static_cast<size_t>(frames) * 2);
+    core.process(input.data(), frames, output.data(), frames);
+}
+
+std::vector<int16_t> readRawPcm(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<int16_t> samples;
+    int16_t sample = 0;
+    while (file.read(reinterpret_cast<char *>(&sample), sizeof(sample))) samples.push_back(sample);
+    return samples;
+}
+
+void testDuplexCoreCapturesFromGateThroughCompensatedTail() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    const int16_t pcm[] = {32'767, 32'767, 32'767, 32'767};
+    tapstory::DuplexCore core;
+    core.trackStore().load("bed", pcm, 4, 20);
+    core.prepareCapture(1'024, 48'000);
+    // Capture buffers are only allocated once a take needs them.
+    assert(!core.hasCaptureBuffers());
+    assert(core.captureRingCapacity() == 1'024);
+    std::atomic<int64_t> notifiedStart{-1};
+    core.setCaptureStartedHandler([&notifiedStart](int64_t frame) {
+        notifiedStart.store(frame);
+    });
+    assert(core.armCapture(path, 10, 4));
+    assert(core.hasCaptureBuffers());
+    assert(core.captureGateFrame() == 14);
+
+    processRamp(core, 8);
+    assert(core.actualCaptureStartFrame() == -1);
+    processRamp(core, 8);
+    processRamp(core, 8);
+    assert(core.actualCaptureStartFrame() == 14);
+
+    // Transport stop at frame 24 keeps capturing silently until 24 + 4.
+    assert(core.beginTransportStop());
+    std::vector<float> input(8, 0.5f);
+    std::vector<float> output(16, 9.0f);
+    for (int i = 0; i < 8; ++i) input[i] = timelineSample(24 + i);
+    core.process(input.data(), 8, output.data(), 8);
+    for (float sample : output) assert(sample == 0.0f);
+    assert(core.currentFrame() == 28);
+    assert(!core.isDrainingTail());
+    assert(core.captureEndFrame() == 28);
+
+    // Later callbacks before the device stops neither advance nor capture.
+    core.process(input.data(), 8, output.data(), 8);
+    assert(core.currentFrame() == 28);
+    core.onTransportStopped();
+    assert(core.finishCapture(false));
+
+    const std::vector<int16_t> samples = readRawPcm(path);
+    assert(core.recordedFrameCount() == 14);
+    assert(samples.size() == 14);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        assert(samples[i] == tapstory::floatToPcm16(timelineSample(14 + static_cast<int64_t>(i))));
+    }
+    assert(notifiedStart.load() == 14);
+    assert(core.droppedCaptureFrameCount() == 0);
+    assert(core.shortInputFrameCount() == 0);
+
+    // Both envelopes cover the take's 14 frames in one 2 kHz block.
+    const tapstory::DuplexCore::TakeOnsetEnvelopes envelopes = core.takeOnsetEnvelopes();
+    assert(envelopes.blockFrames == 24);
+    assert(envelopes.startFrame == 14);
+    assert(envelopes.take.size() == 1 && envelopes.mix.size() == 1);
+    float takeOnset = 0.0f;
+    for (size_t i = 1; i < samples.size(); ++i) {
+        takeOnset += static_cast<float>(std::abs(samples[i] - samples[i - 1]));
+    }
+    assert(envelopes.take[0] == takeOnset);
+    // The bed rises to full scale at frame 20 and falls back at 24.
+    assert(envelopes.mix[0] == 2.0f * 32'767.0f);
+
+    const tapstory::PeakPyramid::Level peaks = core.capturePeaks(0);
+    assert(peaks.binCount == 1);
+    assert(peaks.minMax[0] == *std::min_element(samples.begin(), samples.end()));
+    assert(peaks.minMax[1] == *std::max_element(samples.begin(), samples.end()));
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreSeekCrossfadesAtCallbackBoundary() {
+    const std::vector<int16_t> low(4'000, 8'192);
+    const std::vector<int16_t> high(4'000, 16'384);
+    tapstory::DuplexCore core;
+    core.trackStore().load("low", low.data(), 4'000, 0);
+    core.trackStore().load("high", high.data(), 4'000, 10'000);
+
+    std::vector<float> output(64 * 2);
+    core.process(nullptr, 0, output.data(), 64);
+    assert(core.requestSeek(10'000));
+    assert(core.requestSeek(10'100));
+    assert(core.pendingSeekFrame() == 10'100 && core.currentFrame() == 64);
+
+    // The next callback starts at the newest request and fades from 64 on.
+    const int32_t fade = tapstory::DuplexCore::kSeekCrossfadeFrames;
+    std::vector<float> heard;
+    for (int32_t callback = 0; callback < 6; ++callback) {
+        core.process(nullptr, 0, output.data(), 64);
+        for (int32_t frame = 0; frame < 64; ++frame) {
+            assert(output[frame * 2] == output[frame * 2 + 1]);
+            heard.push_back(output[frame * 2]);
+        }
+    }
+    assert(core.pendingSeekFrame() == tapstory::DuplexCore::kUnsetFrame);
+    assert(core.currentFrame() == 10'100 + 6 * 64);
+    assert(heard[0] > 0.25f && heard[0] < 0.26f);
+    for (int32_t frame = 1; frame < fade; ++frame) {
+        // Equal power stays at or above both levels through the fade.
+        assert(heard[frame] >= 0.25f - 1e-6f && heard[frame] < 0.71f);
+    }
+    assert(heard[fade - 1] > 0.49f);
+    for (size_t frame = fade; frame < heard.size(); ++frame) assert(heard[frame] == 0.5f);
+
+    // Stopped seeks move immediately and drop a request no callback applied.
+    assert(core.requestSeek(5));
+    core.seek(20);
+    core.process(nullptr, 0, output.data(), 64);
+    assert(core.currentFrame() == 84 && output[0] == 0.25f);
+
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    core.prepareCapture(256, 48'000);
+    core.allocateCaptureBuffers();
+    assert(core.hasCaptureBuffers());
+    assert(core.armCapture(path, 500, 0));
+    assert(!core.requestSeek(0));
+    assert(core.abortCapture());
+    core.finishCapture(false);
+
+    // A seek no callback applied before the stop lands at the stop, so a take
+    // armed next starts where the playhead said it would.
+    const std::vector<float> input(64, 0.25f);
+    assert(core.requestSeek(3'000) && core.playheadFrame() == 3'000);
+    core.onTransportStopped();
+    assert(core.pendingSeekFrame() == tapstory::DuplexCore::kUnsetFrame);
+    assert(core.currentFrame() == 3'000);
+    assert(core.armCapture(path, 3'000, 0));
+    core.process(input.data(), 64, output.data(), 64);
+    assert(core.actualCaptureStartFrame() == 3'000);
+    assert(core.finishCapture(false));
+
+    // A take armed while a seek is pending starts from the seek target.
+    assert(core.requestSeek(6'000));
+    assert(core.armCapture(path, 6'000, 0));
+    core.process(input.data(), 64, output.data(), 64);
+    assert(core.actualCaptureStartFrame() == 6'000 && core.currentFrame() == 6'064);
+    assert(core.finishCapture(false));
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreLoopRegionWrapsInsideCallback() {
+    std::vector<int16_t> ramp(1'000);
+    for (size_t i = 0; i < ramp.size(); ++i) ramp[i] = static_cast<int16_t>(i * 16);
+    tapstory::DuplexCore core;
+    core.trackStore().load("ramp", ramp.data(), 1'000, 0);
+    const auto rampAt = [](int64_t frame) { return static_cast<float>(frame * 16) / 32'768.0f; };
+
+    assert(!core.setLoopRegion(100, 120, 32));
+    assert(core.setLoopRegion(100, 300, 0));
+    assert(core.loopRegion().startFrame == 100 && core.loopRegion().endFrame == 300);
+    core.seek(250);
+    std::vector<float> output(64 * 2);
+    core.process(nullptr, 0, output.data(), 64);
+    // Frames 250-299 and then 100-113 play back to back in one callback.
+    for (int32_t frame = 0; frame < 64; ++frame) {
+        const int64_t timeline = frame < 50 ? 250 + frame : 50 + frame;
+        assert(output[frame * 2] == rampAt(timeline));
+    }
+    assert(core.currentFrame() == 114);
+
+    // With a crossfade the audio past the loop end fades out under the start.
+    assert(core.setLoopRegion(100, 300, 16));
+    core.seek(270);
+    core.process(nullptr, 0, output.data(), 64);
+    assert(output[30 * 2] > rampAt(300));
+    assert(output[45 * 2] > rampAt(115) && output[45 * 2] < rampAt(150));
+    for (int32_t frame = 46; frame < 64; ++frame) assert(output[frame * 2] == rampAt(70 + frame));
+
+    // A playhead past the end plays on; clearing stops the wrap.
+    core.seek(400);
+    core.process(nullptr, 0, output.data(), 64);
+    assert(core.currentFrame() == 464);
+    core.clearLoopRegion();
+    assert(!core.loopRegion().active());
+    core.seek(290);
+    core.process(nullptr, 0, output.data(), 64);
+    assert(core.currentFrame() == 354);
+}
+
+void testDuplexCorePracticeSpeedResamplesTimeline() {
+    std::vector<int16_t> tone(48'000);
+    for (size_t frame = 0; frame < tone.size(); ++frame) {
+        const double angle = 2.0 * 3.14159265358979323846 * 200.0 * frame / 48'000;
+        tone[frame] = static_cast<int16_t>(std::lround(32'767.0 * 0.4 * std::sin(angle)));
+    }
+    const auto toneAt = [](double frame) {
+        return 0.4 * std::sin(2.0 * 3.14159265358979323846 * 200.0 * frame / 48'000);
+    };
+    tapstory::DuplexCore core;
+    core.trackStore().load("tone", tone.data(), 48'000, 0);
+
+    assert(!core.setPlaybackSpeed(499) && !core.setPlaybackSpeed(1'001));
+    assert(core.setPlaybackSpeed(500) && core.playbackSpeed() == 500);
+    core.seek(1'000);
+    std::vector<float> whole(2 * 1'024);
+    core.process(nullptr, 0, whole.data(), 1'024);
+    // Half speed reads every timeline frame twice as slowly: a 100 Hz tone.
+    assert(core.currentFrame() == 1'512);
+    for (int32_t frame = 0; frame < 1'024; ++frame) {
+        assert(std::fabs(whole[2 * frame] - toneAt(1'000 + frame * 0.5)) < 1e-3);
+        assert(whole[2 * frame + 1] == whole[2 * frame]);
+    }
+
+    // The playhead keeps its fraction, so bursts of any size render the same.
+    core.seek(1'000);
+    std::vector<float> split(2 * 1'024);
+    for (int32_t offset = 0; offset < 1'024; offset += 37) {
+        core.process(nullptr, 0, split.data() + 2 * offset, std::min(37, 1'024 - offset));
+    }
+    assert(split == whole && core.currentFrame() == 1'512);
+    assert(core.setPlaybackSpeed(750));
+    core.seek(0);
+    for (int callback = 0; callback < 10; ++callback) {
+        core.process(nullptr, 0, split.data(), 37);
+    }
+    assert(core.currentFrame() == 37 * 10 * 750 / 1'000);
+
+    // Loops wrap where the slowed playhead reaches their end.
+    assert(core.setPlaybackSpeed(500) && core.setLoopRegion(2'000, 2'300, 0));
+    core.seek(2'000);
+    core.process(nullptr, 0, whole.data(), 600);
+    assert(core.currentFrame() == 2'000);
+    assert(std::fabs(whole[2 * 580] - toneAt(2'290.0)) < 1e-3);
+    core.clearLoopRegion();
+
+    // The kernel's taps wrap with the loop: a silent region between loud
+    // audio stays silent through every wrap.
+    std::vector<int16_t> gated(4'000, 16'384);
+    std::fill(gated.begin() + 2'000, gated.begin() + 2'300, 0);
+    tapstory::DuplexCore looped;
+    looped.trackStore().load("gated", gated.data(), 4'000, 0);
+    assert(looped.setPlaybackSpeed(500) && looped.setLoopRegion(2'000, 2'300, 0));
+    looped.seek(2'000);
+    for (int callback = 0; callback < 4; ++callback) {
+        looped.process(nullptr, 0, whole.data(), 450);
+        for (int32_t sample = 0; sample < 2 * 450; ++sample) assert(whole[sample] == 0.0f);
+    }
+    assert(looped.currentFrame() == 2'000);
+
+    // Capture only runs at the nominal rate.
+    const std::string path = "/tmp/tapstory-practice-speed-test.pcm";
+    core.prepareCapture(256, 48'000);
+    assert(!core.armCapture(path, 500, 0));
+    assert(core.setPlaybackSpeed(tapstory::DuplexCore::kPlaybackSpeedScale));
+    core.seek(100);
+    core.process(nullptr, 0, whole.data(), 64);
+    assert(core.currentFrame() == 164 && whole[0] == tapstory::pcm16ToFloat(tone[100]));
+    assert(core.armCapture(path, 500, 0));
+    assert(!core.setPlaybackSpeed(500));
+    assert(core.abortCapture());
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreLoopedTakeEndsWhereInputReachesLoopEnd() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    tapstory::DuplexCore core;
+    core.prepareCapture(1'024, 48'000);
+    assert(core.setLoopRegion(100, 200, 0));
+    core.seek(120);
+    assert(!core.armCapture(path, 150, 100));
+    assert(core.armCapture(path, 150, 8));
+    assert(!core.setLoopRegion(100, 108, 0));
+
+    // Small callbacks split the wrap and the lagging input across callbacks.
+    int64_t arrival = 0;
+    std::vector<float> input(6);
+    std::vector<float> output(6 * 2);
+    for (int32_t callback = 0; callback < 25; ++callback) {
+        for (float &sample : input) sample = timelineSample(arrival++);
+        core.process(input.data(), 6, output.data(), 6);
+    }
+    assert(core.currentFrame() == 170);
+    assert(!core.isCaptureArmed());
+    assert(core.actualCaptureStartFrame() == 158);
+    // Output wrapped at 200; input of that pass kept coming for 8 frames.
+    assert(core.captureEndFrame() == 208);
+    assert(core.finishCapture(false));
+
+    const std::vector<int16_t> samples = readRawPcm(path);
+    assert(samples.size() == 50);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        assert(samples[i] == tapstory::floatToPcm16(timelineSample(38 + static_cast<int64_t>(i))));
+    }
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreLoopedTakeWritesOneLanePerPass() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    const std::string prefix = "/tmp/tapstory-duplex-core-lane-";
+    tapstory::DuplexCore core;
+    core.prepareCapture(1'024, 48'000);
+    assert(core.setLoopRegion(100, 200, 0));
+    core.seek(120);
+    assert(core.armCapture(path, 150, 8, tapstory::DuplexCore::kUnsetFrame, prefix));
+
+    // Input sample i arrives with output frame 120 + i until the first wrap.
+    int64_t arrival = 0;
+    std::vector<float> input(6);
+    std::vector<float> output(6 * 2);
+    for (int32_t callback = 0; callback < 60; ++callback) {
+        for (float &sample : input) sample = timelineSample(arrival++);
+        core.process(input.data(), 6, output.data(), 6);
+    }
+    assert(core.isCaptureArmed());
+    assert(core.currentFrame() == 180);
+    core.requestCaptureStop();
+    core.process(input.data(), 6, output.data(), 6);
+    assert(!core.isCaptureArmed());
+    assert(core.finishCapture(false));
+
+    const std::vector<tapstory::DuplexCore::LoopTakeLane> lanes = core.loopTakeLanes();
+    assert(lanes.size() == 4);
+    const int64_t firstArrivals[] = {38, 88, 188, 288};
+    const int64_t startFrames[] = {150, 100, 100, 100};
+    const int64_t endFrames[] = {200, 200, 200, 172};
+    for (size_t pass = 0; pass < lanes.size(); ++pass) {
+        const tapstory::DuplexCore::LoopTakeLane &lane = lanes[pass];
+        assert(lane.passIndex == static_cast<int32_t>(pass));
+        assert(lane.path == prefix + std::to_string(pass) + ".wav");
+        assert(lane.startFrame == startFrames[pass] && lane.endFrame == endFrames[pass]);
+        assert(lane.rawFrameCount == lane.endFrame - lane.startFrame);
+        assert(lane.driftFrames == 0);
+
+        tapstory::WavReader reader;
+        assert(reader.open(lane.path));
+        assert(reader.format().sampleRate == 48'000);
+        assert(reader.frameCount() == lane.rawFrameCount);
+        const int16_t *pcm = reader.pcm16();
+        for (int64_t frame = 0; frame < reader.frameCount(); ++frame) {
+            const float expected = timelineSample(firstArrivals[pass] + frame);
+            assert(pcm[frame] == tapstory::floatToPcm16(expected));
+        }
+        reader.close();
+        std::remove(lane.path.c_str());
+    }
+    assert(core.captureTimelineFrameCount() == 322);
+    assert(core.recordedFrameCount() == 322);
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreParkedTransportHoldsUntilResumed() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    const std::vector<int16_t> bed(1'000, 16'384);
+    tapstory::DuplexCore core;
+    core.trackStore().load("bed", bed.data(), 1'000, 0);
+    core.prepareCapture(1'024, 48'000);
+    core.parkTransport();
+    assert(core.isTransportParked());
+
+    // Parked callbacks are silent and leave timeline and capture alone, so
+    // the control thread seeks and arms as if the streams were stopped.
+    std::vector<float> input(64, 0.25f);
+    std::vector<float> output(64 * 2, 9.0f);
+    core.process(input.data(), 64, output.data(), 64);
+    for (float sample : output) assert(sample == 0.0f);
+    assert(core.currentFrame() == 0);
+    core.seek(200);
+    assert(core.armCapture(path, 200, 0));
+    core.process(input.data(), 64, output.data(), 64);
+    assert(core.currentFrame() == 200 && core.actualCaptureStartFrame() == -1);
+
+    core.resumeTransport();
+    assert(!core.isTransportParked() && core.transportStartDelayNanos() == -1);
+    core.process(input.data(), 64, output.data(), 64);
+    assert(core.transportStartDelayNanos() >= 0);
+    assert(core.currentFrame() == 264 && output[0] == 0.5f);
+    assert(core.actualCaptureStartFrame() == 200);
+
+    core.parkTransport();
+    core.waitForCallbacks();
+    core.onTransportStopped();
+    assert(core.captureEndFrame() == 264);
+    assert(core.finishCapture(false));
+    assert(core.recordedFrameCount() == 64);
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreCancelsPendingPunchOnTransportStop() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    tapstory::DuplexCore core;
+    core.prepareCapture(256, 48'000);
+    assert(core.armCapture(path, 100, 8));
+    processRamp(core, 16);
+    assert(!core.beginTransportStop());
+    processRamp(core, 192);
+    core.onTransportStopped();
+
+    assert(core.actualCaptureStartFrame() == -1);
+    assert(!core.isCaptureArmed());
+    assert(core.finishCapture(false));
+    assert(core.recordedFrameCount() == 0);
+    assert(!core.finishCapture(false));
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreCaptureStopEndsAtCallbackBoundary() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    tapstory::DuplexCore core;
+    core.prepareCapture(256, 48'000);
+    core.seek(32);
+    assert(core.armCapture(path, 0, 0));
+    processRamp(core, 8);
+    // Input shorter than the output burst is recorded as a shortfall.
+    std::vector<float> input(5, 0.25f);
+    std::vector<float> output(16);
+    core.process(input.data(), 5, output.data(), 8);
+    core.requestCaptureStop();
+    processRamp(core, 8);
+
+    assert(core.actualCaptureStartFrame() == 32);
+    assert(core.captureEndFrame() == 48);
+    assert(core.shortInputFrameCount() == 3);
+    assert(core.finishCapture(true));
+    assert(core.recordedFrameCount() == 13);
+    std::remove(path.c_str());
+}
+
+std::vector<unsigned char> readBytes(const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    return std::vector<unsigned char>(
+            (std::istreambuf_iterator<char>(input)),
+            std::istreambuf_iterator<char>());
+}
+
+tapstory::TrackStore makeMixdownStore() {
+    tapstory::TrackStore store;
+    std::vector<int16_t> pcm(30'000);
+    for (size_t i = 0; i < pcm.size(); ++i) pcm[i] = static_cast<int16_t>((i * 97) % 20'000);
+    store.load("a", pcm.data(), 30'000, 0);
+    store.load("b", pcm.data(), 12'345, 9'000);
+    store.load("c", pcm.data(), 7'000, 21'000);
+    return store;
+}
+
+void testDuplexCorePunchOutEndsTakeWhilePlaybackContinues() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    tapstory::DuplexCore core;
+    core.prepareCapture(1'024, 48'000);
+    assert(!core.armCapture(path, 10, 4, 10));
+    assert(core.armCapture(path, 10, 4, 30));
+
+    // The input heard at frame 30 arrives at 34, inside the fifth callback.
+    for (int32_t callback = 0; callback < 6; ++callback) processRamp(core, 8);
+    assert(!core.isCaptureArmed());
+    assert(core.actualCaptureStartFrame() == 14);
+    assert(core.captureEndFrame() == 34);
+    assert(core.currentFrame() == 48);
+    assert(core.finishCapture(true));
+
+    const std::vector<int16_t> samples = readRawPcm(path);
+    assert(samples.size() == 20);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        assert(samples[i] == tapstory::floatToPcm16(timelineSample(14 + static_cast<int64_t>(i))));
+    }
+    std::remove(path.c_str());
+}
+
+void testDuplexCoreScheduledStopEndsTakeAtExactFrame() {
+    const std::string path = "/tmp/tapstory-duplex-core-test.pcm";
+    tapstory::DuplexCore core;
+    core.prepareCapture(1'024, 48'000);
+    assert(!core.scheduleCaptureStop(30));
+    assert(core.armCapture(path, 10, 4));
+    assert(!core.scheduleCaptureStop(10));
+
+    // Scheduled mid-take, the stop still lands inside a later callback.
+    for (int32_t callback = 0; callback < 2; ++callback) processRamp(core, 8);
+    assert(core.scheduleCaptureStop(30));
+    for (int32_t callback = 0; callback < 4; ++callback) processRamp(core, 8);
+    assert(!core.isCaptureArmed());
+    assert(core.actualCaptureStartFrame() == 14);
+    assert(core.captureEndFrame() == 34);
+    assert(core.currentFrame() == 48);
+    assert(core.finishCapture(true));
+    assert(readRawPcm(path).size() == 20);
+
+    // A stop already passed ends the take at the next callback boundary.
+    assert(core.armCapture(path, 50, 4));
+    for (int32_t callback = 0; callback < 3; ++callback) processRamp(core, 8);
+    assert(core.scheduleCaptureStop(60));
+    processRamp(core, 8);
+    assert(!core.isCaptureArmed());
+    assert(core.captureEndFrame() == 72);
+    assert(core.finishCapture(true));
+    assert(readRawPcm(path).size() == 18);
+    std::remove(path.c_str());
+}
+
+void testOfflineMixdownMatchesRealtimeMixer() {
+    const std::string path = "/tmp/tapstory-mixdown-test.wav";
+    const tapstory::TrackStore store = makeMixdownStore();
+    tapstory::MixdownOptions options;
+    options.workerCount = 3;
+    options.blockFrames = 4'096;
+    const tapstory::MixdownResult result =
+            tapstory::renderMixdown(store, 100, 25'100, path, options);
+    assert(result.ok);
+    assert(result.frameCount == 25'000);
+    assert(result.workerCount == 3);
+    assert(result.realtimeFactor > 0.0);
+
+    std::vector<float> mix(25'000 * 2);
+    tapstory::mixTracks(store, 100, mix.data(), 25'000);
+    const std::vector<unsigned char> bytes = readBytes(path);
+    assert(bytes.size() == tapstory::WavWriter::kHeaderBytes + mix.size() * 2);
+    for (size_t i = 0; i < mix.size(); ++i) {
+        const size_t offset = tapstory::WavWriter::kHeaderBytes + i * 2;
+        const int16_t sample = static_cast<int16_t>(bytes[offset] | bytes[offset + 1] << 8);
+        assert(sample == tapstory::floatToPcm16(mix[i]));
+    }
+    assert(!tapstory::renderMixdown(store, 50, 50, path, options).ok);
+    std::remove(path.c_str());
+}
+
+void testParallelFlacMixdownMatchesStreamingEncoder() {
+    const std::string parallelPath = "/tmp/tapstory-mixdown-test.flac";
+    const std::string serialPath = "/tmp/tapstory-flac-writer-test.flac";
+    const tapstory::TrackStore store = makeMixdownStore();
+    tapstory::MixdownOptions options;
+    options.format = tapstory::MixdownFormat::Flac;
+    options.workerCount = 4;
+    options.blockFrames = 5'000;  // rounded up to two FLAC blocks
+    assert(tapstory::renderMixdown(store, 0, store.endFrame(), parallelPath, options).ok);
+
+    const int32_t frames = static_cast<int32_t>(store.endFrame());
+    std::vector<float> mix(static_cast<size_t>(frames) * 2);
+    tapstory::mixTracks(store, 0, mix.data(), frames);
+    std::vector<int16_t> pcm(mix.size());
+    tapstory::convertFloatToPcm16(mix.data(), pcm.data(), pcm.size());
+    tapstory::FlacWriter writer;
+    assert(writer.open(serialPath, 48'000, 2));
+    assert(writer.write(pcm.data(), 1'000));
+    assert(writer.write(pcm.data() + 2'000, static_cast<size_t>(frames) - 1'000));
+    assert(writer.frameCount() == static_cast<uint64_t>(frames));
+    assert(writer.close());
+
+    const std::vector<unsigned char> parallel = readBytes(parallelPath);
+    const std::vector<unsigned char> serial = readBytes(serialPath);
+    assert(parallel == serial);
+    assert(parallel.size() < pcm.size() * 2);
+    assert(parallel[0] == 'f' && parallel[3] == 'C' && parallel[4] == 0x80);
+    uint64_t streamInfo = 0;
+    for (size_t i = 18; i < 26; ++i) streamInfo = streamInfo << 8 | parallel[i];
+    assert((streamInfo >> 44) == 48'000);
+    assert(((streamInfo >> 41) & 0x7) == 1);
+    assert(((streamInfo >> 36) & 0x1f) == 15);
+    assert((streamInfo & 0xfffffffffULL) == static_cast<uint64_t>(frames));
+    const size_t firstFrame = tapstory::FlacWriter::kHeaderBytes;
+    assert(parallel[firstFrame] == 0xff && parallel[firstFrame + 1] == 0xf8);
+    std::remove(parallelPath.c_str());
+    std::remove(serialPath.c_str());
+}
+
+void testMixdownCacheRerendersOnlyChangedBlocks() {
+    const std::string cachePath = "/tmp/tapstory-mixdown-cache-test.wav";
+    const std::string freshPath = "/tmp/tapstory-mixdown-fresh-test.wav";
+    std::vector<int16_t> pcm(20'000);
+    for (size_t i = 0; i < pcm.size(); ++i) pcm[i] = static_cast<int16_t>((i * 37) % 9'000);
+    auto loadChain = [&pcm](tapstory::TrackStore &store, int segments) {
+        store.clear();
+        for (int segment = 0; segment < segments; ++segment) {
+            store.load("segment-" + std::to_string(segment), pcm.data(), 10'000, segment * 9'000);
+        }
+    };
+    auto matchesFreshRender = [&](const tapstory::TrackStore &store) {
+        tapstory::MixdownOptions options;
+        options.workerCount = 2;
+        assert(tapstory::renderMixdown(store, 0, store.endFrame(), freshPath, options).ok);
+        return readBytes(cachePath) == readBytes(freshPath);
+    };
+
+    tapstory::TrackStore store;
+    tapstory::MixdownCache cache(cachePath, 48'000, 4'096);
+    loadChain(store, 3);  // frames [0, 28'000): seven blocks
+    tapstory::MixdownCache::UpdateResult update = cache.update(store, 2);
+    assert(update.ok && update.blockCount == 7 && update.renderedBlocks == 7);
+    assert(matchesFreshRender(store));
+    assert(cache.update(store, 2).renderedBlocks == 0);
+
+    // Reloading identical segments and appending one at 27'000 only touches
+    // blocks 6-9: block 6 gains a contributor, 7-9 are new.
+    loadChain(store, 4);
+    update = cache.update(store, 2);
+    assert(update.ok && update.blockCount == 10 && update.renderedBlocks == 4);
+    assert(matchesFreshRender(store));
+
+    // Dropping the last segment shrinks the file back.
+    loadChain(store, 3);
+    update = cache.update(store, 2);
+    assert(update.ok && update.renderedBlocks == 1);
+    assert(matchesFreshRender(store));
+
+    cache.invalidate();
+    assert(cache.update(store, 1).renderedBlocks == 7);
+    std::remove(cachePath.c_str());
+    std::remove(freshPath.c_str());
+}
+
+/** Same LCG-plus-sine signal as the backend correlation tests. */
+std::vector<double> makeCalibrationSignal(size_t length) {
+    uint32_t state = 0x12345678;
+    std::vector<double> signal(length);
+    for (size_t index = 0; index < length; ++index) {
+        state = 1'664'525U * state + 1'013'904'223U;
+        const double noise = state / 4'294'967'295.0 * 2.0 - 1.0;
+        signal[index] = noise * 0.7 + std::sin(static_cast<double>(index) * 0.071) * 0.3;
+    }
+    return signal;
+}
+
+/** Direct per-lag NCC, as the backend computed it before the FFT path. */
+tapstory::OffsetEstimate bruteForceOffset(
+        const std::vector<double> &reference,
+        const std::vector<double> &test,
+        int64_t maxOffset) {
+    const auto mean = [](const std::vector<double> &samples) {
+        double sum = 0.0;
+        for (const double sample : samples) sum += sample;
+        return sum / static_cast<double>(samples.size());
+    };
+    const double referenceMean = mean(reference);
+    const double testMean = mean(test);
+    const int64_t referenceLength = static_cast<int64_t>(reference.size());
+    const int64_t testLength = static_cast<int64_t>(test.size());
+    const int64_t minimumOverlap = std::max<int64_t>(32, std::min(referenceLength, testLength) / 4);
+
+    tapstory::OffsetEstimate best;
+    for (int64_t offset = -maxOffset; offset <= maxOffset; ++offset) {
+        const int64_t referenceStart = std::max<int64_t>(0, -offset);
+        const int64_t testStart = std::max<int64_t>(0, offset);
+        const int64_t overlap = std::min(referenceLength - referenceStart, testLength - testStart);
+        if (overlap < minimumOverlap) continue;
+        double dot = 0.0;
+        double referenceEnergy = 0.0;
+        double testEnergy = 0.0;
+        for (int64_t index = 0; index < overlap; ++index) {
+            const double referenceValue = reference[referenceStart + index] - referenceMean;
+            const double testValue = test[testStart + index] - testMean;
+            dot += referenceValue * testValue;
+            referenceEnergy += referenceValue * referenceValue;
+            testEnergy += testValue * testValue;
+        }
+        const double energy = std::sqrt(referenceEnergy * testEnergy);
+        const double correlation = energy > 0.0 ? std::abs(dot / energy) : 0.0;
+        if (correlation > best.confidence) {
+            best.confidence = correlation;
+            best.offsetSamples = offset;
+        }
+    }
+    return best;
+}
+
+void testOffsetEstimatorFindsDelayedAndAdvancedCopies() {
+    const std::vector<double> reference = makeCalibrationSignal(4'096);
+    const int64_t delay = 173;
+    std::vector<double> recorded(reference.size() + delay + 64, 0.0);
+    for (size_t index = 0; index < reference.size(); ++index) {
+        recorded[index + delay] = reference[index] * 0.35 + 0.08;
+    }
+    const auto delayed = tapstory::estimateAudioOffset(
+            reference.data(), reference.size(), recorded.data(), recorded.size(), 512);
+    assert(delayed.offsetSamples == delay);
+    assert(std::abs(delayed.fractionalOffsetSamples - delay) < 0.05);
+    assert(delayed.confidence > 0.95);
+
+    const std::vector<double> advanced(reference.begin() + 211, reference.end());
+    const auto early = tapstory::estimateAudioOffset(
+            reference.data(), reference.size(), advanced.data(), advanced.size(), 512);
+    assert(early.offsetSamples == -211);
+    assert(early.confidence > 0.95);
+
+    const std::vector<double> silence(1'024, 0.0);
+    const auto unrelated = tapstory::estimateAudioOffset(
+            reference.data(), 1'024, silence.data(), silence.size(), 128);
+    assert(unrelated.confidence == 0.0);
+
+    // Every lag must agree with the direct sum, including the overlap cut-off.
+    const std::vector<double> shortTest(recorded.begin() + 1'500, recorded.begin() + 2'800);
+    const auto fast = tapstory::estimateAudioOffset(
+            reference.data(), reference.size(), shortTest.data(), shortTest.size(), 3'000);
+    const auto direct = bruteForceOffset(reference, shortTest, 3'000);
+    assert(fast.offsetSamples == direct.offsetSamples);
+    assert(std::abs(fast.confidence - direct.confidence) < 1e-9);
+}
+
+void testOffsetEstimatorInterpolatesHalfSampleDelay() {
+    // Averaging neighbours is a symmetric filter: exactly half a sample late.
+    const std::vector<double> reference = makeCalibrationSignal(8'192);
+    std::vector<double> recorded(reference.size() + 400, 0.0);
+    for (size_t index = 1; index < reference.size(); ++index) {
+        recorded[index + 300] = 0.5 * (reference[index] + reference[index - 1]);
+    }
+    std::vector<int16_t> referencePcm(reference.size());
+    std::vector<int16_t> recordedPcm(recorded.size());
+    for (size_t index = 0; index < reference.size(); ++index) {
+        referencePcm[index] = static_cast<int16_t>(std::lround(reference[index] * 12'000.0));
+    }
+    for (size_t index = 0; index < recorded.size(); ++index) {
+        recordedPcm[index] = static_cast<int16_t>(std::lround(recorded[index] * 12'000.0));
+    }
+    const auto estimate = tapstory::estimateAudioOffset(
+            referencePcm.data(), referencePcm.size(), recordedPcm.data(), recordedPcm.size(), 1'000);
+    assert(std::abs(estimate.fractionalOffsetSamples - 300.5) < 0.1);
+    assert(estimate.confidence > 0.5);
+}
+
+void testLoopbackCalibrationMeasuresRoundTrip() {
+    // Simulated route: output reappears at the input 1'234 frames later,
+    // attenuated, over a noise floor, in 192-frame duplex callbacks.
+    constexpr int32_t kRate = 48'000;
+    constexpr int32_t kBurst = 192;
+    constexpr int64_t kRoundTrip = 1'234;
+    tapstory::DuplexCore core;
+    core.seek(5'000);
+    assert(core.beginCalibration(kRate));
+    assert(!core.beginCalibration(kRate));
+
+    std::vector<float> played;
+    std::vector<float> output(kBurst * tapstory::DuplexCore::kOutputChannelCount);
+    std::vector<float> input(kBurst);
+    uint32_t noise = 1;
+    for (int callbacks = 0; !core.isCalibrationComplete(); ++callbacks) {
+        assert(callbacks < kRate / kBurst);
+        for (int32_t index = 0; index < kBurst; ++index) {
+            const int64_t source = static_cast<int64_t>(played.size()) + index - kRoundTrip;
+            noise = noise * 1'103'515'245U + 12'345U;
+            const float hiss = (static_cast<float>(noise >> 16) / 65'536.0f - 0.5f) * 0.02f;
+            input[index] = (source >= 0 && source < static_cast<int64_t>(played.size())
+                                    ? 0.3f * played[static_cast<size_t>(source)]
+                                    : 0.0f)
+                    + hiss;
+        }
+        core.process(input.data(), kBurst, output.data(), kBurst);
+        for (int32_t index = 0; index < kBurst; ++index) {
+            played.push_back(output[index * tapstory::DuplexCore::kOutputChannelCount]);
+        }
+    }
+    // Under a second of audio, and the transport position is untouched.
+    assert(played.size() < static_cast<size_t>(kRate));
+    assert(core.currentFrame() == 5'000);
+
+    const auto result = core.finishCalibration();
+    assert(result.ok);
+    assert(result.compensationFrames == kRoundTrip);
+    assert(std::abs(result.fractionalFrames - kRoundTrip) < 0.5);
+    assert(result.confidence > 0.9);
+    assert(result.shortInputFrames == 0);
+    assert(!core.isCalibrating());
+    assert(!core.finishCalibration().ok);
+}
+
+void testStreamReadinessWaitsForStableBursts() {
+    constexpr int32_t kBurst = 192;
+    constexpr int64_t kBurstNanos = 4'000'000;
+    tapstory::StreamReadiness readiness;
+    int64_t callback = 0;
+    auto observe = [&](int32_t frames, int32_t xruns, bool timestamps) {
+        tapstory::StreamReadiness::Observation observation;
+        observation.frames = frames;
+        if (timestamps) {
+            observation.output = {callback * kBurst, 1'000 + callback * kBurstNanos};
+            observation.input = {callback * kBurst - 96, 2'000 + callback * kBurstNanos};
+        }
+        observation.xrunCount = xruns;
+        observation.nowNanos = (callback + 1) * kBurstNanos;
+        readiness.observe(observation);
+        ++callback;
+    };
+
+    readiness.arm(kBurst, 48'000, 0, 4);
+    // Timestamps are not valid yet, then an empty callback and an xrun break runs.
+    observe(kBurst, 0, false);
+    observe(kBurst, 0, true);
+    observe(kBurst, 0, true);
+    observe(0, 0, true);
+    observe(kBurst, 0, true);
+    observe(kBurst, 1, true);
+    for (int32_t stable = 0; stable < 3; ++stable) observe(kBurst, 1, true);
+    assert(!readiness.isReady());
+    observe(kBurst, 1, true);
+    assert(readiness.isReady());
+    assert(readiness.readyAfterNanos() == 10 * kBurstNanos);
+
+    // A clock stuck at one position never counts as progress.
+    readiness.arm(kBurst, 48'000, 0, 4);
+    for (int32_t index = 0; index < 8; ++index) {
+        tapstory::StreamReadiness::Observation observation;
+        observation.frames = kBurst;
+        observation.output = {1'000, 5'000};
+        observation.input = {1'000, 5'000};
+        readiness.observe(observation);
+    }
+    assert(!readiness.isReady());
+}
+
+void testStreamReadinessFallsBackWithoutTimestamps() {
+    constexpr int32_t kBurst = 192;
+    constexpr int64_t kBurstNanos = 4'000'000;
+    tapstory::StreamReadiness readiness;
+    int64_t now = 0;
+    auto observe = [&](int32_t frames, int32_t xruns, bool unimplemented) {
+        tapstory::StreamReadiness::Observation observation;
+        observation.frames = frames;
+        observation.output.unimplemented = unimplemented;
+        observation.input.unimplemented = unimplemented;
+        observation.xrunCount = xruns;
+        now += kBurstNanos;
+        observation.nowNanos = now;
+        readiness.observe(observation);
+    };
+
+    // Without a presentation clock, callbacks that vary in size still count;
+    // only one beyond the burst multiple or a new xrun breaks the run.
+    readiness.arm(kBurst, 48'000, 0, 4);
+    observe(kBurst, 0, true);
+    observe(kBurst * (tapstory::StreamReadiness::kMaxBurstMultiple + 1), 0, true);
+    observe(kBurst / 2, 0, true);
+    observe(kBurst * 3, 1, true);
+    observe(96, 1, true);
+    observe(kBurst * 2, 1, true);
+    observe(kBurst * 4, 1, true);
+    assert(!readiness.isReady());
+    observe(kBurst, 1, true);
+    assert(readiness.isReady());
+    assert(readiness.readyAfterNanos() == 8 * kBurstNanos);
+
+    // Implemented timestamps that never become valid cap the wait at the ceiling.
+    readiness.arm(kBurst, 48'000, 0, 4);
+    now = 0;
+    while (now + kBurstNanos < tapstory::StreamReadiness::kUntimedCeilingNanos) {
+        observe(kBurst, 0, false);
+    }
+    assert(!readiness.isReady());
+    observe(kBurst, 0, false);
+    assert(readiness.isReady());
+    assert(readiness.readyAfterNanos() >= tapstory::StreamReadiness::kUntimedCeilingNanos);
+    assert(readiness.readyAfterNanos()
+            < tapstory::StreamReadiness::kUntimedCeilingNanos + kBurstNanos);
+
+    // Unbroken xruns without a clock still end at the ceiling.
+    readiness.arm(kBurst, 48'000, 0, 4);
+    now = 0;
+    for (int32_t xruns = 0; now < tapstory::StreamReadiness::kUntimedCeilingNanos; ++xruns) {
+        observe(kBurst, xruns, true);
+    }
+    assert(readiness.isReady());
+}
+
+void testOnsetEnvelopeStreamsLikeWholeSignal() {
+    std::vector<int16_t> pcm(10'000);
+    uint32_t seed = 7;
+    for (int16_t &sample : pcm) {
+        seed = seed * 1'664'525u + 1'013'904'223u;
+        sample = static_cast<int16_t>(seed >> 16);
+    }
+
+    // Reference: the backend's createOnsetEnvelope over the whole signal.
+    const int32_t blockFrames = tapstory::OnsetEnvelope::blockFramesForRate(44'100);
+    assert(blockFrames == 22);
+    std::vector<float> expected((pcm.size() + blockFrames - 1) / blockFrames, 0.0f);
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        const int16_t previous = i == 0 ? pcm[0] : pcm[i - 1];
+        expected[i / blockFrames] += static_cast<float>(std::abs(pcm[i] - previous));
+    }
+
+    tapstory::OnsetEnvelope streamed(blockFrames);
+    const size_t chunks[] = {1, 5, 22, 23, 500, 4'096};
+    size_t offset = 0;
+    for (size_t chunk = 0; offset < pcm.size(); ++chunk) {
+        const size_t count = std::min(chunks[chunk % 6], pcm.size() - offset);
+        streamed.append(pcm.data() + offset, count);
+        offset += count;
+    }
+    streamed.finish();
+    assert(streamed.values() == expected);
+
+    // Float tracks converted from the same PCM give the same envelope.
+    std::vector<float> samples(pcm.size());
+    tapstory::convertPcm16ToFloat(pcm.data(), samples.data(), samples.size());
+    tapstory::OnsetEnvelope fromFloat(blockFrames);
+    fromFloat.append(samples.data(), samples.size());
+    fromFloat.finish();
+    assert(fromFloat.values() == expected);
+
+    tapstory::TrackStore store;
+    store.load("take", pcm.data(), static_cast<int32_t>(pcm.size()), 1'000);
+    const std::vector<float> mix = tapstory::computeMixOnsetEnvelope(
+            store, 1'000, 1'000 + static_cast<int64_t>(pcm.size()), blockFrames);
+    assert(mix.size() == expected.size());
+    for (size_t i = 0; i < mix.size(); ++i) {
+        assert(std::fabs(mix[i] - expected[i]) <= 2.0f * blockFrames);
+    }
+}
+
+void testPeakPyramidMatchesDirectMinMaxAtEveryLevel() {
+    std::vector<int16_t> pcm(10'000);
+    uint32_t seed = 11;
+    for (int16_t &sample : pcm) {
+        seed = seed * 1'664'525u + 1'013'904'223u;
+        sample = static_cast<int16_t>(seed >> 16);
+    }
+    auto expectLevels = [&pcm](const tapstory::PeakPyramid &peaks) {
+        for (size_t index = 0; index < tapstory::PeakPyramid::kLevelCount; ++index) {
+            const tapstory::PeakPyramid::Level level = peaks.level(index);
+            const size_t binFrames = static_cast<size_t>(level.framesPerBin);
+            assert(level.binCount == (pcm.size() + binFrames - 1) / binFrames);
+            for (size_t bin = 0; bin < level.binCount; ++bin) {
+                const auto first = pcm.begin() + static_cast<std::ptrdiff_t>(bin * binFrames);
+                const auto last = pcm.begin() + static_cast<std::ptrdiff_t>(
+                        std::min(pcm.size(), (bin + 1) * binFrames));
+                assert(level.minMax[bin * 2] == *std::min_element(first, last));
+                assert(level.minMax[bin * 2 + 1] == *std::max_element(first, last));
+            }
+        }
+    };
+
+    tapstory::PeakPyramid streamed(static_cast<int64_t>(pcm.size()));
+    const size_t chunks[] = {1, 100, 255, 257, 4'096, 1'000};
+    size_t offset = 0;
+    for (size_t chunk = 0; offset < pcm.size(); ++chunk) {
+        const size_t count = std::min(chunks[chunk % 6], pcm.size() - offset);
+        streamed.append(pcm.data() + offset, count);
+        offset += count;
+    }
+    // Completed bins are visible before the signal ends.
+    assert(streamed.level(0).binCount == pcm.size() / 256);
+    streamed.finish();
+    assert(streamed.frameCount() == static_cast<int64_t>(pcm.size()));
+    assert(!streamed.truncated());
+    expectLevels(streamed);
+
+    tapstory::TrackStore store;
+    store.load("segment", pcm.data(), static_cast<int32_t>(pcm.size()), 480);
+    assert(store.find("missing") == nullptr);
+    expectLevels(*store.find("segment")->peaks);
+
+    tapstory::PeakPyramid bounded(300);
+    bounded.append(pcm.data(), 500);
+    bounded.finish();
+    assert(bounded.truncated());
+    assert(bounded.frameCount() == 300);
+    assert(bounded.level(0).binCount == 2);
+    assert(bounded.level(2).binCount == 1);
+
+    const std::vector<uint8_t> file = tapstory::encodePeakFile(streamed, 48'000);
+    assert(std::string(file.begin(), file.begin() + 4) == "TSPK");
+    assert(file.size() == 20 + 3 * 8 + (40 + 10 + 3) * 4);
+    assert(tapstory::PeakPyramid::levelIndexFor(100) == 0);
+    assert(tapstory::PeakPyramid::levelIndexFor(1'024) == 1);
+    assert(tapstory::PeakPyramid::levelIndexFor(10'000) == 2);
+}
+
+void appendLittleEndian(std::vector<uint8_t> &bytes, uint32_t value, size_t width) {
+    for (size_t byte = 0; byte < width; ++byte) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+    }
+}
+
+void appendChunk(std::vector<uint8_t> &bytes, const char *id, const std::vector<uint8_t> &body) {
+    bytes.insert(bytes.end(), id, id + 4);
+    appendLittleEndian(bytes, static_cast<uint32_t>(body.size()), 4);
+    bytes.insert(bytes.end(), body.begin(), body.end());
+    if (body.size() % 2 != 0) bytes.push_back(0);
+}
+
+void testWavReaderWalksChunksAndDecodesEveryEncoding() {
+    // 16-bit mono through the writer: mapped, viewed in place and bit-exact.
+    const std::string path = "/tmp/tapstory-wav-reader-test.wav";
+    const std::vector<int16_t> pcm = {0, 1, -1, 32'767, -32'768, 1'234};
+    {
+        tapstory::WavWriter writer;
+        assert(writer.open(path, 44'100, 1));
+        assert(writer.write(pcm.data(), pcm.size()));
+        assert(writer.close());
+    }
+    tapstory::WavReader reader;
+    assert(reader.open(path));
+    assert(reader.format().encoding == tapstory::WavReader::Encoding::Pcm16);
+    assert(reader.format().sampleRate == 44'100);
+    assert(reader.frameCount() == static_cast<int64_t>(pcm.size()));
+    assert(std::equal(pcm.begin(), pcm.end(), reader.pcm16()));
+    std::vector<int16_t> mono(pcm.size());
+    assert(reader.readMonoPcm16(2, mono.data(), 100) == pcm.size() - 2);
+    assert(std::equal(pcm.begin() + 2, pcm.end(), mono.begin()));
+    reader.close();
+    std::remove(path.c_str());
+    assert(!reader.open(path));
+
+    // 24-bit stereo after an odd-sized chunk, so the walker must skip its pad byte.
+    std::vector<uint8_t> format;
+    appendLittleEndian(format, 1, 2);
+    appendLittleEndian(format, 2, 2);
+    appendLittleEndian(format, 48'000, 4);
+    appendLittleEndian(format, 48'000 * 6, 4);
+    appendLittleEndian(format, 6, 2);
+    appendLittleEndian(format, 24, 2);
+    std::vector<uint8_t> data;
+    for (const int32_t sample : {0x7fffff, 0x7fffff, -0x800000, 0x000100, 0x123456, -0x123456}) {
+        appendLittleEndian(data, static_cast<uint32_t>(sample), 3);
+    }
+    std::vector<uint8_t> file = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'};
+    appendChunk(file, "LIST", {'d', 'a', 't', 'a', 'x'});
+    appendChunk(file, "fmt ", format);
+    appendChunk(file, "data", data);
+    assert(reader.openMemory(file.data(), file.size()));
+    assert(reader.format().encoding == tapstory::WavReader::Encoding::Pcm24);
+    assert(reader.format().channelCount == 2);
+    assert(reader.frameCount() == 3);
+    assert(reader.pcm16() == nullptr);
+    int16_t mixed[3];
+    assert(reader.readMonoPcm16(0, mixed, 3) == 3);
+    assert(mixed[0] == 32'767);
+    assert(mixed[1] == (-0x800000 + 0x100) / 2 >> 8);
+    assert(mixed[2] == 0);
+    float floats[6];
+    assert(reader.readFloat(0, floats, 3) == 3);
+    assert(std::fabs(floats[2] + 1.0f) < 1e-6f);
+
+    // WAVE_FORMAT_EXTENSIBLE float, whose sub-format carries the real tag.
+    std::vector<uint8_t> extensible;
+    appendLittleEndian(extensible, 0xfffe, 2);
+    appendLittleEndian(extensible, 1, 2);
+    appendLittleEndian(extensible, 8'000, 4);
+    appendLittleEndian(extensible, 32'000, 4);
+    appendLittleEndian(extensible, 4, 2);
+    appendLittleEndian(extensible, 32, 2);
+    appendLittleEndian(extensible, 22, 2);
+    appendLittleEndian(extensible, 32, 2);
+    appendLittleEndian(extensible, 4, 4);
+    appendLittleEndian(extensible, 3, 2);
+    extensible.resize(40, 0);
+    std::vector<uint8_t> floatData;
+    for (const float sample : {0.5f, -2.0f}) {
+        uint32_t bits;
+        std::memcpy(&bits, &sample, sizeof(bits));
+        appendLittleEndian(floatData, bits, 4);
+    }
+    file = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'};
+    appendChunk(file, "fmt ", extensible);
+    appendChunk(file, "data", floatData);
+    assert(reader.openMemory(file.data(), file.size()));
+    assert(reader.format().encoding == tapstory::WavReader::Encoding::Float32);
+    assert(reader.readMonoPcm16(0, mixed, 2) == 2);
+    assert(mixed[0] == tapstory::floatToPcm16(0.5f));
+    assert(mixed[1] == -32'767);
+
+    file.resize(12);
+    assert(!reader.openMemory(file.data(), file.size()));
+    assert(std::string(reader.error()) == "WAV fmt chunk not found");
+}
+
+std::vector<int16_t> makeSinePcm(int32_t sampleRate, double seconds, double frequency,
+        double amplitude, double phase) {
+    std::vector<int16_t> pcm(static_cast<size_t>(sampleRate * seconds));
+    for (size_t frame = 0; frame < pcm.size(); ++frame) {
+        const double angle = 2.0 * 3.14159265358979323846 * frequency * frame / sampleRate + phase;
+        pcm[frame] = static_cast<int16_t>(std::lround(32'767.0 * amplitude * std::sin(angle)));
+    }
+    return pcm;
+}
+
+void testLosslessDecoderMatchesWavAndFlac() {
+    // Noise defeats the predictors in places, so frames mix every subframe
+    // type the encoder picks, and stereo exercises each decorrelation mode.
+    const std::vector<int16_t> left = makeSinePcm(44'100, 1.0, 440.0, 0.6, 0.0);
+    std::vector<int16_t> stereo(left.size() * 2);
+    uint32_t seed = 12'345;
+    for (size_t frame = 0; frame < left.size(); ++frame) {
+        seed = seed * 1'664'525u + 1'013'904'223u;
+        stereo[2 * frame] = left[frame];
+        stereo[2 * frame + 1] = frame < 10'000 ? 0 : static_cast<int16_t>(seed >> 16);
+    }
+    std::vector<int16_t> expected(left.size());
+    for (size_t frame = 0; frame < left.size(); ++frame) {
+        expected[frame] = static_cast<int16_t>((stereo[2 * frame] + stereo[2 * frame + 1]) >> 1);
+    }
+
+    const std::string wavPath = "/tmp/tapstory-lossless-test.wav";
+    const std::string flacPath = "/tmp/tapstory-lossless-test.flac";
+    tapstory::WavWriter wav;
+    assert(wav.open(wavPath, 44'100, 2) && wav.write(stereo.data(), left.size()) && wav.close());
+    tapstory::FlacWriter flac;
+    assert(flac.open(flacPath, 44'100, 2) && flac.write(stereo.data(), left.size()) && flac.close());
+
+    tapstory::FlacReader reader;
+    assert(reader.open(flacPath));
+    assert(reader.format().sampleRate == 44'100 && reader.format().channelCount == 2);
+    assert(reader.format().bitsPerSample == 16 && reader.frameCount() == 44'100);
+    std::vector<int16_t> partial(5'000);
+    assert(reader.readMonoPcm16(partial.data(), partial.size()) == partial.size());
+    assert(std::equal(partial.begin(), partial.end(), expected.begin()));
+
+    // Decoding keeps both channels and the rate as they were written.
+    std::vector<int16_t> decoded;
+    int32_t channels = 0;
+    int32_t rate = 0;
+    for (const std::string &path : {wavPath, flacPath}) {
+        assert(tapstory::decodeLosslessFileAtFileRate(path, decoded, channels, rate));
+        assert(channels == 2 && rate == 44'100 && decoded == stereo);
+    }
+
+    // A 16-bit mono FLAC decodes bit-exact.
+    tapstory::FlacWriter monoFlac;
+    assert(monoFlac.open(flacPath, 44'100, 1) && monoFlac.write(left.data(), left.size())
+            && monoFlac.close());
+    assert(tapstory::decodeLosslessFileAtFileRate(flacPath, decoded, channels, rate));
+    assert(channels == 1 && rate == 44'100 && decoded == left);
+
+    // Anything else is left to the platform decoders.
+    std::ofstream(flacPath, std::ios::binary | std::ios::trunc) << "ID3\x04 not lossless";
+    assert(!tapstory::decodeLosslessFileAtFileRate(flacPath, decoded, channels, rate));
+    assert(decoded.empty() && channels == 0 && rate == 0);
+    assert(!reader.open(flacPath) && std::strlen(reader.error()) > 0);
+    assert(!tapstory::decodeLosslessFileAtFileRate(
+            "/tmp/tapstory-missing.flac", decoded, channels, rate));
+
+    // The interleaved kernel keeps the reader's rounding for odd channel counts.
+    const int16_t three[] = {-3, 0, 1, 7, 7, 8};
+    int16_t downmixed[2];
+    tapstory::downmixPcm16ToMono(three, 3, downmixed, 2);
+    assert(downmixed[0] == -1 && downmixed[1] == 7);
+    std::remove(wavPath.c_str());
+    std::remove(flacPath.c_str());
+}
+
+void testLoudnessMatchesReferenceSineLevels() {
+    // BS.1770 calibration: a full-scale 997 Hz sine reads -3.01 LUFS, at any rate.
+    for (const int32_t rate : {44'100, 48'000}) {
+        const std::vector<int16_t> half = makeSinePcm(rate, 5.0, 997.0, 0.5, 0.0);
+        const tapstory::LoudnessInfo info = tapstory::measureLoudness(half.data(), half.size(), rate);
+        assert(info.measured);
+        assert(std::fabs(info.integratedLufs - (-3.01 - 6.02)) < 0.05);
+        assert(std::fabs(info.truePeakDbtp - (-6.02)) < 0.05);
+    }
+
+    // A quarter-rate sine sampled 45 degrees off its crests: the samples sit
+    // 3 dB below the waveform peak, which only oversampling recovers.
+    const std::vector<int16_t> offPeak = makeSinePcm(48'000, 1.0, 12'000.0, 0.5, 0.785398);
+    const tapstory::LoudnessInfo offPeakInfo =
+            tapstory::measureLoudness(offPeak.data(), offPeak.size(), 48'000);
+    assert(std::fabs(offPeakInfo.truePeakDbtp - (-6.02)) < 0.3);
+
+    // A quiet passage more than 10 LU down is gated out of the integrated level.
+    std::vector<int16_t> gated = makeSinePcm(48'000, 4.0, 997.0, 0.5, 0.0);
+    const std::vector<int16_t> quiet = makeSinePcm(48'000, 4.0, 997.0, 0.05, 0.0);
+    gated.insert(gated.end(), quiet.begin(), quiet.end());
+    const tapstory::LoudnessInfo gatedInfo =
+            tapstory::measureLoudness(gated.data(), gated.size(), 48'000);
+    assert(std::fabs(gatedInfo.integratedLufs - (-9.03)) < 0.2);
+
+    const std::vector<int16_t> silence(48'000, 0);
+    const tapstory::LoudnessInfo silent =
+            tapstory::measureLoudness(silence.data(), silence.size(), 48'000);
+    assert(!silent.measured && tapstory::loudnessNormalizationGain(silent) == 1.0f);
+    const std::vector<int16_t> blip = makeSinePcm(48'000, 0.2, 997.0, 0.5, 0.0);
+    assert(!tapstory::measureLoudness(blip.data(), blip.size(), 48'000).measured);
+}
+
+void testTrackStoreNormalizesLoudnessAtLoad() {
+    // -9 LUFS peaking at -6 dBTP: 9 dB down to the target.
+    const std::vector<int16_t> loud = makeSinePcm(48'000, 3.0, 997.0, 0.5, 0.0);
+    // -33 LUFS: the boost stops at the limit well before the target.
+    const std::vector<int16_t> quiet = makeSinePcm(48'000, 3.0, 997.0, 0.03, 0.0);
+    // -4 LUFS peaking at -1 dBTP already: only the loudness cut applies.
+    const std::vector<int16_t> hot = makeSinePcm(48'000, 1.0, 997.0, 0.89, 0.0);
+
+    tapstory::TrackStore plain;
+    plain.load("loud", loud.data(), static_cast<int32_t>(loud.size()), 0);
+    assert(!plain.tracks()[0].loudness.measured && plain.tracks()[0].gain == 1.0f);
+
+    tapstory::TrackStore store;
+    store.setSampleRate(48'000);
+    store.load("loud", loud.data(), static_cast<int32_t>(loud.size()), 0);
+    store.load("quiet", quiet.data(), static_cast<int32_t>(quiet.size()), 200'000);
+    store.load("hot", hot.data(), static_cast<int32_t>(hot.size()), 400'000);
+    const auto gainDb = [](const tapstory::Track &track) {
+        return 20.0 * std::log10(static_cast<double>(track.gain));
+    };
+    assert(std::fabs(gainDb(*store.find("loud")) - (-18.0 + 9.03)) < 0.1);
+    assert(std::fabs(gainDb(*store.find("quiet")) - tapstory::kMaxLoudnessGainDb) < 1e-4);
+    assert(std::fabs(gainDb(*store.find("hot")) - (-18.0 + 4.04)) < 0.1);
+    // The gain is part of what a render depends on.
+    assert(store.find("loud")->fingerprint != plain.find("loud")->fingerprint);
+
+    float output[2];
+    tapstory::mixTracks(store, 12, output, 1);
+    const float expected = tapstory::pcm16ToFloat(loud[12]) * store.find("loud")->gain;
+    assert(std::fabs(output[0] - expected) < 1e-6f && output[1] == output[0]);
+}
+
+void testTrackStoreMovesLoadedTracksToNewTimelineRate() {
+    const std::vector<int16_t> tone = makeSinePcm(48'000, 2.5, 997.0, 0.5, 0.0);
+    const std::vector<int16_t> blip(4'800, 8'000);
+    tapstory::TrackStore store;
+    store.setSampleRate(48'000);
+    store.load("tone", tone.data(), static_cast<int32_t>(tone.size()), 0);
+    store.load("blip", blip.data(), 4'800, 96'000);
+    const tapstory::Track before = *store.find("tone");
+
+    store.setTimelineRate(44'100);
+    assert(store.sampleRate() == 44'100);
+    const tapstory::Track &tone44 = *store.find("tone");
+    const tapstory::Track &blip44 = *store.find("blip");
+    // The PCM stays at its own rate and is converted as it plays.
+    assert(tone44.lengthFrames == 120'000 && tone44.samples == before.samples);
+    assert(tone44.sampleRate == 48'000 && tone44.timelineFrames == 110'250);
+    assert(tone44.resampler && tone44.resampler == blip44.resampler);
+    assert(blip44.startFrame == 88'200 && blip44.timelineFrames == 4'410);
+    assert(store.endFrame() == 110'250);
+    assert(store.firstTrackEndingAfter(110'249) == 0);
+    // Level and gain carry over; the rendered content is new.
+    assert(tone44.gain == before.gain && tone44.loudness.measured);
+    assert(tone44.fingerprint != before.fingerprint);
+    assert(!tone44.peaks && store.peaks("tone")->frameCount() == 110'250);
+    // Peaks come from the PCM at its own rate, so the extremes are the source's
+    // up to the float round trip.
+    const tapstory::PeakPyramid::Level toneBins = tone44.peaks->level(0);
+    assert(toneBins.binCount == (110'250 + 255) / 256);
+    const int16_t toneMax = *std::max_element(tone.begin(), tone.end());
+    assert(std::abs(*std::max_element(toneBins.minMax, toneBins.minMax + toneBins.binCount * 2)
+            - toneMax) <= 1);
+    const tapstory::PeakPyramid::Level blipBins = store.peaks("blip")->level(0);
+    assert(blipBins.binCount == (4'410 + 255) / 256);
+    for (size_t value = 0; value < blipBins.binCount * 2; ++value) {
+        assert(blipBins.minMax[value] == tapstory::floatToPcm16(tapstory::pcm16ToFloat(8'000)));
+    }
+    assert(blip44.samples[100] == tapstory::pcm16ToFloat(8'000));
+
+    // Going back to the PCM's own rate drops the converter.
+    store.setTimelineRate(48'000);
+    assert(!store.find("tone")->resampler && store.find("tone")->timelineFrames == 120'000);
+    assert(store.find("tone")->fingerprint == before.fingerprint);
+    store.setTimelineRate(44'100);
+
+    // Same rate is a no-op, and an unknown rate only labels the store.
+    const uint64_t fingerprint = store.find("tone")->fingerprint;
+    store.setTimelineRate(44'100);
+    assert(store.find("tone")->fingerprint == fingerprint);
+    tapstory::TrackStore unrated;
+    unrated.load("blip", blip.data(), 4'800, 10);
+    unrated.setTimelineRate(44'100);
+    assert(unrated.sampleRate() == 44'100 && unrated.tracks()[0].lengthFrames == 4'800);
+
+    assert(tapstory::rescaleFrame(48'000, 48'000, 44'100) == 44'100);
+    assert(tapstory::rescaleFrame(1, 48'000, 44'100) == 1);
+    assert(tapstory::rescaleFrame(-48'000, 48'000, 44'100) == -44'100);
+}
+
+void testPolyphaseResamplerStreamsAcrossBursts() {
+    const tapstory::PolyphaseResampler up(44'100, 48'000);
+    assert(up.outputFrameCount(44'100) == 48'000 && up.outputFrameCount(0) == 0);
+
+    // A 44.1 kHz tone on a 48 kHz timeline plays as the same tone.
+    const std::vector<int16_t> tone = makeSinePcm(44'100, 1.0, 1'000.0, 0.5, 0.0);
+    tapstory::TrackStore store;
+    store.setSampleRate(48'000);
+    store.load("tone", tone.data(), static_cast<int32_t>(tone.size()), 0, 1, 44'100);
+    assert(store.find("tone")->timelineFrames == 48'000 && store.endFrame() == 48'000);
+    const double amplitude = 0.5 * store.find("tone")->gain;
+    std::vector<float> whole(2 * 4'096);
+    tapstory::mixTracks(store, 20'000, whole.data(), 4'096);
+    for (int32_t frame = 0; frame < 4'096; ++frame) {
+        const double angle = 2.0 * 3.14159265358979323846 * 1'000.0 * (20'000 + frame) / 48'000;
+        assert(std::fabs(whole[2 * frame] - amplitude * std::sin(angle)) < 1e-3);
+    }
+
+    // Bursts of any size, and a seek into the middle, render the same samples.
+    std::vector<float> split(2 * 4'096);
+    for (int32_t offset = 0; offset < 4'096; offset += 37) {
+        const int32_t frames = std::min(37, 4'096 - offset);
+        tapstory::mixTracks(store, 20'000 + offset, split.data() + 2 * offset, frames);
+    }
+    assert(split == whole);
+
+    // Turns at other rates still pre-mix into stems that match the mix.
+    const std::vector<int16_t> turn = makeSinePcm(22'050, 0.5, 300.0, 0.4, 0.0);
+    store.load("turn", turn.data(), static_cast<int32_t>(turn.size()), 40'000, 1, 22'050);
+    tapstory::ChainStems stems;
+    stems.update(store);
+    std::vector<float> fromStems(2 * 4'096);
+    for (const int64_t frame : {-100, 20'000, 39'000, 60'000}) {
+        tapstory::mixTracks(store, frame, whole.data(), 4'096);
+        tapstory::mixStems(stems, frame, fromStems.data(), 4'096);
+        assert(whole == fromStems);
+    }
+}
+
+void testChainContainerMapsSegmentsInPlace() {
+    const std::string path = "/tmp/tapstory-chain-container-test.tschain";
+    std::remove(path.c_str());
+    const std::vector<int16_t> tone = makeSinePcm(48'000, 2.5, 997.0, 0.5, 0.0);
+    const std::vector<int16_t> blip(4'800, 8'000);
+    tapstory::TrackStore decoded;
+    decoded.setSampleRate(48'000);
+    decoded.load("tone", tone.data(), static_cast<int32_t>(tone.size()), 0);
+    decoded.load("blip", blip.data(), 4'800, 96'000);
+    assert(tapstory::ChainContainer::append(path, *decoded.find("tone"), 48'000));
+    assert(tapstory::ChainContainer::append(path, *decoded.find("blip"), 48'000));
+
+    auto chain = std::make_shared<tapstory::ChainContainer>();
+    assert(chain->open(path) && chain->segments().size() == 2);
+    tapstory::TrackStore mapped;
+    mapped.setSampleRate(48'000);
+    assert(mapped.loadChain(chain) == 2);
+    const tapstory::Track &tone48 = *mapped.find("tone");
+    const tapstory::Track &original = *decoded.find("tone");
+    assert(tone48.samples.empty() && tone48.pcm() == chain->segments()[0].samples);
+    // Blocks start on page boundaries of the mapping.
+    assert(reinterpret_cast<uintptr_t>(tone48.pcm()) % 4'096 == 0);
+    assert(tone48.fingerprint == original.fingerprint && tone48.gain == original.gain);
+    assert(tone48.loudness.measured
+            && tone48.loudness.integratedLufs == original.loudness.integratedLufs);
+    assert(mapped.endFrame() == decoded.endFrame() && !tone48.peaks);
+    assert(mapped.peaks("tone")->frameCount() == tone48.lengthFrames && tone48.peaks);
+    assert(mapped.peaks("missing") == nullptr);
+
+    std::vector<float> fromDecoded(2 * 512);
+    std::vector<float> fromMapped(2 * 512);
+    tapstory::mixTracks(decoded, 95'800, fromDecoded.data(), 512);
+    tapstory::mixTracks(mapped, 95'800, fromMapped.data(), 512);
+    assert(fromDecoded == fromMapped);
+
+    // A new turn appends without disturbing the mapping already in use.
+    const float *toneView = tone48.pcm();
+    const float toneSample = toneView[1'000];
+    const std::vector<int16_t> turn(2'400, -4'000);
+    decoded.load("turn", turn.data(), 2'400, 120'000);
+    assert(tapstory::ChainContainer::append(path, *decoded.find("turn"), 48'000));
+    assert(toneView[1'000] == toneSample);
+    auto extended = std::make_shared<tapstory::ChainContainer>();
+    assert(extended->open(path) && extended->segments().size() == 3);
+    assert(mapped.loadMapped(extended, 2) && mapped.endFrame() == 122'400);
+    assert(mapped.find("turn")->pcm()[7] == tapstory::pcm16ToFloat(-4'000));
+
+    // Another route rate still maps the block and converts it as it plays.
+    tapstory::TrackStore resampled;
+    resampled.setSampleRate(44'100);
+    assert(resampled.loadMapped(extended, 1));
+    const tapstory::Track &blip44 = resampled.tracks()[0];
+    assert(blip44.chain && blip44.pcm() == extended->segments()[1].samples);
+    assert(blip44.startFrame == 88'200 && blip44.timelineFrames == 4'410);
+    assert(blip44.resampler && blip44.fingerprint != decoded.find("blip")->fingerprint);
+
+    // Filling the index moves the chain into a file with a larger one.
+    tapstory::Track copy = *decoded.find("blip");
+    for (uint32_t index = 3; index <= tapstory::ChainContainer::kDefaultIndexCapacity; ++index) {
+        copy.id = "blip-" + std::to_string(index);
+        assert(tapstory::ChainContainer::append(path, copy, 48'000));
+    }
+    tapstory::ChainContainer grown;
+    assert(grown.open(path));
+    assert(grown.segments().size() == tapstory::ChainContainer::kDefaultIndexCapacity + 1);
+    assert(grown.find("turn")->samples[7] == tapstory::pcm16ToFloat(-4'000));
+    assert(grown.segments().back().startFrame == 96'000);
+    assert(toneView[1'000] == toneSample);
+
+    // Storing a segment again writes nothing; a changed one supersedes the
+    // stored entry, and superseded blocks are compacted once they outweigh
+    // the live ones.
+    const std::string compactPath = "/tmp/tapstory-chain-compact.tschain";
+    std::remove(compactPath.c_str());
+    tapstory::Track moved = *decoded.find("turn");
+    assert(tapstory::ChainContainer::append(compactPath, *decoded.find("blip"), 48'000));
+    assert(tapstory::ChainContainer::append(compactPath, moved, 48'000));
+    assert(tapstory::ChainContainer::append(compactPath, moved, 48'000));
+    tapstory::ChainContainer compacted;
+    assert(compacted.open(compactPath) && compacted.segments().size() == 2);
+    // Blip is 4'800 frames and each turn 2'400, so the fourth move compacts.
+    const std::array<size_t, 4> expectedCounts{{3, 4, 5, 2}};
+    for (size_t move = 0; move < expectedCounts.size(); ++move) {
+        moved.startFrame += 1'000;
+        moved.sourceFingerprint += 1;
+        assert(tapstory::ChainContainer::append(compactPath, moved, 48'000));
+        assert(compacted.open(compactPath));
+        assert(compacted.segments().size() == expectedCounts[move]);
+        assert(compacted.find("turn")->startFrame == moved.startFrame);
+    }
+    assert(compacted.find("blip")->samples[0] == tapstory::pcm16ToFloat(8'000));
+    assert(compacted.find("turn")->samples[7] == tapstory::pcm16ToFloat(-4'000));
+    compacted.close();
+    std::remove(compactPath.c_str());
+
+    tapstory::Track unnamed = *decoded.find("blip");
+    unnamed.id = std::string(tapstory::ChainContainer::kMaxIdBytes + 1, 'x');
+    assert(!tapstory::ChainContainer::append(path, unnamed, 48'000));
+    assert(!grown.open("/tmp/tapstory-missing.tschain") && std::strlen(grown.error()) > 0);
+    std::remove(path.c_str());
+}
+
+void testChainStemsMatchTrackMix() {
+    // Alternating turns that overlap their neighbours, as a duet chain does.
+    tapstory::TrackStore store;
+    for (int index = 0; index < 6; ++index) {
+        const std::vector<int16_t> turn = makeSinePcm(48'000, 0.5, 200.0 + 50 * index, 0.4, 0.0);
+        store.load(
+                "turn-" + std::to_string(index),
+                turn.data(),
+                static_cast<int32_t>(turn.size()),
+                index * 20'000);
+    }
+    tapstory::ChainStems stems;
+    tapstory::ChainStems::UpdateResult update = stems.update(store);
+    assert(update.renderedTracks == 6 && !update.rebuilt);
+    assert(stems.lanes()[0].startFrame == 0 && stems.lanes()[1].startFrame == 20'000);
+    assert(stems.lanes()[1].endFrame() == 124'000);
+
+    std::vector<float> fromTracks(2 * 1'000);
+    std::vector<float> fromStems(2 * 1'000);
+    for (const int64_t frame : {-500, 19'600, 60'000, 123'500}) {
+        tapstory::mixTracks(store, frame, fromTracks.data(), 1'000);
+        tapstory::mixStems(stems, frame, fromStems.data(), 1'000);
+        assert(fromTracks == fromStems);
+    }
+
+    // A new turn only extends its own lane.
+    const std::vector<float> otherLane = stems.lanes()[1].samples;
+    const std::vector<float> ownLane = stems.lanes()[0].samples;
+    const std::vector<int16_t> next(24'000, 3'000);
+    store.load("turn-6", next.data(), 24'000, 120'000);
+    update = stems.update(store);
+    assert(update.renderedTracks == 1 && !update.rebuilt);
+    assert(stems.lanes()[1].samples == otherLane);
+    assert(std::equal(ownLane.begin(), ownLane.end(), stems.lanes()[0].samples.begin()));
+    assert(stems.lanes()[0].endFrame() == 144'000);
+    tapstory::mixTracks(store, 119'000, fromTracks.data(), 1'000);
+    tapstory::mixStems(stems, 119'000, fromStems.data(), 1'000);
+    assert(fromTracks == fromStems);
+
+    // A turn inserted mid-chain rebuilds both lanes.
+    store.load("retake", next.data(), 24'000, 20'000);
+    update = stems.update(store);
+    assert(update.rebuilt && update.renderedTracks == 8);
+    tapstory::mixTracks(store, 30'000, fromTracks.data(), 1'000);
+    tapstory::mixStems(stems, 30'000, fromStems.data(), 1'000);
+    assert(fromTracks == fromStems);
+
+    // The core plays the stems instead of the tracks once the mode is on.
+    tapstory::DuplexCore core;
+    core.trackStore().load("solo", next.data(), 24'000, 0);
+    core.setStemMixing(true);
+    assert(core.isStemMixing());
+    core.trackStore().clear();
+    std::vector<float> output(2 * 64);
+    core.process(nullptr, 0, output.data(), 64);
+    assert(output[0] == tapstory::pcm16ToFloat(3'000));
+    assert(core.refreshStems().rebuilt);
+    core.process(nullptr, 0, output.data(), 64);
+    assert(output[0] == 0.0f);
+    core.setStemMixing(false);
+    assert(core.refreshStems().renderedTracks == 0);
+}
+
+void testMultichannelTracksAndCaptureKeepChannels() {
+    // A stereo track plays each channel on its own side, next to a mono one.
+    const int16_t stereo[] = {8'192, -8'192, 16'384, 0, 0, 4'096};
+    const int16_t mono[] = {4'096, 4'096};
+    tapstory::TrackStore store;
+    assert(store.load("duo", stereo, 3, 0, 2) && store.load("solo", mono, 2, 1));
+    assert(!store.load("wide", stereo, 1, 0, tapstory::kMaxTrackChannelCount + 1));
+    assert(store.find("duo")->channelCount == 2 && store.find("duo")->lengthFrames == 3);
+    float output[8];
+    tapstory::mixTracks(store, 0, output, 4);
+    const float expected[] = {0.25f, -0.25f, 0.625f, 0.125f, 0.125f, 0.25f, 0.0f, 0.0f};
+    for (int i = 0; i < 8; ++i) assert(output[i] == expected[i]);
+    // Peaks describe the mono fold, and channels change the fingerprint.
+    assert(store.peaks("duo")->frameCount() == 3);
+    tapstory::TrackStore folded;
+    folded.load("duo", stereo, 6, 0);
+    assert(folded.tracks()[0].fingerprint != store.find("duo")->fingerprint);
+
+    // BS.1770 sums channel energies: two identical channels read 3 LU louder.
+    const std::vector<int16_t> sine = makeSinePcm(48'000, 3.0, 997.0, 0.25, 0.0);
+    std::vector<int16_t> doubled(sine.size() * 2);
+    for (size_t frame = 0; frame < sine.size(); ++frame) {
+        doubled[2 * frame] = sine[frame];
+        doubled[2 * frame + 1] = sine[frame];
+    }
+    const tapstory::LoudnessInfo single =
+            tapstory::measureLoudness(sine.data(), sine.size(), 48'000);
+    const tapstory::LoudnessInfo both =
+            tapstory::measureLoudness(doubled.data(), sine.size(), 48'000, 2);
+    assert(std::fabs(both.integratedLufs - single.integratedLufs - 3.01) < 0.01);
+    assert(both.truePeakDbtp == single.truePeakDbtp);
+
+    // Resampling and the chain container keep the channels apart.
+    std::vector<int16_t> split(4'800 * 2);
+    for (size_t frame = 0; frame < 4'800; ++frame) {
+        split[2 * frame] = 8'000;
+        split[2 * frame + 1] = -8'000;
+    }
+    tapstory::TrackStore rated;
+    rated.setSampleRate(48'000);
+    rated.load("split", split.data(), 4'800, 0, 2);
+    const std::string path = "/tmp/tapstory-multichannel-chain.tschain";
+    std::remove(path.c_str());
+    assert(tapstory::ChainContainer::append(path, rated.tracks()[0], 48'000));
+    auto chain = std::make_shared<tapstory::ChainContainer>();
+    assert(chain->open(path) && chain->segments()[0].channelCount == 2);
+    tapstory::TrackStore mapped;
+    mapped.setSampleRate(48'000);
+    assert(mapped.loadChain(chain) == 1 && mapped.tracks()[0].channelCount == 2);
+    assert(mapped.tracks()[0].fingerprint == rated.tracks()[0].fingerprint);
+    rated.setTimelineRate(44'100);
+    assert(rated.tracks()[0].timelineFrames == 4'410);
+    float converted[2] = {};
+    tapstory::mixTracks(rated, 2'000, converted, 1);
+    assert(std::fabs(converted[0] - tapstory::pcm16ToFloat(8'000)) < 1e-3f);
+    assert(std::fabs(converted[1] - tapstory::pcm16ToFloat(-8'000)) < 1e-3f);
+    std::remove(path.c_str());
+
+    // Stems turn stereo with the first stereo track and still match the mix.
+    tapstory::ChainStems stems;
+    assert(stems.update(store).rebuilt && stems.lanes()[0].channelCount == 2);
+    float fromStems[8];
+    tapstory::mixStems(stems, 0, fromStems, 4);
+    assert(std::equal(fromStems, fromStems + 8, output));
+
+    // The ring moves whole interleaved frames.
+    tapstory::SpscPcmRing ring(4, 2);
+    assert(ring.capacity() == 4 && ring.write(stereo, 3) == 3 && ring.availableToWrite() == 1);
+    int16_t frames[6] = {};
+    assert(ring.write(stereo, 3) == 1 && ring.read(frames, 2) == 2);
+    assert(std::equal(frames, frames + 4, stereo));
+
+    // A stereo take keeps both input channels, interleaved.
+    const std::string takePath = "/tmp/tapstory-stereo-take.pcm";
+    tapstory::DuplexCore core;
+    core.prepareCapture(1'024, 48'000, 2);
+    assert(core.inputChannelCount() == 2);
+    assert(core.armCapture(takePath, 0, 0));
+    std::vector<float> input(2 * 16);
+    for (size_t frame = 0; frame < 16; ++frame) {
+        input[2 * frame] = 0.5f;
+        input[2 * frame + 1] = -0.25f;
+    }
+    std::vector<float> playback(2 * 16);
+    core.process(input.data(), 16, playback.data(), 16);
+    core.onTransportStopped();
+    assert(core.finishCapture(false));
+    const std::vector<int16_t> take = readRawPcm(takePath);
+    assert(core.recordedFrameCount() == 16 && take.size() == 2 * 16);
+    assert(take[0] == tapstory::floatToPcm16(0.5f) && take[1] == tapstory::floatToPcm16(-0.25f));
+    std::remove(takePath.c_str());
+}
+
+void testPunchTakesSplitOneAlignedTake() {
+    const tapstory::PunchRange ordered[] = {{100, 200}, {200, 260}, {400, 900}};
+    assert(tapstory::arePunchRangesOrdered(ordered, 3));
+    const tapstory::PunchRange overlapping[] = {{100, 200}, {150, 260}};
+    assert(!tapstory::arePunchRangesOrdered(overlapping, 2));
+    const tapstory::PunchRange empty[] = {{100, 100}};
+    assert(!tapstory::arePunchRangesOrdered(empty, 1));
+
+    // The take covers timeline frames 100..599; the last range is clipped.
+    const tapstory::PunchTakeSpan span = tapstory::punchTakeSpan(ordered[2], 100, 500);
+    assert(span.offsetFrames == 300 && span.frameCount == 200 && span.firstTimelineFrame == 400);
+    assert(tapstory::punchTakeSpan({700, 800}, 100, 500).frameCount == 0);
+
+    const std::string takePath = "/tmp/tapstory-punch-take.wav";
+    const std::string prefix = "/tmp/tapstory-punch-take-";
+    std::vector<int16_t> take(500);
+    for (size_t i = 0; i < take.size(); ++i) take[i] = static_cast<int16_t>(100 + i);
+    tapstory::WavWriter writer;
+    assert(writer.open(takePath, 44'100, 1));
+    assert(writer.write(take.data(), take.size()));
+    assert(writer.close());
+
+    std::vector<tapstory::PunchTake> takes;
+    const std::vector<tapstory::PunchRange> ranges(std::begin(ordered), std::end(ordered));
+    assert(tapstory::writePunchTakes(takePath, 100, ranges, prefix, takes));
+    assert(takes.size() == 3);
+    assert(takes[2].path == prefix + "2.wav" && takes[2].rangeIndex == 2);
+    for (const tapstory::PunchTake &punchTake : takes) {
+        tapstory::WavReader reader;
+        assert(reader.open(punchTake.path));
+        assert(reader.format().sampleRate == 44'100);
+        assert(reader.frameCount() == punchTake.frameCount);
+        // Every sample holds its own timeline frame.
+        const int16_t *pcm = reader.pcm16();
+        for (int64_t frame = 0; frame < punchTake.frameCount; ++frame) {
+            assert(pcm[frame] == punchTake.startFrame + frame);
+        }
+        reader.close();
+        std::remove(punchTake.path.c_str());
+    }
+    assert(takes[1].startFrame == 200 && takes[1].frameCount == 60);
+    assert(takes[2].startFrame == 400 && takes[2].frameCount == 200);
+
+    assert(!tapstory::writePunchTakes(takePath, 100, {{200, 150}}, prefix, takes));
+    assert(takes.empty());
+    std::remove(takePath.c_str());
+}
+
+}  // namespace
+
+int main() {
+    testPunchBeforeBufferCapturesWholeInput();
+    testPunchInsideBufferCapturesExactBoundary();
+    testCompensatedPunchGatesLaterButExactly();
+    testPunchAfterAvailableInputCapturesNothing();
+    testStartedCaptureIgnoresPunch();
+    testCaptureOnsetMustMatchCompensatedPunch();
+    testClockDriftAllowsOneBurstAndBoundedLongTakeRate();
+    testTailDrainUsesExactPartialFinalCallback();
+    testTailDrainWaitsForShortInputInsteadOfClippingIt();
+    testTailDrainRequiresCaptureToHaveStarted();
+    testXRunDeltaIgnoresUnsupportedCounters();
+    testXRunDeltaCountsNewDiscontinuities();
+    testRingWrapAndCapacity();
+    testRingGeneratedWrite();
+    testRingSingleProducerSingleConsumer();
+    testMonoTrackMixesOnlyItsOverlap();
+    testMixClampAndCaptureConversionSaturate();
+    testLinearResamplerMatchesLoadPathLength();
+    testWavWriterPatchesSizesOnClose();
+    testTrackStoreKeepsTimelineOrder();
+    testTrackStoreFindsFirstSoundingTrackBySearch();
+    testMixerSumsOverlappingTracksAndClamps();
+    testDuplexCoreCapturesFromGateThroughCompensatedTail();
+    testDuplexCoreSeekCrossfadesAtCallbackBoundary();
+    testDuplexCoreLoopRegionWrapsInsideCallback();
+    testDuplexCorePracticeSpeedResamplesTimeline();
+    testDuplexCoreLoopedTakeEndsWhereInputReachesLoopEnd();
+    testDuplexCoreLoopedTakeWritesOneLanePerPass();
+    testDuplexCoreParkedTransportHoldsUntilResumed();
+    testDuplexCoreCancelsPendingPunchOnTransportStop();
+    testDuplexCoreCaptureStopEndsAtCallbackBoundary();
+    testDuplexCorePunchOutEndsTakeWhilePlaybackContinues();
+    testDuplexCoreScheduledStopEndsTakeAtExactFrame();
+    testOfflineMixdownMatchesRealtimeMixer();
+    testParallelFlacMixdownMatchesStreamingEncoder();
+    testMixdownCacheRerendersOnlyChangedBlocks();
+    testOffsetEstimatorFindsDelayedAndAdvancedCopies();
+    testOffsetEstimatorInterpolatesHalfSampleDelay();
+    testLoopbackCalibrationMeasuresRoundTrip();
+    testStreamReadinessWaitsForStableBursts();
+    testStreamReadinessFallsBackWithoutTimestamps();
+    testOnsetEnvelopeStreamsLikeWholeSignal();
+    testPeakPyramidMatchesDirectMinMaxAtEveryLevel();
+    testWavReaderWalksChunksAndDecodesEveryEncoding();
+    testLosslessDecoderMatchesWavAndFlac();
+    testLoudnessMatchesReferenceSineLevels();
+    testTrackStoreNormalizesLoudnessAtLoad();
+    testTrackStoreMovesLoadedTracksToNewTimelineRate();
+    testPolyphaseResamplerStreamsAcrossBursts();
+    testChainContainerMapsSegmentsInPlace();
+    testChainStemsMatchTrackMix();
+    testMultichannelTracksAndCaptureKeepChannels();
+    testPunchTakesSplitOneAlignedTake();
+    std::cout << "AudioCoreTests passed\n";
+    return 0;
+}
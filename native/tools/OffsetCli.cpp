@@ -0,0 +1,85 @@
+// tapstory-offset: estimate the delay between two related recordings.
+//
+// Inputs are WAV files (channels are averaged) or raw little-endian 16-bit
+// mono PCM, e.g. from
+//   ffmpeg -i take.m4a -ac 1 -ar 48000 -f s16le take.pcm
+// A WAV header's sample rate overrides --sample-rate.
+// The estimate is printed as one JSON object on stdout.
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "audio/OffsetEstimator.h"
+#include "tools/RawPcm.h"
+
+namespace {
+
+struct Options {
+    int32_t sampleRate = 48'000;
+    double maxOffsetMs = 1'000.0;
+    std::string referencePath;
+    std::string testPath;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    std::vector<std::string> paths;
+    for (int index = 1; index < argc; ++index) {
+        const std::string argument = argv[index];
+        if (argument == "--sample-rate" && index + 1 < argc) {
+            options.sampleRate = std::atoi(argv[++index]);
+        } else if (argument == "--max-offset-ms" && index + 1 < argc) {
+            options.maxOffsetMs = std::atof(argv[++index]);
+        } else if (!argument.empty() && argument[0] != '-') {
+            paths.push_back(argument);
+        } else {
+            paths.clear();
+            break;
+        }
+    }
+    if (paths.size() != 2 || options.sampleRate <= 0 || options.maxOffsetMs < 0.0) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--sample-rate 48000] [--max-offset-ms 1000] reference.pcm test.pcm\n";
+        return false;
+    }
+    options.referencePath = paths[0];
+    options.testPath = paths[1];
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 2;
+
+    std::vector<int16_t> reference;
+    std::vector<int16_t> test;
+    int32_t testSampleRate = options.sampleRate;
+    if (!tapstory::readPcm16Input(options.referencePath, reference, options.sampleRate)) {
+        std::cerr << "Failed to read " << options.referencePath << "\n";
+        return 1;
+    }
+    if (!tapstory::readPcm16Input(options.testPath, test, testSampleRate)) {
+        std::cerr << "Failed to read " << options.testPath << "\n";
+        return 1;
+    }
+    if (testSampleRate != options.sampleRate) {
+        std::cerr << "Sample rates differ: " << options.sampleRate << " and "
+                  << testSampleRate << "\n";
+        return 1;
+    }
+
+    const auto maxOffset = static_cast<int64_t>(options.maxOffsetMs * options.sampleRate / 1'000.0);
+    const tapstory::OffsetEstimate estimate = tapstory::estimateAudioOffset(
+            reference.data(), reference.size(), test.data(), test.size(), maxOffset);
+    std::cout.precision(6);
+    std::cout << std::fixed
+              << "{\"offsetSamples\": " << estimate.offsetSamples
+              << ", \"fractionalOffsetSamples\": " << estimate.fractionalOffsetSamples
+              << ", \"offsetMs\": "
+              << estimate.fractionalOffsetSamples * 1'000.0 / options.sampleRate
+              << ", \"confidence\": " << estimate.confidence << "}\n";
+    return 0;
+}
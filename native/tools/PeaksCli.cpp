@@ -0,0 +1,83 @@
+// tapstory-peaks: precompute the waveform peak pyramid of an uploaded segment.
+//
+// Input is a WAV file (channels are averaged) or raw little-endian 16-bit mono
+// PCM, e.g. from
+//   ffmpeg -i take.m4a -ac 1 -ar 48000 -f s16le take.pcm
+// A WAV header's sample rate overrides --sample-rate.
+// The peak file format is documented with encodePeakFile in
+// audio/PeakPyramid.h. A one-line JSON summary is printed on stdout.
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "audio/PeakPyramid.h"
+#include "tools/RawPcm.h"
+
+namespace {
+
+struct Options {
+    int32_t sampleRate = 48'000;
+    std::string inputPath;
+    std::string outputPath;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    std::vector<std::string> paths;
+    for (int index = 1; index < argc; ++index) {
+        const std::string argument = argv[index];
+        if (argument == "--sample-rate" && index + 1 < argc) {
+            options.sampleRate = std::atoi(argv[++index]);
+        } else if (!argument.empty() && argument[0] != '-') {
+            paths.push_back(argument);
+        } else {
+            paths.clear();
+            break;
+        }
+    }
+    if (paths.size() != 2 || options.sampleRate <= 0) {
+        std::cerr << "usage: " << argv[0] << " [--sample-rate 48000] input.pcm output.peaks\n";
+        return false;
+    }
+    options.inputPath = paths[0];
+    options.outputPath = paths[1];
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 2;
+
+    std::vector<int16_t> samples;
+    if (!tapstory::readPcm16Input(options.inputPath, samples, options.sampleRate)) {
+        std::cerr << "Failed to read " << options.inputPath << "\n";
+        return 1;
+    }
+
+    tapstory::PeakPyramid peaks(static_cast<int64_t>(samples.size()));
+    peaks.append(samples.data(), samples.size());
+    peaks.finish();
+    const std::vector<uint8_t> file = tapstory::encodePeakFile(peaks, options.sampleRate);
+
+    std::ofstream output(options.outputPath, std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+    output.close();
+    if (!output) {
+        std::cerr << "Failed to write " << options.outputPath << "\n";
+        return 1;
+    }
+
+    std::cout << "{\"frames\": " << peaks.frameCount() << ", \"levels\": [";
+    for (size_t index = 0; index < tapstory::PeakPyramid::kLevelCount; ++index) {
+        const tapstory::PeakPyramid::Level level = peaks.level(index);
+        std::cout << (index > 0 ? ", " : "")
+                  << "{\"framesPerBin\": " << level.framesPerBin
+                  << ", \"bins\": " << level.binCount << "}";
+    }
+    std::cout << "], \"bytes\": " << file.size() << "}\n";
+    return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "audio/WavReader.h"
+
+namespace tapstory {
+
+/** Read raw little-endian 16-bit PCM, e.g. `ffmpeg ... -f s16le out.pcm`. */
+inline bool readRawPcm16(const std::string &path, std::vector<int16_t> &samples) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    const std::vector<char> bytes{std::istreambuf_iterator<char>(file), {}};
+    samples.resize(bytes.size() / 2);
+    for (size_t index = 0; index < samples.size(); ++index) {
+        const auto low = static_cast<uint8_t>(bytes[index * 2]);
+        const auto high = static_cast<uint8_t>(bytes[index * 2 + 1]);
+        samples[index] = static_cast<int16_t>(static_cast<uint16_t>(low | (high << 8)));
+    }
+    return true;
+}
+
+/**
+ * Read a WAV file as mono PCM16, taking `sampleRate` from its header, or any
+ * other file as raw PCM16 at the given `sampleRate`.
+ */
+inline bool readPcm16Input(
+        const std::string &path,
+        std::vector<int16_t> &samples,
+        int32_t &sampleRate) {
+    WavReader reader;
+    if (!reader.open(path)) return readRawPcm16(path, samples);
+    samples.resize(static_cast<size_t>(reader.frameCount()));
+    reader.readMonoPcm16(0, samples.data(), samples.size());
+    sampleRate = reader.format().sampleRate;
+    return true;
+}
+
+}  // namespace tapstory